@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "benchmarks.h"
+#include "input_recorder.h"
+#include "replay_runner.h"
+
+namespace {
+	size_t scaled(const BenchOptions& options, size_t count) {
+		return options.quick ? count / 10 : count;
+	}
+
+	template<typename T> void print(const std::vector<T>& reports) {
+		for (const T& report : reports) fputs(formatReport(report).c_str(), stdout);
+	}
+
+	void replay(const BenchOptions& options) {
+		if (!options.recording.empty()) {
+			std::vector<RecordedFrame> frames;
+			if (!loadRecording(options.recording, frames)) {
+				fprintf(stderr, "couldn't read %s\n", options.recording.c_str());
+				return;
+			}
+			print(std::vector<ReplayReport>{ runReplay(options.recording, frames) });
+			return;
+		}
+		print(std::vector<ReplayReport>{
+			runReplay("synthetic, 200 strokes of 200 points", syntheticSession(scaled(options, 200), 200)),
+			runReplay("synthetic, 2000 strokes of 50 points", syntheticSession(scaled(options, 2000), 50))
+		});
+	}
+
+	void view(const BenchOptions& options) {
+		print(runViewBenchmarks(scaled(options, 1000000)));
+	}
+
+	void layers(const BenchOptions& options) {
+		print(runLayerBenchmarks(4, scaled(options, 1000000)));
+	}
+
+	void shapes(const BenchOptions& options) {
+		print(runShapeBenchmarks(scaled(options, 1000)));
+	}
+
+	void storage(const BenchOptions& options) {
+		print(runStorageBenchmarks(scaled(options, 1000000)));
+	}
+
+	void syncHost(const BenchOptions& options) {
+		print(runSyncBenchmark(true, options.port, 0, 0, 250));
+	}
+
+	void syncJoin(const BenchOptions& options) {
+		print(runSyncBenchmark(false, options.port, scaled(options, 2000), scaled(options, 20000), 250));
+	}
+
+	struct Suite {
+		const char* name;
+		const char* description;
+		void (*run)(const BenchOptions& options);
+		bool byDefault;  // the sync ends need another process, so they only run when asked for
+	};
+
+	const Suite SUITES[] = {
+		{ "document", "appending, reading and looking up strokes on boards of millions of points", documentBenchmarks, true },
+		{ "history", "commit latency and memory of the delta history against full snapshots", historyBenchmarks, true },
+		{ "ingest", "per-sample cost of taking points into the active stroke on boards of 1k to 10M points", ingestBenchmarks, true },
+		{ "input", "samples a frame and their latency through the sample queue, from a replayed mouse and pen", inputBenchmarks, true },
+		{ "frame", "frame builds over 100k committed segments from the cache against a line per segment", frameBenchmarks, true },
+		{ "replay", "frame builds replaying synthetic sessions, or --recording", replay, true },
+		{ "view", "culling and level of detail on a million point board", view, true },
+		{ "layers", "switching, hiding and clearing layers of a million points each", layers, true },
+		{ "shapes", "shape recognition throughput and accuracy", shapes, true },
+		{ "simplify", "points kept and throughput of simplification and smoothing, over --recording or synthetic strokes", simplifyBenchmarks, true },
+		{ "spatial", "radius and rectangle queries through the index against a linear scan, and the pixel eraser", spatialBenchmarks, true },
+		{ "tessellate", "stroke meshes from the tessellator against AddLine per segment and AddPolyline", tessellationBenchmarks, true },
+		{ "storage", "bytes per point and unpacking throughput of committed strokes", storage, true },
+		{ "board", "saving, loading and recovering board files of 100k to 10M points", boardBenchmarks, true },
+		{ "sync-host", "the hosting end of the loopback sync benchmark, start it first", syncHost, false },
+		{ "sync-join", "the joining end of the loopback sync benchmark", syncJoin, false }
+	};
+
+	void usage() {
+		printf("wb_bench [--quick] [--recording <file>] [--port <port>] [suite...]\n");
+		printf("Runs every suite but the sync ones when none are named\n");
+		for (const Suite& suite : SUITES) printf("  %-10s %s\n", suite.name, suite.description);
+	}
+}
+
+/**
+* Headless benchmarks of the core, each suite prints its reports to stdout
+*/
+int main(int argc, char** argv) {
+	BenchOptions options;
+	std::vector<const Suite*> wanted;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0) options.quick = true;
+		else if (strcmp(argv[i], "--recording") == 0 && i + 1 < argc) options.recording = argv[++i];
+		else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) options.port = (uint16_t) atoi(argv[++i]);
+		else {
+			const Suite* found = nullptr;
+			for (const Suite& suite : SUITES) {
+				if (strcmp(argv[i], suite.name) == 0) found = &suite;
+			}
+			if (!found) {
+				usage();
+				return 1;
+			}
+			wanted.push_back(found);
+		}
+	}
+	if (wanted.empty()) {
+		for (const Suite& suite : SUITES) {
+			if (suite.byDefault) wanted.push_back(&suite);
+		}
+	}
+
+	for (const Suite* suite : wanted) {
+		printf("== %s\n", suite->name);
+		fflush(stdout);
+		suite->run(options);
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <cstdint>
+#include <string>
+#include "sync_session.h"
+
+/**
+* What every suite of wb_bench gets from the command line
+*/
+struct BenchOptions {
+	std::string recording;  // a session recorded with --record, for the suites that replay one
+	bool quick = false;  // boards a tenth the size, to check the suites still run rather than to get numbers
+	uint16_t port = DEFAULT_SYNC_PORT;
+};
+
+// Suites that live in their own files, each prints its own report
+void boardBenchmarks(const BenchOptions& options);
+void documentBenchmarks(const BenchOptions& options);
+void frameBenchmarks(const BenchOptions& options);
+void historyBenchmarks(const BenchOptions& options);
+void ingestBenchmarks(const BenchOptions& options);
+void inputBenchmarks(const BenchOptions& options);
+void spatialBenchmarks(const BenchOptions& options);
+void simplifyBenchmarks(const BenchOptions& options);
+void tessellationBenchmarks(const BenchOptions& options);
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include <imgui/imgui.h>
+#include "benchmarks.h"
+#include "board_file.h"
+#include "stroke_document.h"
+
+namespace {
+	const uint32_t POINTS_PER_STROKE = 250;
+	// Loads timed for each board, the fastest is reported so a cold page cache on the first doesn't count
+	const int LOADS = 3;
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/**
+	* A board of pointCount points in strokes of POINTS_PER_STROKE, a pen wandering a couple of pixels a sample
+	*/
+	void fillBoard(size_t pointCount, StrokeDocument& document, std::mt19937& rng) {
+		std::vector<ImVec2> points;
+		int side = (int) std::max(1000.0, std::sqrt((double) pointCount) * 8.0);
+		while (document.pointCount() < pointCount) {
+			ImVec2 point{ (float) (rng() % side), (float) (rng() % side) };
+			points.clear();
+			for (uint32_t i = 0; i < POINTS_PER_STROKE && document.pointCount() + i < pointCount; i++) {
+				point = { point.x + (float) (int) (rng() % 9) * 0.5f - 2.f, point.y + (float) (int) (rng() % 9) * 0.5f - 2.f };
+				points.push_back(point);
+			}
+			document.addStroke({ IM_COL32(0, 0, 0, 255), 2.f }, points.data(), (uint32_t) points.size());
+		}
+	}
+
+	void removeBoard(const std::string& path) {
+		std::error_code error;
+		for (const char* suffix : { "", ".journal", ".journal.old", ".tmp" }) std::filesystem::remove(path + suffix, error);
+	}
+}
+
+/**
+* Saving and loading boards of 100k to 10M points, and opening one after a crash with the whole board still in the
+* journal, what the first start after a long session that never compacted would take
+*/
+void boardBenchmarks(const BenchOptions& options) {
+	const size_t boards[] = { 100000, 1000000, 10000000 };
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::string path = (directory / "wb_bench_board.wbd").string();
+	std::string crashed = (directory / "wb_bench_crashed.wbd").string();
+
+	for (size_t board : boards) {
+		size_t pointCount = options.quick ? board / 10 : board;
+		std::mt19937 rng(1);
+		StrokeDocument document;
+		fillBoard(pointCount, document, rng);
+		printf("board file, %zu points in %zu strokes\n", document.pointCount(), document.strokes().size());
+
+		auto start = std::chrono::steady_clock::now();
+		if (!writeBoard(path, document)) {
+			fprintf(stderr, "couldn't write %s\n", path.c_str());
+			return;
+		}
+		double saveSeconds = secondsSince(start);
+		uintmax_t size = std::filesystem::file_size(path);
+		printf("  %-13s%.1f ms, %.2f bytes a point\n", "save", saveSeconds * 1e3, (double) size / pointCount);
+
+		double loadSeconds = 1e9;
+		for (int load = 0; load < LOADS; load++) {
+			StrokeDocument loaded;
+			start = std::chrono::steady_clock::now();
+			readBoard(path, loaded);
+			loadSeconds = std::min(loadSeconds, secondsSince(start));
+		}
+		printf("  %-13s%.1f ms, %.1f M points/s\n", "load", loadSeconds * 1e3, pointCount / loadSeconds / 1e6);
+
+		// Every stroke journaled as it was drawn and nothing folded in yet, then the process gone
+		removeBoard(path);
+		removeBoard(crashed);
+		{
+			StrokeDocument journaled;
+			BoardSession session(journaled);
+			if (!session.open(path)) return;
+			std::vector<ImVec2> points;
+			for (const Stroke& stroke : document.strokes()) {
+				document.copyPoints(stroke, points);
+				journaled.addStroke(stroke.style, points.data(), stroke.count, stroke.shape);
+			}
+			std::filesystem::copy_file(path, crashed);
+			std::filesystem::copy_file(path + ".journal", crashed + ".journal");
+			printf("  %-13s%.2f bytes a point\n", "journal", (double) session.journalSize() / pointCount);
+			session.discard();
+		}
+
+		StrokeDocument recovered;
+		BoardSession recovery(recovered);
+		start = std::chrono::steady_clock::now();
+		recovery.open(crashed);
+		printf("  %-13s%.1f ms to replay the journal and fold it into the board\n", "recover", secondsSince(start) * 1e3);
+		recovery.discard();
+	}
+	removeBoard(path);
+	removeBoard(crashed);
+}
@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "benchmarks.h"
+#include "stroke_document.h"
+
+namespace {
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+/**
+* Appending, reading back and looking up the style of strokes of 250 points, on boards of 1M and 4M points
+*/
+void documentBenchmarks(const BenchOptions& options) {
+	const uint32_t pointsPerStroke = 250;
+	const size_t boards[] = { options.quick ? 100000u : 1000000u, options.quick ? 400000u : 4000000u };
+
+	for (size_t pointCount : boards) {
+		StrokeDocument document;
+		std::mt19937 rng(1);
+		size_t strokes = pointCount / pointsPerStroke;
+
+		// Made up before timing, so the numbers are the document's alone
+		std::vector<std::vector<ImVec2>> paths(64);
+		for (std::vector<ImVec2>& path : paths) {
+			ImVec2 point{ (float) (rng() % 20000), (float) (rng() % 20000) };
+			for (uint32_t i = 0; i < pointsPerStroke; i++) {
+				point = { point.x + (float) (int) (rng() % 13) - 6.f, point.y + (float) (int) (rng() % 13) - 6.f };
+				path.push_back(point);
+			}
+		}
+
+		// Drawn the way the pen does it, a point at a time
+		auto start = std::chrono::steady_clock::now();
+		for (size_t s = 0; s < strokes; s++) {
+			document.beginStroke({ IM_COL32(s & 0xFF, 0, 0, 255), 2.f + (float) (s % 10) });
+			for (ImVec2 point : paths[s % paths.size()]) document.appendPoint(point);
+			document.endStroke();
+		}
+		double appendSeconds = secondsSince(start);
+
+		std::vector<float> xs, ys;
+		float sum = 0.f;
+		start = std::chrono::steady_clock::now();
+		for (const Stroke& stroke : document.strokes()) {
+			document.readPoints(stroke, xs, ys);
+			sum += xs.back();
+		}
+		double iterateSeconds = secondsSince(start);
+
+		// What drawing the board used to do, a style per stroke in drawing order, and looking strokes up by id
+		start = std::chrono::steady_clock::now();
+		for (const Stroke& stroke : document.strokes()) sum += stroke.style.thickness + (float) (stroke.style.colour & 0xFF);
+		double walkSeconds = secondsSince(start);
+
+		std::vector<StrokeId> ids(1000000);
+		for (StrokeId& id : ids) id = 1 + rng() % document.strokes().back().id;
+		const size_t lookups = ids.size();
+		start = std::chrono::steady_clock::now();
+		for (StrokeId id : ids) {
+			const Stroke* stroke = document.find(id);
+			if (stroke) sum += stroke->style.thickness;
+		}
+		double findSeconds = secondsSince(start);
+
+		printf("stroke document, %zu strokes of %u points (%zu points)\n"
+			"  append       %.1f ns per point, begin / append / end\n"
+			"  iterate      %.0f M points/s unpacked with readPoints\n"
+			"  style        %.2f ns per stroke walking strokes(), %.1f ns per find(id)\n"
+			"  memory       %.2f bytes per point, %.1f KB in all (checksum %.0f)\n",
+			strokes, pointsPerStroke, document.pointCount(),
+			appendSeconds * 1e9 / document.pointCount(),
+			document.pointCount() / iterateSeconds / 1e6,
+			walkSeconds * 1e9 / strokes, findSeconds * 1e9 / lookups,
+			(double) document.memoryUsage() / document.pointCount(), document.memoryUsage() / 1024.0, sum);
+	}
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include <imgui/imgui.h>
+#include "benchmarks.h"
+#include "whiteboard.h"
+
+namespace {
+	const ImVec2 DISPLAY_SIZE{ 2560.f, 1440.f };
+	// One frame at 144 Hz, what a cached frame build has to fit in with room to spare
+	const double FRAME_BUDGET_MS = 1000.0 / 144.0;
+	const size_t SEGMENTS_PER_STROKE = 250;
+	const int FRAMES = 60;
+
+	/**
+	* An ImGui context with no platform or renderer behind it, the previous context comes back when it goes
+	*/
+	class HeadlessContext {
+	public:
+		HeadlessContext() : previous(ImGui::GetCurrentContext()), context(ImGui::CreateContext()) {
+			ImGui::SetCurrentContext(context);
+			ImGuiIO& io = ImGui::GetIO();
+			io.IniFilename = nullptr;
+			io.DisplaySize = DISPLAY_SIZE;
+			io.DeltaTime = 1.f / 144.f;
+			io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+			unsigned char* pixels = nullptr;
+			int width = 0, height = 0;
+			io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+		}
+
+		~HeadlessContext() {
+			ImGui::DestroyContext(context);
+			ImGui::SetCurrentContext(previous);
+		}
+
+		HeadlessContext(const HeadlessContext&) = delete;
+		HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	private:
+		ImGuiContext* previous;
+		ImGuiContext* context;
+	};
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double median(std::vector<double> times) {
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	// Wandering strokes over one screen, kept as the points they were drawn with
+	std::vector<std::vector<ImVec2>> wanderingStrokes(size_t strokeCount) {
+		std::mt19937 rng(4);
+		auto uniform = [&](float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); };
+		std::vector<std::vector<ImVec2>> strokes(strokeCount);
+		for (std::vector<ImVec2>& points : strokes) {
+			ImVec2 point{ uniform(100.f, DISPLAY_SIZE.x - 100.f), uniform(100.f, DISPLAY_SIZE.y - 100.f) };
+			float heading = uniform(0.f, 6.2831853f);
+			for (size_t i = 0; i <= SEGMENTS_PER_STROKE; i++) {
+				heading += uniform(-0.3f, 0.3f);
+				point = { std::clamp(point.x + 4.f * std::cos(heading), 0.f, DISPLAY_SIZE.x), std::clamp(point.y + 4.f * std::sin(heading), 0.f, DISPLAY_SIZE.y) };
+				points.push_back(point);
+			}
+		}
+		return strokes;
+	}
+
+	double buildFrame(Whiteboard& board, const FrameInput& input) {
+		auto start = std::chrono::steady_clock::now();
+		ImGui::NewFrame();
+		board.update(input);
+		board.draw(ImGui::GetBackgroundDrawList(), input);
+		ImGui::Render();
+		return millisecondsSince(start);
+	}
+}
+
+/**
+* Frame builds over a board of committed strokes all on screen, from the baked cache against an AddLine per segment,
+* and whether the cached ones fit a frame at 144 Hz
+*/
+void frameBenchmarks(const BenchOptions& options) {
+	HeadlessContext context;
+	size_t strokeCount = options.quick ? 40 : 400;
+	std::vector<std::vector<ImVec2>> strokes = wanderingStrokes(strokeCount);
+	auto board = std::make_unique<Whiteboard>();
+	board->view.size = DISPLAY_SIZE;
+	StrokeDocument& document = board->layers.active().contents().document;
+	for (const std::vector<ImVec2>& points : strokes) document.addStroke({ IM_COL32(255, 0, 0, 255), 3.f }, points.data(), (uint32_t) points.size());
+
+	// Baked until the board is drawn from its 1:1 cache
+	FrameInput input;
+	for (int frame = 0; frame < 100 && board->layers.active().peek().cache.drawnLevel() != 0; frame++) buildFrame(*board, input);
+	std::vector<double> cached;
+	for (int frame = 0; frame < FRAMES; frame++) cached.push_back(buildFrame(*board, input));
+
+	std::vector<double> perSegment;
+	for (int frame = 0; frame < FRAMES / 6; frame++) {
+		auto start = std::chrono::steady_clock::now();
+		ImGui::NewFrame();
+		ImDrawList* drawList = ImGui::GetBackgroundDrawList();
+		for (const std::vector<ImVec2>& points : strokes) {
+			for (size_t i = 1; i < points.size(); i++) drawList->AddLine(points[i - 1], points[i], IM_COL32(255, 0, 0, 255), 3.f);
+		}
+		ImGui::Render();
+		perSegment.push_back(millisecondsSince(start));
+	}
+
+	printf("frame build, %zu committed segments on screen\n", strokeCount * SEGMENTS_PER_STROKE);
+	printf("  %-17s%.2f ms median, %s the %.2f ms of a frame at 144 Hz\n", "cached", median(cached), median(cached) < FRAME_BUDGET_MS ? "within" : "OVER", FRAME_BUDGET_MS);
+	printf("  %-17s%.2f ms median\n", "line per segment", median(perSegment));
+}
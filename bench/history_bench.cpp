@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+#include <imgui/imgui.h>
+#include "benchmarks.h"
+#include "history.h"
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace {
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double percentile(std::vector<double> times, double p) {
+		if (times.empty()) return 0.0;
+		std::sort(times.begin(), times.end());
+		return times[std::min(times.size() - 1, (size_t) (p * (times.size() - 1) + 0.5))];
+	}
+
+	// The process's resident set right now, 0 where /proc isn't there to ask
+	size_t residentBytes() {
+#ifdef __linux__
+		FILE* file = fopen("/proc/self/statm", "r");
+		if (!file) return 0;
+		size_t pages = 0, resident = 0;
+		int read = fscanf(file, "%zu %zu", &pages, &resident);
+		fclose(file);
+		return read == 2 ? resident * (size_t) sysconf(_SC_PAGESIZE) : 0;
+#else
+		return 0;
+#endif
+	}
+
+	/**
+	* The undo history the board used to keep, a copy of every point and both style tables per stroke committed
+	*/
+	struct MemoryState {
+		ImVector<ImVec2> drawn;
+		std::map<int, ImU32> colours;
+		std::map<int, float> thicknesses;
+	};
+
+	struct SchemeReport {
+		std::vector<double> commitMs;
+		size_t peakResident = 0;
+		size_t historyBytes = 0;
+	};
+
+	void print(const char* name, size_t strokes, const SchemeReport& report) {
+		double total = 0.0;
+		for (double time : report.commitMs) total += time;
+		printf("history, %s, %zu strokes\n"
+			"  commit       mean %.4f ms, p50 %.4f ms, p99 %.4f ms, first %.4f ms, last %.4f ms\n"
+			"  memory       %.1f KB held by the history, resident grew by %.1f KB at its peak\n",
+			name, strokes,
+			total / report.commitMs.size(), percentile(report.commitMs, 0.5), percentile(report.commitMs, 0.99), report.commitMs.front(), report.commitMs.back(),
+			report.historyBytes / 1024.0, report.peakResident / 1024.0);
+	}
+}
+
+/**
+* Commits strokes of 100 points one at a time, into a delta History and into the full board snapshots it replaced
+* The delta history goes first, so memory the snapshots free and the allocator keeps can't be counted in its favour
+*/
+void historyBenchmarks(const BenchOptions& options) {
+	const size_t strokes = options.quick ? 150 : 600;
+	const uint32_t pointsPerStroke = 100;
+	std::mt19937 rng(1);
+	std::vector<ImVec2> points;
+	for (uint32_t i = 0; i < pointsPerStroke; i++) points.push_back({ (float) (rng() % 2000), (float) (rng() % 1000) });
+	const DrawingSettings settings{ { 1.f, 0.f, 0.f, 1.f }, 5.f };
+
+	SchemeReport delta;
+	{
+		size_t baseline = residentBytes();
+		StrokeDocument document;
+		History history(settings, SIZE_MAX);
+		for (size_t s = 0; s < strokes; s++) {
+			auto start = std::chrono::steady_clock::now();
+			HistoryEntry entry;
+			entry.added.push_back(document.addStroke({ IM_COL32(255, 0, 0, 255), 5.f }, points.data(), pointsPerStroke));
+			entry.settings = settings;
+			history.commit(std::move(entry));
+			delta.commitMs.push_back(secondsSince(start) * 1e3);
+			delta.peakResident = std::max(delta.peakResident, residentBytes() - std::min(baseline, residentBytes()));
+		}
+		delta.historyBytes = history.memoryUsage();
+	}
+	print("deltas (History)", strokes, delta);
+
+	SchemeReport snapshots;
+	{
+		size_t baseline = residentBytes();
+		MemoryState board;
+		std::vector<MemoryState> history;
+		for (size_t s = 0; s < strokes; s++) {
+			auto start = std::chrono::steady_clock::now();
+			board.colours[board.drawn.Size] = IM_COL32(255, 0, 0, 255);
+			board.thicknesses[board.drawn.Size] = 5.f;
+			for (ImVec2 point : points) board.drawn.push_back(point);
+			board.drawn.push_back({ -1.f, -1.f });
+			history.push_back(board);
+			snapshots.commitMs.push_back(secondsSince(start) * 1e3);
+			snapshots.peakResident = std::max(snapshots.peakResident, residentBytes() - std::min(baseline, residentBytes()));
+		}
+		for (const MemoryState& state : history) {
+			// Map nodes hold the key, the value and about 32 bytes of tree
+			snapshots.historyBytes += sizeof(MemoryState) + state.drawn.Capacity * sizeof(ImVec2) + (state.colours.size() + state.thicknesses.size()) * 48;
+		}
+	}
+	print("full snapshots (MemoryState)", strokes, snapshots);
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <imgui/imgui.h>
+#include "benchmarks.h"
+#include "ingest.h"
+#include "stroke_document.h"
+
+namespace {
+	// Samples are timed in batches this big, a single accept is too short for the clock
+	const size_t BATCH = 64;
+	// The whole-board scan only gets as many samples as add up to this many comparisons, so the 10M board doesn't take minutes
+	const size_t SCAN_POINTS = 200000000;
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double percentile(std::vector<double> times, double p) {
+		if (times.empty()) return 0.0;
+		std::sort(times.begin(), times.end());
+		return times[std::min(times.size() - 1, (size_t) (p * (times.size() - 1) + 0.5))];
+	}
+
+	/**
+	* A board of pointCount points in strokes of 250, at the same density whatever its size
+	* The flat copy is what the frame loop used to scan
+	*/
+	void fillBoard(size_t pointCount, StrokeDocument& document, std::vector<ImVec2>& drawn, std::mt19937& rng) {
+		const uint32_t pointsPerStroke = 250;
+		int side = (int) std::max(1000.0, std::sqrt((double) pointCount) * 8.0);
+		drawn.reserve(pointCount);
+		while (document.pointCount() < pointCount) {
+			ImVec2 point{ (float) (rng() % side), (float) (rng() % side) };
+			document.beginStroke({ IM_COL32(0, 0, 0, 255), 2.f });
+			for (uint32_t i = 0; i < pointsPerStroke && document.pointCount() < pointCount; i++) {
+				point = { point.x + (float) (int) (rng() % 7) - 3.f, point.y + (float) (int) (rng() % 7) - 3.f };
+				document.appendPoint(point);
+				drawn.push_back(point);
+			}
+			document.endStroke();
+		}
+	}
+
+	// Time per sample of each batch, in ns
+	std::vector<double> timeIngest(PointIngestor& ingestor, const std::vector<ImVec2>& samples, size_t& accepted) {
+		std::vector<double> batches;
+		double time = 0.0;
+		ingestor.begin();
+		for (size_t start = 0; start + BATCH <= samples.size(); start += BATCH) {
+			auto clock = std::chrono::steady_clock::now();
+			for (size_t i = start; i < start + BATCH; i++) {
+				time += 1.0 / 240.0;
+				if (ingestor.accept(samples[i], time)) accepted++;
+			}
+			batches.push_back(secondsSince(clock) * 1e9 / BATCH);
+		}
+		return batches;
+	}
+
+	void printIngest(const char* name, const std::vector<double>& batches, size_t accepted, size_t samples) {
+		double total = 0.0;
+		for (double time : batches) total += time;
+		printf("  %-13s%.1f ns per sample mean, p50 %.1f ns, p99 %.1f ns, %zu of %zu taken\n",
+			name, total / batches.size(), percentile(batches, 0.5), percentile(batches, 0.99), accepted, samples);
+	}
+}
+
+/**
+* Per-sample cost of taking pointer samples into the active stroke, on boards of 1k to 10M points
+* Against the last sample only and with the global hash, next to the whole-board scan ingestion used to do
+*/
+void ingestBenchmarks(const BenchOptions& options) {
+	const size_t boards[] = { 1000, 10000, 100000, 1000000, 10000000 };
+	const size_t sampleCount = options.quick ? 16384 : 262144;
+
+	for (size_t pointCount : boards) {
+		if (options.quick && pointCount > 1000000) continue;
+		std::mt19937 rng(1);
+		StrokeDocument document;
+		std::vector<ImVec2> drawn;
+		fillBoard(pointCount, document, drawn, rng);
+
+		// A pen moving a couple of pixels a sample, wandering over the old ink
+		int side = (int) std::max(1000.0, std::sqrt((double) pointCount) * 8.0);
+		std::vector<ImVec2> samples(sampleCount);
+		ImVec2 pen{ side * 0.5f, side * 0.5f };
+		for (ImVec2& sample : samples) {
+			pen = { std::clamp(pen.x + (float) (int) (rng() % 5) - 2.f, 0.f, (float) side), std::clamp(pen.y + (float) (int) (rng() % 5) - 2.f, 0.f, (float) side) };
+			sample = pen;
+		}
+
+		printf("ingest, board of %zu points, %zu samples\n", document.pointCount(), samples.size());
+
+		PointIngestor local;
+		size_t accepted = 0;
+		std::vector<double> localBatches = timeIngest(local, samples, accepted);
+		printIngest("last sample", localBatches, accepted, samples.size());
+
+		PointIngestor global(IngestSettings{ 1.f, 0.0, true, 1.f });
+		auto start = std::chrono::steady_clock::now();
+		global.rebuild(document);
+		double rebuildSeconds = secondsSince(start);
+		accepted = 0;
+		std::vector<double> globalBatches = timeIngest(global, samples, accepted);
+		printIngest("global hash", globalBatches, accepted, samples.size());
+		printf("  %-13s%.1f ms to hash the board\n", "rebuild", rebuildSeconds * 1e3);
+
+		// What every frame did while the button was down, only as many samples as keep this short
+		size_t scans = std::max<size_t>(1, std::min(samples.size(), SCAN_POINTS / drawn.size() / (options.quick ? 10 : 1)));
+		accepted = 0;
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < scans; i++) {
+			bool found = false;
+			for (ImVec2 point : drawn) {
+				if (point.x == samples[i].x && point.y == samples[i].y) {
+					found = true;
+					break;
+				}
+			}
+			if (!found) accepted++;
+		}
+		printf("  %-13s%.1f ns per sample over %zu samples, %zu of them taken\n", "board scan", secondsSince(start) * 1e9 / scans, scans, accepted);
+	}
+}
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "benchmarks.h"
+#include "input_source.h"
+
+namespace {
+	// How often the render loop drains the queue, a frame at 144 Hz
+	const double FRAME_SECONDS = 1.0 / 144.0;
+
+	/**
+	* A pen circling at rate samples a second for the given time, with the button down throughout
+	*/
+	std::vector<PointerSample> pen(double rate, double seconds) {
+		std::vector<PointerSample> samples;
+		for (size_t i = 0; i < (size_t) (rate * seconds); i++) {
+			double t = i / rate;
+			samples.push_back({ 500.f + 300.f * (float) std::cos(t * 6.0), 500.f + 300.f * (float) std::sin(t * 6.0), 1.f, POINTER_LEFT, t });
+		}
+		return samples;
+	}
+}
+
+/**
+* Samples replayed at a mouse's and a fast pen's rate through the queue, drained once a frame like the render loop does,
+* reporting how many come in a frame and how long they waited to be taken in
+*/
+void inputBenchmarks(const BenchOptions& options) {
+	const double rates[] = { 1000.0, 8000.0 };
+	double seconds = options.quick ? 0.25 : 2.0;
+	std::vector<PointerSample> batch(4096);
+
+	for (double rate : rates) {
+		ReplaySource source;
+		source.setSamples(pen(rate, seconds));
+		SampleQueue queue;
+		InputStats stats;
+		size_t frames = 0;
+		double latencies = 0.0;
+		source.start(queue);
+		auto next = std::chrono::steady_clock::now();
+		while (!source.finished() || queue.size() > 0) {
+			next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(FRAME_SECONDS));
+			std::this_thread::sleep_until(next);
+			double now = monotonicSeconds();
+			size_t count = queue.pop(batch.data(), batch.size());
+			for (size_t i = 0; i < count; i++) latencies += now - batch[i].time;
+			stats.frame(batch.data(), count, now);
+			frames++;
+		}
+		source.stop();
+
+		printf("input, %.0f samples a second for %.2f s drained at 144 Hz\n", rate, seconds);
+		printf("  %-11s%zu in %zu frames, %.1f a frame, %zu dropped\n", "samples", stats.totalSamples, frames, (double) stats.totalSamples / frames, queue.droppedCount());
+		printf("  %-11s%.2f ms mean, %.2f ms max from being taken to being drained\n", "latency", latencies / stats.totalSamples * 1e3, stats.maxLatency * 1e3);
+	}
+}
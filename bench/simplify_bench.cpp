@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <imgui/imgui.h>
+#include "benchmarks.h"
+#include "ingest.h"
+#include "input_recorder.h"
+#include "replay_runner.h"
+#include "simplify.h"
+#include "spatial_index.h"
+
+namespace {
+	// Timed passes over every stroke, the fastest is reported
+	const int PASSES = 5;
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/**
+	* The strokes the pen drew in a session, every run of left button samples through an ingestor
+	* Erasing is left out by following E through the tools the way the board does
+	*/
+	std::vector<std::vector<ImVec2>> strokesOf(const std::vector<RecordedFrame>& frames) {
+		std::vector<std::vector<ImVec2>> strokes;
+		std::vector<ImVec2> stroke;
+		PointIngestor ingestor;
+		int tool = 0;  // Tool::Pen, cycled through the erasers
+		auto finish = [&]() {
+			if (stroke.size() > 1) strokes.push_back(stroke);
+			stroke.clear();
+		};
+		for (const RecordedFrame& frame : frames) {
+			if (frame.input.cycleTool) tool = (tool + 1) % 3;
+			for (const PointerSample& sample : frame.samples) {
+				if (!(sample.buttons & POINTER_LEFT) || tool != 0) {
+					finish();
+					continue;
+				}
+				if (stroke.empty()) ingestor.begin();
+				if (ingestor.accept({ sample.x, sample.y }, sample.time)) stroke.push_back({ sample.x, sample.y });
+			}
+			if (!frame.input.leftDown) finish();
+		}
+		finish();
+		return strokes;
+	}
+
+	// What the board keeps of a stroke while it is drawn, before anything runs on release
+	void streamStroke(const std::vector<ImVec2>& in, float tolerance, std::vector<ImVec2>& out) {
+		StreamingSimplifier streamer;
+		streamer.begin();
+		out.clear();
+		for (ImVec2 point : in) {
+			if (streamer.push(point, tolerance) == StreamAction::ReplaceLast) out.back() = point;
+			else out.push_back(point);
+		}
+	}
+
+	// Furthest any point drawn is from the line kept
+	float maxDeviation(const std::vector<ImVec2>& drawn, const std::vector<ImVec2>& kept) {
+		float furthest = 0.f;
+		for (ImVec2 point : drawn) {
+			float nearest = FLT_MAX;
+			for (size_t i = 0; i + 1 < kept.size(); i++) nearest = std::min(nearest, segmentDistance(point, kept[i], kept[i + 1]));
+			if (kept.size() == 1) nearest = segmentDistance(point, kept[0], kept[0]);
+			furthest = std::max(furthest, nearest);
+		}
+		return furthest;
+	}
+
+	struct Pipeline {
+		const char* name;
+		bool streaming;
+		SimplifySettings settings;
+	};
+}
+
+/**
+* Points kept, throughput and how far the line moves for each simplification / smoothing pipeline, over the strokes of
+* --recording or of a synthetic session
+*/
+void simplifyBenchmarks(const BenchOptions& options) {
+	std::vector<RecordedFrame> frames;
+	std::string source = "synthetic session";
+	if (!options.recording.empty()) {
+		if (!loadRecording(options.recording, frames)) {
+			fprintf(stderr, "couldn't read %s\n", options.recording.c_str());
+			return;
+		}
+		source = options.recording;
+	}
+	else frames = syntheticSession(options.quick ? 20 : 200, 200);
+
+	std::vector<std::vector<ImVec2>> strokes = strokesOf(frames);
+	size_t drawnPoints = 0;
+	for (const std::vector<ImVec2>& stroke : strokes) drawnPoints += stroke.size();
+	if (strokes.empty()) {
+		printf("simplification, no strokes in %s\n", source.c_str());
+		return;
+	}
+
+	SimplifySettings defaults;
+	auto with = [&](SimplifyMethod method, SmoothMethod smoothing) {
+		SimplifySettings settings = defaults;
+		settings.method = method;
+		settings.smoothing = smoothing;
+		return settings;
+	};
+	const Pipeline pipelines[] = {
+		{ "streaming only", true, with(SimplifyMethod::None, SmoothMethod::None) },
+		{ "douglas-peucker", false, with(SimplifyMethod::DouglasPeucker, SmoothMethod::None) },
+		{ "visvalingam", false, with(SimplifyMethod::Visvalingam, SmoothMethod::None) },
+		{ "streaming, then douglas-peucker on release (the board's default)", true, with(SimplifyMethod::DouglasPeucker, SmoothMethod::None) },
+		{ "douglas-peucker, then chaikin", false, with(SimplifyMethod::DouglasPeucker, SmoothMethod::Chaikin) },
+		{ "douglas-peucker, then catmull-rom", false, with(SimplifyMethod::DouglasPeucker, SmoothMethod::CatmullRom) }
+	};
+
+	std::vector<ImVec2> streamed, kept;
+	for (const Pipeline& pipeline : pipelines) {
+		double fastest = 1e9;
+		size_t keptPoints = 0;
+		float deviation = 0.f;
+		for (int pass = 0; pass < (options.quick ? 1 : PASSES); pass++) {
+			keptPoints = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (const std::vector<ImVec2>& stroke : strokes) {
+				if (pipeline.streaming) {
+					streamStroke(stroke, defaults.tolerance, streamed);
+					processStroke(streamed, pipeline.settings, kept);
+				}
+				else processStroke(stroke, pipeline.settings, kept);
+				keptPoints += kept.size();
+			}
+			fastest = std::min(fastest, secondsSince(start));
+		}
+
+		// Measured apart from the timing, every point drawn is checked against the whole line kept
+		for (const std::vector<ImVec2>& stroke : strokes) {
+			if (pipeline.streaming) {
+				streamStroke(stroke, defaults.tolerance, streamed);
+				processStroke(streamed, pipeline.settings, kept);
+			}
+			else processStroke(stroke, pipeline.settings, kept);
+			deviation = std::max(deviation, maxDeviation(stroke, kept));
+		}
+
+		printf("simplification, %s, %zu strokes from %s\n"
+			"  kept         %zu of %zu points (%.1f%%)\n"
+			"  speed        %.1f M points/s\n"
+			"  moved        %.2f px at most, the tolerance is %.2f px\n",
+			pipeline.name, strokes.size(), source.c_str(),
+			keptPoints, drawnPoints, keptPoints * 100.0 / drawnPoints, drawnPoints / fastest / 1e6, deviation, defaults.tolerance);
+	}
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <imgui/imgui.h>
+#include "benchmarks.h"
+#include "eraser.h"
+#include "history.h"
+#include "spatial_index.h"
+#include "stroke_document.h"
+
+namespace {
+	const uint32_t POINTS_PER_STROKE = 250;
+	// Board area per segment in square pixels, so every board is as crowded as the others
+	const float AREA_PER_SEGMENT = 400.f;
+	// What the eraser covers by default, and a selection about a quarter of a screen across
+	const float ERASER_RADIUS = 15.f;
+	const float SELECTION_SIZE = 600.f;
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double percentile(std::vector<double> times, double p) {
+		if (times.empty()) return 0.0;
+		std::sort(times.begin(), times.end());
+		return times[std::min(times.size() - 1, (size_t) (p * (times.size() - 1) + 0.5))];
+	}
+
+	/**
+	* What a hit test over a flat list of segments has to look at, the way the board was kept before the index
+	*/
+	struct FlatSegment {
+		ImVec2 a;
+		ImVec2 b;
+		float pad;
+	};
+
+	void wander(std::vector<ImVec2>& points, float side, std::mt19937& rng) {
+		auto uniform = [&](float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); };
+		points.clear();
+		ImVec2 point{ uniform(0.f, side), uniform(0.f, side) };
+		float heading = uniform(0.f, 6.2831853f);
+		for (uint32_t i = 0; i < POINTS_PER_STROKE; i++) {
+			heading += uniform(-0.3f, 0.3f);
+			point = { point.x + 6.f * std::cos(heading), point.y + 6.f * std::sin(heading) };
+			points.push_back(point);
+		}
+	}
+
+	void printQueries(const char* name, double indexSeconds, double scanSeconds, size_t queries, size_t indexHits, size_t scanHits) {
+		printf("  %-13s%.2f us indexed, %.1f us scanning (%.1fx), %.1f hits a query%s\n",
+			name, indexSeconds * 1e6 / queries, scanSeconds * 1e6 / queries, scanSeconds / indexSeconds, (double) indexHits / queries,
+			indexHits == scanHits ? "" : " (the scan found a different number)");
+	}
+}
+
+/**
+* Radius and rectangle queries through the spatial index against a scan of every segment, on boards of 10k, 100k and 1M
+* segments, then the pixel eraser dragged across the biggest board a sample at a time
+*/
+void spatialBenchmarks(const BenchOptions& options) {
+	const size_t boards[] = { 10000, 100000, 1000000 };
+	const size_t queryCount = options.quick ? 100 : 500;
+
+	for (size_t segmentCount : boards) {
+		if (options.quick && segmentCount > 100000) continue;
+		std::mt19937 rng(1);
+		float side = std::sqrt(segmentCount * AREA_PER_SEGMENT);
+		StrokeDocument document;
+		std::vector<ImVec2> points;
+		for (size_t added = 0; added < segmentCount; added += POINTS_PER_STROKE - 1) {
+			wander(points, side, rng);
+			document.addStroke({ IM_COL32(255, 255, 255, 255), 2.f + 6.f * (float) (rng() >> 8) / (float) (1u << 24) }, points.data(), POINTS_PER_STROKE);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		SpatialIndex index(document);
+		double buildSeconds = secondsSince(start);
+
+		// Unpacked from the document, so both find the same ink
+		std::vector<FlatSegment> flat;
+		std::vector<float> xs, ys;
+		for (const Stroke& stroke : document.strokes()) {
+			document.readPoints(stroke, xs, ys);
+			for (size_t i = 1; i < xs.size(); i++) flat.push_back({ { xs[i - 1], ys[i - 1] }, { xs[i], ys[i] }, stroke.style.thickness * 0.5f });
+		}
+
+		std::vector<ImVec2> centres(queryCount);
+		for (ImVec2& centre : centres) centre = { side * (float) (rng() >> 8) / (float) (1u << 24), side * (float) (rng() >> 8) / (float) (1u << 24) };
+
+		printf("spatial index, %zu strokes, %zu segments on a board %.0f px across\n", document.strokes().size(), flat.size(), side);
+		printf("  %-13s%.1f ms, %.1f KB\n", "build", buildSeconds * 1e3, index.memoryUsage() / 1024.0);
+
+		std::vector<SegmentRef> hits;
+		size_t indexHits = 0, scanHits = 0;
+		start = std::chrono::steady_clock::now();
+		for (ImVec2 centre : centres) {
+			index.queryRadius(centre, ERASER_RADIUS, hits);
+			indexHits += hits.size();
+		}
+		double indexSeconds = secondsSince(start);
+		start = std::chrono::steady_clock::now();
+		for (ImVec2 centre : centres) {
+			for (const FlatSegment& segment : flat) {
+				if (segmentDistance(centre, segment.a, segment.b) <= ERASER_RADIUS + segment.pad) scanHits++;
+			}
+		}
+		printQueries("radius", indexSeconds, secondsSince(start), centres.size(), indexHits, scanHits);
+
+		indexHits = scanHits = 0;
+		start = std::chrono::steady_clock::now();
+		for (ImVec2 centre : centres) {
+			index.queryRect(centre, { centre.x + SELECTION_SIZE, centre.y + SELECTION_SIZE }, hits);
+			indexHits += hits.size();
+		}
+		indexSeconds = secondsSince(start);
+		start = std::chrono::steady_clock::now();
+		for (ImVec2 min : centres) {
+			ImVec2 max{ min.x + SELECTION_SIZE, min.y + SELECTION_SIZE };
+			for (const FlatSegment& segment : flat) {
+				if (std::max(segment.a.x, segment.b.x) + segment.pad < min.x || std::min(segment.a.x, segment.b.x) - segment.pad > max.x
+					|| std::max(segment.a.y, segment.b.y) + segment.pad < min.y || std::min(segment.a.y, segment.b.y) - segment.pad > max.y) continue;
+				scanHits++;
+			}
+		}
+		printQueries("rectangle", indexSeconds, secondsSince(start), centres.size(), indexHits, scanHits);
+
+		// A pixel eraser swept across the middle of the board, a pointer sample a few pixels on from the last each time
+		Eraser eraser(document, index);
+		std::vector<double> sampleMs;
+		ImVec2 position{ side * 0.1f, side * 0.5f };
+		eraser.begin(position);
+		while (position.x < side * 0.9f && sampleMs.size() < queryCount) {
+			position = { position.x + 4.f, position.y + 3.f * std::sin(position.x / 50.f) };
+			start = std::chrono::steady_clock::now();
+			eraser.moveTo(position, ERASER_RADIUS, EraserMode::Pixel);
+			sampleMs.push_back(secondsSince(start) * 1e3);
+		}
+		HistoryEntry entry;
+		eraser.end(entry);
+		double total = 0.0;
+		for (double time : sampleMs) total += time;
+		printf("  %-13s%.3f ms per sample mean, p99 %.3f ms, max %.3f ms, %zu strokes taken off and %zu put back in pieces\n",
+			"pixel eraser", total / sampleMs.size(), percentile(sampleMs, 0.99), percentile(sampleMs, 1.0), entry.removed.size(), entry.added.size());
+	}
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <imgui/imgui.h>
+#include "benchmarks.h"
+#include "stroke_tessellator.h"
+
+namespace {
+	const ImVec2 DISPLAY_SIZE{ 2560.f, 1440.f };
+	const uint32_t POINTS_PER_STROKE = 250;
+	// Timed frames for each way of drawing, the fastest is reported
+	const int FRAMES = 5;
+
+	/**
+	* An ImGui context with no platform or renderer behind it, the previous context comes back when it goes
+	*/
+	class HeadlessContext {
+	public:
+		HeadlessContext() : previous(ImGui::GetCurrentContext()), context(ImGui::CreateContext()) {
+			ImGui::SetCurrentContext(context);
+			ImGuiIO& io = ImGui::GetIO();
+			io.IniFilename = nullptr;
+			io.DisplaySize = DISPLAY_SIZE;
+			io.DeltaTime = 1.f / 144.f;
+			io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+			unsigned char* pixels = nullptr;
+			int width = 0, height = 0;
+			io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+		}
+
+		~HeadlessContext() {
+			ImGui::DestroyContext(context);
+			ImGui::SetCurrentContext(previous);
+		}
+
+		HeadlessContext(const HeadlessContext&) = delete;
+		HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	private:
+		ImGuiContext* previous;
+		ImGuiContext* context;
+	};
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	struct Geometry {
+		double seconds = 1e9;
+		size_t vertices = 0;
+		size_t indices = 0;
+	};
+
+	/**
+	* Draws every stroke into the background list of a fresh frame, FRAMES times over
+	*/
+	template<typename F> Geometry measure(size_t strokeCount, F&& drawStroke) {
+		Geometry geometry;
+		for (int frame = 0; frame < FRAMES; frame++) {
+			ImGui::NewFrame();
+			ImDrawList* drawList = ImGui::GetBackgroundDrawList();
+			auto start = std::chrono::steady_clock::now();
+			for (size_t stroke = 0; stroke < strokeCount; stroke++) drawStroke(drawList, stroke);
+			geometry.seconds = std::min(geometry.seconds, secondsSince(start));
+			geometry.vertices = drawList->VtxBuffer.Size;
+			geometry.indices = drawList->IdxBuffer.Size;
+			ImGui::Render();
+		}
+		return geometry;
+	}
+
+	void printGeometry(const char* name, const Geometry& geometry, size_t points) {
+		printf("  %-13s%.1f M points/s, %.2f vertices and %.2f indices a point\n",
+			name, points / geometry.seconds / 1e6, (double) geometry.vertices / points, (double) geometry.indices / points);
+	}
+}
+
+/**
+* Tessellating wandering strokes with tessellateStroke (through drawStroke) against an AddLine per segment and ImGui's
+* own AddPolyline, for thin, medium and highlighter thicknesses and both joins
+*/
+void tessellationBenchmarks(const BenchOptions& options) {
+	HeadlessContext context;
+	const size_t strokeCount = options.quick ? 100 : 1000;
+
+	std::mt19937 rng(1);
+	auto uniform = [&](float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); };
+	std::vector<std::vector<float>> xs(strokeCount), ys(strokeCount);
+	std::vector<std::vector<ImVec2>> points(strokeCount);
+	for (size_t stroke = 0; stroke < strokeCount; stroke++) {
+		ImVec2 point{ uniform(100.f, DISPLAY_SIZE.x - 100.f), uniform(100.f, DISPLAY_SIZE.y - 100.f) };
+		float heading = uniform(0.f, 6.2831853f);
+		for (uint32_t i = 0; i < POINTS_PER_STROKE; i++) {
+			heading += uniform(-0.3f, 0.3f);
+			point = { point.x + 6.f * std::cos(heading), point.y + 6.f * std::sin(heading) };
+			xs[stroke].push_back(point.x);
+			ys[stroke].push_back(point.y);
+			points[stroke].push_back(point);
+		}
+	}
+	const size_t pointCount = strokeCount * POINTS_PER_STROKE;
+
+	struct Case {
+		const char* name;
+		float thickness;
+		ImU32 colour;
+	};
+	const Case cases[] = {
+		{ "thin pen", 2.f, IM_COL32(255, 255, 255, 255) },
+		{ "default pen", 5.f, IM_COL32(255, 0, 0, 255) },
+		{ "highlighter", 20.f, IM_COL32(255, 255, 0, 96) }
+	};
+
+	for (const Case& test : cases) {
+		printf("tessellation, %s at %.0f px, %zu strokes of %u points\n", test.name, test.thickness, strokeCount, POINTS_PER_STROKE);
+		StrokeStyle style{ test.colour, test.thickness };
+
+		TessellationSettings round;
+		printGeometry("round joins", measure(strokeCount, [&](ImDrawList* drawList, size_t stroke) {
+			drawStroke(drawList, xs[stroke].data(), ys[stroke].data(), POINTS_PER_STROKE, style, round);
+		}), pointCount);
+
+		TessellationSettings miter;
+		miter.join = JoinStyle::Miter;
+		miter.roundCaps = false;
+		printGeometry("miter joins", measure(strokeCount, [&](ImDrawList* drawList, size_t stroke) {
+			drawStroke(drawList, xs[stroke].data(), ys[stroke].data(), POINTS_PER_STROKE, style, miter);
+		}), pointCount);
+
+		printGeometry("AddPolyline", measure(strokeCount, [&](ImDrawList* drawList, size_t stroke) {
+			drawList->AddPolyline(points[stroke].data(), (int) POINTS_PER_STROKE, test.colour, 0, test.thickness);
+		}), pointCount);
+
+		// What the board drew before the tessellator
+		printGeometry("AddLine", measure(strokeCount, [&](ImDrawList* drawList, size_t stroke) {
+			for (uint32_t i = 1; i < POINTS_PER_STROKE; i++) drawList->AddLine(points[stroke][i - 1], points[stroke][i], test.colour, test.thickness);
+		}), pointCount);
+	}
+}
@@ -0,0 +1,528 @@
+#include "board_file.h"
+#include "checksum.h"
+#include "point_codec.h"
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Start folding the journal back into the board once it is this big
+const size_t COMPACT_JOURNAL_BYTES = 4 * 1024 * 1024;
+// Unreadable copies of one board kept side by side before moveAside gives up
+const int MAX_ASIDE = 100;
+// A uint32 takes at most this many bytes as a varint
+const int MAX_VARINT_BYTES = 5;
+
+enum JournalOp : uint8_t {
+	JOURNAL_ADD = 1,
+	JOURNAL_REMOVE = 2,
+	JOURNAL_RESTYLE = 3,
+	JOURNAL_CLEAR = 4,
+	JOURNAL_ADD_SHAPE = 5  // JOURNAL_ADD with the stroke's shape before the point count
+};
+
+template<typename T> static void put(std::vector<uint8_t>& out, T value) {
+	size_t at = out.size();
+	out.resize(at + sizeof(T));
+	std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+template<typename T> static bool get(const uint8_t*& at, const uint8_t* end, T& value) {
+	if ((size_t) (end - at) < sizeof(T)) return false;
+	std::memcpy(&value, at, sizeof(T));
+	at += sizeof(T);
+	return true;
+}
+
+/**
+* Flushes the file and waits for it to reach the disk, so a rename over another file never leaves it empty after a crash
+*/
+static bool syncFile(FILE* file) {
+	if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+/**
+* Copies everything in from onto the end of to
+*/
+static bool appendFile(const std::string& from, const std::string& to) {
+	FILE* in = std::fopen(from.c_str(), "rb");
+	if (!in) return false;
+	FILE* out = std::fopen(to.c_str(), "ab");
+	if (!out) {
+		std::fclose(in);
+		return false;
+	}
+
+	std::vector<uint8_t> buffer(64 * 1024);
+	bool ok = true;
+	for (size_t read; ok && (read = std::fread(buffer.data(), 1, buffer.size(), in)) > 0;) ok = std::fwrite(buffer.data(), 1, read, out) == read;
+	ok = !std::ferror(in) && syncFile(out) && ok;
+	std::fclose(in);
+	return std::fclose(out) == 0 && ok;
+}
+
+/**
+* Read only view of a whole file
+*/
+class MappedFile {
+public:
+	~MappedFile() {
+#ifdef _WIN32
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (data) munmap((void*) data, size);
+#endif
+	}
+
+	bool open(const std::string& path) {
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return false;
+		size = (size_t) fileSize.QuadPart;
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) return false;
+		data = (const uint8_t*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info {};
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		size = (size_t) info.st_size;
+
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		data = mapped == MAP_FAILED ? nullptr : (const uint8_t*) mapped;
+#endif
+		return data != nullptr;
+	}
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+};
+
+bool writeBoard(const std::string& path, const StrokeDocument& document) {
+	const std::vector<Stroke>& strokes = document.strokes();
+
+	// The packed bytes are written straight out of the document, nothing is unpacked or copied
+	std::vector<BoardStrokeRecord> records;
+	std::vector<const uint8_t*> packed;
+	records.reserve(strokes.size());
+	packed.reserve(strokes.size());
+	uint64_t pointCount = 0;
+	uint64_t pointsSize = 0;
+	for (const Stroke& stroke : strokes) {
+		if (stroke.id == document.activeStroke()) continue;
+
+		BoardStrokeRecord record{};
+		record.id = stroke.id;
+		record.colour = stroke.style.colour;
+		record.thickness = stroke.style.thickness;
+		record.count = stroke.count;
+		record.first = pointsSize;
+		record.size = (uint32_t) packedSize(document.packedPointsOf(stroke), stroke.count);
+		record.shape = stroke.shape;
+		record.grid = stroke.grid;
+		pointCount += stroke.count;
+		pointsSize += record.size;
+		records.push_back(record);
+		packed.push_back(document.packedPointsOf(stroke));
+	}
+
+	BoardHeader header{};
+	std::memcpy(header.magic, BOARD_MAGIC, sizeof(header.magic));
+	header.version = BOARD_VERSION;
+	header.strokeCount = (uint32_t) records.size();
+	header.pointCount = pointCount;
+	header.strokesOffset = sizeof(BoardHeader);
+	header.pointsOffset = header.strokesOffset + records.size() * sizeof(BoardStrokeRecord);
+	header.pointsSize = pointsSize;
+
+	std::string temporary = path + ".tmp";
+	FILE* file = std::fopen(temporary.c_str(), "wb");
+	if (!file) return false;
+
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+		&& (records.empty() || std::fwrite(records.data(), sizeof(BoardStrokeRecord), records.size(), file) == records.size());
+	for (size_t s = 0; s < records.size() && ok; s++) ok = std::fwrite(packed[s], 1, records[s].size, file) == records[s].size;
+	// On the disk before it replaces the board, or a crash could leave an empty file where the board was
+	ok = ok && syncFile(file);
+	ok = std::fclose(file) == 0 && ok;
+	if (!ok) return false;
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
+
+/**
+* Whether at to end holds exactly count points' worth of varints, so unpacking them never reads past the end
+*/
+static bool checkPacked(const uint8_t* at, const uint8_t* end, uint32_t count) {
+	for (uint64_t varints = 0; varints < (uint64_t) count * 2; varints++) {
+		for (int i = 0;; i++) {
+			if (i == MAX_VARINT_BYTES || at == end) return false;
+			if (!(*at++ & 0x80)) break;
+		}
+	}
+	return at == end;
+}
+
+/**
+* Version 1 and 2 boards, whose points were quantized to uint16s
+*/
+static BoardRead readLegacyBoard(const uint8_t* data, size_t size, const BoardHeader& header, StrokeDocument& document) {
+	uint64_t xsOffset = header.pointsOffset;
+	uint64_t ysOffset = header.pointsSize;
+	if (xsOffset > size || ysOffset > size) return BoardRead::Unreadable;
+	if (header.strokesOffset + (uint64_t) header.strokeCount * sizeof(LegacyStrokeRecord) > size) return BoardRead::Unreadable;
+	if (xsOffset + header.pointCount * sizeof(uint16_t) > size) return BoardRead::Unreadable;
+	if (ysOffset + header.pointCount * sizeof(uint16_t) > size) return BoardRead::Unreadable;
+
+	const uint8_t* records = data + header.strokesOffset;
+	const uint8_t* xs = data + xsOffset;
+	const uint8_t* ys = data + ysOffset;
+
+	LegacyStrokeRecord record;
+	for (uint32_t s = 0; s < header.strokeCount; s++) {
+		std::memcpy(&record, records + s * sizeof(LegacyStrokeRecord), sizeof(record));
+		if (record.first > header.pointCount || record.count > header.pointCount - record.first) return BoardRead::Unreadable;
+		if (record.shift > 31 || record.shape > (uint32_t) StrokeShape::Arrow) return BoardRead::Unreadable;
+	}
+
+	document.reserve(header.strokeCount, header.pointCount);
+	std::vector<ImVec2> points;
+	for (uint32_t s = 0; s < header.strokeCount; s++) {
+		std::memcpy(&record, records + s * sizeof(LegacyStrokeRecord), sizeof(record));
+		float step = (float) (1u << record.shift) / LEGACY_POINT_SUBPIXELS;
+		points.resize(record.count);
+		for (uint32_t i = 0; i < record.count; i++) {
+			uint16_t qx;
+			uint16_t qy;
+			std::memcpy(&qx, xs + (record.first + i) * sizeof(uint16_t), sizeof(qx));
+			std::memcpy(&qy, ys + (record.first + i) * sizeof(uint16_t), sizeof(qy));
+			points[i] = { record.originX + qx * step, record.originY + qy * step };
+		}
+		document.insertStroke(record.id, { record.colour, record.thickness }, points.data(), record.count, (StrokeShape) record.shape);
+	}
+	return BoardRead::Loaded;
+}
+
+BoardRead readBoard(const std::string& path, StrokeDocument& document) {
+	std::error_code error;
+	if (!std::filesystem::exists(path, error)) return BoardRead::Missing;
+
+	MappedFile file;
+	if (!file.open(path) || file.size < sizeof(BoardHeader)) return BoardRead::Unreadable;
+
+	BoardHeader header;
+	std::memcpy(&header, file.data, sizeof(header));
+	if (std::memcmp(header.magic, BOARD_MAGIC, sizeof(header.magic)) != 0 || header.version == 0) return BoardRead::Unreadable;
+	if (header.version > BOARD_VERSION) return BoardRead::Newer;
+	// Each bound checked on its own first, so none of the sums can wrap
+	if (header.strokeCount > file.size || header.pointCount > file.size || header.strokesOffset > file.size) return BoardRead::Unreadable;
+	if (header.version < 3) return readLegacyBoard(file.data, file.size, header, document);
+
+	if (header.pointsOffset > file.size || header.pointsSize > file.size - header.pointsOffset) return BoardRead::Unreadable;
+	if (header.strokesOffset + (uint64_t) header.strokeCount * sizeof(BoardStrokeRecord) > file.size) return BoardRead::Unreadable;
+
+	const uint8_t* records = file.data + header.strokesOffset;
+	const uint8_t* points = file.data + header.pointsOffset;
+
+	BoardStrokeRecord record;
+	for (uint32_t s = 0; s < header.strokeCount; s++) {
+		std::memcpy(&record, records + s * sizeof(BoardStrokeRecord), sizeof(record));
+		if (record.first > header.pointsSize || record.size > header.pointsSize - record.first) return BoardRead::Unreadable;
+		if ((uint8_t) record.shape > (uint8_t) StrokeShape::Arrow || record.grid > MAX_PACKED_GRID) return BoardRead::Unreadable;
+		if (!checkPacked(points + record.first, points + record.first + record.size, record.count)) return BoardRead::Unreadable;
+	}
+
+	document.reserve(header.strokeCount, header.pointCount);
+	PackedPoints packed;
+	for (uint32_t s = 0; s < header.strokeCount; s++) {
+		std::memcpy(&record, records + s * sizeof(BoardStrokeRecord), sizeof(record));
+		packed.bytes.assign(points + record.first, points + record.first + record.size);
+		packed.count = record.count;
+		packed.grid = record.grid;
+		document.insertStroke(record.id, { record.colour, record.thickness }, packed, record.shape);
+	}
+	return BoardRead::Loaded;
+}
+
+std::string moveAside(const std::string& path) {
+	std::error_code error;
+	for (int copy = 1; copy <= MAX_ASIDE; copy++) {
+		std::string aside = path + ".unreadable" + (copy > 1 ? "." + std::to_string(copy) : "");
+		if (std::filesystem::exists(aside, error)) continue;
+
+		std::filesystem::rename(path, aside, error);
+		return error ? "" : aside;
+	}
+	return "";
+}
+
+/**
+* Applies every intact record in a journal, stopping at the first torn or corrupt one (the tail of a crash)
+*/
+static void replayJournal(const std::string& path, StrokeDocument& document) {
+	MappedFile file;
+	if (!file.open(path)) return;
+
+	const uint8_t* at = file.data;
+	const uint8_t* end = file.data + file.size;
+	std::vector<ImVec2> points;
+	while (true) {
+		uint32_t size;
+		uint32_t checksum;
+		if (!get(at, end, size) || !get(at, end, checksum)) return;
+		if ((size_t) (end - at) < size || crc32(at, size) != checksum) return;
+
+		const uint8_t* payload = at;
+		const uint8_t* payloadEnd = at + size;
+		at = payloadEnd;
+
+		uint8_t op;
+		StrokeId id = INVALID_STROKE;
+		StrokeStyle style{};
+		uint32_t count = 0;
+		uint8_t shape = 0;
+		if (!get(payload, payloadEnd, op)) return;
+
+		switch (op) {
+		case JOURNAL_ADD:
+		case JOURNAL_ADD_SHAPE:
+			if (!get(payload, payloadEnd, id) || !get(payload, payloadEnd, style.colour) || !get(payload, payloadEnd, style.thickness)) return;
+			if (op == JOURNAL_ADD_SHAPE && (!get(payload, payloadEnd, shape) || shape > (uint8_t) StrokeShape::Arrow)) return;
+			if (!get(payload, payloadEnd, count)) return;
+			if ((size_t) (payloadEnd - payload) < count * sizeof(ImVec2)) return;
+			points.resize(count);
+			std::memcpy(points.data(), payload, count * sizeof(ImVec2));
+			document.insertStroke(id, style, points.data(), count, (StrokeShape) shape);
+			break;
+		case JOURNAL_REMOVE:
+			if (!get(payload, payloadEnd, id)) return;
+			document.removeStroke(id);
+			break;
+		case JOURNAL_RESTYLE:
+			if (!get(payload, payloadEnd, id) || !get(payload, payloadEnd, style.colour) || !get(payload, payloadEnd, style.thickness)) return;
+			document.setStyle(id, style);
+			break;
+		case JOURNAL_CLEAR:
+			document.clear();
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+BoardSession::BoardSession(StrokeDocument& document) : document(&document) {
+	document.addListener(this);
+}
+
+BoardSession::~BoardSession() {
+	close();
+	document->removeListener(this);
+}
+
+bool BoardSession::open(const std::string& path) {
+	close();
+	// Only set once the board is known to be this session's, discard never deletes one it didn't open
+	this->path.clear();
+
+	std::string journalPath = path + ".journal";
+	std::string oldJournalPath = path + ".journal.old";
+
+	BoardRead read = readBoard(path, *document);
+	// Left for the version that wrote it, journaling here would mean writing this version's board over it later
+	if (read == BoardRead::Newer) return false;
+	if (read == BoardRead::Unreadable) {
+		std::string aside = moveAside(path);
+		if (aside.empty()) return false;
+		// The journals are still replayed onto the fresh board, copies of them go with the old one to recover it from
+		std::error_code error;
+		std::filesystem::copy_file(oldJournalPath, aside + ".journal.old", error);
+		std::filesystem::copy_file(journalPath, aside + ".journal", error);
+	}
+	this->path = path;
+
+	// Replaying a journal over a board that already has it folded in is harmless, the last op on each stroke wins either way
+	bool recovered = std::filesystem::exists(journalPath) || std::filesystem::exists(oldJournalPath);
+	replayJournal(oldJournalPath, *document);
+	replayJournal(journalPath, *document);
+
+	if (recovered || read != BoardRead::Loaded) {
+		if (!writeBoard(path, *document)) return false;
+		std::error_code error;
+		std::filesystem::remove(oldJournalPath, error);
+		std::filesystem::remove(journalPath, error);
+	}
+
+	journal = std::fopen(journalPath.c_str(), "wb");
+	journalBytes = 0;
+	return journal != nullptr;
+}
+
+void BoardSession::close() {
+	waitForCompaction();
+	if (!journal) return;
+
+	std::fclose(journal);
+	journal = nullptr;
+
+	if (writeBoard(path, *document)) {
+		std::error_code error;
+		std::filesystem::remove(path + ".journal", error);
+	}
+}
+
+void BoardSession::discard() {
+	waitForCompaction();
+	if (journal) std::fclose(journal);
+	journal = nullptr;
+
+	std::error_code error;
+	std::filesystem::remove(path, error);
+	std::filesystem::remove(path + ".journal", error);
+	std::filesystem::remove(path + ".journal.old", error);
+}
+
+/**
+* The journal is written as if the old document had been cleared and the new one's strokes added to it, which is what
+* the board now holds
+*/
+void BoardSession::switchDocument(StrokeDocument& next) {
+	if (&next == document) return;
+
+	document->removeListener(this);
+	document = &next;
+	document->addListener(this);
+
+	documentCleared(next);
+	for (const Stroke& stroke : next.strokes()) {
+		if (stroke.id != next.activeStroke()) strokeAdded(next, stroke);
+	}
+}
+
+void BoardSession::waitForCompaction() {
+	if (compactor.joinable()) compactor.join();
+}
+
+void BoardSession::update() {
+	if (!compacting && compactor.joinable()) compactor.join();
+	if (journalBytes >= COMPACT_JOURNAL_BYTES) compactInBackground();
+}
+
+/**
+* Starts a fresh journal and writes a snapshot of the board on another thread
+* The old journal is only deleted once the new board file is in place, so there is always something to recover from.
+* One left behind by a compaction that failed is kept, with the journal added onto its end, and goes once this one works.
+*/
+void BoardSession::compactInBackground() {
+	if (!journal || compacting) return;
+	waitForCompaction();
+
+	std::string journalPath = path + ".journal";
+	std::string oldJournalPath = path + ".journal.old";
+
+	std::fclose(journal);
+	std::error_code error;
+	bool moved;
+	if (std::filesystem::exists(oldJournalPath, error)) moved = appendFile(journalPath, oldJournalPath);
+	else {
+		std::filesystem::rename(journalPath, oldJournalPath, error);
+		moved = !error;
+	}
+	journal = std::fopen(journalPath.c_str(), moved ? "wb" : "ab");
+	if (!moved || !journal) return;
+	journalBytes = 0;
+
+	// writeBoard skips the stroke being drawn, it gets journaled when it is finished
+	StrokeDocument snapshot = *document;
+
+	compacting = true;
+	compactor = std::thread([this, snapshot = std::move(snapshot), oldJournalPath]() {
+		if (writeBoard(path, snapshot)) {
+			std::error_code error;
+			std::filesystem::remove(oldJournalPath, error);
+		}
+		compacting = false;
+	});
+}
+
+void BoardSession::append(const std::vector<uint8_t>& payload) {
+	if (!journal) return;
+
+	uint32_t size = (uint32_t) payload.size();
+	uint32_t checksum = crc32(payload.data(), payload.size());
+	std::fwrite(&size, sizeof(size), 1, journal);
+	std::fwrite(&checksum, sizeof(checksum), 1, journal);
+	std::fwrite(payload.data(), 1, payload.size(), journal);
+	std::fflush(journal);
+	journalBytes += sizeof(size) + sizeof(checksum) + payload.size();
+}
+
+void BoardSession::strokeAdded(const StrokeDocument& document, const Stroke& stroke) {
+	record.clear();
+	put(record, stroke.shape == StrokeShape::Freehand ? JOURNAL_ADD : JOURNAL_ADD_SHAPE);
+	put(record, stroke.id);
+	put(record, stroke.style.colour);
+	put(record, stroke.style.thickness);
+	if (stroke.shape != StrokeShape::Freehand) put(record, stroke.shape);
+	put(record, stroke.count);
+	document.copyPoints(stroke, points);
+	for (ImVec2 point : points) put(record, point);
+	append(record);
+}
+
+void BoardSession::strokeRemoved(const StrokeDocument&, const Stroke& stroke) {
+	record.clear();
+	put(record, JOURNAL_REMOVE);
+	put(record, stroke.id);
+	append(record);
+}
+
+void BoardSession::strokeRestyled(const StrokeDocument&, const Stroke& stroke) {
+	record.clear();
+	put(record, JOURNAL_RESTYLE);
+	put(record, stroke.id);
+	put(record, stroke.style.colour);
+	put(record, stroke.style.thickness);
+	append(record);
+}
+
+void BoardSession::documentCleared(const StrokeDocument&) {
+	record.clear();
+	put(record, JOURNAL_CLEAR);
+	append(record);
+}
@@ -0,0 +1,147 @@
+#ifndef BOARD_FILE_H
+#define BOARD_FILE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "stroke_document.h"
+
+/**
+* Board file layout (little endian)
+* BoardHeader, then strokeCount BoardStrokeRecords, then every stroke's points packed exactly as the document keeps them
+* (see point_codec.h), each on its own grid, so a board loads back to the same points whatever zoom they were drawn at
+* Version 3 started storing the packed points. Versions 1 and 2 quantized them (see LegacyStrokeRecord) and are still
+* read, version 2 added the stroke's shape (version 1 strokes are all freehand).
+*/
+const char BOARD_MAGIC[4] = { 'W', 'B', 'R', 'D' };
+const uint32_t BOARD_VERSION = 3;
+// Steps a pixel of the points in version 1 and 2 boards, before their stroke's shift
+const float LEGACY_POINT_SUBPIXELS = 8.f;
+
+struct BoardHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t strokeCount;
+	uint32_t reserved;
+	uint64_t pointCount;
+	uint64_t strokesOffset;
+	uint64_t pointsOffset;
+	uint64_t pointsSize;  // bytes of packed points, in version 1 and 2 where the ys start (the xs start at pointsOffset)
+};
+
+struct BoardStrokeRecord {
+	StrokeId id;
+	ImU32 colour;
+	float thickness;
+	uint32_t count;
+	uint64_t first;  // where its packed points start, from pointsOffset
+	uint32_t size;  // bytes of packed points
+	StrokeShape shape;
+	uint8_t grid;
+	uint16_t reserved;
+};
+
+/**
+* A stroke in a version 1 or 2 board, its points are uint16s from first in the xs and ys arrays, quantized relative to
+* origin in steps of 2^shift / LEGACY_POINT_SUBPIXELS pixels
+*/
+struct LegacyStrokeRecord {
+	StrokeId id;
+	ImU32 colour;
+	float thickness;
+	float originX;
+	float originY;
+	uint32_t shift;
+	uint32_t count;
+	uint32_t shape;  // StrokeShape, was reserved and always 0 in version 1
+	uint64_t first;
+};
+
+/**
+* What readBoard made of a board file
+*/
+enum class BoardRead {
+	Loaded,
+	Missing,
+	Unreadable,  // truncated or corrupt
+	Newer  // written by a later version than this one
+};
+
+/**
+* Writes the whole document to path, going through a temporary file so a crash never leaves half a board behind
+*/
+bool writeBoard(const std::string& path, const StrokeDocument& document);
+/**
+* Memory maps the file and decodes it onto the end of the document
+* Every record is checked before any stroke is added, a board that can't be read leaves the document as it was
+*/
+BoardRead readBoard(const std::string& path, StrokeDocument& document);
+
+/**
+* Renames a file that couldn't be read to path.unreadable (or .unreadable.2 and on when that is taken), so whatever is
+* saved in its place never replaces it. Returns where it went, or "" if it couldn't be moved.
+*/
+std::string moveAside(const std::string& path);
+
+/**
+* Keeps a document saved to disk
+* Every committed change is appended to a journal next to the board file as it happens, so a crash can only lose the
+* stroke being drawn. Once the journal gets big it is folded back into the board file on a background thread.
+*/
+class BoardSession : public StrokeListener {
+public:
+	explicit BoardSession(StrokeDocument& document);
+	~BoardSession();
+	BoardSession(const BoardSession&) = delete;
+	BoardSession& operator=(const BoardSession&) = delete;
+
+	/**
+	* Loads the board and replays any journals left behind by a crash, then starts journaling
+	* A fresh board is only started when there is no file at path. One that can't be read is moved aside first (see
+	* moveAside) with a copy of its journals, and one from a newer version is left alone and not opened.
+	*/
+	bool open(const std::string& path);
+	/**
+	* Folds everything into the board file and stops journaling
+	*/
+	void close();
+	/**
+	* Stops journaling and deletes the board file and its journals
+	*/
+	void discard();
+	/**
+	* Saves a different document to the same board from now on, eg. when a layer's contents are swapped for others
+	*/
+	void switchDocument(StrokeDocument& next);
+
+	// Call once a frame, starts a compaction when the journal is big and tidies up after finished ones
+	void update();
+	void compactInBackground();
+
+	bool isOpen() const { return journal != nullptr; }
+	size_t journalSize() const { return journalBytes; }
+
+	void strokeAdded(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRemoved(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRestyled(const StrokeDocument& document, const Stroke& stroke) override;
+	void documentCleared(const StrokeDocument& document) override;
+
+private:
+	void append(const std::vector<uint8_t>& payload);
+	void waitForCompaction();
+
+	StrokeDocument* document;
+	std::string path;
+	FILE* journal = nullptr;
+	size_t journalBytes = 0;
+	std::vector<uint8_t> record;
+	std::vector<ImVec2> points;
+
+	std::thread compactor;
+	std::atomic<bool> compacting{ false };
+};
+
+#endif // BOARD_FILE_H
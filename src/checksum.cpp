@@ -0,0 +1,36 @@
+#include "checksum.h"
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+	static const auto table = []() {
+		struct { uint32_t entries[256]; } table{};
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table.entries[i] = c;
+		}
+		return table;
+	}();
+
+	crc ^= 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++) crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+
+uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler) {
+	// Largest run that can be summed before the 32 bit sums could overflow
+	const size_t BLOCK = 5552;
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+	while (size > 0) {
+		size_t run = size < BLOCK ? size : BLOCK;
+		for (size_t i = 0; i < run; i++) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += run;
+		size -= run;
+	}
+	return (b << 16) | a;
+}
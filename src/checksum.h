@@ -0,0 +1,16 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+* CRC-32 as used by zlib and PNG, pass the previous result in as crc to continue a running checksum
+*/
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+/**
+* Adler-32 as used by zlib streams, pass the previous result in as adler to continue a running checksum
+*/
+uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+
+#endif // CHECKSUM_H
@@ -0,0 +1,176 @@
+#include "damage.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Anti-aliased edges reach a little past the thickness
+const float DAMAGE_FRINGE = 2.f;
+
+static DamageRect unite(const DamageRect& a, const DamageRect& b) {
+	return { std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1) };
+}
+
+static bool touches(const DamageRect& a, const DamageRect& b) {
+	return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+void mergeDamage(std::vector<DamageRect>& rects, DamageRect rect) {
+	// Swallow everything the new rect touches, growing it as we go, until nothing else does
+	for (bool merged = true; merged;) {
+		merged = false;
+		for (size_t i = 0; i < rects.size(); i++) {
+			if (!touches(rects[i], rect)) continue;
+			rect = unite(rects[i], rect);
+			rects[i] = rects.back();
+			rects.pop_back();
+			merged = true;
+			break;
+		}
+	}
+	rects.push_back(rect);
+
+	while (rects.size() > MAX_DAMAGE_RECTS) {
+		// Merge the pair that wastes the fewest pixels
+		size_t bestA = 0, bestB = 1;
+		long long bestWaste = std::numeric_limits<long long>::max();
+		for (size_t a = 0; a < rects.size(); a++) {
+			for (size_t b = a + 1; b < rects.size(); b++) {
+				long long waste = (long long) unite(rects[a], rects[b]).area() - rects[a].area() - rects[b].area();
+				if (waste < bestWaste) {
+					bestWaste = waste;
+					bestA = a;
+					bestB = b;
+				}
+			}
+		}
+		DamageRect united = unite(rects[bestA], rects[bestB]);
+		rects[bestB] = rects.back();
+		rects.pop_back();
+		rects.erase(rects.begin() + bestA);
+		mergeDamage(rects, united);
+	}
+}
+
+void DamageTracker::setView(const Viewport& view) {
+	if (view == this->view) return;
+	this->view = view;
+	boundsWidth = (int) view.size.x;
+	boundsHeight = (int) view.size.y;
+	addAll();
+}
+
+bool DamageTracker::toPixels(ImVec2 min, ImVec2 max, DamageRect& out) const {
+	out.x0 = std::max(0, (int) std::floor(min.x));
+	out.y0 = std::max(0, (int) std::floor(min.y));
+	out.x1 = std::min(boundsWidth, (int) std::ceil(max.x));
+	out.y1 = std::min(boundsHeight, (int) std::ceil(max.y));
+	return out.x0 < out.x1 && out.y0 < out.y1;
+}
+
+void DamageTracker::add(ImVec2 min, ImVec2 max) {
+	DamageRect rect;
+	if (full || !toPixels(min, max, rect)) return;
+
+	mergeDamage(current, rect);
+}
+
+float DamageTracker::strokePadding(float thickness) const {
+	return thickness * 0.5f * std::max(joinReach, 1.f) + DAMAGE_FRINGE;
+}
+
+void DamageTracker::addStroke(const Stroke& stroke) {
+	float pad = strokePadding(stroke.style.thickness * view.zoom);
+	ImVec2 min = view.toScreen(stroke.min);
+	ImVec2 max = view.toScreen(stroke.max);
+	add({ min.x - pad, min.y - pad }, { max.x + pad, max.y + pad });
+}
+
+void DamageTracker::addOverlay(ImVec2 min, ImVec2 max) {
+	DamageRect rect;
+	if (toPixels(min, max, rect)) mergeDamage(overlays, rect);
+}
+
+void DamageTracker::addAll() {
+	full = true;
+	current.clear();
+}
+
+void DamageTracker::endFrame(int bufferAge, std::vector<DamageRect>& redraw, std::vector<DamageRect>& present) {
+	// What changed since the last frame, the overlays are damaged where they are now and where they were
+	present = current;
+	for (const DamageRect& rect : overlays) mergeDamage(present, rect);
+	for (const DamageRect& rect : lastOverlays) mergeDamage(present, rect);
+
+	long long area = 0;
+	for (const DamageRect& rect : present) area += rect.area();
+	bool frameFull = full || area > FULL_DAMAGE_FRACTION * boundsWidth * boundsHeight;
+
+	// The back buffer is also missing everything that changed in the frames it skipped
+	bool redrawFull = frameFull || bufferAge <= 0 || bufferAge > DAMAGE_HISTORY + 1;
+	redraw = present;
+	for (int age = 1; age < bufferAge && !redrawFull; age++) {
+		const Frame& past = history[(historyIndex - (age - 1) + DAMAGE_HISTORY) % DAMAGE_HISTORY];
+		redrawFull = past.full;
+		for (const DamageRect& rect : past.rects) mergeDamage(redraw, rect);
+	}
+
+	historyIndex = (historyIndex + 1) % DAMAGE_HISTORY;
+	history[historyIndex].rects = present;
+	history[historyIndex].full = frameFull;
+
+	if (frameFull) present.assign(1, screen());
+	if (redrawFull) redraw.assign(1, screen());
+
+	std::swap(overlays, lastOverlays);
+	overlays.clear();
+	current.clear();
+	full = false;
+}
+
+void DamageTracker::strokeAdded(const StrokeDocument&, const Stroke& stroke) {
+	addStroke(stroke);
+}
+
+void DamageTracker::strokeRemoved(const StrokeDocument&, const Stroke& stroke) {
+	addStroke(stroke);
+}
+
+void DamageTracker::strokeRestyled(const StrokeDocument&, const Stroke& stroke) {
+	addStroke(stroke);
+}
+
+void DamageTracker::documentCleared(const StrokeDocument&) {
+	addAll();
+}
+
+DamageClip::DamageClip(ImDrawData* drawData, const std::vector<DamageRect>& rects) : drawData(drawData), original(drawData->CmdLists.Size) {
+	ImVec2 offset = drawData->DisplayPos;
+	for (int i = 0; i < drawData->CmdLists.Size; i++) {
+		ImVector<ImDrawCmd>& commands = drawData->CmdLists[i]->CmdBuffer;
+		original[i].swap(commands);
+
+		for (const ImDrawCmd& command : original[i]) {
+			if (command.UserCallback) {
+				commands.push_back(command);
+				continue;
+			}
+
+			for (const DamageRect& rect : rects) {
+				ImVec4 clip{
+					std::max(command.ClipRect.x, rect.x0 + offset.x), std::max(command.ClipRect.y, rect.y0 + offset.y),
+					std::min(command.ClipRect.z, rect.x1 + offset.x), std::min(command.ClipRect.w, rect.y1 + offset.y)
+				};
+				if (clip.x >= clip.z || clip.y >= clip.w) continue;
+
+				commands.push_back(command);
+				commands.back().ClipRect = clip;
+			}
+		}
+	}
+}
+
+DamageClip::~DamageClip() {
+	for (int i = 0; i < drawData->CmdLists.Size; i++) {
+		drawData->CmdLists[i]->CmdBuffer.swap(original[i]);
+	}
+}
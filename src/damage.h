@@ -0,0 +1,119 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+#include "viewport.h"
+
+// Beyond this many rectangles the closest ones get merged
+const int MAX_DAMAGE_RECTS = 8;
+// Once this much of the screen is damaged the whole thing is redrawn
+const float FULL_DAMAGE_FRACTION = 0.5f;
+// Frames of damage kept, so a back buffer this many presents old can be brought up to date
+const int DAMAGE_HISTORY = 3;
+
+/**
+* Whole pixels, right and bottom exclusive
+*/
+struct DamageRect {
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+
+	int area() const { return (x1 - x0) * (y1 - y0); }
+	bool operator==(const DamageRect& other) const { return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1; }
+};
+
+/**
+* Works out which parts of the screen changed since the last frame, in screen pixels
+* Committed strokes are damaged through the listener of every document it is added to (one for each layer), anything
+* else drawn on the board is reported with add() when it changes, or with addOverlay() every frame if it is redrawn in
+* a new place each frame (previews, cursors, windows), which also damages wherever it was the frame before
+*/
+class DamageTracker : public StrokeListener {
+public:
+	DamageTracker() = default;
+	DamageTracker(const DamageTracker&) = delete;
+	DamageTracker& operator=(const DamageTracker&) = delete;
+
+	/**
+	* Strokes are placed on screen through the view, moving it or resizing the screen damages everything
+	*/
+	void setView(const Viewport& view);
+	int width() const { return boundsWidth; }
+	int height() const { return boundsHeight; }
+
+	/**
+	* How far past its points a stroke's joins can reach, as a multiple of half its thickness (the miter limit for
+	* mitered joins)
+	*/
+	void setJoinReach(float reach) { joinReach = reach; }
+	// Distance around a stroke's points its ink can cover, in the same units as the thickness
+	float strokePadding(float thickness) const;
+
+	void add(ImVec2 min, ImVec2 max);
+	// Damages the stroke's bounding box, which is on the board rather than the screen
+	void addStroke(const Stroke& stroke);
+	void addOverlay(ImVec2 min, ImVec2 max);
+	void addAll();
+
+	bool hasDamage() const { return full || !current.empty() || !overlays.empty() || !lastOverlays.empty(); }
+
+	/**
+	* Closes the frame, redraw is what has to be drawn into a back buffer last presented bufferAge frames ago (0 if
+	* its contents are unknown) and present is what changed since the last frame
+	* Either list holds the one full screen rectangle when everything has to go
+	*/
+	void endFrame(int bufferAge, std::vector<DamageRect>& redraw, std::vector<DamageRect>& present);
+
+	void strokeAdded(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRemoved(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRestyled(const StrokeDocument& document, const Stroke& stroke) override;
+	void documentCleared(const StrokeDocument& document) override;
+
+private:
+	struct Frame {
+		std::vector<DamageRect> rects;
+		bool full = true;
+	};
+
+	bool toPixels(ImVec2 min, ImVec2 max, DamageRect& out) const;
+	DamageRect screen() const { return { 0, 0, boundsWidth, boundsHeight }; }
+
+	Viewport view;
+	int boundsWidth = 0;
+	int boundsHeight = 0;
+	float joinReach = 1.f;
+	std::vector<DamageRect> current;
+	bool full = true;
+	std::vector<DamageRect> overlays;
+	std::vector<DamageRect> lastOverlays;
+	Frame history[DAMAGE_HISTORY];  // ring of past frames' damage, newest at historyIndex
+	int historyIndex = 0;
+};
+
+/**
+* Adds rect to rects, merging it with any it overlaps or touches and keeping at most MAX_DAMAGE_RECTS
+*/
+void mergeDamage(std::vector<DamageRect>& rects, DamageRect rect);
+
+/**
+* Cuts the draw data down to the damaged rectangles for as long as it lives
+* Every command is repeated once for each rectangle it overlaps with its clip rect shrunk to fit, and dropped if it
+* overlaps none, so a backend that scissors to clip rects only touches damaged pixels
+*/
+class DamageClip {
+public:
+	DamageClip(ImDrawData* drawData, const std::vector<DamageRect>& rects);
+	~DamageClip();
+	DamageClip(const DamageClip&) = delete;
+	DamageClip& operator=(const DamageClip&) = delete;
+
+private:
+	ImDrawData* drawData;
+	std::vector<ImVector<ImDrawCmd>> original;
+};
+
+#endif // DAMAGE_H
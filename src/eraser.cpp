@@ -0,0 +1,137 @@
+#include "eraser.h"
+#include <algorithm>
+#include <cmath>
+#include "shapes.h"
+
+static bool inside(ImVec2 p, ImVec2 centre, float radius) {
+	float dx = p.x - centre.x;
+	float dy = p.y - centre.y;
+	return dx * dx + dy * dy < radius * radius;
+}
+
+static ImVec2 lerp(ImVec2 a, ImVec2 b, float t) {
+	return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t };
+}
+
+void Eraser::begin(ImVec2 position) {
+	last = position;
+	pending = HistoryEntry();
+}
+
+void Eraser::moveTo(ImVec2 position, float radius, EraserMode mode) {
+	float dx = position.x - last.x;
+	float dy = position.y - last.y;
+	float length = std::sqrt(dx * dx + dy * dy);
+	int steps = std::max(1, (int) std::ceil(length / std::max(radius * 0.5f, 1.f)));
+	for (int i = 1; i <= steps; i++) {
+		eraseAt(lerp(last, position, (float) i / steps), radius, mode);
+	}
+	last = position;
+}
+
+void Eraser::eraseAt(ImVec2 centre, float radius, EraserMode mode) {
+	index.queryRadius(centre, radius, hits);
+
+	StrokeId previous = INVALID_STROKE;
+	for (const SegmentRef& hit : hits) {
+		if (hit.stroke == previous) continue;
+		previous = hit.stroke;
+
+		if (mode == EraserMode::Stroke) take(hit.stroke);
+		else split(hit.stroke, centre, radius);
+	}
+}
+
+/**
+* Takes a stroke off the board, remembering it for undo unless this gesture is what created it
+*/
+void Eraser::take(StrokeId id) {
+	auto added = std::find(pending.added.begin(), pending.added.end(), id);
+	if (added != pending.added.end()) {
+		pending.added.erase(added);
+		document.removeStroke(id);
+		return;
+	}
+
+	const Stroke* stroke = document.find(id);
+	if (!stroke) return;
+
+	SavedStroke saved;
+	saved.id = id;
+	saved.style = stroke->style;
+	saved.shape = stroke->shape;
+	document.removeStroke(id, &saved.points);
+	pending.removed.push_back(std::move(saved));
+}
+
+/**
+* Cuts the part of the stroke under the eraser out, the first piece left over keeps the stroke's id
+* Shapes are cut along their outline and what is left of them becomes freehand
+*/
+void Eraser::split(StrokeId id, ImVec2 centre, float radius) {
+	const Stroke* stroke = document.find(id);
+	if (!stroke) return;
+
+	StrokeStyle style = stroke->style;
+	float reach = radius + style.thickness * 0.5f;
+	strokeOutline(document, *stroke, style.thickness * SHAPE_HIT_TOLERANCE, points);
+	pieces.clear();
+	if (points.empty()) return;
+
+	bool cut = false;
+	std::vector<ImVec2> current;
+	if (!inside(points[0], centre, reach)) current.push_back(points[0]);
+	else cut = true;
+
+	for (size_t i = 0; i + 1 < points.size(); i++) {
+		ImVec2 a = points[i];
+		ImVec2 b = points[i + 1];
+		ImVec2 d = { b.x - a.x, b.y - a.y };
+		ImVec2 f = { a.x - centre.x, a.y - centre.y };
+		float qa = d.x * d.x + d.y * d.y;
+		float qb = 2.f * (f.x * d.x + f.y * d.y);
+		float qc = f.x * f.x + f.y * f.y - reach * reach;
+		float discriminant = qb * qb - 4.f * qa * qc;
+
+		float lo = 1.f;
+		float hi = 0.f;
+		if (qa > 0.f && discriminant > 0.f) {
+			float root = std::sqrt(discriminant);
+			lo = std::max((-qb - root) / (2.f * qa), 0.f);
+			hi = std::min((-qb + root) / (2.f * qa), 1.f);
+		}
+
+		if (lo >= hi) {
+			if (!inside(b, centre, reach)) current.push_back(b);
+			continue;
+		}
+
+		cut = true;
+		if (lo > 0.f) current.push_back(lerp(a, b, lo));
+		if (current.size() >= 2) pieces.push_back(std::move(current));
+		current.clear();
+		if (hi < 1.f) {
+			current.push_back(lerp(a, b, hi));
+			current.push_back(b);
+		}
+	}
+	if (!cut) return;
+	if (current.size() >= 2) pieces.push_back(std::move(current));
+
+	take(id);
+	if (pieces.empty()) return;
+
+	document.insertStroke(id, style, pieces[0].data(), (uint32_t) pieces[0].size());
+	pending.added.push_back(id);
+	for (size_t i = 1; i < pieces.size(); i++) {
+		pending.added.push_back(document.addStroke(style, pieces[i].data(), (uint32_t) pieces[i].size()));
+	}
+}
+
+bool Eraser::end(HistoryEntry& entry) {
+	if (pending.added.empty() && pending.removed.empty()) return false;
+
+	entry = std::move(pending);
+	pending = HistoryEntry();
+	return true;
+}
@@ -0,0 +1,46 @@
+#ifndef ERASER_H
+#define ERASER_H
+
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+#include "spatial_index.h"
+#include "history.h"
+
+enum class EraserMode {
+	Stroke,  // removes any stroke it touches
+	Pixel  // only removes the ink under it, splitting strokes where needed
+};
+
+/**
+* Erases along the path of the pointer, building up a single history entry for the whole gesture
+*/
+class Eraser {
+public:
+	Eraser(StrokeDocument& document, const SpatialIndex& index) : document(document), index(index) {}
+
+	void begin(ImVec2 position);
+	/**
+	* Erases everything within radius of the path from the last position to this one
+	*/
+	void moveTo(ImVec2 position, float radius, EraserMode mode);
+	/**
+	* Hands over what was erased, returns false if nothing was
+	*/
+	bool end(HistoryEntry& entry);
+
+private:
+	void eraseAt(ImVec2 centre, float radius, EraserMode mode);
+	void take(StrokeId id);
+	void split(StrokeId id, ImVec2 centre, float radius);
+
+	StrokeDocument& document;
+	const SpatialIndex& index;
+	ImVec2 last;
+	HistoryEntry pending;
+	std::vector<SegmentRef> hits;
+	std::vector<ImVec2> points;
+	std::vector<std::vector<ImVec2>> pieces;
+};
+
+#endif // ERASER_H
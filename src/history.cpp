@@ -0,0 +1,120 @@
+#include "history.h"
+
+static size_t savedBytes(const std::vector<SavedStroke>& strokes) {
+	size_t total = strokes.capacity() * sizeof(SavedStroke);
+	for (const SavedStroke& stroke : strokes) {
+		total += stroke.points.bytes.capacity();
+	}
+	return total;
+}
+
+static void putBack(StrokeDocument& document, std::vector<SavedStroke>& strokes) {
+	for (const SavedStroke& stroke : strokes) {
+		// Gone before it was undone, eg. erased by another client on a shared board
+		if (stroke.points.count == 0) continue;
+		document.insertStroke(stroke.id, stroke.style, stroke.points, stroke.shape);
+	}
+}
+
+size_t HistoryEntry::memoryUsage() const {
+	return sizeof(HistoryEntry)
+		+ added.capacity() * sizeof(StrokeId)
+		+ restyled.capacity() * sizeof(Restyle)
+		+ savedBytes(removed)
+		+ savedBytes(stash);
+}
+
+History::History(const DrawingSettings& initial, size_t memoryBudget) : base(initial), budget(memoryBudget) {}
+
+void History::commit(HistoryEntry entry) {
+	discardRedo();
+	entry.stash.clear();
+	bytes += entry.memoryUsage();
+	entries.push_back(std::move(entry));
+	applied++;
+	enforceBudget();
+}
+
+void History::discardRedo() {
+	while (entries.size() > applied) {
+		bytes -= entries.back().memoryUsage();
+		entries.pop_back();
+	}
+}
+
+bool History::undo(StrokeDocument& document) {
+	if (!canUndo()) return false;
+
+	HistoryEntry& entry = entries[applied - 1];
+	bytes -= entry.memoryUsage();
+
+	entry.stash.resize(entry.added.size());
+	for (size_t i = entry.added.size(); i-- > 0;) {
+		SavedStroke& saved = entry.stash[i];
+		saved.id = entry.added[i];
+		const Stroke* stroke = document.find(saved.id);
+		if (stroke) {
+			saved.style = stroke->style;
+			saved.shape = stroke->shape;
+		}
+		document.removeStroke(saved.id, &saved.points);
+	}
+	putBack(document, entry.removed);
+	for (const Restyle& restyle : entry.restyled) {
+		document.setStyle(restyle.id, restyle.before);
+	}
+
+	bytes += entry.memoryUsage();
+	applied--;
+	return true;
+}
+
+bool History::redo(StrokeDocument& document) {
+	if (!canRedo()) return false;
+
+	HistoryEntry& entry = entries[applied];
+	bytes -= entry.memoryUsage();
+
+	for (const SavedStroke& stroke : entry.removed) {
+		document.removeStroke(stroke.id);
+	}
+	putBack(document, entry.stash);
+	std::vector<SavedStroke>().swap(entry.stash);
+	for (const Restyle& restyle : entry.restyled) {
+		document.setStyle(restyle.id, restyle.after);
+	}
+
+	bytes += entry.memoryUsage();
+	applied++;
+	return true;
+}
+
+const DrawingSettings& History::settings() const {
+	return applied > 0 ? entries[applied - 1].settings : base;
+}
+
+void History::setMemoryBudget(size_t memoryBudget) {
+	budget = memoryBudget;
+	enforceBudget();
+}
+
+/**
+* Folds the oldest entries into the checkpoint until the history fits in its budget
+* Only entries that are currently applied can be folded, and the latest one is always kept
+*/
+void History::enforceBudget() {
+	while (bytes > budget && applied > 1) {
+		bytes -= entries.front().memoryUsage();
+		base = entries.front().settings;
+		entries.pop_front();
+		applied--;
+		checkpoint++;
+	}
+}
+
+void History::clear() {
+	entries.clear();
+	applied = 0;
+	checkpoint = 0;
+	bytes = 0;
+}
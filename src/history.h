@@ -0,0 +1,95 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+
+const size_t DEFAULT_HISTORY_BUDGET = 64 * 1024 * 1024;
+
+/**
+* The colour and thickness selected in the menu when an entry was committed
+* Undo / redo puts these back, like the full snapshots used to
+*/
+struct DrawingSettings {
+	float colour[4];
+	float thickness;
+};
+
+struct SavedStroke {
+	StrokeId id;
+	StrokeStyle style;
+	PackedPoints points;
+	StrokeShape shape = StrokeShape::Freehand;
+};
+
+struct Restyle {
+	StrokeId id;
+	StrokeStyle before;
+	StrokeStyle after;
+};
+
+/**
+* One undoable change to the document
+* added: strokes put on the board, their points are only copied out (into stash) while the entry is undone
+* removed: strokes taken off the board (erasing), kept so undo can put them back
+* restyled: strokes whose colour / thickness changed
+*/
+struct HistoryEntry {
+	std::vector<StrokeId> added;
+	std::vector<SavedStroke> removed;
+	std::vector<Restyle> restyled;
+	DrawingSettings settings{};
+
+	std::vector<SavedStroke> stash;
+
+	size_t memoryUsage() const;
+};
+
+/**
+* Undo history made up of deltas rather than copies of the board
+* Committing only costs the size of the change, undo / redo only touch the strokes in the entry
+* Once the entries use more than the memory budget the oldest are folded into the checkpoint and can no longer be undone
+*/
+class History {
+public:
+	History(const DrawingSettings& initial, size_t memoryBudget = DEFAULT_HISTORY_BUDGET);
+
+	/**
+	* Records a change that has already been applied to the document, throwing away anything that could be redone
+	*/
+	void commit(HistoryEntry entry);
+	/**
+	* Throws away anything that could be redone, as a commit does, for changes made outside the history
+	*/
+	void discardRedo();
+	bool undo(StrokeDocument& document);
+	bool redo(StrokeDocument& document);
+	bool canUndo() const { return applied > 0; }
+	bool canRedo() const { return applied < entries.size(); }
+
+	// Settings that were selected at the current position
+	const DrawingSettings& settings() const;
+
+	// Position / size counting everything that has been folded into the checkpoint
+	size_t position() const { return checkpoint + applied; }
+	size_t size() const { return checkpoint + entries.size(); }
+
+	size_t memoryUsage() const { return bytes; }
+	void setMemoryBudget(size_t budget);
+	void clear();
+
+private:
+	void enforceBudget();
+
+	std::deque<HistoryEntry> entries;
+	size_t applied = 0;
+	size_t checkpoint = 0;
+	DrawingSettings base;
+	size_t bytes = 0;
+	size_t budget;
+};
+
+#endif // HISTORY_H
@@ -0,0 +1,49 @@
+#include "ingest.h"
+#include <cmath>
+#include <vector>
+#include "shapes.h"
+
+void PointIngestor::begin() {
+	hasLast = false;
+}
+
+uint64_t PointIngestor::cellKey(ImVec2 point) const {
+	int32_t x = (int32_t) std::floor(point.x / settings.cellSize);
+	int32_t y = (int32_t) std::floor(point.y / settings.cellSize);
+	return ((uint64_t) (uint32_t) x << 32) | (uint32_t) y;
+}
+
+bool PointIngestor::accept(ImVec2 point, double time) {
+	if (hasLast) {
+		float dx = point.x - last.x;
+		float dy = point.y - last.y;
+		if (dx * dx + dy * dy < settings.minDistance * settings.minDistance) return false;
+		if (time - lastTime < settings.minInterval) return false;
+	}
+
+	if (settings.globalDedup && !inked.insert(cellKey(point)).second) return false;
+
+	hasLast = true;
+	last = point;
+	lastTime = time;
+	return true;
+}
+
+void PointIngestor::rebuild(const StrokeDocument& document) {
+	inked.clear();
+	if (!settings.globalDedup) return;
+
+	inked.reserve(document.pointCount());
+	std::vector<ImVec2> outline;
+	for (const Stroke& stroke : document.strokes()) {
+		// Freehand points are unpacked as they are, shapes only store their control points so the points of their
+		// outline stand in for the ones drawn
+		strokeOutline(document, stroke, settings.cellSize * 0.5f, outline);
+		for (ImVec2 point : outline) inked.insert(cellKey(point));
+	}
+}
+
+void PointIngestor::clear() {
+	hasLast = false;
+	inked.clear();
+}
@@ -0,0 +1,47 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <cstdint>
+#include <unordered_set>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+
+struct IngestSettings {
+	float minDistance = 1.f;  // pixels the pointer has to move before another point is taken
+	double minInterval = 0.0;  // seconds between accepted points, 0 takes every one
+	bool globalDedup = false;  // also drop points that land on a cell already inked by any stroke
+	float cellSize = 1.f;  // size of a global dedup cell in pixels
+};
+
+/**
+* Decides which pointer samples make it into the active stroke
+* Samples are only compared against the last accepted one, so the cost doesn't grow with the board
+* With globalDedup on, a spatial hash of inked cells is kept as well (still constant time per sample)
+*/
+class PointIngestor {
+public:
+	IngestSettings settings;
+
+	PointIngestor() = default;
+	explicit PointIngestor(const IngestSettings& settings) : settings(settings) {}
+
+	// Call when a new stroke starts
+	void begin();
+	bool accept(ImVec2 point, double time);
+
+	/**
+	* The global hash only ever grows, after strokes are removed it has to be rebuilt from the document
+	*/
+	void rebuild(const StrokeDocument& document);
+	void clear();
+
+private:
+	uint64_t cellKey(ImVec2 point) const;
+
+	bool hasLast = false;
+	ImVec2 last;
+	double lastTime = 0.0;
+	std::unordered_set<uint64_t> inked;
+};
+
+#endif // INGEST_H
@@ -0,0 +1,79 @@
+#include "input_recorder.h"
+#include <sstream>
+
+bool InputRecorder::open(const std::string& path) {
+	close();
+	file.open(path);
+	if (!file) return false;
+
+	file.precision(17);
+	file << "# whiteboard recording 2\n";
+	return true;
+}
+
+void InputRecorder::record(const FrameInput& input) {
+	if (!file.is_open()) return;
+
+	unsigned flags = (input.leftDown ? RECORD_LEFT_DOWN : 0) | (input.rightDown ? RECORD_RIGHT_DOWN : 0)
+		| (input.undoClicked ? RECORD_UNDO : 0) | (input.redoClicked ? RECORD_REDO : 0) | (input.snapHeld ? RECORD_SNAP : 0)
+		| (input.cycleTool ? RECORD_CYCLE_TOOL : 0) | (input.uiCaptured ? RECORD_UI_CAPTURED : 0)
+		| (input.middleDown ? RECORD_MIDDLE_DOWN : 0) | (input.resetView ? RECORD_RESET_VIEW : 0);
+	file << "F " << input.time << ' ' << input.mouse.x << ' ' << input.mouse.y << ' ' << flags << ' ' << input.sampleCount << ' ' << input.wheel << '\n';
+	for (size_t i = 0; i < input.sampleCount; i++) {
+		const PointerSample& sample = input.samples[i];
+		file << "S " << sample.time << ' ' << sample.x << ' ' << sample.y << ' ' << sample.pressure << ' ' << (int) sample.buttons << '\n';
+	}
+}
+
+void InputRecorder::close() {
+	if (file.is_open()) file.close();
+}
+
+bool loadRecording(const std::string& path, std::vector<RecordedFrame>& frames) {
+	std::ifstream file(path);
+	if (!file) return false;
+
+	frames.clear();
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+
+		std::istringstream fields(line);
+		char kind = 0;
+		fields >> kind;
+		if (kind == 'F') {
+			RecordedFrame frame;
+			unsigned flags = 0;
+			size_t sampleCount = 0;
+			if (!(fields >> frame.input.time >> frame.input.mouse.x >> frame.input.mouse.y >> flags >> sampleCount)) return false;
+			frame.input.leftDown = flags & RECORD_LEFT_DOWN;
+			frame.input.rightDown = flags & RECORD_RIGHT_DOWN;
+			frame.input.undoClicked = flags & RECORD_UNDO;
+			frame.input.redoClicked = flags & RECORD_REDO;
+			frame.input.snapHeld = flags & RECORD_SNAP;
+			frame.input.cycleTool = flags & RECORD_CYCLE_TOOL;
+			frame.input.uiCaptured = flags & RECORD_UI_CAPTURED;
+			frame.input.middleDown = flags & RECORD_MIDDLE_DOWN;
+			frame.input.resetView = flags & RECORD_RESET_VIEW;
+			if (!(fields >> frame.input.wheel)) frame.input.wheel = 0.f;
+			frame.samples.reserve(sampleCount);
+			frames.push_back(std::move(frame));
+		}
+		else if (kind == 'S') {
+			if (frames.empty()) return false;
+			PointerSample sample{};
+			int buttons = 0;
+			if (!(fields >> sample.time >> sample.x >> sample.y >> sample.pressure >> buttons)) return false;
+			sample.buttons = (uint8_t) buttons;
+			frames.back().samples.push_back(sample);
+		}
+		else return false;
+	}
+
+	// Only now that nothing else is pushed can the frames point at their samples
+	for (RecordedFrame& frame : frames) {
+		frame.input.samples = frame.samples.data();
+		frame.input.sampleCount = frame.samples.size();
+	}
+	return true;
+}
@@ -0,0 +1,49 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "whiteboard.h"
+
+/**
+* Recording layout, one frame per "F" line followed by that frame's pointer samples
+* F time mouseX mouseY flags sampleCount wheel
+* S time x y pressure buttons
+* flags is a bit set of the FrameInput buttons and keys, wheel is missing from version 1 recordings
+*/
+const unsigned RECORD_LEFT_DOWN = 1 << 0;
+const unsigned RECORD_RIGHT_DOWN = 1 << 1;
+const unsigned RECORD_UNDO = 1 << 2;
+const unsigned RECORD_REDO = 1 << 3;
+const unsigned RECORD_SNAP = 1 << 4;
+const unsigned RECORD_CYCLE_TOOL = 1 << 5;
+const unsigned RECORD_UI_CAPTURED = 1 << 6;
+const unsigned RECORD_MIDDLE_DOWN = 1 << 7;
+const unsigned RECORD_RESET_VIEW = 1 << 8;
+
+/**
+* A frame read back from a recording, input.samples points into samples
+*/
+struct RecordedFrame {
+	FrameInput input;
+	std::vector<PointerSample> samples;
+};
+
+/**
+* Writes every frame's input to a file as it happens, so a session can be replayed exactly
+*/
+class InputRecorder {
+public:
+	bool open(const std::string& path);
+	void record(const FrameInput& input);
+	void close();
+	bool isOpen() const { return file.is_open(); }
+
+private:
+	std::ofstream file;
+};
+
+bool loadRecording(const std::string& path, std::vector<RecordedFrame>& frames);
+
+#endif // INPUT_RECORDER_H
@@ -0,0 +1,88 @@
+#include "input_source.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+// Weight of the newest frame in the moving averages
+const double STATS_SMOOTHING = 0.05;
+
+double monotonicSeconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+ReplaySource::~ReplaySource() {
+	stop();
+}
+
+bool ReplaySource::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) return false;
+
+	samples.clear();
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+
+		std::istringstream fields(line);
+		PointerSample sample{};
+		int buttons = 0;
+		if (!(fields >> sample.time >> sample.x >> sample.y >> sample.pressure >> buttons)) return false;
+		sample.buttons = (uint8_t) buttons;
+		samples.push_back(sample);
+	}
+	return true;
+}
+
+bool saveSamples(const std::string& path, const std::vector<PointerSample>& samples) {
+	std::ofstream file(path);
+	if (!file) return false;
+
+	file << "# time x y pressure buttons\n";
+	for (const PointerSample& sample : samples) {
+		file << sample.time << ' ' << sample.x << ' ' << sample.y << ' ' << sample.pressure << ' ' << (int) sample.buttons << '\n';
+	}
+	return (bool) file;
+}
+
+bool ReplaySource::start(SampleQueue& queue) {
+	stop();
+	running = true;
+	done = false;
+
+	worker = std::thread([this, &queue]() {
+		double start = monotonicSeconds();
+		double first = samples.empty() ? 0.0 : samples.front().time;
+		for (const PointerSample& recorded : samples) {
+			double due = start + (recorded.time - first);
+			while (running && monotonicSeconds() < due) {
+				std::this_thread::sleep_for(std::chrono::microseconds(250));
+			}
+			if (!running) break;
+
+			PointerSample sample = recorded;
+			sample.time = monotonicSeconds();
+			queue.push(sample);
+		}
+		done = true;
+	});
+	return true;
+}
+
+void ReplaySource::stop() {
+	running = false;
+	if (worker.joinable()) worker.join();
+}
+
+void InputStats::frame(const PointerSample* batch, size_t count, double now) {
+	lastFrameSamples = count;
+	totalSamples += count;
+	samplesPerFrame += (count - samplesPerFrame) * STATS_SMOOTHING;
+
+	for (size_t i = 0; i < count; i++) {
+		double age = now - batch[i].time;
+		latency += (age - latency) * STATS_SMOOTHING;
+		maxLatency = std::max(maxLatency, age);
+	}
+}
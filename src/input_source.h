@@ -0,0 +1,77 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_queue.h"
+
+const uint8_t POINTER_LEFT = 1 << 0;
+const uint8_t POINTER_RIGHT = 1 << 1;
+
+/**
+* One pointer position, x / y are in window client coordinates
+* time is in seconds on the monotonicSeconds() clock, at the moment the sample was taken (not when it was read)
+*/
+struct PointerSample {
+	float x;
+	float y;
+	float pressure;  // 0-1, 1 for devices without pressure
+	uint8_t buttons;
+	double time;
+};
+
+typedef SpscQueue<PointerSample, 4096> SampleQueue;
+
+double monotonicSeconds();
+
+/**
+* Something that produces pointer samples on its own thread and pushes every one of them onto a queue
+* The render loop drains the queue once per frame, so no movement between frames is lost
+*/
+class InputSource {
+public:
+	virtual ~InputSource() = default;
+	virtual bool start(SampleQueue& queue) = 0;
+	virtual void stop() = 0;
+};
+
+/**
+* Plays back samples from a text file with one "time x y pressure buttons" sample per line
+* Samples are pushed at their recorded times relative to start(), the same way a live device would deliver them
+*/
+class ReplaySource : public InputSource {
+public:
+	~ReplaySource() override;
+
+	bool load(const std::string& path);
+	void setSamples(std::vector<PointerSample> samples) { this->samples = std::move(samples); }
+	bool start(SampleQueue& queue) override;
+	void stop() override;
+	bool finished() const { return done.load(); }
+
+private:
+	std::vector<PointerSample> samples;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> done{ false };
+};
+
+bool saveSamples(const std::string& path, const std::vector<PointerSample>& samples);
+
+/**
+* Rolling numbers on how the samples are arriving, fed with each frame's batch
+*/
+struct InputStats {
+	size_t lastFrameSamples = 0;
+	double samplesPerFrame = 0.0;  // moving average
+	double latency = 0.0;  // moving average, seconds from a sample being taken to it being drained
+	double maxLatency = 0.0;
+	size_t totalSamples = 0;
+
+	void frame(const PointerSample* batch, size_t count, double now);
+};
+
+#endif // INPUT_SOURCE_H
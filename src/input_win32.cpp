@@ -0,0 +1,89 @@
+#include "input_win32.h"
+#include <chrono>
+
+// Size of the system's mouse move history
+const int MOUSE_HISTORY = 64;
+
+static bool samePoint(const MOUSEMOVEPOINT& a, const MOUSEMOVEPOINT& b) {
+	return a.x == b.x && a.y == b.y && a.time == b.time;
+}
+
+Win32MouseSource::~Win32MouseSource() {
+	stop();
+}
+
+bool Win32MouseSource::start(SampleQueue& queue) {
+	stop();
+
+	origin = {};
+	if (!ClientToScreen(window, &origin)) return false;
+
+	hasLast = false;
+	running = true;
+	worker = std::thread([this, &queue]() {
+		while (running) {
+			poll(queue);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	return true;
+}
+
+void Win32MouseSource::stop() {
+	running = false;
+	if (worker.joinable()) worker.join();
+}
+
+void Win32MouseSource::poll(SampleQueue& queue) {
+	POINT cursor{};
+	if (!GetCursorPos(&cursor)) return;
+
+	MOUSEMOVEPOINT current{};
+	current.x = cursor.x & 0x0000FFFF;
+	current.y = cursor.y & 0x0000FFFF;
+
+	MOUSEMOVEPOINT history[MOUSE_HISTORY];
+	int count = GetMouseMovePointsEx(sizeof(MOUSEMOVEPOINT), &current, history, MOUSE_HISTORY, GMMP_USE_DISPLAY_POINTS);
+	if (count <= 0) return;
+
+	uint8_t buttons = 0;
+	if (GetAsyncKeyState(VK_LBUTTON) & 0x8000) buttons |= POINTER_LEFT;
+	if (GetAsyncKeyState(VK_RBUTTON) & 0x8000) buttons |= POINTER_RIGHT;
+
+	// Everything in the history on the first poll was moved before we started
+	if (!hasLast) {
+		last = history[0];
+		lastButtons = buttons;
+		hasLast = true;
+		return;
+	}
+
+	// History is newest first, take moves up to where we got to last time, or to one older than it if that has gone
+	// (tick counts wrap, so they are compared by their difference)
+	int fresh = 0;
+	while (fresh < count && !samePoint(history[fresh], last) && (LONG) (history[fresh].time - last.time) >= 0) fresh++;
+	if (fresh == 0) {
+		lastButtons = buttons;
+		return;
+	}
+	last = history[0];
+
+	// Move times are GetTickCount milliseconds, turn them into ages and take those off our clock
+	double now = monotonicSeconds();
+	DWORD ticks = GetTickCount();
+	for (int i = fresh - 1; i >= 0; i--) {
+		const MOUSEMOVEPOINT& move = history[i];
+		int x = move.x > 32767 ? move.x - 65536 : move.x;
+		int y = move.y > 32767 ? move.y - 65536 : move.y;
+
+		PointerSample sample{};
+		sample.x = (float) (x - origin.x);
+		sample.y = (float) (y - origin.y);
+		sample.pressure = 1.f;
+		// A press or release happened some time before we read it, the newest move is the only one known to be after it
+		sample.buttons = i == 0 ? buttons : lastButtons;
+		sample.time = now - (DWORD) (ticks - move.time) / 1000.0;
+		queue.push(sample);
+	}
+	lastButtons = buttons;
+}
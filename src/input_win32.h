@@ -0,0 +1,36 @@
+#ifndef INPUT_WIN32_H
+#define INPUT_WIN32_H
+
+#include <Windows.h>
+#include <atomic>
+#include <thread>
+#include "input_source.h"
+
+/**
+* Reads the system's mouse move history (GetMouseMovePointsEx) on its own thread
+* Windows keeps the last 64 moves, so every coalesced movement gets through even though we only poll every millisecond or so
+* Only moves made after start() are taken, the first poll just marks where the history is up to
+* Buttons are read when the history is, so only the newest move of a poll gets them, the ones before it keep the buttons
+* the last poll read. Mice have no pressure so it is always 1.
+*/
+class Win32MouseSource : public InputSource {
+public:
+	explicit Win32MouseSource(HWND window) : window(window) {}
+	~Win32MouseSource() override;
+
+	bool start(SampleQueue& queue) override;
+	void stop() override;
+
+private:
+	void poll(SampleQueue& queue);
+
+	HWND window;
+	POINT origin{};
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	MOUSEMOVEPOINT last{};
+	bool hasLast = false;
+	uint8_t lastButtons = 0;
+};
+
+#endif // INPUT_WIN32_H
@@ -0,0 +1,177 @@
+#include "layered_session.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+// The id LayerStack gives the layer a board starts out with
+const LayerId FIRST_LAYER = 1;
+
+template<typename T> static void put(std::vector<uint8_t>& out, T value) {
+	size_t at = out.size();
+	out.resize(at + sizeof(T));
+	std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+template<typename T> static bool get(const uint8_t*& at, const uint8_t* end, T& value) {
+	if ((size_t) (end - at) < sizeof(T)) return false;
+	std::memcpy(&value, at, sizeof(T));
+	at += sizeof(T);
+	return true;
+}
+
+bool writeLayerManifest(const std::string& path, const std::vector<LayerInfo>& layers) {
+	std::vector<uint8_t> bytes(LAYERS_MAGIC, LAYERS_MAGIC + sizeof(LAYERS_MAGIC));
+	put(bytes, LAYERS_VERSION);
+	put(bytes, (uint32_t) layers.size());
+	for (const LayerInfo& layer : layers) {
+		uint16_t length = (uint16_t) std::min<size_t>(layer.name.size(), UINT16_MAX);
+		put(bytes, layer.id);
+		put(bytes, (uint8_t) layer.visible);
+		put(bytes, length);
+		bytes.insert(bytes.end(), layer.name.begin(), layer.name.begin() + length);
+	}
+
+	std::string temporary = path + ".tmp";
+	FILE* file = std::fopen(temporary.c_str(), "wb");
+	if (!file) return false;
+	bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	ok = std::fclose(file) == 0 && ok;
+	if (!ok) return false;
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
+
+bool readLayerManifest(const std::string& path, std::vector<LayerInfo>& layers) {
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file) return false;
+	std::vector<uint8_t> bytes;
+	uint8_t buffer[4096];
+	for (size_t read; (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) bytes.insert(bytes.end(), buffer, buffer + read);
+	std::fclose(file);
+
+	const uint8_t* at = bytes.data();
+	const uint8_t* end = at + bytes.size();
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	if (!get(at, end, magic) || std::memcmp(magic, LAYERS_MAGIC, sizeof(magic)) != 0) return false;
+	if (!get(at, end, version) || version == 0 || version > LAYERS_VERSION || !get(at, end, count)) return false;
+
+	layers.clear();
+	for (uint32_t i = 0; i < count; i++) {
+		LayerInfo layer{};
+		uint8_t visible;
+		uint16_t length;
+		if (!get(at, end, layer.id) || !get(at, end, visible) || !get(at, end, length)) return false;
+		if (layer.id == INVALID_LAYER || (size_t) (end - at) < length) return false;
+		layer.visible = visible != 0;
+		layer.name.assign((const char*) at, length);
+		at += length;
+		layers.push_back(layer);
+	}
+	return !layers.empty();
+}
+
+LayeredSession::LayeredSession(LayerStack& layers) : layers(layers) {
+	layers.addListener(this);
+}
+
+LayeredSession::~LayeredSession() {
+	close();
+	layers.removeListener(this);
+}
+
+std::string LayeredSession::layerPath(LayerId id) const {
+	return id == FIRST_LAYER ? path : path + "." + std::to_string(id);
+}
+
+bool LayeredSession::open(const std::string& path) {
+	close();
+	this->path = path;
+
+	std::vector<LayerInfo> saved;
+	std::string manifestPath = path + ".layers";
+	if (!readLayerManifest(manifestPath, saved)) {
+		// Kept rather than written over, the layers it listed are still on disk next to it
+		std::error_code error;
+		if (std::filesystem::exists(manifestPath, error) && moveAside(manifestPath).empty()) {
+			this->path.clear();
+			return false;
+		}
+		saved = { { FIRST_LAYER, "Layer 1", true } };
+	}
+	layers.restore(saved);
+
+	bool ok = true;
+	for (size_t i = 0; i < layers.size(); i++) {
+		Layer& layer = layers[i];
+		auto session = std::make_unique<BoardSession>(layer.document());
+		ok = session->open(layerPath(layer.id())) && ok;
+		sessions[layer.id()] = std::move(session);
+	}
+	saveManifest();
+	return ok;
+}
+
+void LayeredSession::close() {
+	if (sessions.empty()) return;
+
+	if (manifestChanged) saveManifest();
+	// Each one folds its journal into its board file as it goes
+	sessions.clear();
+}
+
+void LayeredSession::update() {
+	if (manifestChanged) saveManifest();
+	for (auto& [id, session] : sessions) session->update();
+}
+
+void LayeredSession::compactInBackground() {
+	for (auto& [id, session] : sessions) session->compactInBackground();
+}
+
+size_t LayeredSession::journalSize() const {
+	size_t total = 0;
+	for (const auto& [id, session] : sessions) total += session->journalSize();
+	return total;
+}
+
+void LayeredSession::saveManifest() {
+	layers.describe(described);
+	manifestChanged = !writeLayerManifest(path + ".layers", described);
+}
+
+void LayeredSession::layerAdded(Layer& layer) {
+	if (path.empty()) return;
+
+	auto session = std::make_unique<BoardSession>(layer.document());
+	session->open(layerPath(layer.id()));
+	sessions[layer.id()] = std::move(session);
+	manifestChanged = true;
+}
+
+void LayeredSession::layerRemoved(Layer& layer) {
+	auto session = sessions.find(layer.id());
+	if (session == sessions.end()) return;
+
+	// Out of the manifest first, so a crash part way through never lists a layer whose files are gone
+	manifestChanged = true;
+	std::vector<LayerInfo> remaining;
+	layers.describe(remaining);
+	std::erase_if(remaining, [&](const LayerInfo& info) { return info.id == layer.id(); });
+	if (writeLayerManifest(path + ".layers", remaining)) session->second->discard();
+	sessions.erase(session);
+}
+
+void LayeredSession::layerSwapped(Layer& layer, const StrokeDocument&) {
+	auto session = sessions.find(layer.id());
+	if (session != sessions.end()) session->second->switchDocument(layer.document());
+}
+
+void LayeredSession::layersChanged() {
+	// Not while closed, eg. on a board joined from another instance
+	if (!path.empty()) manifestChanged = true;
+}
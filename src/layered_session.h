@@ -0,0 +1,64 @@
+#ifndef LAYERED_SESSION_H
+#define LAYERED_SESSION_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "board_file.h"
+#include "layers.h"
+
+/**
+* Layer manifest layout (little endian)
+* LAYERS_MAGIC, LAYERS_VERSION as a uint32, the layer count as a uint32, then for each layer from the bottom up its id
+* as a uint32, whether it is visible as a uint8, and its name as a uint16 byte count followed by that many UTF-8 bytes
+*/
+const char LAYERS_MAGIC[4] = { 'W', 'B', 'L', 'Y' };
+const uint32_t LAYERS_VERSION = 1;
+
+bool writeLayerManifest(const std::string& path, const std::vector<LayerInfo>& layers);
+bool readLayerManifest(const std::string& path, std::vector<LayerInfo>& layers);
+
+/**
+* Keeps every layer of a board saved
+* Each layer has its own board file and journal (see BoardSession), with a manifest next to them listing the layers in
+* order. The layer a board starts out with keeps the board's own path, so a board saved before there were layers opens
+* as that layer, the others go next to it with their id on the end.
+*/
+class LayeredSession : public LayerListener {
+public:
+	explicit LayeredSession(LayerStack& layers);
+	~LayeredSession();
+	LayeredSession(const LayeredSession&) = delete;
+	LayeredSession& operator=(const LayeredSession&) = delete;
+
+	/**
+	* Replaces the stack's layers with the saved ones and loads each of them, then keeps them all saved
+	*/
+	bool open(const std::string& path);
+	void close();
+
+	// Call once a frame, writes the manifest if anything in it changed and updates each layer's session
+	void update();
+	void compactInBackground();
+
+	size_t journalSize() const;
+
+	void layerAdded(Layer& layer) override;
+	void layerRemoved(Layer& layer) override;
+	void layerSwapped(Layer& layer, const StrokeDocument& previous) override;
+	void layersChanged() override;
+
+private:
+	std::string layerPath(LayerId id) const;
+	void saveManifest();
+
+	LayerStack& layers;
+	std::string path;
+	std::unordered_map<LayerId, std::unique_ptr<BoardSession>> sessions;
+	bool manifestChanged = false;
+	std::vector<LayerInfo> described;
+};
+
+#endif // LAYERED_SESSION_H
@@ -0,0 +1,286 @@
+#include "layers.h"
+#include <algorithm>
+#include <utility>
+
+LayerContents::LayerContents(DamageTracker& damage, const DrawingSettings& settings, const TessellationSettings& tessellation)
+	: history(settings), cache(document), spatialIndex(document), eraser(document, spatialIndex), snapper(document, spatialIndex), damage(damage) {
+	cache.setTessellation(tessellation);
+	document.addListener(&damage);
+}
+
+LayerContents::~LayerContents() {
+	document.removeListener(&damage);
+}
+
+void LayerContents::pack() {
+	if (packed || document.isDrawing()) return;
+
+	cache.release();
+	spatialIndex.release();
+	ingestor.clear();
+	document.shrink();
+	packed = true;
+}
+
+void LayerContents::unpack() {
+	if (!packed) return;
+
+	ingestor.rebuild(document);
+	packed = false;
+}
+
+void LayerContents::reindex() {
+	if (spatialIndex.isReleased()) spatialIndex.rebuild();
+}
+
+size_t LayerContents::memoryUsage() const {
+	return document.memoryUsage() + history.memoryUsage() + cache.memoryUsage() + spatialIndex.memoryUsage();
+}
+
+Layer::Layer(LayerId id, std::string name, DamageTracker& damage, const DrawingSettings& settings, const TessellationSettings& tessellation)
+	: name(std::move(name)), layerId(id), damage(damage), settings(settings), tessellation(tessellation),
+	current(std::make_unique<LayerContents>(damage, settings, tessellation)) {}
+
+LayerContents& Layer::contents() {
+	unpacked().reindex();
+	return *current;
+}
+
+LayerContents& Layer::unpacked() {
+	if (current->packed) {
+		current->unpack();
+		// Start the clock again, rather than packing it straight back up if it is still hidden
+		hiddenAt = -1.0;
+	}
+	return *current;
+}
+
+void Layer::commit(HistoryEntry entry) {
+	// Anything new after undoing a clear means it can't be redone
+	if (cleared && clearUndone) cleared.reset();
+	current->history.commit(std::move(entry));
+}
+
+bool Layer::undo() {
+	if (current->history.canUndo()) {
+		LayerContents& ink = contents();
+		if (ink.history.undo(ink.document)) ink.ingestor.rebuild(ink.document);
+		return true;
+	}
+	if (!cleared || clearUndone) return false;
+
+	swapCleared();
+	clearUndone = true;
+	return true;
+}
+
+bool Layer::redo() {
+	if (current->history.canRedo()) {
+		LayerContents& ink = contents();
+		if (ink.history.redo(ink.document)) ink.ingestor.rebuild(ink.document);
+		return true;
+	}
+	if (!cleared || !clearUndone) return false;
+
+	swapCleared();
+	clearUndone = false;
+	return true;
+}
+
+void Layer::swapCleared() {
+	std::swap(current, cleared);
+	current->document.continueIds(cleared->document);
+	clearedAt = -1.0;
+	if (!visible) hiddenAt = -1.0;
+	damage.addAll();
+}
+
+bool Layer::clear(double time) {
+	if (current->document.strokes().empty() || current->document.isDrawing()) return false;
+
+	// Whatever an earlier clear kept goes now, and so does anything that could be redone, as when something new is committed
+	current->history.discardRedo();
+	cleared = std::move(current);
+	current = std::make_unique<LayerContents>(damage, settings, tessellation);
+	current->document.continueIds(cleared->document);
+	clearUndone = false;
+	clearedAt = time;
+	damage.addAll();
+	return true;
+}
+
+bool Layer::packIdle(double time) {
+	// -1 is a clock that hasn't started yet, it starts now
+	if (clearedAt < 0.0) clearedAt = time;
+	if (hiddenAt < 0.0) hiddenAt = time;
+
+	if (cleared && !cleared->packed && time - clearedAt >= LAYER_PACK_DELAY) {
+		cleared->pack();
+		return true;
+	}
+	if (!visible && !current->packed && time - hiddenAt >= LAYER_PACK_DELAY) {
+		current->pack();
+		return true;
+	}
+	return false;
+}
+
+size_t Layer::memoryUsage() const {
+	return sizeof(Layer) + name.capacity() + current->memoryUsage() + (cleared ? cleared->memoryUsage() : 0);
+}
+
+LayerStack::LayerStack(DamageTracker& damage, const DrawingSettings& settings) : damage(damage), settings(settings) {
+	layers.push_back(create(nextId++, "Layer 1"));
+}
+
+std::unique_ptr<Layer> LayerStack::create(LayerId id, const std::string& name) {
+	return std::make_unique<Layer>(id, name, damage, settings, tessellation);
+}
+
+Layer* LayerStack::find(LayerId id) {
+	for (std::unique_ptr<Layer>& layer : layers) {
+		if (layer->id() == id) return layer.get();
+	}
+	return nullptr;
+}
+
+Layer& LayerStack::add(const std::string& name) {
+	activeIndex = layers.empty() ? 0 : activeIndex + 1;
+	Layer& layer = **layers.insert(layers.begin() + activeIndex, create(nextId++, name));
+	notify([&](LayerListener* listener) { listener->layerAdded(layer); });
+	return layer;
+}
+
+bool LayerStack::remove(size_t index) {
+	if (layers.size() <= 1 || index >= layers.size()) return false;
+
+	notify([&](LayerListener* listener) { listener->layerRemoved(*layers[index]); });
+	if (layers[index]->isVisible()) damage.addAll();
+	layers.erase(layers.begin() + index);
+	if (activeIndex > index || activeIndex == layers.size()) activeIndex--;
+	return true;
+}
+
+bool LayerStack::move(size_t index, int direction) {
+	size_t target = index + direction;
+	if (index >= layers.size() || target >= layers.size()) return false;
+
+	std::swap(layers[index], layers[target]);
+	if (activeIndex == index) activeIndex = target;
+	else if (activeIndex == target) activeIndex = index;
+	damage.addAll();
+	notify([&](LayerListener* listener) { listener->layersChanged(); });
+	return true;
+}
+
+void LayerStack::setActive(size_t index) {
+	if (index < layers.size()) activeIndex = index;
+}
+
+void LayerStack::setVisible(size_t index, bool visible, double time) {
+	Layer& layer = *layers[index];
+	if (layer.visible == visible) return;
+
+	layer.visible = visible;
+	layer.hiddenAt = time;
+	damage.addAll();
+	notify([&](LayerListener* listener) { listener->layersChanged(); });
+}
+
+bool LayerStack::clear(size_t index, double time) {
+	Layer& layer = *layers[index];
+	if (!layer.clear(time)) return false;
+
+	notify([&](LayerListener* listener) { listener->layerSwapped(layer, layer.cleared->document); });
+	return true;
+}
+
+void LayerStack::rename(size_t index, const std::string& name) {
+	if (layers[index]->name == name) return;
+
+	layers[index]->name = name;
+	notify([&](LayerListener* listener) { listener->layersChanged(); });
+}
+
+void LayerStack::commit(HistoryEntry entry) {
+	active().commit(std::move(entry));
+}
+
+bool LayerStack::undo() {
+	Layer& layer = active();
+	bool swapping = !layer.current->history.canUndo();
+	if (!layer.undo()) return false;
+
+	if (swapping) notify([&](LayerListener* listener) { listener->layerSwapped(layer, layer.cleared->document); });
+	return true;
+}
+
+bool LayerStack::redo() {
+	Layer& layer = active();
+	bool swapping = !layer.current->history.canRedo();
+	if (!layer.redo()) return false;
+
+	if (swapping) notify([&](LayerListener* listener) { listener->layerSwapped(layer, layer.cleared->document); });
+	return true;
+}
+
+void LayerStack::restore(const std::vector<LayerInfo>& saved) {
+	layers.clear();
+	nextId = 1;
+	for (const LayerInfo& info : saved) {
+		std::unique_ptr<Layer> layer = create(info.id, info.name);
+		layer->visible = info.visible;
+		layer->hiddenAt = -1.0;
+		layers.push_back(std::move(layer));
+		nextId = std::max(nextId, info.id + 1);
+	}
+	if (layers.empty()) layers.push_back(create(nextId++, "Layer 1"));
+	activeIndex = layers.size() - 1;
+	damage.addAll();
+}
+
+void LayerStack::describe(std::vector<LayerInfo>& out) const {
+	out.clear();
+	for (const std::unique_ptr<Layer>& layer : layers) out.push_back({ layer->id(), layer->name, layer->isVisible() });
+}
+
+void LayerStack::update(double time) {
+	for (std::unique_ptr<Layer>& layer : layers) {
+		if (layer->packIdle(time)) return;
+	}
+}
+
+void LayerStack::setTessellation(const TessellationSettings& settings) {
+	tessellation = settings;
+	for (std::unique_ptr<Layer>& layer : layers) {
+		layer->tessellation = settings;
+		layer->current->cache.setTessellation(settings);
+		if (layer->cleared) layer->cleared->cache.setTessellation(settings);
+	}
+}
+
+size_t LayerStack::strokeCount() const {
+	size_t total = 0;
+	for (const std::unique_ptr<Layer>& layer : layers) total += layer->document().strokes().size();
+	return total;
+}
+
+size_t LayerStack::pointCount() const {
+	size_t total = 0;
+	for (const std::unique_ptr<Layer>& layer : layers) total += layer->document().pointCount();
+	return total;
+}
+
+size_t LayerStack::memoryUsage() const {
+	size_t total = layers.capacity() * sizeof(std::unique_ptr<Layer>);
+	for (const std::unique_ptr<Layer>& layer : layers) total += layer->memoryUsage();
+	return total;
+}
+
+void LayerStack::addListener(LayerListener* listener) {
+	listeners.push_back(listener);
+}
+
+void LayerStack::removeListener(LayerListener* listener) {
+	listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
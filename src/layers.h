@@ -0,0 +1,214 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "stroke_document.h"
+#include "history.h"
+#include "ingest.h"
+#include "lod_cache.h"
+#include "spatial_index.h"
+#include "eraser.h"
+#include "snapping.h"
+#include "damage.h"
+
+typedef uint32_t LayerId;
+const LayerId INVALID_LAYER = 0;
+
+// Seconds a layer has to stay hidden (or cleared) before its geometry and ingestor are freed, so flicking it
+// off and on again costs nothing
+const double LAYER_PACK_DELAY = 5.0;
+
+/**
+* Everything drawn on one layer, with what it takes to draw and edit it
+* The document comes before everything that listens to it
+*/
+struct LayerContents {
+	LayerContents(DamageTracker& damage, const DrawingSettings& settings, const TessellationSettings& tessellation);
+	~LayerContents();
+	LayerContents(const LayerContents&) = delete;
+	LayerContents& operator=(const LayerContents&) = delete;
+
+	// Frees the geometry caches, index and ingestor (the points are always packed), unpack() only brings the ingestor back, reindex() the index
+	void pack();
+	void unpack();
+	void reindex();
+	size_t memoryUsage() const;
+
+	StrokeDocument document;
+	History history;
+	PointIngestor ingestor;
+	LodCache cache;
+	SpatialIndex spatialIndex;
+	Eraser eraser;
+	SnapEngine snapper;
+	bool packed = false;
+
+private:
+	DamageTracker& damage;
+};
+
+/**
+* A named sheet of strokes drawn over the layers below it
+* Clearing swaps in fresh contents and keeps the old ones, so it is undone by swapping them back rather than by copying
+* every stroke into the history. Undo / redo step through the current contents' history first and only then across
+* the clear.
+*/
+class Layer {
+public:
+	Layer(LayerId id, std::string name, DamageTracker& damage, const DrawingSettings& settings, const TessellationSettings& tessellation);
+
+	LayerId id() const { return layerId; }
+	bool isVisible() const { return visible; }
+	bool isPacked() const { return current->packed; }
+
+	/**
+	* The layer's strokes, history, caches and tools, unpacked and indexed first if they were packed away
+	*/
+	LayerContents& contents();
+	/**
+	* Enough to draw the layer, the ingestor is back but the spatial index is left for whenever the tools need it
+	*/
+	LayerContents& unpacked();
+	/**
+	* The contents as they are, without unpacking them, so its index and caches may be empty
+	*/
+	const LayerContents& peek() const { return *current; }
+	StrokeDocument& document() { return current->document; }
+	const StrokeDocument& document() const { return current->document; }
+
+	bool canUndo() const { return current->history.canUndo() || (cleared && !clearUndone); }
+	bool canRedo() const { return current->history.canRedo() || (cleared && clearUndone); }
+
+	size_t memoryUsage() const;
+
+	std::string name;
+
+private:
+	friend class LayerStack;
+
+	void commit(HistoryEntry entry);
+	bool undo();
+	bool redo();
+	// Returns false if there was nothing to clear
+	bool clear(double time);
+	void swapCleared();
+	// Packs whatever has been out of sight for LAYER_PACK_DELAY, returns true if anything was packed
+	bool packIdle(double time);
+
+	LayerId layerId;
+	DamageTracker& damage;
+	DrawingSettings settings;
+	TessellationSettings tessellation;
+	std::unique_ptr<LayerContents> current;
+	std::unique_ptr<LayerContents> cleared;  // what the last clear swapped out, or the empty contents if it was undone
+	bool clearUndone = false;
+	double clearedAt = 0.0;
+	bool visible = true;
+	double hiddenAt = 0.0;
+};
+
+/**
+* Gets told about layers being added, removed and changed, eg. to keep each one saved
+*/
+class LayerListener {
+public:
+	virtual ~LayerListener() = default;
+	virtual void layerAdded(Layer& /*layer*/) {}
+	// Called before the layer is destroyed
+	virtual void layerRemoved(Layer& /*layer*/) {}
+	// The layer's document was swapped for another by a clear, or by undoing / redoing one
+	virtual void layerSwapped(Layer& /*layer*/, const StrokeDocument& /*previous*/) {}
+	// A name, visibility or the order changed
+	virtual void layersChanged() {}
+};
+
+/**
+* How a layer is saved, and restored in LayerStack::restore
+*/
+struct LayerInfo {
+	LayerId id;
+	std::string name;
+	bool visible;
+};
+
+/**
+* The board's layers, bottom first, and which one the tools work on
+* Hiding, showing, reordering and clearing a layer only flip a flag or swap pointers and damage the screen, anything
+* heavier (packing a hidden layer, rebaking one that comes back) is left for later frames
+*/
+class LayerStack {
+public:
+	LayerStack(DamageTracker& damage, const DrawingSettings& settings);
+	LayerStack(const LayerStack&) = delete;
+	LayerStack& operator=(const LayerStack&) = delete;
+
+	size_t size() const { return layers.size(); }
+	Layer& operator[](size_t index) { return *layers[index]; }
+	const Layer& operator[](size_t index) const { return *layers[index]; }
+	Layer& active() { return *layers[activeIndex]; }
+	const Layer& active() const { return *layers[activeIndex]; }
+	size_t activeLayer() const { return activeIndex; }
+	Layer* find(LayerId id);
+
+	/**
+	* Adds an empty layer above the active one and makes it active
+	*/
+	Layer& add(const std::string& name);
+	/**
+	* The last layer can't be removed
+	*/
+	bool remove(size_t index);
+	// Swaps the layer with the one above (+1) or below (-1) it
+	bool move(size_t index, int direction);
+	void setActive(size_t index);
+	void setVisible(size_t index, bool visible, double time);
+	bool clear(size_t index, double time);
+	void rename(size_t index, const std::string& name);
+
+	/**
+	* History of the active layer, for changes that have already been applied to its document
+	*/
+	void commit(HistoryEntry entry);
+	bool undo();
+	bool redo();
+
+	/**
+	* Replaces every layer with empty ones as described, bottom first, for loading a saved board
+	* Listeners aren't told, whoever is loading the board fills the layers in afterwards
+	*/
+	void restore(const std::vector<LayerInfo>& saved);
+	void describe(std::vector<LayerInfo>& out) const;
+
+	/**
+	* Call once a frame, packs at most one layer that has been hidden for long enough
+	*/
+	void update(double time);
+	void setTessellation(const TessellationSettings& settings);
+	const TessellationSettings& tessellationSettings() const { return tessellation; }
+
+	size_t strokeCount() const;
+	size_t pointCount() const;
+	size_t memoryUsage() const;
+
+	void addListener(LayerListener* listener);
+	void removeListener(LayerListener* listener);
+
+private:
+	std::unique_ptr<Layer> create(LayerId id, const std::string& name);
+	template<typename F> void notify(F&& call) {
+		for (LayerListener* listener : listeners) call(listener);
+	}
+
+	DamageTracker& damage;
+	DrawingSettings settings;
+	TessellationSettings tessellation;
+	std::vector<std::unique_ptr<Layer>> layers;
+	size_t activeIndex = 0;
+	LayerId nextId = 1;
+	std::vector<LayerListener*> listeners;
+};
+
+#endif // LAYERS_H
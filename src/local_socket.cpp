@@ -0,0 +1,223 @@
+#include "local_socket.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET NativeSocket;
+const int SEND_FLAGS = 0;
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+// A peer that has gone away shows up as an error from send rather than SIGPIPE
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#endif
+
+// Bytes asked of the socket per read
+const size_t RECEIVE_CHUNK = 64 * 1024;
+// Connections a listening socket keeps waiting before accept() takes them
+const int LISTEN_BACKLOG = 8;
+// How long connect() waits between tries while nobody is listening yet
+const int CONNECT_RETRY_MS = 20;
+
+static bool startNetworking() {
+#ifdef _WIN32
+	static const bool started = []() {
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}();
+	return started;
+#else
+	return true;
+#endif
+}
+
+static NativeSocket native(intptr_t handle) {
+	return (NativeSocket) handle;
+}
+
+static void closeNative(NativeSocket socket) {
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	::close(socket);
+#endif
+}
+
+static bool wouldBlock() {
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static bool setNonBlocking(NativeSocket socket) {
+#ifdef _WIN32
+	u_long on = 1;
+	return ioctlsocket(socket, FIONBIO, &on) == 0;
+#else
+	int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static void setNoDelay(NativeSocket socket) {
+	int on = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*) &on, sizeof(on));
+}
+
+static sockaddr_in loopback(uint16_t port) {
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return address;
+}
+
+LocalSocket::~LocalSocket() {
+	close();
+}
+
+LocalSocket::LocalSocket(LocalSocket&& other) noexcept
+	: handle(std::exchange(other.handle, -1)), pending(std::move(other.pending)), pendingAt(std::exchange(other.pendingAt, 0)) {}
+
+LocalSocket& LocalSocket::operator=(LocalSocket&& other) noexcept {
+	if (this != &other) {
+		close();
+		handle = std::exchange(other.handle, -1);
+		pending = std::move(other.pending);
+		pendingAt = std::exchange(other.pendingAt, 0);
+	}
+	return *this;
+}
+
+bool LocalSocket::listen(uint16_t port) {
+	close();
+	if (!startNetworking()) return false;
+
+	NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	handle = (intptr_t) socket;
+	if (handle == -1) return false;
+
+#ifndef _WIN32
+	// Lets a host start again straight away on the port it just left, on Windows this would let two hosts share it
+	int on = 1;
+	setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#endif
+	sockaddr_in address = loopback(port);
+	if (bind(socket, (const sockaddr*) &address, sizeof(address)) != 0 || ::listen(socket, LISTEN_BACKLOG) != 0 || !setNonBlocking(socket)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool LocalSocket::accept(LocalSocket& connection) {
+	if (!isOpen()) return false;
+
+	NativeSocket accepted = ::accept(native(handle), nullptr, nullptr);
+	if ((intptr_t) accepted == -1) return false;
+	if (!setNonBlocking(accepted)) {
+		closeNative(accepted);
+		return false;
+	}
+	setNoDelay(accepted);
+
+	connection.close();
+	connection.handle = (intptr_t) accepted;
+	return true;
+}
+
+bool LocalSocket::connect(uint16_t port, double timeout) {
+	close();
+	if (!startNetworking()) return false;
+
+	sockaddr_in address = loopback(port);
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+	while (true) {
+		NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if ((intptr_t) socket == -1) return false;
+
+		// Blocking, a loopback connect either goes through or is refused straight away
+		if (::connect(socket, (const sockaddr*) &address, sizeof(address)) == 0) {
+			if (!setNonBlocking(socket)) {
+				closeNative(socket);
+				return false;
+			}
+			setNoDelay(socket);
+			handle = (intptr_t) socket;
+			return true;
+		}
+		closeNative(socket);
+
+		if (std::chrono::steady_clock::now() >= deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_MS));
+	}
+}
+
+bool LocalSocket::send(const uint8_t* data, size_t size) {
+	if (!isOpen()) return false;
+
+	pending.insert(pending.end(), data, data + size);
+	return flush();
+}
+
+bool LocalSocket::flush() {
+	if (!isOpen()) return false;
+
+	while (pendingAt < pending.size()) {
+		int chunk = (int) std::min<size_t>(pending.size() - pendingAt, INT32_MAX);
+		auto sent = ::send(native(handle), (const char*) pending.data() + pendingAt, chunk, SEND_FLAGS);
+		if (sent < 0) {
+			if (wouldBlock()) break;
+			close();
+			return false;
+		}
+		pendingAt += (size_t) sent;
+	}
+
+	// Only move what is left down once most of the buffer has gone, so a slow reader doesn't make every send a copy
+	if (pendingAt == pending.size()) {
+		pending.clear();
+		pendingAt = 0;
+	}
+	else if (pendingAt > pending.size() / 2) {
+		pending.erase(pending.begin(), pending.begin() + pendingAt);
+		pendingAt = 0;
+	}
+	return true;
+}
+
+bool LocalSocket::receive(std::vector<uint8_t>& out) {
+	if (!isOpen()) return false;
+
+	while (true) {
+		size_t at = out.size();
+		out.resize(at + RECEIVE_CHUNK);
+		auto received = ::recv(native(handle), (char*) out.data() + at, (int) RECEIVE_CHUNK, 0);
+		out.resize(at + (received > 0 ? (size_t) received : 0));
+		if (received > 0) continue;
+
+		if (received < 0 && wouldBlock()) return true;
+		close();
+		return false;
+	}
+}
+
+void LocalSocket::close() {
+	if (handle != -1) closeNative(native(handle));
+	handle = -1;
+	pending.clear();
+	pendingAt = 0;
+}
@@ -0,0 +1,44 @@
+#ifndef LOCAL_SOCKET_H
+#define LOCAL_SOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+* A TCP connection to another process on the same machine, only ever over the loopback interface
+* Once connected nothing blocks: send() queues whatever the socket won't take yet for flush() to retry, and receive()
+* appends whatever has arrived. Nagle is off, callers batch their own writes.
+*/
+class LocalSocket {
+public:
+	LocalSocket() = default;
+	~LocalSocket();
+	LocalSocket(LocalSocket&& other) noexcept;
+	LocalSocket& operator=(LocalSocket&& other) noexcept;
+	LocalSocket(const LocalSocket&) = delete;
+	LocalSocket& operator=(const LocalSocket&) = delete;
+
+	// Starts taking connections on 127.0.0.1:port
+	bool listen(uint16_t port);
+	// Takes a connection that is waiting, if there is one
+	bool accept(LocalSocket& connection);
+	// Keeps trying 127.0.0.1:port for up to timeout seconds
+	bool connect(uint16_t port, double timeout);
+
+	// These return false once the connection is gone
+	bool send(const uint8_t* data, size_t size);
+	bool flush();
+	bool receive(std::vector<uint8_t>& out);
+
+	void close();
+	bool isOpen() const { return handle != -1; }
+	size_t unsent() const { return pending.size() - pendingAt; }
+
+private:
+	intptr_t handle = -1;  // a SOCKET on Windows, a file descriptor elsewhere
+	std::vector<uint8_t> pending;
+	size_t pendingAt = 0;
+};
+
+#endif // LOCAL_SOCKET_H
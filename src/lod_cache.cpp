@@ -0,0 +1,126 @@
+#include "lod_cache.h"
+#include <algorithm>
+#include <cmath>
+#include "shapes.h"
+#include "stroke_tessellator.h"
+
+LodCache::LodCache(StrokeDocument& document) : document(document), levels(LOD_FINEST - LOD_COARSEST + 1) {}
+
+int LodCache::levelFor(float zoom) {
+	// Nearest power of two, so a level is never drawn more than a factor of sqrt(2) off its own zoom
+	int lod = (int) std::lround(std::log2(zoom));
+	return std::clamp(lod, LOD_COARSEST, LOD_DIRECT);
+}
+
+void LodCache::sync(const Viewport& view) {
+	frame++;
+	int wanted = levelFor(view.zoom);
+	if (wanted == LOD_DIRECT) {
+		drawn = LOD_DIRECT;
+		return;
+	}
+
+	Level& target = level(wanted);
+	if (!target.cache) {
+		target.cache = std::make_unique<StrokeCache>(document, wanted);
+		target.cache->setTessellation(tessellation);
+	}
+	target.lastUsed = frame;
+
+	if (drawn != wanted && drawn != LOD_DIRECT && !refilling) {
+		// Keep drawing the old level while the new one bakes a bit at a time
+		Level& current = level(drawn);
+		current.cache->sync();
+		current.lastUsed = frame;
+		target.cache->sync(LOD_BAKE_BUDGET);
+	}
+	else {
+		target.cache->sync(refilling ? LOD_BAKE_BUDGET : SIZE_MAX);
+	}
+	if (target.cache->isComplete()) {
+		drawn = wanted;
+		refilling = false;
+	}
+	else if (refilling) drawn = wanted;
+
+	evict();
+}
+
+void LodCache::evict() {
+	int kept = 0;
+	for (const Level& candidate : levels) kept += candidate.cache != nullptr;
+
+	while (kept > LOD_LEVELS_KEPT) {
+		Level* oldest = nullptr;
+		for (Level& candidate : levels) {
+			if (candidate.cache && candidate.lastUsed != frame && (!oldest || candidate.lastUsed < oldest->lastUsed)) oldest = &candidate;
+		}
+		if (!oldest) return;
+
+		oldest->cache.reset();
+		kept--;
+	}
+}
+
+void LodCache::draw(ImDrawList* drawList, const Viewport& view) const {
+	if (drawn != LOD_DIRECT) {
+		level(drawn).cache->draw(drawList, view);
+		return;
+	}
+
+	size_t end = document.strokes().size();
+	if (document.isDrawing()) end--;
+	for (size_t i = 0; i < end; i++) {
+		drawDirect(drawList, document.strokes()[i], view);
+	}
+}
+
+void LodCache::drawDirect(ImDrawList* drawList, const Stroke& stroke, const Viewport& view) const {
+	float reach = tessellation.join == JoinStyle::Miter ? std::max(tessellation.miterLimit, 1.f) : 1.f;
+	float pad = stroke.style.thickness * 0.5f * reach + 2.f / view.zoom;
+	if (!view.isVisible({ stroke.min.x - pad, stroke.min.y - pad }, { stroke.max.x + pad, stroke.max.y + pad })) return;
+
+	uint32_t count = stroke.count;
+	if (stroke.shape != StrokeShape::Freehand) {
+		strokeOutline(document, stroke, SHAPE_TOLERANCE / view.zoom, outline);
+		count = (uint32_t) outline.size();
+		xs.resize(count);
+		ys.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			xs[i] = (outline[i].x - view.origin.x) * view.zoom;
+			ys[i] = (outline[i].y - view.origin.y) * view.zoom;
+		}
+	}
+	else {
+		document.readPoints(stroke, xs, ys, view.zoom, { -view.origin.x * view.zoom, -view.origin.y * view.zoom });
+	}
+
+	StrokeStyle style = stroke.style;
+	style.thickness *= view.zoom;
+	drawStroke(drawList, xs.data(), ys.data(), count, style, tessellation);
+}
+
+void LodCache::release() {
+	for (Level& candidate : levels) candidate.cache.reset();
+	drawn = LOD_DIRECT;
+	refilling = true;
+}
+
+void LodCache::setTessellation(const TessellationSettings& settings) {
+	tessellation = settings;
+	for (Level& candidate : levels) {
+		if (candidate.cache) candidate.cache->setTessellation(settings);
+	}
+}
+
+size_t LodCache::vertexCount() const {
+	return drawn == LOD_DIRECT ? 0 : level(drawn).cache->vertexCount();
+}
+
+size_t LodCache::memoryUsage() const {
+	size_t total = levels.capacity() * sizeof(Level) + (xs.capacity() + ys.capacity()) * sizeof(float);
+	for (const Level& candidate : levels) {
+		if (candidate.cache) total += candidate.cache->memoryUsage();
+	}
+	return total;
+}
@@ -0,0 +1,84 @@
+#ifndef LOD_CACHE_H
+#define LOD_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_cache.h"
+#include "stroke_document.h"
+#include "viewport.h"
+
+// Coarsest and finest cached levels of detail, a level n cache is tessellated for a zoom of 2^n
+const int LOD_COARSEST = -6;
+const int LOD_FINEST = 2;
+// Zoomed in past the finest level so little is on screen that it is tessellated fresh each frame
+const int LOD_DIRECT = LOD_FINEST + 1;
+// Levels kept baked at once, the least recently used go first
+const int LOD_LEVELS_KEPT = 3;
+// Points baked per frame for a level that is being brought in, the old level is drawn until it is done
+const size_t LOD_BAKE_BUDGET = 200000;
+
+/**
+* Picks a level of detail for the zoom and draws the board from it
+* Zoomed out, strokes come from decimated caches so the geometry drawn is bounded by the screen rather than the board.
+* Each level only gets baked once it is first needed.
+*/
+class LodCache {
+public:
+	explicit LodCache(StrokeDocument& document);
+	LodCache(const LodCache&) = delete;
+	LodCache& operator=(const LodCache&) = delete;
+
+	// The level a zoom is drawn at, LOD_DIRECT when it is past the finest cached one
+	static int levelFor(float zoom);
+
+	/**
+	* Bakes what the view needs, needs a current ImGui frame
+	*/
+	void sync(const Viewport& view);
+	void draw(ImDrawList* drawList, const Viewport& view) const;
+	/**
+	* Tessellates a single stroke straight into the draw list, culled and placed for the view
+	*/
+	void drawDirect(ImDrawList* drawList, const Stroke& stroke, const Viewport& view) const;
+
+	void setTessellation(const TessellationSettings& settings);
+	const TessellationSettings& tessellationSettings() const { return tessellation; }
+	int drawnLevel() const { return drawn; }
+
+	/**
+	* Frees every baked level
+	* The next level is baked a budget at a time like any other, but drawn as far as it has got rather than waited on
+	*/
+	void release();
+	// Released and not yet baked back up to the level being drawn
+	bool isRefilling() const { return refilling; }
+
+	// Vertices of the level being drawn
+	size_t vertexCount() const;
+	// Every kept level
+	size_t memoryUsage() const;
+
+private:
+	struct Level {
+		std::unique_ptr<StrokeCache> cache;
+		uint64_t lastUsed = 0;
+	};
+
+	Level& level(int lod) { return levels[lod - LOD_COARSEST]; }
+	const Level& level(int lod) const { return levels[lod - LOD_COARSEST]; }
+	void evict();
+
+	StrokeDocument& document;
+	TessellationSettings tessellation;
+	std::vector<Level> levels;
+	int drawn = LOD_DIRECT;
+	bool refilling = false;
+	uint64_t frame = 0;
+	mutable std::vector<ImVec2> outline;
+	mutable std::vector<float> xs;
+	mutable std::vector<float> ys;
+};
+
+#endif // LOD_CACHE_H
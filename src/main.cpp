@@ -1,21 +1,41 @@
 #include <Windows.h>
 #include <dwmapi.h>
 #include <d3d11.h>
+#include <d3d11_1.h>
+#include <dxgi1_4.h>
+#include <dcomp.h>
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_dx11.h>
 #include <imgui/imgui_impl_win32.h>
 
-#include "snapping.h"
+#include "whiteboard.h"
+#include "input_source.h"
+#include "input_win32.h"
+#include "input_recorder.h"
+#include "replay_runner.h"
+#include "layered_session.h"
+#include "sync_session.h"
+#include "rasterizer.h"
+#include "png_writer.h"
+#include "profiler.h"
+#include "profiler_overlay.h"
 #include <vector>
-#include <map>
 #include <string>
 #include <algorithm>
+#include <filesystem>
 #include <iterator>
 #include <ranges>
 
 using namespace std;
 
+// Frames built after the last event, ImGui needs a couple to settle hover states and layout
+const int SETTLE_FRAMES = 3;
+// Longest the loop sleeps while idle before checking on the input queue and the board session
+const DWORD IDLE_WAIT_MS = 100;
+// How long while the board is shared, changes from other instances are only picked up between waits
+const DWORD SHARED_IDLE_WAIT_MS = 4;
+
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 /**
@@ -35,30 +55,108 @@ LRESULT CALLBACK window_procedure(HWND window, UINT message, WPARAM w_param, LPA
 	return DefWindowProc(window, message, w_param, l_param);
 }
 
-class MemoryState {
-public:
-	ImVector<ImVec2> drawn;
-	map<int, ImU32> colours{};
-	float drawingColour[4];
-	float lastDrawingColour[4];
-	map<int, float> thicknesses{};
-	float drawingThickness;
-	float lastDrawingThickness;
-
-	MemoryState(const ImVector<ImVec2>& drawn, const std::map<int, ImU32>& colours, const float drawingColour[4], const float lastDrawingColour[4], const map<int, float> thicknesses, const float drawingThickness, const float lastDrawingThickness)
-		: drawn(drawn), colours(colours), thicknesses(thicknesses), drawingThickness(drawingThickness), lastDrawingThickness(lastDrawingThickness) {
-		std::copy(drawingColour, drawingColour + 4, this->drawingColour);
-		std::copy(lastDrawingColour, lastDrawingColour + 4, this->lastDrawingColour);
+/**
+* The value following flag on the command line, or "" if the flag isn't there
+*/
+string argument(const string& args, const string& flag) {
+	size_t at = args.find(flag);
+	if (at == string::npos) return "";
+
+	size_t start = args.find_first_not_of(' ', at + flag.size());
+	if (start == string::npos || args.compare(start, 2, "--") == 0) return "";
+	return args.substr(start, args.find(' ', start) - start);
+}
+
+/**
+* The port following flag, or the default one
+*/
+uint16_t portArgument(const string& args, const string& flag) {
+	int port = atoi(argument(args, flag).c_str());
+	return port > 0 && port <= 65535 ? (uint16_t) port : DEFAULT_SYNC_PORT;
+}
+
+/**
+* A file next to the executable, so the board is the same one whatever directory the whiteboard is started from
+* Falls back to name in the current directory if the executable's path can't be had or has no narrow form
+*/
+string besideExecutable(const string& name) {
+	wchar_t executable[MAX_PATH];
+	DWORD length = GetModuleFileNameW(nullptr, executable, MAX_PATH);
+	if (length == 0 || length == MAX_PATH) return name;
+
+	try {
+		return (filesystem::path(executable).parent_path() / name).string();
+	}
+	catch (const system_error&) {
+		return name;
+	}
+}
+
+/**
+* Replays a recording, or synthetic sessions and the view benchmarks when there isn't one, without opening a window
+* The report is printed to benchmark_report.txt, or next to the recording
+*/
+int runBenchmark(const string& recording) {
+	vector<ReplayReport> reports;
+	vector<StorageReport> storageReports;
+	vector<ShapeReport> shapeReports;
+	if (recording.empty()) {
+		reports.push_back(runReplay("synthetic, 200 strokes of 200 points", syntheticSession(200, 200)));
+		reports.push_back(runReplay("synthetic, 2000 strokes of 50 points", syntheticSession(2000, 50)));
+		for (const ReplayReport& report : runViewBenchmarks(1000000)) reports.push_back(report);
+		for (const ReplayReport& report : runLayerBenchmarks(4, 1000000)) reports.push_back(report);
+		storageReports = runStorageBenchmarks(1000000);
+		shapeReports = runShapeBenchmarks(1000);
+	}
+	else {
+		vector<RecordedFrame> frames;
+		if (!loadRecording(recording, frames)) return 1;
+		reports.push_back(runReplay(recording, frames));
 	}
-};
+
+	FILE* file = fopen(recording.empty() ? "benchmark_report.txt" : (recording + ".report.txt").c_str(), "w");
+	if (!file) return 1;
+	for (const ReplayReport& report : reports) fputs(formatReport(report).c_str(), file);
+	for (const StorageReport& report : storageReports) fputs(formatReport(report).c_str(), file);
+	for (const ShapeReport& report : shapeReports) fputs(formatReport(report).c_str(), file);
+	fclose(file);
+	return 0;
+}
+
+/**
+* One end of the sync benchmark over loopback, the report is printed to sync_host_report.txt or sync_join_report.txt
+*/
+int runSyncBenchmark(const string& side) {
+	bool hosting = side == "host";
+	if (!hosting && side != "join") return 1;
+
+	vector<SyncReport> reports = runSyncBenchmark(hosting, DEFAULT_SYNC_PORT, 2000, 20000, 250);
+	if (reports.empty()) return 1;
+
+	FILE* file = fopen(hosting ? "sync_host_report.txt" : "sync_join_report.txt", "w");
+	if (!file) return 1;
+	for (const SyncReport& report : reports) fputs(formatReport(report).c_str(), file);
+	fclose(file);
+	return 0;
+}
 
 /**
 * @parameter instance This window's instance
 * @parameter _ The previous window's instance
-* @parameter _ The command line arguments
+* @parameter cmd_line The command line arguments
+*	"--pointer-replay <file>" draws from a recorded sample file instead of the mouse
+*	"--record <file>" records every frame's input so it can be benchmarked later
+*	"--benchmark [<recording>]" replays a recording, or a synthetic session, without a window and writes a report
+*	"--host [<port>]" shares the board with other instances on this machine
+*	"--join [<port>]" draws on a board another instance is sharing instead of the saved one
+*	"--sync-benchmark host|join" runs one end of the sync benchmark without a window, start the host first
 * @parameter cmd_show Determines whether or not we want to show our window
 */
-INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
+INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR cmd_line, INT cmd_show) {
+	const string args = cmd_line ? cmd_line : "";
+	if (args.find("--sync-benchmark") != string::npos) return runSyncBenchmark(argument(args, "--sync-benchmark"));
+	if (args.find("--benchmark") != string::npos) return runBenchmark(argument(args, "--benchmark"));
+
 	// Create the window class
 	WNDCLASSEXW wc{};
 	wc.cbSize = sizeof(WNDCLASSEXW);
@@ -70,16 +168,16 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 	// Register the window class
 	RegisterClassExW(&wc);
 
-	// Use the window class to create a window
+	// Use the window class to create a window, covering every monitor
 	const HWND window = CreateWindowExW(
 		WS_EX_TOPMOST | WS_EX_TRANSPARENT,
 		wc.lpszClassName,
 		L"Whiteboard",
 		WS_POPUP,
-		-2560,
-		0,
-		2560 * 2, // width - look into using GetSystemMetrics or smth
-		1440, // height
+		GetSystemMetrics(SM_XVIRTUALSCREEN),
+		GetSystemMetrics(SM_YVIRTUALSCREEN),
+		GetSystemMetrics(SM_CXVIRTUALSCREEN), // width
+		GetSystemMetrics(SM_CYVIRTUALSCREEN), // height
 		nullptr,
 		nullptr,
 		wc.hInstance,
@@ -109,18 +207,6 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 		DwmExtendFrameIntoClientArea(window, &margins);
 	}
 
-	DXGI_SWAP_CHAIN_DESC sd{};
-	sd.BufferDesc.RefreshRate.Numerator = 144U;
-	sd.BufferDesc.RefreshRate.Denominator = 1U;
-	sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	sd.SampleDesc.Count = 1U;
-	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	sd.BufferCount = 2U;
-	sd.OutputWindow = window;
-	sd.Windowed = TRUE;
-	sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-	sd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
-
 	// Compile time array containg the DX11 features that we want
 	constexpr D3D_FEATURE_LEVEL levels[2]{
 		D3D_FEATURE_LEVEL_11_0,
@@ -133,20 +219,105 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 	ID3D11RenderTargetView* render_target_view{ nullptr };
 	D3D_FEATURE_LEVEL level{};
 
-	D3D11CreateDeviceAndSwapChain(
-		nullptr,
-		D3D_DRIVER_TYPE_HARDWARE,
-		nullptr,
-		0U,
-		levels,
-		2U,
-		D3D11_SDK_VERSION,
-		&sd,
-		&swap_chain,
-		&device,
-		&level,
-		&device_context
-	);
+	// Flip model keeps each back buffer's contents between frames, so only damaged parts need redrawing
+	// Flip model swap chains made for a window ignore their alpha, one made for composition and set as the content of a
+	// DirectComposition visual blends with what is behind the window through its premultiplied alpha, which is what
+	// ImGui's blend state leaves in a buffer cleared to transparent
+	IDXGISwapChain1* swap_chain1{ nullptr };
+	IDCompositionDevice* composition{ nullptr };
+	IDCompositionTarget* composition_target{ nullptr };
+	IDCompositionVisual* composition_visual{ nullptr };
+	DXGI_SWAP_CHAIN_DESC1 sd1{};
+	{
+		RECT client_area{};
+		GetClientRect(window, &client_area);
+		sd1.Width = (UINT) client_area.right;
+		sd1.Height = (UINT) client_area.bottom;
+	}
+	sd1.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	sd1.SampleDesc.Count = 1U;
+	sd1.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	sd1.BufferCount = 2U;
+	sd1.Scaling = DXGI_SCALING_STRETCH;
+	sd1.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+	sd1.AlphaMode = DXGI_ALPHA_MODE_PREMULTIPLIED;
+
+	auto createComposition = [&]() {
+		IDXGIDevice* dxgi_device{ nullptr };
+		IDXGIAdapter* adapter{ nullptr };
+		IDXGIFactory2* factory{ nullptr };
+		bool created = SUCCEEDED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, D3D11_CREATE_DEVICE_BGRA_SUPPORT, levels, 2U, D3D11_SDK_VERSION, &device, &level, &device_context))
+			&& SUCCEEDED(device->QueryInterface(IID_PPV_ARGS(&dxgi_device)))
+			&& SUCCEEDED(dxgi_device->GetAdapter(&adapter))
+			&& SUCCEEDED(adapter->GetParent(IID_PPV_ARGS(&factory)))
+			&& SUCCEEDED(factory->CreateSwapChainForComposition(device, &sd1, nullptr, &swap_chain1))
+			&& SUCCEEDED(swap_chain1->QueryInterface(IID_PPV_ARGS(&swap_chain)))
+			&& SUCCEEDED(DCompositionCreateDevice(dxgi_device, IID_PPV_ARGS(&composition)))
+			&& SUCCEEDED(composition->CreateTargetForHwnd(window, TRUE, &composition_target))
+			&& SUCCEEDED(composition->CreateVisual(&composition_visual))
+			&& SUCCEEDED(composition_visual->SetContent(swap_chain1))
+			&& SUCCEEDED(composition_target->SetRoot(composition_visual))
+			&& SUCCEEDED(composition->Commit());
+		if (factory) factory->Release();
+		if (adapter) adapter->Release();
+		if (dxgi_device) dxgi_device->Release();
+		return created;
+	};
+
+	auto releaseComposition = [&]() {
+		if (composition_visual) composition_visual->Release();
+		if (composition_target) composition_target->Release();
+		if (composition) composition->Release();
+		if (swap_chain1) swap_chain1->Release();
+		if (swap_chain) swap_chain->Release();
+		if (device_context) device_context->Release();
+		if (device) device->Release();
+		composition_visual = nullptr;
+		composition_target = nullptr;
+		composition = nullptr;
+		swap_chain1 = nullptr;
+		swap_chain = nullptr;
+		device_context = nullptr;
+		device = nullptr;
+	};
+
+	bool flipModel = createComposition();
+	if (!flipModel) {
+		// Before Windows 8, a window's own swap chain, redrawn and presented whole every frame, alpha comes from the
+		// frame extended over the client area
+		releaseComposition();
+		DXGI_SWAP_CHAIN_DESC sd{};
+		sd.BufferDesc.RefreshRate.Numerator = 144U;
+		sd.BufferDesc.RefreshRate.Denominator = 1U;
+		sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		sd.SampleDesc.Count = 1U;
+		sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		sd.BufferCount = 2U;
+		sd.OutputWindow = window;
+		sd.Windowed = TRUE;
+		sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+		sd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+		D3D11CreateDeviceAndSwapChain(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0U, levels, 2U, D3D11_SDK_VERSION, &sd, &swap_chain, &device, &level, &device_context);
+	}
+	if (!swap_chain) return 1;
+
+	// Partial clears, optional
+	ID3D11DeviceContext1* device_context1{ nullptr };
+	if (flipModel) device_context->QueryInterface(IID_PPV_ARGS(&device_context1));
+
+	// The present each of the back buffers was last shown in, -1 when its contents can't be relied on
+	int64_t presentedIn[2]{ -1, -1 };
+	int64_t presents = 0;
+	auto forgetBuffers = [&]() { fill(std::begin(presentedIn), std::end(presentedIn), -1); };
+	// Which back buffer is drawn into next, asked of the swap chain where it can say and counted otherwise
+	IDXGISwapChain3* swap_chain3{ nullptr };
+	if (flipModel) swap_chain->QueryInterface(IID_PPV_ARGS(&swap_chain3));
+	auto backBufferIndex = [&]() { return swap_chain3 ? (size_t) swap_chain3->GetCurrentBackBufferIndex() : (size_t) (presents % std::size(presentedIn)); };
+	// How many presents ago a back buffer was last shown, 0 when it has to be redrawn whole
+	auto bufferAge = [&](size_t buffer) {
+		if (!flipModel || !device_context1 || presentedIn[buffer] < 0) return 0;
+		return (int) (presents - presentedIn[buffer]);
+	};
 
 	// Create the render target
 	ID3D11Texture2D* back_buffer{ nullptr };
@@ -174,40 +345,86 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 	// Menu Vars
 	bool menuOpen = true;
 	bool menuActive = true;
+#ifdef WB_PROFILE
+	bool profilerOpen = false;
+#endif
 	bool backgroundEnabled = true;
 	float backgroundOpacity = 0.4f;
-	float drawingColour[4] = { 1.f, 0.f, 0.f, 1.f };
-	float lastDrawingColour[4];
-	float drawingThickness = 5.f;
-	float lastDrawingThickness = 5.f;
-	copy(drawingColour, drawingColour + 4, lastDrawingColour);
 
 	// Drawing Vars
-	int placeInHistory = 0;
-	vector<MemoryState> history;
-	ImVector<ImVec2> drawn;
-	map<int, ImU32> colours {};
-	map<int, float> thicknesses {};
-	history.push_back(MemoryState(drawn, colours, drawingColour, lastDrawingColour, thicknesses, drawingThickness, lastDrawingThickness));
-	bool drawingLine = false;
-	bool undoPrevFrame = false;
-	bool redoNextFrame = false;
-	bool drawingStraightLine = false;
-	ImVec2 lineStart;
-
-	colours[0] = IM_COL32(255, 0, 0, 255);
-	drawn.push_back({ -1, -1 });
+	Whiteboard board;
+	{
+		RECT client_area{};
+		GetClientRect(window, &client_area);
+		board.view.size = { (float) client_area.right, (float) client_area.bottom };
+	}
+	LayeredSession session(board.layers);
+	SyncSession sync(board.layers);
+	// A joined board is the host's, only the host keeps it on disk
+	bool joined = args.find("--join") != string::npos && sync.join(portArgument(args, "--join"));
+	if (!joined) session.open(besideExecutable("whiteboard.wbd"));
+	if (!joined && args.find("--host") != string::npos) sync.host(portArgument(args, "--host"));
+	board.documentLoaded();
+	ThreadPool threadPool;
+	double exportTime = -1.0;
+
+	// Input Vars
+	SampleQueue sampleQueue;
+	vector<PointerSample> samples(4096);
+	InputStats inputStats;
+	Win32MouseSource mouseSource(window);
+	ReplaySource replaySource;
+	InputSource* inputSource = &mouseSource;
+	bool replaying = false;
+	PointerSample lastReplayed{};
+	string replayPath = argument(args, "--pointer-replay");
+	if (!replayPath.empty() && replaySource.load(replayPath)) {
+		inputSource = &replaySource;
+		replaying = true;
+	}
+	inputSource->start(sampleQueue);
+	InputRecorder recorder;
+	string recordPath = argument(args, "--record");
+	if (!recordPath.empty()) recorder.open(recordPath);
+	int framesToBuild = SETTLE_FRAMES;
+	bool lastBackgroundEnabled = backgroundEnabled;
+	float lastBackgroundOpacity = backgroundOpacity;
+	vector<DamageRect> redrawRects;
+	vector<DamageRect> presentRects;
+	vector<D3D11_RECT> clearRects;
+	vector<RECT> dirtyRects;
 
 	while (running) {
-		MSG msg;
-		while (PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE)) {
-			TranslateMessage(&msg);
-			DispatchMessage(&msg);
+		{
+			PROFILE_SCOPE("Message Pump");
+			MSG msg;
+			while (PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE)) {
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+				framesToBuild = SETTLE_FRAMES;
+
+				if (msg.message == WM_QUIT) {
+					running = false;
+				}
+			}
+		}
 
-			if (msg.message == WM_QUIT) {
-				running = false;
+		// Nothing to react to, sleep until a message comes in rather than building frames nobody will see change
+		bool busy = board.isBusy() || sampleQueue.size() > 0 || (replaying && !replaySource.finished());
+#ifdef WB_PROFILE
+		busy |= profilerOpen;
+#endif
+		if (running && framesToBuild == 0 && !busy) {
+			session.update();
+			if (sync.update()) {
+				framesToBuild = SETTLE_FRAMES;
+				continue;
 			}
+			PROFILE_SCOPE("Idle");
+			MsgWaitForMultipleObjects(0, nullptr, FALSE, sync.isConnected() ? SHARED_IDLE_WAIT_MS : IDLE_WAIT_MS, QS_ALLINPUT);
+			continue;
 		}
+		if (framesToBuild > 0) framesToBuild--;
 
 		if (ImGui::IsKeyPressed(ImGuiKey_Escape)) running = false;
 		if (ImGui::IsKeyPressed(ImGuiKey_LeftAlt)) menuOpen = !menuOpen;
@@ -216,148 +433,61 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 		if (!running) break;
 
 		// Frame
-		ImGui_ImplDX11_NewFrame();
-		ImGui_ImplWin32_NewFrame();
-		ImGui::NewFrame();
-
-		// Rendering
-		if (backgroundEnabled) ImGui::GetBackgroundDrawList()->AddRectFilled({ 0, 0 }, { 2560 * 2, 1440 }, ImColor(0.f, 0.f, 0.f, backgroundOpacity));  // Background
-
-		if (!ranges::equal(drawingColour, lastDrawingColour)) {
-			colours[drawn.Size] = IM_COL32(
-				lround(drawingColour[0] * 255),
-				lround(drawingColour[1] * 255),
-				lround(drawingColour[2] * 255),
-				lround(drawingColour[3] * 255)
-			);
-			drawn.push_back({ -1, -1 });
-			copy(drawingColour, drawingColour + 4, lastDrawingColour);
+		{
+			PROFILE_SCOPE("New Frame");
+			ImGui_ImplDX11_NewFrame();
+			ImGui_ImplWin32_NewFrame();
+			ImGui::NewFrame();
 		}
 
-		if (drawingThickness != lastDrawingThickness) {
-			thicknesses[drawn.Size] = drawingThickness;
-			drawn.push_back({ -1, -1 });
-			lastDrawingThickness = drawingThickness;
-		}
-
-		ImVec2 mouse_pos = io.MousePos;
-		if (!io.WantCaptureMouse) {
-			if (io.MouseDown[0] && !drawingStraightLine) {
-				drawingLine = true;
-
-				bool inList = false;
-				for (ImVec2 point : drawn) {
-					if (point.x == mouse_pos.x && point.y == mouse_pos.y) {
-						inList = true;
-						break;
-					}
-				}
-				if (!inList) drawn.push_back(mouse_pos);
-			}
-			else if (drawingLine) {
-				drawingLine = false;
-
-				drawn.push_back({ -1, -1 });
-
-				if (placeInHistory != history.size() - 1) {
-					history.erase(history.begin() + placeInHistory + 1, history.end());
-				}
-				placeInHistory++;
-				history.push_back(MemoryState(drawn, colours, drawingColour, lastDrawingColour, thicknesses, drawingThickness, lastDrawingThickness));
-			}
-			else {
-				if (io.MouseClicked[4] && !redoNextFrame && !drawingStraightLine) {
-					if (placeInHistory < history.size() - 1) placeInHistory++;
-					MemoryState unloading = history[placeInHistory];
-					drawn = unloading.drawn;
-					colours = unloading.colours;
-					std::memcpy(drawingColour, unloading.drawingColour, sizeof(drawingColour));
-					std::memcpy(lastDrawingColour, unloading.lastDrawingColour, sizeof(lastDrawingColour));
-					thicknesses = unloading.thicknesses;
-					drawingThickness = unloading.drawingThickness;
-					lastDrawingThickness = unloading.lastDrawingThickness;
-				}
-				else if (redoNextFrame) {
-					redoNextFrame = false;
-				}
-				else if (io.MouseClicked[3] && !undoPrevFrame && !drawingStraightLine) {
-					if (placeInHistory >= 1) placeInHistory--;
-					MemoryState unloading = history[placeInHistory];
-					drawn = unloading.drawn;
-					colours = unloading.colours;
-					std::memcpy(drawingColour, unloading.drawingColour, sizeof(drawingColour));
-					std::memcpy(lastDrawingColour, unloading.lastDrawingColour, sizeof(lastDrawingColour));
-					thicknesses = unloading.thicknesses;
-					drawingThickness = unloading.drawingThickness;
-					lastDrawingThickness = unloading.lastDrawingThickness;
-				}
-				else if (undoPrevFrame) {
-					undoPrevFrame = false;
-				}
-				else if (io.MouseDown[1]) {
-					if (!drawingStraightLine) {
-						drawingStraightLine = true;
-						lineStart = mouse_pos;
-					}
-				}
-				else if (drawingStraightLine) {
-					drawingStraightLine = false;
-					drawn.push_back(lineStart);
-					if (ImGui::IsKeyDown(ImGuiKey_LeftShift)) {
-						drawn.push_back(snap(lineStart, mouse_pos));
-					}
-					else {
-						drawn.push_back(mouse_pos);
-					}
-
-					drawn.push_back({ -1, -1 });
-
-					if (placeInHistory != history.size() - 1) {
-						history.erase(history.begin() + placeInHistory + 1, history.end());
-					}
-					placeInHistory++;
-					history.push_back(MemoryState(drawn, colours, drawingColour, lastDrawingColour, thicknesses, drawingThickness, lastDrawingThickness));
-				}
-			}
-		}
+		size_t sampleCount = sampleQueue.pop(samples.data(), samples.size());
+		inputStats.frame(samples.data(), sampleCount, monotonicSeconds());
+		PROFILE_COUNTER("Samples", sampleCount);
 
-		ImU32 currentColour = IM_COL32(255, 0, 0, 255);
-		float currentThickness = 5.f;
-		for (int i = 1; i < drawn.Size; i++) {
-			ImVec2 point1 = drawn[i - 1];
-			ImVec2 point2 = drawn[i];
-			if (point1.x == -1 || point2.x == -1) {
-				ImU32 newColour = colours[point2.x == -1 ? i : i - 1];
-				if (newColour) currentColour = newColour;
-
-				ImU32 newThickness = thicknesses[point2.x == -1 ? i : i - 1];
-				if (newThickness) currentThickness = newThickness;
-				continue;
-			}
-			ImGui::GetBackgroundDrawList()->AddLine(point1, point2, currentColour, currentThickness);
+		// Rendering
+		if (backgroundEnabled) ImGui::GetBackgroundDrawList()->AddRectFilled({ 0, 0 }, board.view.size, ImColor(0.f, 0.f, 0.f, backgroundOpacity));  // Background
+		if (backgroundEnabled != lastBackgroundEnabled || backgroundOpacity != lastBackgroundOpacity) board.damage.addAll();
+		lastBackgroundEnabled = backgroundEnabled;
+		lastBackgroundOpacity = backgroundOpacity;
+
+		FrameInput input;
+		input.time = monotonicSeconds();
+		input.mouse = io.MousePos;
+		input.leftDown = io.MouseDown[0];
+		input.rightDown = io.MouseDown[1];
+		input.middleDown = io.MouseDown[2];
+		input.wheel = io.MouseWheel;
+		input.undoClicked = io.MouseClicked[3];
+		input.redoClicked = io.MouseClicked[4];
+		input.snapHeld = ImGui::IsKeyDown(ImGuiKey_LeftShift);
+		input.cycleTool = ImGui::IsKeyPressed(ImGuiKey_E);
+		input.resetView = ImGui::IsKeyPressed(ImGuiKey_Home);
+		input.uiCaptured = io.WantCaptureMouse;
+		input.samples = samples.data();
+		input.sampleCount = sampleCount;
+		if (replaying) {
+			if (sampleCount > 0) lastReplayed = samples[sampleCount - 1];
+			input.mouse = { lastReplayed.x, lastReplayed.y };
+			input.leftDown = lastReplayed.buttons & POINTER_LEFT;
 		}
+		recorder.record(input);
 
-		if (drawingStraightLine) {
-			if (ImGui::IsKeyDown(ImGuiKey_LeftShift)) {
-				ImGui::GetBackgroundDrawList()->AddLine(lineStart, snap(lineStart, mouse_pos), IM_COL32(
-				lround(drawingColour[0] * 255),
-				lround(drawingColour[1] * 255),
-				lround(drawingColour[2] * 255),
-				lround(drawingColour[3] * 255)
-			), currentThickness);
-			}
-			else {
-				ImGui::GetBackgroundDrawList()->AddLine(lineStart, mouse_pos, IM_COL32(
-					lround(drawingColour[0] * 255),
-					lround(drawingColour[1] * 255),
-					lround(drawingColour[2] * 255),
-					lround(drawingColour[3] * 255)
-				), currentThickness);
-			}
+		board.update(input);
+		{
+			// After the board's update, so this frame's points go out in this frame's batch
+			PROFILE_SCOPE("Sync");
+			if (sync.update()) framesToBuild = SETTLE_FRAMES;
 		}
+		board.draw(ImGui::GetBackgroundDrawList(), input);
+		sync.drawLive(ImGui::GetBackgroundDrawList(), board.view, board.damage, board.layers.tessellationSettings());
 
 		if (menuOpen) {
-			ImGui::GetBackgroundDrawList()->AddText({ 10, 10 }, ImColor(1.f, 1.f, 1.f, 1.f), (std::to_string(placeInHistory + 1) + " / " + std::to_string(history.size())).c_str());
+			PROFILE_SCOPE("Menu");
+			const History& history = board.layers.active().peek().history;
+			string position = std::to_string(history.position() + 1) + " / " + std::to_string(history.size() + 1);
+			ImGui::GetBackgroundDrawList()->AddText({ 10, 10 }, ImColor(1.f, 1.f, 1.f, 1.f), position.c_str());
+			ImVec2 positionSize = ImGui::CalcTextSize(position.c_str());
+			board.damage.addOverlay({ 10, 10 }, { 10 + positionSize.x, 10 + positionSize.y });
 
 			ImGui::Begin("Settings", &menuActive);
 
@@ -366,15 +496,146 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 				ImGui::SliderFloat("Background Opacity", &backgroundOpacity, 0.0f, 1.0f);
 			}
 
+			ImGui::SeparatorText("Tool");
+			if (ImGui::RadioButton("Pen", board.tool == Tool::Pen)) board.tool = Tool::Pen;
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Stroke Eraser", board.tool == Tool::StrokeEraser)) board.tool = Tool::StrokeEraser;
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Pixel Eraser", board.tool == Tool::PixelEraser)) board.tool = Tool::PixelEraser;
+			if (board.tool != Tool::Pen) {
+				ImGui::SliderFloat("Eraser Radius", &board.eraserRadius, 2.0f, 100.0f);
+			}
+
 			ImGui::SeparatorText("Drawing");
-			ImGui::ColorEdit4("Drawing Colour", drawingColour);
-			ImGui::SliderFloat("Line Thickness", &drawingThickness, 1.0f, 30.0f);
+			ImGui::ColorEdit4("Drawing Colour", board.drawingColour);
+			ImGui::SliderFloat("Line Thickness", &board.drawingThickness, 1.0f, 30.0f);
+			TessellationSettings tessellation = board.layers.tessellationSettings();
+			const char* joinStyles[] = { "Round", "Miter" };
+			int joinStyle = (int) tessellation.join;
+			bool tessellationChanged = ImGui::Combo("Joins", &joinStyle, joinStyles, IM_ARRAYSIZE(joinStyles));
+			tessellationChanged |= ImGui::Checkbox("Round Caps", &tessellation.roundCaps);
+			if (tessellationChanged) {
+				tessellation.join = (JoinStyle) joinStyle;
+				board.setTessellation(tessellation);
+			}
 
 			auto preset = [&](const pair<vector<float>, float>& preset) {
-				std::memcpy(drawingColour, ranges::take_view(preset.first, 4).data(), sizeof(preset.first));
-				drawingThickness = preset.second;
+				std::memcpy(board.drawingColour, ranges::take_view(preset.first, 4).data(), sizeof(board.drawingColour));
+				board.drawingThickness = preset.second;
 				};
 
+			ImGui::SeparatorText("Stroke Processing");
+			const char* simplifyMethods[] = { "None", "Douglas-Peucker", "Visvalingam" };
+			int simplifyMethod = (int) board.simplifySettings.method;
+			if (ImGui::Combo("Simplify", &simplifyMethod, simplifyMethods, IM_ARRAYSIZE(simplifyMethods))) board.simplifySettings.method = (SimplifyMethod) simplifyMethod;
+			ImGui::SliderFloat("Tolerance", &board.simplifySettings.tolerance, 0.1f, 5.0f);
+			ImGui::Checkbox("Simplify While Drawing", &board.simplifySettings.streaming);
+			const char* smoothMethods[] = { "None", "Chaikin", "Catmull-Rom" };
+			int smoothMethod = (int) board.simplifySettings.smoothing;
+			if (ImGui::Combo("Smoothing", &smoothMethod, smoothMethods, IM_ARRAYSIZE(smoothMethods))) board.simplifySettings.smoothing = (SmoothMethod) smoothMethod;
+			if (board.rawPoints > 0) {
+				ImGui::Text("Stored %zu of %zu points (%.1fx fewer)", board.keptPoints, board.rawPoints, (double) board.rawPoints / max<size_t>(board.keptPoints, 1));
+			}
+
+			ImGui::SeparatorText("Shapes and Snapping");
+			ImGui::Checkbox("Recognise Shapes", &board.shapeSettings.recognise);
+			if (board.shapeSettings.recognise) {
+				ImGui::SliderFloat("Shape Tolerance", &board.shapeSettings.tolerance, 1.0f, 15.0f);
+				ImGui::Text("%zu strokes recognised as shapes", board.recognisedShapes);
+			}
+			const char* snapAngles[] = { "90 degrees", "45 degrees", "30 degrees", "15 degrees" };
+			int snapAngle = (int) board.snapSettings.angles;
+			if (ImGui::Combo("Shift Snaps To", &snapAngle, snapAngles, IM_ARRAYSIZE(snapAngles))) board.snapSettings.angles = (SnapAngles) snapAngle;
+			ImGui::Checkbox("Snap To Grid", &board.snapSettings.grid);
+			if (board.snapSettings.grid) ImGui::SliderFloat("Grid Size", &board.snapSettings.gridSize, 5.0f, 200.0f);
+			ImGui::Checkbox("Snap To Ends", &board.snapSettings.magnetism);
+			if (board.snapSettings.magnetism) ImGui::SliderFloat("Snap Radius", &board.snapSettings.magnetRadius, 2.0f, 40.0f);
+			ImGui::TextDisabled("Right drag draws straight lines, shift snaps their angle");
+
+			ImGui::SeparatorText("Input");
+			ImGui::Text("%.1f samples / frame, latency %.2f ms (max %.2f ms)", inputStats.samplesPerFrame, inputStats.latency * 1000.0, inputStats.maxLatency * 1000.0);
+			ImGui::Text("%zu samples, %zu dropped", inputStats.totalSamples, sampleQueue.droppedCount());
+			if (recorder.isOpen()) ImGui::Text("Recording to %s", recordPath.c_str());
+
+			ImGui::SeparatorText("View");
+			int lod = board.layers.active().peek().cache.drawnLevel();
+			if (lod == LOD_DIRECT) ImGui::Text("Zoom %.0f%%, drawn directly", board.view.zoom * 100.f);
+			else ImGui::Text("Zoom %.0f%%, level of detail %d", board.view.zoom * 100.f, lod);
+			if (ImGui::Button("Reset View")) board.view.reset();
+			ImGui::SameLine();
+			ImGui::TextDisabled("Middle drag pans, wheel zooms, Home resets");
+
+			ImGui::SeparatorText("Layers");
+			// Top first, the way they stack up on screen
+			for (size_t i = board.layers.size(); i-- > 0;) {
+				Layer& layer = board.layers[i];
+				ImGui::PushID((int) layer.id());
+				bool visible = layer.isVisible();
+				if (ImGui::Checkbox("##Visible", &visible)) board.layers.setVisible(i, visible, monotonicSeconds());
+				ImGui::SameLine();
+				if (ImGui::Selectable(layer.name.c_str(), i == board.layers.activeLayer()) && !board.isBusy()) board.layers.setActive(i);
+				ImGui::PopID();
+			}
+			{
+				size_t active = board.layers.activeLayer();
+				ImGui::BeginDisabled(board.isBusy());
+				if (ImGui::Button("New Layer")) board.layers.add("Layer " + std::to_string(board.layers.size() + 1));
+				ImGui::SameLine();
+				if (ImGui::Button("Up")) board.layers.move(active, 1);
+				ImGui::SameLine();
+				if (ImGui::Button("Down")) board.layers.move(active, -1);
+				ImGui::SameLine();
+				if (ImGui::Button("Clear")) board.layers.clear(active, monotonicSeconds());
+				ImGui::SameLine();
+				if (ImGui::Button("Delete")) board.layers.remove(active);
+				ImGui::EndDisabled();
+
+				Layer& selected = board.layers.active();
+				char name[64]{};
+				selected.name.copy(name, sizeof(name) - 1);
+				if (ImGui::InputText("Layer Name", name, sizeof(name))) board.layers.rename(board.layers.activeLayer(), name);
+				ImGui::Text("%zu strokes, %.1f MB%s", selected.document().strokes().size(), selected.memoryUsage() / (1024.0 * 1024.0), selected.isPacked() ? ", caches freed while hidden" : "");
+				if (!selected.isVisible()) ImGui::TextDisabled("Hidden, show it to draw on it");
+				else ImGui::TextDisabled("Undo goes back past a clear");
+			}
+
+			ImGui::SeparatorText("Board");
+			ImGui::Text("%zu strokes, journal %.1f KB", board.layers.strokeCount(), session.journalSize() / 1024.0);
+			if (ImGui::Button("Save Now")) session.compactInBackground();
+			ImGui::SameLine();
+			if (ImGui::Button("Export PNG")) {
+				double start = monotonicSeconds();
+				RasterSettings rasterSettings;
+				rasterSettings.origin = board.view.origin;
+				rasterSettings.scale = board.view.zoom;
+				if (backgroundEnabled) rasterSettings.background = { 0.f, 0.f, 0.f, backgroundOpacity };
+				RasterImage image;
+				image.width = (int) board.view.size.x;
+				image.height = (int) board.view.size.y;
+				vector<const StrokeDocument*> visible;
+				for (size_t i = 0; i < board.layers.size(); i++) {
+					if (board.layers[i].isVisible()) visible.push_back(&board.layers[i].unpacked().document);
+				}
+				rasterize(visible, rasterSettings, image, threadPool);
+				exportTime = writePng("whiteboard.png", image.width, image.height, image.pixels.data(), threadPool) ? monotonicSeconds() - start : -1.0;
+			}
+			if (exportTime >= 0.0) ImGui::Text("Exported whiteboard.png in %.0f ms on %u threads", exportTime * 1000.0, threadPool.size());
+
+			ImGui::SeparatorText("Shared Board");
+			if (sync.isConnected()) {
+				const SyncStats& stats = sync.stats();
+				if (sync.isHosting()) ImGui::Text("Hosting, %zu joined", sync.peerCount());
+				else ImGui::Text("Joined as client %u", sync.clientId());
+				ImGui::Text("Sent %zu ops (%.1f KB), received %zu ops (%.1f KB)", stats.opsSent, stats.bytesSent / 1024.0, stats.opsReceived, stats.bytesReceived / 1024.0);
+				if (!sync.isHosting()) ImGui::TextDisabled("Kept by the host, nothing is saved here");
+			}
+			else ImGui::TextDisabled("Not shared, start with --host or --join");
+
+#ifdef WB_PROFILE
+			ImGui::SeparatorText("Profiling");
+			ImGui::Checkbox("Profiler", &profilerOpen);
+#endif
+
 			ImGui::SeparatorText("Presets");
 			if (ImGui::Button("Default") || ImGui::IsKeyPressed(ImGuiKey_Keypad0)) preset(make_pair(vector<float>{1.f, 0.f, 0.f, 1.f}, 5.f ));
 			ImGui::SameLine();
@@ -386,30 +647,85 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 			ImGui::End();
 		}
 
+#ifdef WB_PROFILE
+		if (profilerOpen) drawProfilerWindow(&profilerOpen);
+#endif
+
 		// Finish Frame
-		ImGui::Render();
-		constexpr float colour[4]{ 0.f, 0.f, 0.f, 0.f };
-		device_context->OMSetRenderTargets(1U, &render_target_view, nullptr);
-		device_context->ClearRenderTargetView(render_target_view, colour);
+		{
+			PROFILE_SCOPE("ImGui::Render");
+			ImGui::Render();
+		}
 
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		// Windows can change anywhere inside themselves, they are damaged whole every frame they are drawn
+		ImDrawData* drawData = ImGui::GetDrawData();
+		for (const ImDrawList* list : drawData->CmdLists) {
+			if (list == ImGui::GetBackgroundDrawList() || list->CmdBuffer.empty()) continue;
 
-		swap_chain->Present(1U, 0U);  // Vsync
-	}
+			ImVec4 bounds = list->CmdBuffer[0].ClipRect;
+			for (const ImDrawCmd& command : list->CmdBuffer) {
+				bounds = { min(bounds.x, command.ClipRect.x), min(bounds.y, command.ClipRect.y), max(bounds.z, command.ClipRect.z), max(bounds.w, command.ClipRect.w) };
+			}
+			board.damage.addOverlay({ bounds.x - drawData->DisplayPos.x, bounds.y - drawData->DisplayPos.y }, { bounds.z - drawData->DisplayPos.x, bounds.w - drawData->DisplayPos.y });
+		}
 
-	// Close the program, cleanup
-	// https://stackoverflow.com/a/10465032/12964643
-	for (MemoryState memState : history) {
-		memState.drawn.clear();
-		memState.drawn.shrink(0);
-		memState.colours.clear();
+		if (board.damage.hasDamage()) {
+			size_t backBuffer = backBufferIndex();
+			board.damage.endFrame(bufferAge(backBuffer), redrawRects, presentRects);
+			{
+				PROFILE_SCOPE("RenderDrawData");
+				constexpr float colour[4]{ 0.f, 0.f, 0.f, 0.f };
+				device_context->OMSetRenderTargets(1U, &render_target_view, nullptr);
+				if (device_context1) {
+					clearRects.clear();
+					for (const DamageRect& rect : redrawRects) clearRects.push_back({ rect.x0, rect.y0, rect.x1, rect.y1 });
+					device_context1->ClearView(render_target_view, colour, clearRects.data(), (UINT) clearRects.size());
+				}
+				else device_context->ClearRenderTargetView(render_target_view, colour);
+
+				DamageClip clip(drawData, redrawRects);
+				ImGui_ImplDX11_RenderDrawData(drawData);
+			}
+			{
+				PROFILE_SCOPE("Present");
+				bool fullPresent = presentRects.size() == 1 && presentRects[0] == DamageRect{ 0, 0, board.damage.width(), board.damage.height() };
+				HRESULT presented;
+				if (swap_chain1 && !fullPresent) {
+					dirtyRects.clear();
+					for (const DamageRect& rect : presentRects) dirtyRects.push_back({ rect.x0, rect.y0, rect.x1, rect.y1 });
+					DXGI_PRESENT_PARAMETERS parameters{ (UINT) dirtyRects.size(), dirtyRects.data(), nullptr, nullptr };
+					presented = swap_chain1->Present1(1U, 0U, &parameters);  // Vsync
+				}
+				else presented = swap_chain->Present(1U, 0U);  // Vsync
+
+				// Anything but a plain present (occluded, failed) may not have shown or kept the buffers, they are all
+				// redrawn whole before being trusted again
+				if (presented == S_OK) presentedIn[backBuffer] = presents++;
+				else forgetBuffers();
+			}
+
+			size_t redrawnPixels = 0;
+			for (const DamageRect& rect : redrawRects) redrawnPixels += rect.area();
+			PROFILE_COUNTER("Redrawn Pixels", redrawnPixels);
+		}
+		{
+			PROFILE_SCOPE("Board Session");
+			session.update();
+		}
+
+		PROFILE_COUNTER("Strokes", board.layers.strokeCount());
+		PROFILE_COUNTER("Points", board.layers.pointCount());
+		PROFILE_COUNTER("Segments", board.layers.pointCount() - min(board.layers.pointCount(), board.layers.strokeCount()));
+		PROFILE_COUNTER("Vertices", ImGui::GetDrawData()->TotalVtxCount);
+		PROFILE_COUNTER("Cached Vertices", board.layers.active().peek().cache.vertexCount());
+		PROFILE_COUNTER("History Bytes", board.layers.active().peek().history.memoryUsage());
+		PROFILE_FRAME();
 	}
-	history.clear();
-	history.shrink_to_fit();
-	vector<MemoryState>().swap(history);
 
-	drawn.clear();
-	drawn.shrink(0);
+	// Close the program, cleanup
+	inputSource->stop();
+	recorder.close();
+	session.close();
 
 	// Window cleanup
 	ImGui_ImplDX11_Shutdown();
@@ -417,10 +733,10 @@ INT APIENTRY WinMain(HINSTANCE instance, HINSTANCE, PSTR, INT cmd_show) {
 
 	ImGui::DestroyContext();
 
-	if (swap_chain) swap_chain->Release();
-	if (device_context) device_context->Release();
-	if (device) device->Release();
+	if (swap_chain3) swap_chain3->Release();
+	if (device_context1) device_context1->Release();
 	if (render_target_view) render_target_view->Release();
+	releaseComposition();
 
 	DestroyWindow(window);
 	UnregisterClassW(wc.lpszClassName, wc.hInstance);
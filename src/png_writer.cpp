@@ -0,0 +1,186 @@
+#include "png_writer.h"
+#include "checksum.h"
+#include <cstdio>
+#include <cstring>
+
+// Rows compressed together as one independent deflate run
+const int BAND_ROWS = 32;
+const size_t WINDOW_SIZE = 32768;
+const size_t MIN_MATCH = 3;
+const size_t MAX_MATCH = 258;
+const int HASH_BITS = 15;
+
+const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+/**
+* Deflate bit writer, bits go in least significant first
+*/
+class BitWriter {
+public:
+	explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+	void bits(uint32_t value, int count) {
+		buffer |= (uint64_t) value << used;
+		used += count;
+		while (used >= 8) {
+			out.push_back((uint8_t) buffer);
+			buffer >>= 8;
+			used -= 8;
+		}
+	}
+
+	// Huffman codes are defined most significant bit first
+	void code(uint32_t code, int length) {
+		uint32_t reversed = 0;
+		for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+		bits(reversed, length);
+	}
+
+	void alignToByte() {
+		if (used > 0) bits(0, 8 - used);
+	}
+
+private:
+	std::vector<uint8_t>& out;
+	uint64_t buffer = 0;
+	int used = 0;
+};
+
+// Fixed Huffman table from RFC 1951 3.2.6
+static void writeSymbol(BitWriter& writer, int symbol) {
+	if (symbol < 144) writer.code(0x30 + symbol, 8);
+	else if (symbol < 256) writer.code(0x190 + symbol - 144, 9);
+	else if (symbol < 280) writer.code(symbol - 256, 7);
+	else writer.code(0xC0 + symbol - 280, 8);
+}
+
+static void writeMatch(BitWriter& writer, size_t length, size_t distance) {
+	int l = 28;
+	while (LENGTH_BASE[l] > length) l--;
+	writeSymbol(writer, 257 + l);
+	writer.bits((uint32_t) (length - LENGTH_BASE[l]), LENGTH_EXTRA[l]);
+
+	int d = 29;
+	while (DISTANCE_BASE[d] > distance) d--;
+	writer.code(d, 5);
+	writer.bits((uint32_t) (distance - DISTANCE_BASE[d]), DISTANCE_EXTRA[d]);
+}
+
+/**
+* Greedy LZ77 with a single candidate per hash and the fixed Huffman codes
+* Finishes with an empty stored block so the output ends on a byte boundary and can be followed by the next band
+*/
+static void deflateBand(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+	BitWriter writer(out);
+	writer.bits(0, 1);  // BFINAL
+	writer.bits(1, 2);  // BTYPE fixed Huffman
+
+	std::vector<int32_t> head(1 << HASH_BITS, -1);
+	auto hash = [&](size_t i) {
+		uint32_t v = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+		return (v * 2654435761u) >> (32 - HASH_BITS);
+	};
+
+	size_t i = 0;
+	while (i < size) {
+		size_t length = 0;
+		size_t distance = 0;
+		if (i + MIN_MATCH <= size) {
+			uint32_t h = hash(i);
+			int32_t candidate = head[h];
+			head[h] = (int32_t) i;
+			if (candidate >= 0 && i - candidate <= WINDOW_SIZE) {
+				size_t limit = size - i < MAX_MATCH ? size - i : MAX_MATCH;
+				while (length < limit && data[candidate + length] == data[i + length]) length++;
+				distance = i - candidate;
+			}
+		}
+
+		if (length >= MIN_MATCH) {
+			writeMatch(writer, length, distance);
+			// Only index the start of long runs, indexing every byte of them costs more than it finds
+			size_t indexed = length < 16 ? length : 1;
+			for (size_t k = 1; k < indexed && i + k + MIN_MATCH <= size; k++) head[hash(i + k)] = (int32_t) (i + k);
+			i += length;
+		}
+		else {
+			writeSymbol(writer, data[i]);
+			i++;
+		}
+	}
+
+	writeSymbol(writer, 256);  // end of block
+	writer.bits(0, 1);
+	writer.bits(0, 2);  // empty stored block
+	writer.alignToByte();
+	out.insert(out.end(), { 0x00, 0x00, 0xFF, 0xFF });
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+	out.insert(out.end(), { (uint8_t) (value >> 24), (uint8_t) (value >> 16), (uint8_t) (value >> 8), (uint8_t) value });
+}
+
+static void putChunk(std::vector<uint8_t>& png, const char type[4], const uint8_t* data, size_t size) {
+	putBigEndian(png, (uint32_t) size);
+	size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data, data + size);
+	putBigEndian(png, crc32(png.data() + start, png.size() - start));
+}
+
+std::vector<uint8_t> encodePng(int width, int height, const uint8_t* rgba, ThreadPool& pool) {
+	size_t stride = (size_t) width * 4;
+	size_t bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+
+	// Each row gets the Sub filter, flat areas turn into runs of zeros that compress to almost nothing
+	std::vector<std::vector<uint8_t>> filtered(bands);
+	std::vector<std::vector<uint8_t>> compressed(bands);
+	pool.parallelFor(bands, [&](size_t band) {
+		int first = (int) band * BAND_ROWS;
+		int last = first + BAND_ROWS < height ? first + BAND_ROWS : height;
+
+		std::vector<uint8_t>& rows = filtered[band];
+		rows.resize((last - first) * (stride + 1));
+		uint8_t* at = rows.data();
+		for (int y = first; y < last; y++) {
+			const uint8_t* row = rgba + y * stride;
+			*at++ = 1;
+			for (size_t x = 0; x < stride; x++) *at++ = (uint8_t) (row[x] - (x >= 4 ? row[x - 4] : 0));
+		}
+
+		compressed[band].reserve(rows.size() / 4);
+		deflateBand(rows.data(), rows.size(), compressed[band]);
+	});
+
+	std::vector<uint8_t> stream = { 0x78, 0x01 };
+	uint32_t adler = 1;
+	for (size_t band = 0; band < bands; band++) {
+		stream.insert(stream.end(), compressed[band].begin(), compressed[band].end());
+		adler = adler32(filtered[band].data(), filtered[band].size(), adler);
+	}
+	// Final empty fixed Huffman block
+	stream.insert(stream.end(), { 0x03, 0x00 });
+	putBigEndian(stream, adler);
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<uint8_t> header;
+	putBigEndian(header, (uint32_t) width);
+	putBigEndian(header, (uint32_t) height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });  // 8 bit RGBA, no interlacing
+	putChunk(png, "IHDR", header.data(), header.size());
+	putChunk(png, "IDAT", stream.data(), stream.size());
+	putChunk(png, "IEND", nullptr, 0);
+	return png;
+}
+
+bool writePng(const std::string& path, int width, int height, const uint8_t* rgba, ThreadPool& pool) {
+	std::vector<uint8_t> png = encodePng(width, height, rgba, pool);
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (!file) return false;
+	bool ok = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+	return std::fclose(file) == 0 && ok;
+}
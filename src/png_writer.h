@@ -0,0 +1,16 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "thread_pool.h"
+
+/**
+* Encodes 8 bit RGBA pixels (straight alpha, rows top to bottom) as a PNG
+* Bands of rows are compressed on the pool independently and stitched together into a single zlib stream
+*/
+std::vector<uint8_t> encodePng(int width, int height, const uint8_t* rgba, ThreadPool& pool);
+bool writePng(const std::string& path, int width, int height, const uint8_t* rgba, ThreadPool& pool);
+
+#endif // PNG_WRITER_H
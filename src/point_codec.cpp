@@ -0,0 +1,157 @@
+#include "point_codec.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+// Furthest from the origin a packed coordinate can be, in steps of the packed grid
+// 2^29 is exact as a float, and two coordinates within it of 0 are at most 2^30 apart, which fits an int32 step
+const float PACKED_LIMIT = (float) (1 << 29);
+// Steps of the grid a stroke is packed on between two of its points, on average at most
+const float GRID_STEPS_PER_SEGMENT = 32.f;
+// The top bit of every byte, none of them set means 8 varints of a byte each
+const uint64_t CONTINUATION_BITS = 0x8080808080808080ull;
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+	while (value >= 0x80) {
+		out.push_back((uint8_t) (value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8_t) value);
+}
+
+static uint32_t zigzag(int32_t value) {
+	return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+	return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+static float gridScale(uint8_t grid) {
+	return PACKED_SUBPIXELS * (float) (1u << grid);
+}
+
+static int32_t quantize(float coordinate, float scale) {
+	return (int32_t) std::lround(std::clamp(coordinate * scale, -PACKED_LIMIT, PACKED_LIMIT));
+}
+
+template<typename F> static void pack(uint32_t count, std::vector<uint8_t>& out, uint8_t grid, F&& point) {
+	float scale = gridScale(grid);
+	int32_t x = 0;
+	int32_t y = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		ImVec2 p = point(i);
+		int32_t qx = quantize(p.x, scale);
+		int32_t qy = quantize(p.y, scale);
+		// Both ends are clamped to within 2^29 of 0, so the difference fits
+		putVarint(out, zigzag(qx - x));
+		putVarint(out, zigzag(qy - y));
+		x = qx;
+		y = qy;
+	}
+}
+
+void packPoints(const float* xs, const float* ys, uint32_t count, std::vector<uint8_t>& out, uint8_t grid) {
+	pack(count, out, grid, [&](uint32_t i) { return ImVec2{ xs[i], ys[i] }; });
+}
+
+void packPoints(const ImVec2* points, uint32_t count, std::vector<uint8_t>& out, uint8_t grid) {
+	pack(count, out, grid, [&](uint32_t i) { return points[i]; });
+}
+
+/**
+* Packing on a grid finer than one the points sit on exactly keeps them exactly where they are, so a stroke that is
+* unpacked and packed again (eg. replayed from a journal, which keeps its points as floats) never moves
+* Undo, saved boards and other clients never repack, they carry the packed bytes and grid as they are
+*/
+template<typename F> static uint8_t chooseGrid(uint32_t count, F&& point) {
+	const float finest = gridScale(MAX_PACKED_GRID);
+	float length = 0.f;
+	float extent = 0.f;
+	uint64_t steps = 0;
+	bool exact = true;
+	for (uint32_t i = 0; i < count; i++) {
+		ImVec2 p = point(i);
+		if (i > 0) {
+			ImVec2 previous = point(i - 1);
+			length += std::sqrt((p.x - previous.x) * (p.x - previous.x) + (p.y - previous.y) * (p.y - previous.y));
+		}
+		extent = std::max({ extent, std::fabs(p.x), std::fabs(p.y) });
+
+		// Every coordinate's steps on the finest grid, or'd together, the trailing zeros are grids it could do without
+		float fx = p.x * finest, fy = p.y * finest;
+		exact = exact && fx == std::nearbyint(fx) && fy == std::nearbyint(fy) && std::max(std::fabs(fx), std::fabs(fy)) <= PACKED_LIMIT;
+		if (exact) steps |= (uint64_t) std::llabs((long long) fx) | (uint64_t) std::llabs((long long) fy);
+	}
+
+	uint8_t grid = 0;
+	float spacing = count > 1 ? length / (float) (count - 1) : 0.f;
+	while (grid < MAX_PACKED_GRID && spacing * gridScale(grid + 1) <= GRID_STEPS_PER_SEGMENT && extent * gridScale(grid + 1) <= PACKED_LIMIT) grid++;
+	if (exact) grid = std::max(grid, (uint8_t) (MAX_PACKED_GRID - std::min<int>(std::countr_zero(steps), MAX_PACKED_GRID)));
+	return grid;
+}
+
+uint8_t packingGrid(const float* xs, const float* ys, uint32_t count) {
+	return chooseGrid(count, [&](uint32_t i) { return ImVec2{ xs[i], ys[i] }; });
+}
+
+uint8_t packingGrid(const ImVec2* points, uint32_t count) {
+	return chooseGrid(count, [&](uint32_t i) { return points[i]; });
+}
+
+float packedCoordinate(float coordinate, uint8_t grid) {
+	float scale = gridScale(grid);
+	return (float) quantize(coordinate, scale) * (1.f / scale);
+}
+
+size_t packedSize(const uint8_t* at, uint32_t count) {
+	const uint8_t* start = at;
+	for (uint32_t ends = 0; ends < count * 2; at++) {
+		if (!(*at & 0x80)) ends++;
+	}
+	return at - start;
+}
+
+const uint8_t* unpackPoints(const uint8_t* at, uint32_t count, uint8_t grid, float* xs, float* ys, float scale, ImVec2 offset) {
+	float step = scale / gridScale(grid);
+	uint32_t x = 0;
+	uint32_t y = 0;
+	auto varint = [&]() {
+		uint32_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			uint8_t byte = *at++;
+			value |= (uint32_t) (byte & 0x7F) << shift;
+			if (!(byte & 0x80)) return value;
+		}
+	};
+
+	uint32_t i = 0;
+	while (i < count) {
+		// 4 more points take at least 8 bytes, so the load never reaches past them
+		if constexpr (std::endian::native == std::endian::little) {
+			uint64_t word = 0;
+			if (count - i >= 4) std::memcpy(&word, at, sizeof(word));
+			// Points up to the first byte with its continuation bit set, every step before it fits in a byte
+			uint32_t points = count - i >= 4 ? (uint32_t) std::countr_zero(word & CONTINUATION_BITS) / 16 : 0;
+			if (points > 0) {
+				for (uint32_t k = 0; k < points; k++, word >>= 16) {
+					x += (uint32_t) unzigzag((uint32_t) word & 0xFF);
+					y += (uint32_t) unzigzag((uint32_t) (word >> 8) & 0xFF);
+					xs[i + k] = (float) (int32_t) x * step + offset.x;
+					ys[i + k] = (float) (int32_t) y * step + offset.y;
+				}
+				at += points * 2;
+				i += points;
+				continue;
+			}
+		}
+
+		x += (uint32_t) unzigzag(varint());
+		y += (uint32_t) unzigzag(varint());
+		xs[i] = (float) (int32_t) x * step + offset.x;
+		ys[i] = (float) (int32_t) y * step + offset.y;
+		i++;
+	}
+	return at;
+}
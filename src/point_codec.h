@@ -0,0 +1,80 @@
+#ifndef POINT_CODEC_H
+#define POINT_CODEC_H
+
+#include <cstdint>
+#include <vector>
+#include <imgui/imgui.h>
+
+// Packed points are rounded to steps of 1 / PACKED_SUBPIXELS pixels on the coarsest grid
+const float PACKED_SUBPIXELS = 8.f;
+// Each grid halves the step of the one before, the finest is 1 / (PACKED_SUBPIXELS << MAX_PACKED_GRID) pixels
+const uint8_t MAX_PACKED_GRID = 5;
+
+// Unsigned LEB128, 7 bits a byte with the top bit set on every byte but the last
+void putVarint(std::vector<uint8_t>& out, uint32_t value);
+
+/**
+* Appends count points in a compact form, for committed ink (see StrokeDocument) or ink sent elsewhere
+* Each point is rounded to the grid and stored as the zig-zag varint difference from the one before (the first from
+* 0, 0), so a pen moving a few pixels between samples takes about 2 bytes a point instead of 8
+* Steps of 8 pixels or more need two bytes each even on the coarsest grid, so quick strokes take about 4
+*/
+void packPoints(const float* xs, const float* ys, uint32_t count, std::vector<uint8_t>& out, uint8_t grid = 0);
+void packPoints(const ImVec2* points, uint32_t count, std::vector<uint8_t>& out, uint8_t grid = 0);
+
+/**
+* The grid to pack a stroke's points on, fine enough that rounding moves them by a small part of the distance between
+* them (so ink drawn zoomed in keeps its shape) and coarse enough that most steps fit in a byte
+* Points that already sit on a grid, eg. ones that were unpacked, get one they keep their exact place on
+*/
+uint8_t packingGrid(const float* xs, const float* ys, uint32_t count);
+uint8_t packingGrid(const ImVec2* points, uint32_t count);
+
+// Where coordinate lands once packed on the grid, rounding only ever keeps the order of coordinates
+float packedCoordinate(float coordinate, uint8_t grid);
+
+// Bytes taken by count packed points starting at at
+size_t packedSize(const uint8_t* at, uint32_t count);
+
+/**
+* Unpacks count points into xs / ys as their position * scale + offset, eg. straight onto the screen
+* Points whose steps fit in a byte, most of a pen stroke, are decoded up to 4 at a time from one 8 byte load without a
+* branch per byte, so only the odd long step goes through the byte at a time path. Returns the end of the points.
+*/
+const uint8_t* unpackPoints(const uint8_t* at, uint32_t count, uint8_t grid, float* xs, float* ys, float scale = 1.f, ImVec2 offset = { 0.f, 0.f });
+
+/**
+* Reads points back from packPoints, one at a time from where they start
+* The caller knows how many there are, nothing past the end of them is checked
+*/
+class PointDecoder {
+public:
+	explicit PointDecoder(const uint8_t* at, uint8_t grid = 0) : at(at), step(1.f / (PACKED_SUBPIXELS * (float) (1u << grid))) {}
+
+	ImVec2 next() {
+		// Wrapping rather than overflowing on points that were never packed by packPoints
+		x += (uint32_t) unzigzag(varint());
+		y += (uint32_t) unzigzag(varint());
+		return { (float) (int32_t) x * step, (float) (int32_t) y * step };
+	}
+
+	const uint8_t* end() const { return at; }
+
+private:
+	uint32_t varint() {
+		uint32_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			uint8_t byte = *at++;
+			value |= (uint32_t) (byte & 0x7F) << shift;
+			if (!(byte & 0x80)) return value;
+		}
+	}
+	static int32_t unzigzag(uint32_t value) { return (int32_t) (value >> 1) ^ -(int32_t) (value & 1); }
+
+	const uint8_t* at;
+	float step;
+	uint32_t x = 0;
+	uint32_t y = 0;
+};
+
+#endif // POINT_CODEC_H
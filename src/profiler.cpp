@@ -0,0 +1,192 @@
+#include "profiler.h"
+
+#ifdef WB_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+	std::atomic<size_t> allocationCount{ 0 };
+	std::atomic<size_t> allocatedBytes{ 0 };
+
+	void* countedAllocation(size_t size) {
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		if (void* block = std::malloc(size ? size : 1)) return block;
+		throw std::bad_alloc();
+	}
+}
+
+// Counting replacements for the global allocation functions, the aligned and nothrow forms are left alone
+void* operator new(size_t size) { return countedAllocation(size); }
+void* operator new[](size_t size) { return countedAllocation(size); }
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete[](void* block) noexcept { std::free(block); }
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+void operator delete[](void* block, size_t) noexcept { std::free(block); }
+
+size_t profileAllocationCount() {
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+size_t profileAllocatedBytes() {
+	return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+Profiler& Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler() : origin(std::chrono::steady_clock::now()), frames(PROFILE_HISTORY) {}
+
+int Profiler::zone(const char* name) {
+	// Scopes in different places can share a zone by name
+	auto it = std::find(zones.begin(), zones.end(), name);
+	if (it != zones.end()) return (int) (it - zones.begin());
+
+	zones.push_back(name);
+	current.zoneTotals.resize(zones.size(), 0.0);
+	return (int) zones.size() - 1;
+}
+
+int Profiler::counter(const char* name) {
+	auto it = std::find(counters.begin(), counters.end(), name);
+	if (it != counters.end()) return (int) (it - counters.begin());
+
+	counters.push_back(name);
+	current.counterValues.resize(counters.size(), 0.0);
+	return (int) counters.size() - 1;
+}
+
+double Profiler::now() const {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+}
+
+int Profiler::enterScope() {
+	return depth++;
+}
+
+void Profiler::exitScope(int zone, double start, int depth) {
+	double end = now();
+	current.events.push_back({ zone, depth, start, end });
+	current.zoneTotals[zone] += end - start;
+	this->depth = depth;
+}
+
+void Profiler::setCounter(int counter, double value) {
+	current.counterValues[counter] = value;
+}
+
+void Profiler::endFrame() {
+	static const int allocations = counter("Allocations");
+	size_t allocated = profileAllocationCount();
+	setCounter(allocations, (double) (allocated - frameAllocations));
+	frameAllocations = allocated;
+	current.end = now();
+
+	// Swap into the ring so the slot's vectors get reused for the next frame
+	Frame& slot = frames[frameCount % PROFILE_HISTORY];
+	std::swap(slot, current);
+	frameCount++;
+
+	current.start = slot.end;
+	current.events.clear();
+	current.zoneTotals.assign(zones.size(), 0.0);
+	current.counterValues = slot.counterValues;
+	current.counterValues.resize(counters.size(), 0.0);
+}
+
+template<typename Value> void Profiler::collect(Value value, std::vector<float>& out) const {
+	out.clear();
+	size_t kept = std::min<size_t>(frameCount, PROFILE_HISTORY);
+	for (size_t i = frameCount - kept; i < frameCount; i++) {
+		out.push_back((float) (value(frames[i % PROFILE_HISTORY]) * 1000.0));
+	}
+}
+
+void Profiler::frameTimes(std::vector<float>& out) const {
+	collect([](const Frame& frame) { return frame.end - frame.start; }, out);
+}
+
+void Profiler::zoneTimes(int zone, std::vector<float>& out) const {
+	collect([zone](const Frame& frame) { return zone < (int) frame.zoneTotals.size() ? frame.zoneTotals[zone] : 0.0; }, out);
+}
+
+static double percentile(std::vector<float>& values, double p) {
+	if (values.empty()) return 0.0;
+	size_t rank = std::min(values.size() - 1, (size_t) (p * values.size()));
+	std::nth_element(values.begin(), values.begin() + rank, values.end());
+	return values[rank];
+}
+
+double Profiler::framePercentile(double p) const {
+	std::vector<float> values;
+	frameTimes(values);
+	return percentile(values, p);
+}
+
+double Profiler::zonePercentile(int zone, double p) const {
+	std::vector<float> values;
+	zoneTimes(zone, values);
+	return percentile(values, p);
+}
+
+double Profiler::counterValue(int counter) const {
+	if (frameCount == 0) return 0.0;
+	const Frame& last = frames[(frameCount - 1) % PROFILE_HISTORY];
+	return counter < (int) last.counterValues.size() ? last.counterValues[counter] : 0.0;
+}
+
+static void writeJsonString(FILE* file, const std::string& text) {
+	std::fputc('"', file);
+	for (char c : text) {
+		if (c == '"' || c == '\\') std::fputc('\\', file);
+		std::fputc(c, file);
+	}
+	std::fputc('"', file);
+}
+
+/**
+* Writes the kept frames in the Chrome trace event format, for chrome://tracing or ui.perfetto.dev
+*/
+bool Profiler::writeChromeTrace(const std::string& path) const {
+	FILE* file = std::fopen(path.c_str(), "w");
+	if (!file) return false;
+
+	std::fputs("{\"traceEvents\":[\n", file);
+	bool first = true;
+	auto separator = [&]() {
+		if (!first) std::fputs(",\n", file);
+		first = false;
+	};
+
+	size_t kept = std::min<size_t>(frameCount, PROFILE_HISTORY);
+	for (size_t i = frameCount - kept; i < frameCount; i++) {
+		const Frame& frame = frames[i % PROFILE_HISTORY];
+
+		separator();
+		std::fprintf(file, "{\"name\":\"Frame %zu\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", i, frame.start * 1e6, (frame.end - frame.start) * 1e6);
+		for (const ProfileEvent& event : frame.events) {
+			separator();
+			std::fputs("{\"name\":", file);
+			writeJsonString(file, zones[event.zone]);
+			std::fprintf(file, ",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", event.start * 1e6, (event.end - event.start) * 1e6);
+		}
+		for (size_t c = 0; c < frame.counterValues.size(); c++) {
+			separator();
+			std::fputs("{\"name\":", file);
+			writeJsonString(file, counters[c]);
+			std::fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%.17g}}", frame.end * 1e6, frame.counterValues[c]);
+		}
+	}
+
+	std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+	return std::fclose(file) == 0;
+}
+
+#endif // WB_PROFILE
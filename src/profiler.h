@@ -0,0 +1,117 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/**
+* Frame profiler, only compiled in when WB_PROFILE is defined
+* PROFILE_SCOPE("name") times the rest of the enclosing block, PROFILE_COUNTER("name", value) records a value for the
+* current frame and PROFILE_FRAME() closes the frame. Without WB_PROFILE they expand to nothing and their arguments are
+* never evaluated. Only the thread calling PROFILE_FRAME() should be instrumented.
+* Heap allocations are counted too and recorded as the "Allocations" counter each frame.
+*/
+#ifdef WB_PROFILE
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Frames kept for the overlay and for trace dumps
+const int PROFILE_HISTORY = 240;
+
+struct ProfileEvent {
+	int zone;
+	int depth;
+	double start;  // seconds since the profiler was created
+	double end;
+};
+
+class Profiler {
+public:
+	static Profiler& instance();
+
+	int zone(const char* name);
+	int counter(const char* name);
+	double now() const;
+
+	int enterScope();
+	void exitScope(int zone, double start, int depth);
+	void setCounter(int counter, double value);
+	void endFrame();
+
+	const std::vector<std::string>& zoneNames() const { return zones; }
+	const std::vector<std::string>& counterNames() const { return counters; }
+	// Oldest first, in milliseconds
+	void frameTimes(std::vector<float>& out) const;
+	void zoneTimes(int zone, std::vector<float>& out) const;
+	// Percentile p (0-1) over the kept frames, in milliseconds
+	double framePercentile(double p) const;
+	double zonePercentile(int zone, double p) const;
+	double counterValue(int counter) const;
+
+	bool writeChromeTrace(const std::string& path) const;
+
+private:
+	struct Frame {
+		double start = 0.0;
+		double end = 0.0;
+		std::vector<ProfileEvent> events;
+		std::vector<double> zoneTotals;
+		std::vector<double> counterValues;
+	};
+
+	Profiler();
+	template<typename Value> void collect(Value value, std::vector<float>& out) const;
+
+	std::chrono::steady_clock::time_point origin;
+	std::vector<std::string> zones;
+	std::vector<std::string> counters;
+	std::vector<Frame> frames;  // ring of the last PROFILE_HISTORY frames
+	size_t frameCount = 0;
+	size_t frameAllocations = 0;  // profileAllocationCount() at the end of the last frame
+	Frame current;
+	int depth = 0;
+};
+
+/**
+* Every heap allocation made through operator new since the program started, on any thread
+*/
+size_t profileAllocationCount();
+size_t profileAllocatedBytes();
+
+/**
+* Times its own lifetime as one event of a zone
+*/
+class ProfileScope {
+public:
+	explicit ProfileScope(int zone) : zone(zone), depth(Profiler::instance().enterScope()), start(Profiler::instance().now()) {}
+	~ProfileScope() { Profiler::instance().exitScope(zone, start, depth); }
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	int zone;
+	int depth;
+	double start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) \
+	static const int PROFILE_CONCAT(profileZone, __LINE__) = Profiler::instance().zone(name); \
+	ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileZone, __LINE__))
+#define PROFILE_COUNTER(name, value) \
+	do { \
+		static const int profileCounter = Profiler::instance().counter(name); \
+		Profiler::instance().setCounter(profileCounter, (double) (value)); \
+	} while (false)
+#define PROFILE_FRAME() Profiler::instance().endFrame()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNTER(name, value)
+#define PROFILE_FRAME()
+
+#endif // WB_PROFILE
+
+#endif // PROFILER_H
@@ -0,0 +1,60 @@
+#include "profiler_overlay.h"
+
+#ifdef WB_PROFILE
+
+#include <algorithm>
+#include <imgui/imgui.h>
+
+void drawProfilerWindow(bool* open) {
+	Profiler& profiler = Profiler::instance();
+	if (!ImGui::Begin("Profiler", open)) {
+		ImGui::End();
+		return;
+	}
+
+	static std::vector<float> times;
+	profiler.frameTimes(times);
+	float highest = times.empty() ? 0.f : *std::max_element(times.begin(), times.end());
+	ImGui::Text("Frame p50 %.2f ms, p99 %.2f ms", profiler.framePercentile(0.5), profiler.framePercentile(0.99));
+	ImGui::PlotHistogram("##Frames", times.data(), (int) times.size(), 0, nullptr, 0.f, std::max(highest, 1.f), ImVec2(-1.f, 80.f));
+
+	if (ImGui::BeginTable("Zones", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+		ImGui::TableSetupColumn("Phase");
+		ImGui::TableSetupColumn("p50 ms");
+		ImGui::TableSetupColumn("p99 ms");
+		ImGui::TableSetupColumn("History");
+		ImGui::TableHeadersRow();
+		const std::vector<std::string>& zones = profiler.zoneNames();
+		for (int zone = 0; zone < (int) zones.size(); zone++) {
+			profiler.zoneTimes(zone, times);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(zones[zone].c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", profiler.zonePercentile(zone, 0.5));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", profiler.zonePercentile(zone, 0.99));
+			ImGui::TableNextColumn();
+			ImGui::PushID(zone);
+			ImGui::PlotHistogram("##Zone", times.data(), (int) times.size(), 0, nullptr, 0.f, FLT_MAX, ImVec2(-1.f, 18.f));
+			ImGui::PopID();
+		}
+		ImGui::EndTable();
+	}
+
+	const std::vector<std::string>& counters = profiler.counterNames();
+	for (int counter = 0; counter < (int) counters.size(); counter++) {
+		ImGui::Text("%s: %.0f", counters[counter].c_str(), profiler.counterValue(counter));
+	}
+
+	static bool dumped = false;
+	if (ImGui::Button("Dump Chrome Trace")) dumped = profiler.writeChromeTrace("whiteboard_trace.json");
+	if (dumped) {
+		ImGui::SameLine();
+		ImGui::TextUnformatted("Wrote whiteboard_trace.json");
+	}
+
+	ImGui::End();
+}
+
+#endif // WB_PROFILE
@@ -0,0 +1,15 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#ifdef WB_PROFILE
+
+#include "profiler.h"
+
+/**
+* ImGui window with the rolling frame time graph, p50 / p99 for the frame and every zone, and the latest counters
+*/
+void drawProfilerWindow(bool* open);
+
+#endif // WB_PROFILE
+
+#endif // PROFILER_OVERLAY_H
@@ -0,0 +1,180 @@
+#include "rasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include "shapes.h"
+
+struct TileBounds {
+	int x0, y0, x1, y1;  // exclusive max
+};
+
+/**
+* A segment in image space with what is needed to measure distances to it repeatedly
+*/
+struct RasterSegment {
+	float ax, ay;
+	float dx, dy;
+	float inverseLengthSq;
+
+	RasterSegment(ImVec2 a, ImVec2 b) : ax(a.x), ay(a.y), dx(b.x - a.x), dy(b.y - a.y) {
+		float lengthSq = dx * dx + dy * dy;
+		inverseLengthSq = lengthSq > 0.f ? 1.f / lengthSq : 0.f;
+	}
+
+	float distanceSq(float px, float py) const {
+		float rx = px - ax;
+		float ry = py - ay;
+		float t = std::clamp((rx * dx + ry * dy) * inverseLengthSq, 0.f, 1.f);
+		float cx = rx - t * dx;
+		float cy = ry - t * dy;
+		return cx * cx + cy * cy;
+	}
+};
+
+/**
+* Takes the coverage of one stroke in this tile, the union of a capsule around every segment
+* pointAt(i) gives the stroke's count points on the board, coverage is tileSize * tileSize, touched grows to the area written
+*/
+template<typename F> static void strokeCoverage(F&& pointAt, uint32_t count, const RasterSettings& settings, const TileBounds& tile, float radius, float* coverage, TileBounds& touched) {
+	int tileSize = settings.tileSize;
+	float reach = radius + 0.5f;
+	// Anything closer than this is fully covered
+	float solid = std::max(radius - 0.5f, 0.f);
+
+	ImVec2 previous = pointAt(0);
+	previous = { (previous.x - settings.origin.x) * settings.scale, (previous.y - settings.origin.y) * settings.scale };
+	for (uint32_t i = 0; i < std::max<uint32_t>(count, 2) - 1; i++) {
+		ImVec2 next = previous;
+		if (count > 1) {
+			ImVec2 point = pointAt(i + 1);
+			next = { (point.x - settings.origin.x) * settings.scale, (point.y - settings.origin.y) * settings.scale };
+		}
+		RasterSegment segment(previous, next);
+		ImVec2 a = previous;
+		previous = next;
+
+		int x0 = std::max(tile.x0, (int) std::floor(std::min(a.x, next.x) - reach));
+		int y0 = std::max(tile.y0, (int) std::floor(std::min(a.y, next.y) - reach));
+		int x1 = std::min(tile.x1, (int) std::ceil(std::max(a.x, next.x) + reach));
+		int y1 = std::min(tile.y1, (int) std::ceil(std::max(a.y, next.y) + reach));
+		if (x0 >= x1 || y0 >= y1) continue;
+
+		touched = { std::min(touched.x0, x0), std::min(touched.y0, y0), std::max(touched.x1, x1), std::max(touched.y1, y1) };
+		for (int y = y0; y < y1; y++) {
+			float* row = coverage + (y - tile.y0) * tileSize - tile.x0;
+			float py = y + 0.5f;
+			for (int x = x0; x < x1; x++) {
+				if (row[x] >= 1.f) continue;
+				float distanceSq = segment.distanceSq(x + 0.5f, py);
+				if (distanceSq >= reach * reach) continue;
+				row[x] = distanceSq <= solid * solid ? 1.f : std::max(row[x], reach - std::sqrt(distanceSq));
+			}
+		}
+	}
+}
+
+void rasterize(const StrokeDocument& document, const RasterSettings& settings, RasterImage& image, ThreadPool& pool) {
+	rasterize(std::vector<const StrokeDocument*>{ &document }, settings, image, pool);
+}
+
+void rasterize(const std::vector<const StrokeDocument*>& documents, const RasterSettings& settings, RasterImage& image, ThreadPool& pool) {
+	int tileSize = settings.tileSize;
+	int tilesX = (image.width + tileSize - 1) / tileSize;
+	int tilesY = (image.height + tileSize - 1) / tileSize;
+	image.pixels.assign((size_t) image.width * image.height * 4, 0);
+	if (tilesX <= 0 || tilesY <= 0) return;
+
+	// Every stroke of every document in drawing order, by the document it is in and where it is in it
+	std::vector<std::pair<uint32_t, uint32_t>> strokes;
+	for (uint32_t d = 0; d < documents.size(); d++) {
+		for (uint32_t s = 0; s < documents[d]->strokes().size(); s++) strokes.push_back({ d, s });
+	}
+
+	// Bin strokes into the tiles their bounds touch, keeping drawing order within each tile
+	std::vector<std::vector<uint32_t>> bins((size_t) tilesX * tilesY);
+	// Shapes are traced out up front, the tiles only read them
+	std::vector<std::vector<ImVec2>> outlines(strokes.size());
+	for (uint32_t s = 0; s < strokes.size(); s++) {
+		const StrokeDocument& document = *documents[strokes[s].first];
+		const Stroke& stroke = document.strokes()[strokes[s].second];
+		if (stroke.count == 0) continue;
+
+		float reach = std::max(stroke.style.thickness * settings.scale * 0.5f, 0.5f) + 0.5f;
+		float x0 = (stroke.min.x - settings.origin.x) * settings.scale - reach;
+		float y0 = (stroke.min.y - settings.origin.y) * settings.scale - reach;
+		float x1 = (stroke.max.x - settings.origin.x) * settings.scale + reach;
+		float y1 = (stroke.max.y - settings.origin.y) * settings.scale + reach;
+		if (x1 < 0.f || y1 < 0.f || x0 >= image.width || y0 >= image.height) continue;
+		// Unpacked once here rather than in every tile the stroke crosses
+		strokeOutline(document, stroke, SHAPE_TOLERANCE / settings.scale, outlines[s]);
+
+		int tx0 = std::max(0, (int) (x0 / tileSize));
+		int ty0 = std::max(0, (int) (y0 / tileSize));
+		int tx1 = std::min(tilesX - 1, (int) (x1 / tileSize));
+		int ty1 = std::min(tilesY - 1, (int) (y1 / tileSize));
+		for (int ty = ty0; ty <= ty1; ty++) {
+			for (int tx = tx0; tx <= tx1; tx++) bins[(size_t) ty * tilesX + tx].push_back(s);
+		}
+	}
+
+	const ImVec4& background = settings.background;
+	pool.parallelFor(bins.size(), [&](size_t index) {
+		TileBounds tile{};
+		tile.x0 = (int) (index % tilesX) * tileSize;
+		tile.y0 = (int) (index / tilesX) * tileSize;
+		tile.x1 = std::min(tile.x0 + tileSize, image.width);
+		tile.y1 = std::min(tile.y0 + tileSize, image.height);
+
+		// Premultiplied, blended with one + inverse source alpha like the DX11 backend's blend state
+		thread_local std::vector<float> colour;
+		thread_local std::vector<float> coverage;
+		colour.resize((size_t) tileSize * tileSize * 4);
+		coverage.assign((size_t) tileSize * tileSize, 0.f);
+		for (size_t p = 0; p < colour.size(); p += 4) {
+			colour[p + 0] = background.x * background.w;
+			colour[p + 1] = background.y * background.w;
+			colour[p + 2] = background.z * background.w;
+			colour[p + 3] = background.w;
+		}
+
+		for (uint32_t s : bins[index]) {
+			const StrokeDocument& document = *documents[strokes[s].first];
+			const Stroke& stroke = document.strokes()[strokes[s].second];
+			float width = stroke.style.thickness * settings.scale;
+			// Lines thinner than a pixel are drawn a pixel wide and faded instead
+			float radius = std::max(width * 0.5f, 0.5f);
+			ImVec4 rgba = ImGui::ColorConvertU32ToFloat4(stroke.style.colour);
+			rgba.w *= std::min(width, 1.f);
+
+			TileBounds touched{ tile.x1, tile.y1, tile.x0, tile.y0 };
+			const std::vector<ImVec2>& outline = outlines[s];
+			strokeCoverage([&](uint32_t i) { return outline[i]; }, (uint32_t) outline.size(), settings, tile, radius, coverage.data(), touched);
+
+			for (int y = touched.y0; y < touched.y1; y++) {
+				size_t row = (size_t) (y - tile.y0) * tileSize;
+				for (int x = touched.x0; x < touched.x1; x++) {
+					float& amount = coverage[row + x - tile.x0];
+					if (amount <= 0.f) continue;
+
+					float alpha = rgba.w * amount;
+					float* pixel = &colour[(row + x - tile.x0) * 4];
+					pixel[0] = rgba.x * alpha + pixel[0] * (1.f - alpha);
+					pixel[1] = rgba.y * alpha + pixel[1] * (1.f - alpha);
+					pixel[2] = rgba.z * alpha + pixel[2] * (1.f - alpha);
+					pixel[3] = alpha + pixel[3] * (1.f - alpha);
+					amount = 0.f;
+				}
+			}
+		}
+
+		for (int y = tile.y0; y < tile.y1; y++) {
+			const float* pixel = &colour[(size_t) (y - tile.y0) * tileSize * 4];
+			uint8_t* out = &image.pixels[((size_t) y * image.width + tile.x0) * 4];
+			for (int x = tile.x0; x < tile.x1; x++, pixel += 4, out += 4) {
+				float alpha = pixel[3];
+				float unpremultiply = alpha > 0.f ? 1.f / alpha : 0.f;
+				for (int c = 0; c < 3; c++) out[c] = (uint8_t) std::lround(std::clamp(pixel[c] * unpremultiply, 0.f, 1.f) * 255.f);
+				out[3] = (uint8_t) std::lround(std::clamp(alpha, 0.f, 1.f) * 255.f);
+			}
+		}
+	});
+}
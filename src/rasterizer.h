@@ -0,0 +1,40 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+#include "thread_pool.h"
+
+const int DEFAULT_TILE_SIZE = 64;
+
+struct RasterSettings {
+	ImVec2 origin{ 0.f, 0.f };  // board position of the image's top left corner
+	float scale = 1.f;  // image pixels per board pixel
+	ImVec4 background{ 0.f, 0.f, 0.f, 0.f };
+	int tileSize = DEFAULT_TILE_SIZE;
+};
+
+/**
+* 8 bit RGBA pixels with straight alpha, rows top to bottom
+*/
+struct RasterImage {
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> pixels;
+};
+
+/**
+* Draws the document on the CPU, with no graphics API involved
+* The image is split into tiles that are rendered in parallel on the pool. Strokes are anti-aliased, with round joins
+* and caps, and each one is blended over the ones before it the same way the overlay's blend state does, so
+* highlighters come out as they look on screen.
+*/
+void rasterize(const StrokeDocument& document, const RasterSettings& settings, RasterImage& image, ThreadPool& pool);
+/**
+* Draws several documents over each other, the first at the bottom (eg. the visible layers)
+*/
+void rasterize(const std::vector<const StrokeDocument*>& documents, const RasterSettings& settings, RasterImage& image, ThreadPool& pool);
+
+#endif // RASTERIZER_H
@@ -0,0 +1,857 @@
+#include "replay_runner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <imgui/imgui.h>
+#include "point_codec.h"
+#include "profiler.h"
+#include "shapes.h"
+#include "stroke_tessellator.h"
+#include "sync_session.h"
+
+namespace {
+	const double FRAME_TIME = 1.0 / 144.0;
+	const ImVec2 DISPLAY_SIZE{ 2560.f * 2, 1440.f };
+	// How long either side of the sync benchmark waits for the other
+	const double SYNC_TIMEOUT = 30.0;
+	// Points a stroke drawn live gets between updates, about what a pen gives at 144 Hz
+	const size_t SYNC_POINTS_PER_FRAME = 4;
+	// Strokes committed per update while measuring throughput, and most there can be waiting on the host's removes
+	const size_t SYNC_STROKES_PER_FRAME = 32;
+	const size_t SYNC_IN_FLIGHT = 1024;
+
+	size_t allocationCount() {
+#ifdef WB_PROFILE
+		return profileAllocationCount();
+#else
+		return 0;
+#endif
+	}
+
+	size_t allocatedBytes() {
+#ifdef WB_PROFILE
+		return profileAllocatedBytes();
+#else
+		return 0;
+#endif
+	}
+
+	double percentile(const std::vector<double>& sorted, double p) {
+		if (sorted.empty()) return 0.0;
+		return sorted[std::min(sorted.size() - 1, (size_t) (p * (sorted.size() - 1) + 0.5))];
+	}
+
+	/**
+	* Builds frames for syntheticSession, keeping the clock, pointer and buttons between them
+	*/
+	class SessionBuilder {
+	public:
+		explicit SessionBuilder(std::vector<RecordedFrame>& frames) : frames(frames) {}
+
+		// One frame, pointer samples are spread evenly through it
+		RecordedFrame& frame(const std::vector<ImVec2>& moves = {}) {
+			RecordedFrame& frame = frames.emplace_back();
+			for (size_t i = 0; i < moves.size(); i++) {
+				mouse = moves[i];
+				frame.samples.push_back({ mouse.x, mouse.y, 1.f, buttons, time + FRAME_TIME * (i + 1) / moves.size() });
+			}
+			time += FRAME_TIME;
+			frame.input.time = time;
+			frame.input.mouse = mouse;
+			frame.input.leftDown = buttons & POINTER_LEFT;
+			frame.input.rightDown = buttons & POINTER_RIGHT;
+			return frame;
+		}
+
+		void press(uint8_t button) { buttons |= button; frame(); }
+		void release(uint8_t button) { buttons &= ~button; frame(); }
+		void moveTo(ImVec2 point) { mouse = point; frame(); }
+
+		ImVec2 mouse{ 0.f, 0.f };
+		uint8_t buttons = 0;
+		double time = 0.0;
+
+	private:
+		std::vector<RecordedFrame>& frames;
+	};
+
+	/**
+	* An ImGui context with no platform or renderer behind it, the previous context comes back when it goes
+	*/
+	class HeadlessContext {
+	public:
+		HeadlessContext() : previous(ImGui::GetCurrentContext()), context(ImGui::CreateContext()) {
+			ImGui::SetCurrentContext(context);
+			ImGuiIO& io = ImGui::GetIO();
+			io.IniFilename = nullptr;
+			io.DisplaySize = DISPLAY_SIZE;
+			io.DeltaTime = (float) FRAME_TIME;
+			io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;  // the DX11 backend has it, so strokes draw the same way
+			unsigned char* pixels = nullptr;
+			int width = 0, height = 0;
+			io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+		}
+
+		~HeadlessContext() {
+			ImGui::DestroyContext(context);
+			ImGui::SetCurrentContext(previous);
+		}
+
+		HeadlessContext(const HeadlessContext&) = delete;
+		HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	private:
+		ImGuiContext* previous;
+		ImGuiContext* context;
+	};
+
+	/**
+	* Made up hand drawn strokes for the shape benchmarks, the true outline with a slow wobble and a little jitter
+	*/
+	class HandDrawing {
+	public:
+		explicit HandDrawing(uint32_t seed) : rng(seed) {}
+
+		// Raw engine output only, like syntheticSession
+		float uniform(float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); }
+
+		void begin(ImVec2 start, float size) {
+			points.assign(1, start);
+			travelled = 0.f;
+			wobble = size * 0.012f;
+			wavelength = size * uniform(0.5f, 1.f);
+			phase = uniform(0.f, 6.2831853f);
+		}
+
+		// Pushed off the true outline along its normal
+		void add(ImVec2 point, ImVec2 normal) {
+			float dx = point.x - points.back().x, dy = point.y - points.back().y;
+			travelled += std::sqrt(dx * dx + dy * dy);
+			float offset = wobble * std::sin(travelled / wavelength * 6.2831853f + phase) + uniform(-0.5f, 0.5f);
+			points.push_back({ point.x + normal.x * offset, point.y + normal.y * offset });
+		}
+
+		void lineTo(ImVec2 target) {
+			ImVec2 from = points.back();
+			float dx = target.x - from.x, dy = target.y - from.y;
+			float length = std::sqrt(dx * dx + dy * dy);
+			if (length <= 0.f) return;
+			ImVec2 normal{ -dy / length, dx / length };
+			int steps = std::max(1, (int) (length / SPACING));
+			for (int i = 1; i <= steps; i++) add({ from.x + dx * i / steps, from.y + dy * i / steps }, normal);
+		}
+
+		std::vector<ImVec2> points;
+
+	private:
+		// Pixels between samples, about what the ingestor keeps at a steady hand speed
+		static constexpr float SPACING = 3.f;
+
+		std::mt19937 rng;
+		float travelled = 0.f;
+		float wobble = 0.f;
+		float wavelength = 1.f;
+		float phase = 0.f;
+	};
+
+	/**
+	* Builds one frame the way the window does, returns how long it took in milliseconds
+	*/
+	double buildFrame(Whiteboard& board, const FrameInput& input, std::vector<DamageRect>& redraw, std::vector<DamageRect>& present) {
+		auto start = std::chrono::steady_clock::now();
+		ImGui::NewFrame();
+		board.update(input);
+		board.draw(ImGui::GetBackgroundDrawList(), input);
+		ImGui::Render();
+		if (board.damage.hasDamage()) board.damage.endFrame(2, redraw, present);
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/**
+	* A stroke that sets off somewhere random in the extent and wanders about, spacing apart from one point to the next
+	*/
+	void wander(std::vector<ImVec2>& points, size_t count, ImVec2 extent, std::mt19937& rng, float spacing = 6.f) {
+		auto uniform = [&](float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); };
+		points.clear();
+		ImVec2 point{ uniform(0.f, extent.x), uniform(0.f, extent.y) };
+		float heading = uniform(0.f, 6.2831853f);
+		for (size_t i = 0; i < count; i++) {
+			heading += uniform(-0.3f, 0.3f);
+			point = { point.x + spacing * std::cos(heading), point.y + spacing * std::sin(heading) };
+			points.push_back(point);
+		}
+	}
+
+	/**
+	* Adds wandering strokes of 250 points at random over the extent until there are about pointCount more points
+	*/
+	void scatterStrokes(StrokeDocument& document, size_t pointCount, ImVec2 extent, std::mt19937& rng, float spacing = 6.f) {
+		const uint32_t pointsPerStroke = 250;
+		std::vector<ImVec2> points;
+		for (size_t added = 0; added < pointCount; added += pointsPerStroke) {
+			wander(points, pointsPerStroke, extent, rng, spacing);
+			ImU32 colour = IM_COL32(rng() & 0xFF, rng() & 0xFF, rng() & 0xFF, 255);
+			float thickness = 2.f + 10.f * (float) (rng() >> 8) / (float) (1u << 24);
+			document.addStroke({ colour, thickness }, points.data(), pointsPerStroke);
+		}
+	}
+
+	void finishSyncReport(SyncReport& report, const SyncStats& stats, const SyncStats& start) {
+		report.opsSent = stats.opsSent - start.opsSent;
+		report.opsReceived = stats.opsReceived - start.opsReceived;
+		report.batchesSent = stats.batchesSent - start.batchesSent;
+		report.bytesSent = stats.bytesSent - start.bytesSent;
+		report.bytesReceived = stats.bytesReceived - start.bytesReceived;
+	}
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void finishReport(ReplayReport& report, const Whiteboard& board, std::vector<double>& times) {
+		report.frames = times.size();
+		report.strokes = board.layers.strokeCount();
+		report.points = board.layers.pointCount();
+		report.vertices = times.empty() ? 0 : ImGui::GetDrawData()->TotalVtxCount;
+		report.memoryBytes = board.memoryUsage();
+		report.peakMemoryBytes = std::max(report.peakMemoryBytes, report.memoryBytes);
+		if (times.empty()) return;
+
+		double total = 0.0;
+		for (double time : times) total += time;
+		report.meanMs = total / times.size();
+		std::sort(times.begin(), times.end());
+		report.p50Ms = percentile(times, 0.5);
+		report.p99Ms = percentile(times, 0.99);
+		report.maxMs = times.back();
+	}
+}
+
+ReplayReport runReplay(const std::string& name, const std::vector<RecordedFrame>& frames) {
+	HeadlessContext context;
+	auto board = std::make_unique<Whiteboard>();
+	board->view.size = DISPLAY_SIZE;
+	std::vector<DamageRect> redraw, present;
+
+	ReplayReport report;
+	report.name = name;
+	std::vector<double> times;
+	times.reserve(frames.size());
+	size_t allocationsBefore = allocationCount();
+	size_t bytesBefore = allocatedBytes();
+
+	for (const RecordedFrame& frame : frames) {
+		times.push_back(buildFrame(*board, frame.input, redraw, present));
+		report.peakMemoryBytes = std::max(report.peakMemoryBytes, board->memoryUsage());
+	}
+
+	report.allocations = allocationCount() - allocationsBefore;
+	report.allocatedBytes = allocatedBytes() - bytesBefore;
+	finishReport(report, *board, times);
+	return report;
+}
+
+std::vector<ReplayReport> runViewBenchmarks(size_t pointCount, uint32_t seed) {
+	HeadlessContext context;
+	auto board = std::make_unique<Whiteboard>();
+	board->view.size = DISPLAY_SIZE;
+	std::vector<DamageRect> redraw, present;
+
+	// Wandering strokes spread over a board 8 screens across and 8 down
+	const ImVec2 extent{ DISPLAY_SIZE.x * 8, DISPLAY_SIZE.y * 8 };
+	std::mt19937 rng(seed);
+	scatterStrokes(board->layers.active().contents().document, pointCount, extent, rng);
+
+	struct Scenario {
+		const char* name;
+		ImVec2 origin;
+		float zoom;
+		ImVec2 panPerFrame;  // in screen pixels
+	};
+	const Scenario scenarios[] = {
+		{ "view culling, one screen of the board at 1:1", { extent.x * 0.5f, extent.y * 0.5f }, 1.f, { 0.f, 0.f } },
+		{ "view culling, panning across the board at 1:1", { 0.f, extent.y * 0.5f }, 1.f, { -40.f, 0.f } },
+		{ "level of detail, the whole board at 1/8", { 0.f, 0.f }, 1.f / 8.f, { 0.f, 0.f } },
+		{ "level of detail, a quarter of the board at 1/4", { 0.f, 0.f }, 1.f / 4.f, { 0.f, 0.f } },
+		{ "level of detail, zoomed in to 16x", { extent.x * 0.5f, extent.y * 0.5f }, 16.f, { 0.f, 0.f } }
+	};
+
+	std::vector<ReplayReport> reports;
+	FrameInput input;
+	for (const Scenario& scenario : scenarios) {
+		board->view.origin = scenario.origin;
+		board->view.zoom = scenario.zoom;
+
+		// Levels are baked a bit at a time, only time frames drawn from the one the zoom wants
+		int wanted = LodCache::levelFor(scenario.zoom);
+		for (int warmUp = 0; warmUp < 1000 && board->layers.active().peek().cache.drawnLevel() != wanted; warmUp++) buildFrame(*board, input, redraw, present);
+		buildFrame(*board, input, redraw, present);
+
+		ReplayReport report;
+		char name[128];
+		snprintf(name, sizeof(name), "%s (%zu points)", scenario.name, board->layers.pointCount());
+		report.name = name;
+		std::vector<double> times;
+		size_t allocationsBefore = allocationCount();
+		size_t bytesBefore = allocatedBytes();
+		for (int frame = 0; frame < 240; frame++) {
+			board->view.pan(scenario.panPerFrame);
+			times.push_back(buildFrame(*board, input, redraw, present));
+		}
+		report.allocations = allocationCount() - allocationsBefore;
+		report.allocatedBytes = allocatedBytes() - bytesBefore;
+		finishReport(report, *board, times);
+		reports.push_back(report);
+	}
+	return reports;
+}
+
+std::vector<ReplayReport> runLayerBenchmarks(size_t layerCount, size_t pointsPerLayer, uint32_t seed) {
+	HeadlessContext context;
+	auto board = std::make_unique<Whiteboard>();
+	board->view.size = DISPLAY_SIZE;
+	std::vector<DamageRect> redraw, present;
+
+	// Each layer spread over the same 8 x 8 screens, all of it in view at 1/8 so every visible layer draws
+	const ImVec2 extent{ DISPLAY_SIZE.x * 8, DISPLAY_SIZE.y * 8 };
+	std::mt19937 rng(seed);
+	LayerStack& layers = board->layers;
+	for (size_t i = 0; i < layerCount; i++) {
+		if (i > 0) layers.add("Layer " + std::to_string(i + 1));
+		scatterStrokes(layers.active().contents().document, pointsPerLayer, extent, rng);
+	}
+	board->view.zoom = 1.f / 8.f;
+
+	FrameInput input;
+	auto frame = [&]() {
+		input.time += FRAME_TIME;
+		return buildFrame(*board, input, redraw, present);
+	};
+	auto settle = [&]() {
+		int wanted = LodCache::levelFor(board->view.zoom);
+		auto settled = [&]() {
+			for (size_t i = 0; i < layers.size(); i++) {
+				if (layers[i].isVisible() && layers[i].peek().cache.drawnLevel() != wanted) return false;
+			}
+			return true;
+		};
+		for (int warmUp = 0; warmUp < 5000 && !settled(); warmUp++) frame();
+		frame();
+	};
+	settle();
+
+	struct Scenario {
+		const char* name;
+		std::function<bool(int frame)> step;  // run before each timed frame, false stops early
+	};
+	const Scenario scenarios[] = {
+		{ "hiding / showing the bottom layer every frame", [&](int) {
+			layers.setVisible(0, !layers[0].isVisible(), input.time);
+			return true;
+		} },
+		{ "switching the active layer every frame", [&](int frame) {
+			layers.setActive(frame % layers.size());
+			return true;
+		} },
+		{ "moving the top layer down / up every frame", [&](int frame) {
+			return layers.move(layers.size() - 1 - frame % 2, frame % 2 ? 1 : -1);
+		} },
+		{ "clearing the active layer / undoing it every frame", [&](int frame) {
+			return frame % 2 ? layers.undo() : layers.clear(layers.activeLayer(), input.time);
+		} }
+	};
+
+	std::vector<ReplayReport> reports;
+	auto timeFrames = [&](const std::string& name, int frames, const std::function<bool(int frame)>& step) {
+		ReplayReport report;
+		char label[160];
+		snprintf(label, sizeof(label), "layers, %s (%zu x %zu points)", name.c_str(), layers.size(), pointsPerLayer);
+		report.name = label;
+		std::vector<double> times;
+		size_t allocationsBefore = allocationCount();
+		size_t bytesBefore = allocatedBytes();
+		for (int i = 0; i < frames && step(i); i++) {
+			times.push_back(frame());
+			report.peakMemoryBytes = std::max(report.peakMemoryBytes, board->memoryUsage());
+		}
+		report.allocations = allocationCount() - allocationsBefore;
+		report.allocatedBytes = allocatedBytes() - bytesBefore;
+		finishReport(report, *board, times);
+		reports.push_back(report);
+	};
+	for (const Scenario& scenario : scenarios) {
+		timeFrames(scenario.name, 240, scenario.step);
+		settle();
+	}
+
+	// Everything but the top layer hidden for long enough to be packed, then drawing just that one
+	for (size_t i = 0; i + 1 < layers.size(); i++) layers.setVisible(i, false, input.time);
+	input.time += LAYER_PACK_DELAY;
+	for (size_t i = 0; i < layers.size(); i++) frame();
+	timeFrames("all but the top one hidden and packed", 240, [](int) { return true; });
+
+	// Frames from showing a packed layer until it has been baked again, the first one unpacks it
+	timeFrames("showing a packed layer until it has been rebaked", 5000, [&](int frame) {
+		if (frame == 0) layers.setVisible(0, true, input.time);
+		return frame == 0 || layers[0].peek().cache.isRefilling();
+	});
+	return reports;
+}
+
+std::vector<StorageReport> runStorageBenchmarks(size_t pointCount, uint32_t seed) {
+	struct Scenario {
+		const char* name;
+		float spacing;  // between a stroke's points, on the board
+	};
+	const Scenario scenarios[] = {
+		{ "pen strokes drawn at 1:1", 6.f },
+		{ "pen strokes drawn zoomed in to 16x", 6.f / 16.f },
+		{ "quick flicks drawn at 1:1", 40.f }
+	};
+	const int passes = 20;
+
+	std::vector<StorageReport> reports;
+	std::vector<float> xs, ys;
+	for (const Scenario& scenario : scenarios) {
+		StrokeDocument document;
+		std::mt19937 rng(seed);
+		scatterStrokes(document, pointCount, { DISPLAY_SIZE.x * 8, DISPLAY_SIZE.y * 8 }, rng, scenario.spacing);
+
+		StorageReport report;
+		report.name = scenario.name;
+		report.strokes = document.strokes().size();
+		report.points = document.pointCount();
+		report.packedBytes = document.packedBytes();
+		report.floatBytes = report.points * 2 * sizeof(float);
+
+		// The fastest of a few passes over every stroke, the slower ones were only interrupted
+		auto fastest = [&](auto&& unpack) {
+			double best = 0.0;
+			for (int pass = 0; pass < passes; pass++) {
+				auto start = std::chrono::steady_clock::now();
+				for (const Stroke& stroke : document.strokes()) unpack(stroke);
+				double seconds = secondsSince(start);
+				if (seconds > 0.0) best = std::max(best, report.points / seconds);
+			}
+			return best;
+		};
+		// The way the caches read strokes, onto a level or the screen
+		report.unpackPointsPerSecond = fastest([&](const Stroke& stroke) {
+			document.readPoints(stroke, xs, ys, 0.5f, { 100.f, 100.f });
+		});
+		report.decodePointsPerSecond = fastest([&](const Stroke& stroke) {
+			xs.resize(stroke.count);
+			ys.resize(stroke.count);
+			PointDecoder decoder(document.packedPointsOf(stroke), stroke.grid);
+			for (uint32_t i = 0; i < stroke.count; i++) {
+				ImVec2 point = decoder.next();
+				xs[i] = point.x * 0.5f + 100.f;
+				ys[i] = point.y * 0.5f + 100.f;
+			}
+		});
+		reports.push_back(report);
+	}
+	return reports;
+}
+
+std::vector<ShapeReport> runShapeBenchmarks(size_t shapesPerKind, uint32_t seed) {
+	HeadlessContext context;
+	ImDrawList scratch(ImGui::GetDrawListSharedData());
+	scratch.Flags |= ImDrawListFlags_AllowVtxOffset;
+	HandDrawing hand(seed);
+	const StrokeShape kinds[] = { StrokeShape::Line, StrokeShape::Rectangle, StrokeShape::Ellipse, StrokeShape::Arrow, StrokeShape::Freehand };
+	const float thickness = DEFAULT_DRAWING_THICKNESS;
+	const float tolerance = ShapeSettings().tolerance;
+
+	auto vertices = [&](const std::vector<ImVec2>& points) {
+		std::vector<float> xs(points.size()), ys(points.size());
+		for (size_t i = 0; i < points.size(); i++) {
+			xs[i] = points[i].x;
+			ys[i] = points[i].y;
+		}
+		scratch._ResetForNewFrame();
+		drawStroke(&scratch, xs.data(), ys.data(), (uint32_t) points.size(), { IM_COL32_WHITE, thickness }, TessellationSettings());
+		return (size_t) scratch.VtxBuffer.Size;
+	};
+
+	std::vector<ShapeReport> reports;
+	std::vector<ImVec2> simplified, outline;
+	for (StrokeShape kind : kinds) {
+		ShapeReport report;
+		report.name = kind == StrokeShape::Freehand ? "Scribble" : shapeName(kind);
+		double seconds = 0.0;
+		double error = 0.0;
+
+		for (size_t i = 0; i < shapesPerKind; i++) {
+			float size = hand.uniform(60.f, 600.f);
+			ImVec2 centre{ hand.uniform(-2000.f, 2000.f), hand.uniform(-2000.f, 2000.f) };
+			float angle = hand.uniform(0.f, 6.2831853f);
+			ImVec2 axis{ std::cos(angle), std::sin(angle) };
+			ImVec2 across{ -axis.y, axis.x };
+			auto at = [&](float x, float y) { return ImVec2{ centre.x + axis.x * x + across.x * y, centre.y + axis.y * x + across.y * y }; };
+
+			// What was meant, to measure the fit against: the ends of a line or arrow's shaft, or a centre and two half sizes
+			ImVec2 truth[3];
+			switch (kind) {
+			case StrokeShape::Line:
+			case StrokeShape::Arrow: {
+				truth[0] = at(-size * 0.5f, 0.f);
+				truth[1] = at(size * 0.5f, 0.f);
+				hand.begin(truth[0], size);
+				hand.lineTo(truth[1]);
+				if (kind == StrokeShape::Line) break;
+
+				float spread = hand.uniform(0.35f, 0.8f);
+				float head = size * hand.uniform(0.15f, 0.3f);
+				ImVec2 back{ -axis.x, -axis.y };
+				ImVec2 barbs[2] = {
+					{ truth[1].x + (back.x * std::cos(spread) - back.y * std::sin(spread)) * head, truth[1].y + (back.x * std::sin(spread) + back.y * std::cos(spread)) * head },
+					{ truth[1].x + (back.x * std::cos(spread) + back.y * std::sin(spread)) * head, truth[1].y + (-back.x * std::sin(spread) + back.y * std::cos(spread)) * head }
+				};
+				// Back through the tip, straight across, or only one barb
+				hand.lineTo(barbs[0]);
+				if (i % 3 == 0) hand.lineTo(truth[1]);
+				if (i % 3 != 2) hand.lineTo(barbs[1]);
+				break;
+			}
+			case StrokeShape::Rectangle: {
+				float w = size * 0.5f, h = size * hand.uniform(0.2f, 0.5f);
+				truth[0] = centre;
+				truth[1] = { w, 0.f };
+				truth[2] = { h, 0.f };
+				ImVec2 corners[4] = { at(-w, -h), at(w, -h), at(w, h), at(-w, h) };
+				hand.begin(corners[0], size);
+				for (int corner = 1; corner <= 4; corner++) hand.lineTo(corners[corner % 4]);
+				float overshoot = hand.uniform(0.f, 0.1f);
+				hand.lineTo({ corners[0].x + (corners[1].x - corners[0].x) * overshoot, corners[0].y + (corners[1].y - corners[0].y) * overshoot });
+				break;
+			}
+			case StrokeShape::Ellipse: {
+				float a = size * 0.5f, b = a * hand.uniform(0.3f, 1.f);
+				truth[0] = centre;
+				truth[1] = { a, 0.f };
+				truth[2] = { b, 0.f };
+				float start = hand.uniform(0.f, 6.2831853f);
+				float end = start + 6.2831853f + hand.uniform(-0.1f, 0.3f);
+				float step = 3.f / a;
+				hand.begin(at(a * std::cos(start), b * std::sin(start)), size);
+				for (float t = start + step; t <= end; t += step) {
+					ImVec2 normal = at(b * std::cos(t), a * std::sin(t));
+					normal = { normal.x - centre.x, normal.y - centre.y };
+					float length = std::sqrt(normal.x * normal.x + normal.y * normal.y);
+					hand.add(at(a * std::cos(t), b * std::sin(t)), { normal.x / length, normal.y / length });
+				}
+				break;
+			}
+			default: {
+				// Wandering scribbles and open arcs, neither should turn into anything
+				hand.begin(centre, size);
+				float heading = angle;
+				int steps = (int) (size / 3.f);
+				float turn = hand.uniform(1.f, 3.5f) / steps;
+				for (int step = 0; step < steps; step++) {
+					heading += i % 2 ? turn : hand.uniform(-0.3f, 0.3f);
+					ImVec2 from = hand.points.back();
+					hand.add({ from.x + 3.f * std::cos(heading), from.y + 3.f * std::sin(heading) }, { 0.f, 0.f });
+				}
+				break;
+			}
+			}
+
+			RecognisedShape shape;
+			auto start = std::chrono::steady_clock::now();
+			bool recognised = recogniseShape(hand.points, tolerance, shape);
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			report.drawn++;
+			if (!recognised) {
+				if (kind == StrokeShape::Freehand) report.recognised++;
+				continue;
+			}
+			if (shape.shape != kind) {
+				report.mistaken++;
+				continue;
+			}
+			report.recognised++;
+
+			if (kind == StrokeShape::Line || kind == StrokeShape::Arrow) {
+				float dx0 = shape.points[0].x - truth[0].x, dy0 = shape.points[0].y - truth[0].y;
+				float dx1 = shape.points[1].x - truth[1].x, dy1 = shape.points[1].y - truth[1].y;
+				error += (std::sqrt(dx0 * dx0 + dy0 * dy0) + std::sqrt(dx1 * dx1 + dy1 * dy1)) * 0.5f / size;
+			}
+			else {
+				ImVec2 fitted{ (shape.points[0].x + shape.points[2].x) * 0.5f, (shape.points[0].y + shape.points[2].y) * 0.5f };
+				auto half = [&](int i) { float dx = shape.points[i].x - shape.points[0].x, dy = shape.points[i].y - shape.points[0].y; return std::sqrt(dx * dx + dy * dy) * 0.5f; };
+				float large = std::max(half(1), half(3)), small = std::min(half(1), half(3));
+				float dx = fitted.x - truth[0].x, dy = fitted.y - truth[0].y;
+				error += (std::sqrt(dx * dx + dy * dy) + std::fabs(large - truth[1].x) + std::fabs(small - truth[2].x)) / size;
+			}
+
+			processStroke(hand.points, SimplifySettings(), simplified);
+			shapeOutline(shape.shape, shape.points, shape.count, SHAPE_TOLERANCE, outline);
+			report.freehandPoints += simplified.size();
+			report.shapePoints += shape.count;
+			report.freehandVertices += vertices(simplified);
+			report.shapeVertices += vertices(outline);
+		}
+
+		report.meanUs = report.drawn ? seconds * 1e6 / report.drawn : 0.0;
+		size_t correct = kind == StrokeShape::Freehand ? 0 : report.recognised;
+		report.meanError = correct ? error / correct : 0.0;
+		reports.push_back(report);
+	}
+	return reports;
+}
+
+std::vector<SyncReport> runSyncBenchmark(bool hosting, uint16_t port, size_t roundTripStrokes, size_t throughputStrokes, size_t pointsPerStroke, uint32_t seed) {
+	// Nothing is drawn, the layers only need somewhere to report damage to
+	DamageTracker damage;
+	DrawingSettings settings{ { 1.f, 1.f, 1.f, 1.f }, 4.f };
+	LayerStack layers(damage, settings);
+	SyncSession sync(layers);
+	std::vector<SyncReport> reports;
+
+	if (hosting) {
+		if (!sync.host(port)) return reports;
+
+		SyncReport& report = reports.emplace_back();
+		report.name = "sync host, removing every stroke it gets";
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(SYNC_TIMEOUT);
+		std::chrono::steady_clock::time_point first, last;
+		bool joined = false;
+		while (joined ? sync.peerCount() > 0 : std::chrono::steady_clock::now() < deadline) {
+			bool changed = sync.update();
+			joined |= sync.peerCount() > 0;
+
+			StrokeDocument& document = layers.active().document();
+			if (!document.strokes().empty()) {
+				if (report.strokes == 0) first = std::chrono::steady_clock::now();
+				last = std::chrono::steady_clock::now();
+			}
+			while (!document.strokes().empty()) {
+				const Stroke& stroke = document.strokes().back();
+				report.strokes++;
+				report.points += stroke.count;
+				document.removeStroke(stroke.id);
+			}
+			if (!changed) std::this_thread::yield();
+		}
+		report.seconds = report.strokes > 0 ? std::chrono::duration<double>(last - first).count() : 0.0;
+		finishSyncReport(report, sync.stats(), SyncStats{});
+		return reports;
+	}
+
+	if (!sync.join(port, SYNC_TIMEOUT)) return reports;
+	// Joining swapped the layers out, this is the host's
+	StrokeDocument& document = layers.active().document();
+	std::mt19937 rng(seed);
+	std::vector<std::vector<ImVec2>> pool(64);
+	for (std::vector<ImVec2>& points : pool) wander(points, pointsPerStroke, DISPLAY_SIZE, rng);
+	const StrokeStyle style{ IM_COL32(255, 0, 0, 255), 5.f };
+
+	// One at a time, streamed live and then committed, timing how long the host's remove takes to come back
+	SyncReport& roundTrip = reports.emplace_back();
+	roundTrip.name = "sync round trip, " + std::to_string(roundTripStrokes) + " strokes of " + std::to_string(pointsPerStroke) + " points drawn live";
+	SyncStats start = sync.stats();
+	auto phaseStart = std::chrono::steady_clock::now();
+	std::vector<double> times;
+	for (size_t i = 0; i < roundTripStrokes && sync.isConnected(); i++) {
+		const std::vector<ImVec2>& points = pool[i % pool.size()];
+		document.beginStroke(style);
+		for (size_t j = 0; j < points.size(); j++) {
+			document.appendPoint(points[j]);
+			if (j % SYNC_POINTS_PER_FRAME == SYNC_POINTS_PER_FRAME - 1) sync.update();
+		}
+		StrokeId id = document.endStroke();
+
+		auto sent = std::chrono::steady_clock::now();
+		sync.update();
+		while (document.find(id) && sync.isConnected()) {
+			if (!sync.update()) std::this_thread::yield();
+		}
+		if (document.find(id)) break;
+		times.push_back(secondsSince(sent) * 1000.0);
+		roundTrip.strokes++;
+		roundTrip.points += points.size();
+	}
+	roundTrip.seconds = secondsSince(phaseStart);
+	finishSyncReport(roundTrip, sync.stats(), start);
+	roundTrip.roundTrips = times.size();
+	if (!times.empty()) {
+		double total = 0.0;
+		for (double time : times) total += time;
+		roundTrip.meanMs = total / times.size();
+		std::sort(times.begin(), times.end());
+		roundTrip.p50Ms = percentile(times, 0.5);
+		roundTrip.p99Ms = percentile(times, 0.99);
+		roundTrip.maxMs = times.back();
+	}
+
+	// As many committed strokes as the host keeps up with, timed until the last of them has been removed again
+	SyncReport& throughput = reports.emplace_back();
+	throughput.name = "sync throughput, " + std::to_string(throughputStrokes) + " committed strokes of " + std::to_string(pointsPerStroke) + " points";
+	start = sync.stats();
+	phaseStart = std::chrono::steady_clock::now();
+	size_t committed = 0;
+	while ((committed < throughputStrokes || !document.strokes().empty()) && sync.isConnected()) {
+		for (size_t i = 0; i < SYNC_STROKES_PER_FRAME && committed < throughputStrokes && document.strokes().size() < SYNC_IN_FLIGHT; i++) {
+			const std::vector<ImVec2>& points = pool[committed++ % pool.size()];
+			document.addStroke(style, points.data(), (uint32_t) points.size());
+			throughput.points += points.size();
+		}
+		if (!sync.update()) std::this_thread::yield();
+	}
+	throughput.strokes = committed - document.strokes().size();
+	throughput.seconds = secondsSince(phaseStart);
+	finishSyncReport(throughput, sync.stats(), start);
+	return reports;
+}
+
+std::vector<RecordedFrame> syntheticSession(size_t strokes, size_t pointsPerStroke, uint32_t seed) {
+	// Raw engine output only, the standard distributions are free to differ between libraries
+	std::mt19937 rng(seed);
+	auto uniform = [&](float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); };
+
+	std::vector<RecordedFrame> frames;
+	SessionBuilder session(frames);
+	const size_t samplesPerFrame = 4;
+
+	for (size_t i = 0; i < strokes; i++) {
+		ImVec2 point{ uniform(100.f, DISPLAY_SIZE.x - 100.f), uniform(100.f, DISPLAY_SIZE.y - 100.f) };
+
+		if (i % 7 == 6) {
+			// Straight line, snapped every other time
+			session.moveTo(point);
+			session.press(POINTER_RIGHT);
+			session.moveTo({ point.x + uniform(-400.f, 400.f), point.y + uniform(-400.f, 400.f) });
+			if (i % 2) frames.back().input.snapHeld = true;
+			session.release(POINTER_RIGHT);
+			if (i % 2) frames.back().input.snapHeld = true;
+			continue;
+		}
+
+		// A wandering scribble
+		session.moveTo(point);
+		session.press(POINTER_LEFT);
+		float heading = uniform(0.f, 6.2831853f);
+		std::vector<ImVec2> moves;
+		for (size_t drawn = 0; drawn < pointsPerStroke; drawn += samplesPerFrame) {
+			moves.clear();
+			for (size_t j = 0; j < samplesPerFrame; j++) {
+				heading += uniform(-0.3f, 0.3f);
+				point.x = std::clamp(point.x + 6.f * std::cos(heading), 0.f, DISPLAY_SIZE.x);
+				point.y = std::clamp(point.y + 6.f * std::sin(heading), 0.f, DISPLAY_SIZE.y);
+				moves.push_back(point);
+			}
+			session.frame(moves);
+		}
+		session.release(POINTER_LEFT);
+
+		if (i % 10 == 9) {
+			session.frame().input.undoClicked = true;
+			session.frame().input.undoClicked = true;
+			session.frame().input.redoClicked = true;
+		}
+
+		if (i % 13 == 12) {
+			// Wipe across the board with the stroke eraser, then the pixel eraser, and go back to the pen
+			for (int eraser = 0; eraser < 2; eraser++) {
+				session.frame().input.cycleTool = true;
+				ImVec2 from{ uniform(0.f, DISPLAY_SIZE.x), uniform(0.f, DISPLAY_SIZE.y) };
+				ImVec2 to{ uniform(0.f, DISPLAY_SIZE.x), uniform(0.f, DISPLAY_SIZE.y) };
+				session.moveTo(from);
+				session.press(POINTER_LEFT);
+				for (int step = 1; step <= 30; step++) {
+					float t = step / 30.f;
+					session.frame({ { from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t } });
+				}
+				session.release(POINTER_LEFT);
+			}
+			session.frame().input.cycleTool = true;
+		}
+	}
+
+	for (RecordedFrame& frame : frames) {
+		frame.input.samples = frame.samples.data();
+		frame.input.sampleCount = frame.samples.size();
+	}
+	return frames;
+}
+
+std::string formatReport(const ShapeReport& report) {
+	char text[512];
+	int length = snprintf(text, sizeof(text),
+		"shape recognition, %s\n"
+		"  recognised   %zu of %zu (%.1f%%), %zu mistaken for another shape\n"
+		"  fitting      %.2f us per stroke\n",
+		report.name.c_str(),
+		report.recognised, report.drawn, report.drawn ? report.recognised * 100.0 / report.drawn : 0.0, report.mistaken,
+		report.meanUs);
+	if (report.shapePoints > 0 && length > 0 && (size_t) length < sizeof(text)) {
+		snprintf(text + length, sizeof(text) - length,
+			"  accuracy     mean error %.2f%% of the size\n"
+			"  stored       %zu points instead of %zu, %zu vertices instead of %zu\n",
+			report.meanError * 100.0,
+			report.shapePoints, report.freehandPoints, report.shapeVertices, report.freehandVertices);
+	}
+	return text;
+}
+
+std::string formatReport(const StorageReport& report) {
+	char text[512];
+	snprintf(text, sizeof(text),
+		"point storage, %s\n"
+		"  board        %zu strokes, %zu points\n"
+		"  resident     %.2f bytes per point, %.1f KB instead of %.1f KB as floats (%.1fx smaller)\n"
+		"  unpacking    %.0f M points/s, %.0f M points/s a point at a time\n",
+		report.name.c_str(),
+		report.strokes, report.points,
+		report.points ? (double) report.packedBytes / report.points : 0.0, report.packedBytes / 1024.0, report.floatBytes / 1024.0,
+		report.packedBytes ? (double) report.floatBytes / report.packedBytes : 0.0,
+		report.unpackPointsPerSecond / 1e6, report.decodePointsPerSecond / 1e6);
+	return text;
+}
+
+std::string formatReport(const ReplayReport& report) {
+	char text[512];
+	snprintf(text, sizeof(text),
+		"%s\n"
+		"  frames       %zu\n"
+		"  frame build  mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n"
+		"  allocations  %zu (%.1f KB), %.1f per frame\n"
+		"  board        %zu strokes, %zu points, %zu vertices in the last frame\n"
+		"  memory       %.1f KB, peak %.1f KB\n",
+		report.name.c_str(), report.frames,
+		report.meanMs, report.p50Ms, report.p99Ms, report.maxMs,
+		report.allocations, report.allocatedBytes / 1024.0, report.frames ? (double) report.allocations / report.frames : 0.0,
+		report.strokes, report.points, report.vertices,
+		report.memoryBytes / 1024.0, report.peakMemoryBytes / 1024.0);
+	return text;
+}
+
+std::string formatReport(const SyncReport& report) {
+	char text[768];
+	int length = snprintf(text, sizeof(text),
+		"%s\n"
+		"  strokes      %zu (%zu points) in %.3f s, %.0f strokes/s, %.2f M points/s\n"
+		"  sent         %zu ops in %zu batches, %.1f KB\n"
+		"  received     %zu ops, %.1f KB\n"
+		"  wire         %.2f bytes per point\n",
+		report.name.c_str(),
+		report.strokes, report.points, report.seconds,
+		report.seconds > 0.0 ? report.strokes / report.seconds : 0.0, report.seconds > 0.0 ? report.points / report.seconds / 1e6 : 0.0,
+		report.opsSent, report.batchesSent, report.bytesSent / 1024.0,
+		report.opsReceived, report.bytesReceived / 1024.0,
+		report.points ? (double) std::max(report.bytesSent, report.bytesReceived) / report.points : 0.0);
+	if (report.roundTrips > 0 && length > 0 && (size_t) length < sizeof(text)) {
+		snprintf(text + length, sizeof(text) - length,
+			"  round trip   mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms over %zu strokes\n",
+			report.meanMs, report.p50Ms, report.p99Ms, report.maxMs, report.roundTrips);
+	}
+	return text;
+}
@@ -0,0 +1,134 @@
+#ifndef REPLAY_RUNNER_H
+#define REPLAY_RUNNER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "input_recorder.h"
+
+/**
+* Frame build numbers for one replayed session
+* A frame is built from ImGui::NewFrame() through the board's update and draw, ImGui::Render() and damage tracking, which
+* is everything on the CPU side of a real frame short of the menu and handing the draw data to the GPU
+*/
+struct ReplayReport {
+	std::string name;
+	size_t frames = 0;
+	double meanMs = 0.0;
+	double p50Ms = 0.0;
+	double p99Ms = 0.0;
+	double maxMs = 0.0;
+	// Only counted when built with WB_PROFILE, otherwise left at 0
+	size_t allocations = 0;
+	size_t allocatedBytes = 0;
+	size_t strokes = 0;
+	size_t points = 0;
+	size_t vertices = 0;  // in the last frame's draw data
+	size_t memoryBytes = 0;  // Whiteboard::memoryUsage() after the last frame
+	size_t peakMemoryBytes = 0;
+};
+
+/**
+* Replays frames through a fresh Whiteboard in its own ImGui context, with no window or graphics device behind it
+* The caller's ImGui context, if any, is put back afterwards
+*/
+ReplayReport runReplay(const std::string& name, const std::vector<RecordedFrame>& frames);
+
+/**
+* Fills a board with about pointCount points spread over 8 x 8 screens, then times frames drawn from views that lean on
+* culling (one screen at 1:1, panning) and on level of detail (the whole board zoomed out, close up)
+* Frames are only timed once the level the zoom wants has finished baking
+*/
+std::vector<ReplayReport> runViewBenchmarks(size_t pointCount, uint32_t seed = 1);
+
+/**
+* Fills layerCount layers with pointsPerLayer points each, all in view at 1/8, then times frames that hide / show,
+* switch, reorder and clear / undo clear a layer each frame, frames with every layer but one hidden and packed, and
+* showing a packed layer again until it has been rebaked
+*/
+std::vector<ReplayReport> runLayerBenchmarks(size_t layerCount, size_t pointsPerLayer, uint32_t seed = 1);
+
+/**
+* How much room a board's committed points take and how fast they unpack, see runStorageBenchmarks
+*/
+struct StorageReport {
+	std::string name;
+	size_t strokes = 0;
+	size_t points = 0;
+	size_t packedBytes = 0;
+	size_t floatBytes = 0;  // the same points as a pair of floats each, the way they were kept before being packed
+	double unpackPointsPerSecond = 0.0;  // readPoints, up to 4 points a load
+	double decodePointsPerSecond = 0.0;  // PointDecoder, a point at a time
+};
+
+/**
+* Fills a document with about pointCount points of wandering strokes, spaced like a pen at 1:1, drawn zoomed in and
+* flicked quickly, and times unpacking all of them
+* How packing changes frame times is what runViewBenchmarks measures
+*/
+std::vector<StorageReport> runStorageBenchmarks(size_t pointCount, uint32_t seed = 1);
+
+/**
+* How recogniseShape does on made up hand drawn strokes of one kind
+*/
+struct ShapeReport {
+	std::string name;
+	size_t drawn = 0;
+	size_t recognised = 0;  // as what was drawn, scribbles count when they are left alone
+	size_t mistaken = 0;  // as some other shape
+	double meanUs = 0.0;  // per stroke, fitting every kind
+	double meanError = 0.0;  // how far the recognised shapes are from the ones drawn, as a fraction of their size
+	// Points and vertices the recognised strokes would have kept as simplified freehand, and do as shapes
+	size_t freehandPoints = 0;
+	size_t shapePoints = 0;
+	size_t freehandVertices = 0;
+	size_t shapeVertices = 0;
+};
+
+/**
+* Draws shapesPerKind wobbly lines, rectangles, ellipses, arrows and scribbles and fits every one of them
+*/
+std::vector<ShapeReport> runShapeBenchmarks(size_t shapesPerKind, uint32_t seed = 1);
+
+/**
+* Numbers from one side of a sync benchmark, see runSyncBenchmark
+*/
+struct SyncReport {
+	std::string name;
+	size_t strokes = 0;
+	size_t points = 0;
+	double seconds = 0.0;
+	// Round trips, from a committed stroke going out to the host's remove of it coming back
+	size_t roundTrips = 0;
+	double meanMs = 0.0;
+	double p50Ms = 0.0;
+	double p99Ms = 0.0;
+	double maxMs = 0.0;
+	size_t opsSent = 0;
+	size_t opsReceived = 0;
+	size_t batchesSent = 0;
+	size_t bytesSent = 0;
+	size_t bytesReceived = 0;
+};
+
+/**
+* One end of a two process benchmark of SyncSession over loopback, run the host first and then the joining side
+* The joining side draws strokes of pointsPerStroke points a few points a frame like a pen would, so they stream live,
+* and commits them, and the host removes every stroke it gets. First roundTripStrokes one at a time, each waiting for
+* its remove to come back, then throughputStrokes committed as fast as the host keeps up with.
+* Each side reports its own end, the host once the joining side has gone
+*/
+std::vector<SyncReport> runSyncBenchmark(bool hosting, uint16_t port, size_t roundTripStrokes, size_t throughputStrokes, size_t pointsPerStroke, uint32_t seed = 1);
+
+/**
+* A made up session of strokes scribbled at 144 Hz, with straight lines, undo / redo and both erasers mixed in
+* The same seed always gives the same frames on every platform
+*/
+std::vector<RecordedFrame> syntheticSession(size_t strokes, size_t pointsPerStroke, uint32_t seed = 1);
+
+std::string formatReport(const ReplayReport& report);
+std::string formatReport(const StorageReport& report);
+std::string formatReport(const ShapeReport& report);
+std::string formatReport(const SyncReport& report);
+
+#endif // REPLAY_RUNNER_H
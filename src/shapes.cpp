@@ -0,0 +1,447 @@
+#include "shapes.h"
+#include "simplify.h"
+#include "spatial_index.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Shapes smaller than this many times the tolerance are left as they were drawn
+const float MIN_SHAPE_SIZE = 3.f;
+// How far the drawn points may stray from a fitted shape on average, as a fraction of its size, on top of the tolerance
+const float RELATIVE_TOLERANCE = 0.035f;
+// No drawn point may be further from a fitted shape than this many times the average allowed
+const float MAX_ERROR_FACTOR = 3.f;
+// Strokes whose ends are closer together than this fraction of their length are treated as closed
+const float CLOSED_FRACTION = 0.2f;
+// Lines can only double back on themselves by this fraction of their length, on top of the tolerance
+const float LINE_MAX_BACKTRACK = 0.05f;
+// How much longer or shorter than the fitted outline a closed stroke can be, going round twice or only halfway isn't a shape
+const float PERIMETER_MIN = 0.8f;
+const float PERIMETER_MAX = 1.35f;
+// Rectangles have to fill this much of their box, an ellipse only fills pi / 4 of its
+const float RECTANGLE_MIN_FILL = 0.88f;
+// Sine of 8 degrees, rectangles and ellipses leaning by less than this are straightened
+const float LEVEL_SIN = 0.139f;
+// Ellipses whose axes are within this fraction of each other become circles
+const float ROUND_FRACTION = 0.1f;
+// Arrow barbs have to be between 10 and 75 degrees off the shaft and at most this fraction of its length
+const float BARB_MIN_COS = 0.259f;
+const float BARB_MAX_COS = 0.985f;
+const float BARB_MAX_LENGTH = 0.6f;
+// Recognised arrows get symmetric barbs 30 degrees off the shaft
+const float HEAD_COS = 0.866f;
+const float HEAD_SIN = 0.5f;
+const int ELLIPSE_MIN_SEGMENTS = 12;
+const int ELLIPSE_MAX_SEGMENTS = 4096;
+
+static ImVec2 add(ImVec2 a, ImVec2 b) { return { a.x + b.x, a.y + b.y }; }
+static ImVec2 sub(ImVec2 a, ImVec2 b) { return { a.x - b.x, a.y - b.y }; }
+static ImVec2 scale(ImVec2 a, float s) { return { a.x * s, a.y * s }; }
+static ImVec2 midpoint(ImVec2 a, ImVec2 b) { return { (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f }; }
+static float dot(ImVec2 a, ImVec2 b) { return a.x * b.x + a.y * b.y; }
+static float length(ImVec2 a) { return std::sqrt(dot(a, a)); }
+
+static float pathLength(const std::vector<ImVec2>& points) {
+	float total = 0.f;
+	for (size_t i = 1; i < points.size(); i++) total += length(sub(points[i], points[i - 1]));
+	return total;
+}
+
+/**
+* Snaps a unit axis to horizontal / vertical if it is only leaning a little
+*/
+static ImVec2 level(ImVec2 axis) {
+	if (std::fabs(axis.y) < LEVEL_SIN) return { 1.f, 0.f };
+	if (std::fabs(axis.x) < LEVEL_SIN) return { 0.f, 1.f };
+	return axis;
+}
+
+/**
+* Corners of the rectangle spanning x0..x1 along axis and y0..y1 across it, relative to origin
+*/
+static void frameCorners(ImVec2 origin, ImVec2 axis, float x0, float y0, float x1, float y1, RecognisedShape& out) {
+	ImVec2 across{ -axis.y, axis.x };
+	auto corner = [&](float x, float y) { return add(origin, add(scale(axis, x), scale(across, y))); };
+	out.points[0] = corner(x0, y0);
+	out.points[1] = corner(x1, y0);
+	out.points[2] = corner(x1, y1);
+	out.points[3] = corner(x0, y1);
+	out.count = 4;
+}
+
+static bool fitLine(const std::vector<ImVec2>& points, float allowed, RecognisedShape& out) {
+	ImVec2 a = points.front();
+	ImVec2 b = points.back();
+	float chord = length(sub(b, a));
+	if (chord <= 0.f) return false;
+	ImVec2 along = scale(sub(b, a), 1.f / chord);
+
+	// Lines are held to a third of the error of other shapes, a gentle curve is more likely meant than not
+	float total = 0.f;
+	float backtrack = 0.f;
+	float previous = 0.f;
+	for (ImVec2 point : points) {
+		float distance = segmentDistance(point, a, b);
+		if (distance > allowed) return false;
+		total += distance;
+
+		float progress = dot(sub(point, a), along);
+		backtrack += std::max(previous - progress, 0.f);
+		previous = progress;
+	}
+	if (total / points.size() > allowed / 3.f || backtrack > allowed + chord * LINE_MAX_BACKTRACK) return false;
+
+	out.shape = StrokeShape::Line;
+	out.points[0] = a;
+	out.points[1] = b;
+	out.count = 2;
+	return true;
+}
+
+/**
+* A straight shaft from the first corner to the second, then one or two barbs drawn back from the tip
+*/
+static bool fitArrow(const std::vector<ImVec2>& points, float allowed, RecognisedShape& out) {
+	std::vector<ImVec2> corners;
+	simplifyDouglasPeucker(points, allowed, corners);
+	if (corners.size() < 3 || corners.size() > 5) return false;
+
+	ImVec2 tail = corners[0];
+	ImVec2 tip = corners[1];
+	float shaft = length(sub(tail, tip));
+	if (shaft <= 0.f) return false;
+	ImVec2 back = scale(sub(tail, tip), 1.f / shaft);
+
+	float head = 0.f;
+	int barbs = 0;
+	for (size_t i = 2; i < corners.size(); i++) {
+		ImVec2 barb = sub(corners[i], tip);
+		float reach = length(barb);
+		if (reach > shaft * BARB_MAX_LENGTH) return false;
+		// Back at the tip to draw the other barb
+		if (reach < allowed) continue;
+
+		float cosine = dot(barb, back) / reach;
+		if (cosine < BARB_MIN_COS || cosine > BARB_MAX_COS) return false;
+		head += reach;
+		barbs++;
+	}
+	if (barbs == 0) return false;
+	head /= barbs;
+
+	out.shape = StrokeShape::Arrow;
+	out.points[0] = tail;
+	out.points[1] = tip;
+	out.points[2] = add(tip, scale({ back.x * HEAD_COS - back.y * HEAD_SIN, back.x * HEAD_SIN + back.y * HEAD_COS }, head));
+	out.points[3] = add(tip, scale({ back.x * HEAD_COS + back.y * HEAD_SIN, -back.x * HEAD_SIN + back.y * HEAD_COS }, head));
+	out.count = 4;
+	return true;
+}
+
+/**
+* Axes from the covariance of the outline, then the radii from a least squares fit of x^2 / a^2 + y^2 / b^2 = 1
+* Returns the mean distance of the points from the ellipse, or FLT_MAX if it doesn't fit
+*/
+static float fitEllipse(const std::vector<ImVec2>& points, float pathLength, float allowed, RecognisedShape& out) {
+	// Everything is relative to the first point so big board coordinates don't eat the precision
+	ImVec2 origin = points.front();
+
+	// Segments are weighted by their length so uneven sampling doesn't pull the centre about
+	double weight = 0.0, cx = 0.0, cy = 0.0;
+	for (size_t i = 1; i < points.size(); i++) {
+		ImVec2 mid = sub(midpoint(points[i - 1], points[i]), origin);
+		double w = length(sub(points[i], points[i - 1]));
+		weight += w;
+		cx += mid.x * w;
+		cy += mid.y * w;
+	}
+	if (weight <= 0.0) return FLT_MAX;
+	cx /= weight;
+	cy /= weight;
+
+	double cxx = 0.0, cxy = 0.0, cyy = 0.0;
+	for (size_t i = 1; i < points.size(); i++) {
+		ImVec2 mid = sub(midpoint(points[i - 1], points[i]), origin);
+		double w = length(sub(points[i], points[i - 1]));
+		double dx = mid.x - cx, dy = mid.y - cy;
+		cxx += dx * dx * w;
+		cxy += dx * dy * w;
+		cyy += dy * dy * w;
+	}
+
+	// Eigenvector of the larger eigenvalue, a circle has none so any axis will do
+	double half = (cxx - cyy) * 0.5;
+	double root = std::sqrt(half * half + cxy * cxy);
+	ImVec2 axis{ 1.f, 0.f };
+	if (root > 1e-9 * (cxx + cyy)) {
+		double ex = half + root, ey = cxy;
+		double norm = std::sqrt(ex * ex + ey * ey);
+		if (norm > 0.0) axis = { (float) (ex / norm), (float) (ey / norm) };
+		else axis = { 0.f, 1.f };
+	}
+	axis = level(axis);
+	ImVec2 across{ -axis.y, axis.x };
+	ImVec2 centre = add(origin, { (float) cx, (float) cy });
+
+	double sxxxx = 0.0, sxxyy = 0.0, syyyy = 0.0, sxx = 0.0, syy = 0.0;
+	for (ImVec2 point : points) {
+		ImVec2 d = sub(point, centre);
+		double x = dot(d, axis), y = dot(d, across);
+		sxxxx += x * x * x * x;
+		sxxyy += x * x * y * y;
+		syyyy += y * y * y * y;
+		sxx += x * x;
+		syy += y * y;
+	}
+	double determinant = sxxxx * syyyy - sxxyy * sxxyy;
+	if (determinant <= 0.0) return FLT_MAX;
+	double a = (sxx * syyyy - syy * sxxyy) / determinant;
+	double b = (syy * sxxxx - sxx * sxxyy) / determinant;
+	if (a <= 0.0 || b <= 0.0) return FLT_MAX;
+	float ra = (float) (1.0 / std::sqrt(a));
+	float rb = (float) (1.0 / std::sqrt(b));
+	if (std::fabs(ra - rb) < ROUND_FRACTION * std::max(ra, rb)) {
+		ra = rb = (ra + rb) * 0.5f;
+		axis = { 1.f, 0.f };
+		across = { 0.f, 1.f };
+	}
+
+	// Ramanujan's approximation
+	float perimeter = 3.14159265f * (3.f * (ra + rb) - std::sqrt((3.f * ra + rb) * (ra + 3.f * rb)));
+	if (pathLength < perimeter * PERIMETER_MIN || pathLength > perimeter * PERIMETER_MAX) return FLT_MAX;
+
+	// Distance along the ray from the centre, close enough to the true distance for judging the fit
+	float total = 0.f;
+	for (ImVec2 point : points) {
+		ImVec2 d = sub(point, centre);
+		float x = dot(d, axis) / ra, y = dot(d, across) / rb;
+		float r = std::sqrt(x * x + y * y);
+		float distance = r > 0.f ? length(d) * std::fabs(1.f - 1.f / r) : std::min(ra, rb);
+		if (distance > allowed * MAX_ERROR_FACTOR) return FLT_MAX;
+		total += distance;
+	}
+	float error = total / points.size();
+	if (error > allowed) return FLT_MAX;
+
+	out.shape = StrokeShape::Ellipse;
+	frameCorners(centre, axis, -ra, -rb, ra, rb, out);
+	return error;
+}
+
+/**
+* Turned to the smallest box around the convex hull, then each side moved to the average of the points nearest it
+* Returns the mean distance of the points from the rectangle, or FLT_MAX if it doesn't fit
+*/
+static float fitRectangle(const std::vector<ImVec2>& points, float pathLength, float allowed, RecognisedShape& out) {
+	ImVec2 origin = points.front();
+	std::vector<ImVec2> sorted(points.size());
+	for (size_t i = 0; i < points.size(); i++) sorted[i] = sub(points[i], origin);
+	std::sort(sorted.begin(), sorted.end(), [](ImVec2 a, ImVec2 b) { return a.x != b.x ? a.x < b.x : a.y < b.y; });
+
+	// Andrew's monotone chain
+	auto cross = [](ImVec2 o, ImVec2 a, ImVec2 b) { return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x); };
+	std::vector<ImVec2> hull(sorted.size() * 2);
+	size_t k = 0;
+	for (size_t i = 0; i < sorted.size(); i++) {
+		while (k >= 2 && cross(hull[k - 2], hull[k - 1], sorted[i]) <= 0.f) k--;
+		hull[k++] = sorted[i];
+	}
+	for (size_t i = sorted.size() - 1, lower = k + 1; i-- > 0;) {
+		while (k >= lower && cross(hull[k - 2], hull[k - 1], sorted[i]) <= 0.f) k--;
+		hull[k++] = sorted[i];
+	}
+	hull.resize(k > 1 ? k - 1 : k);
+	if (hull.size() < 3) return FLT_MAX;
+
+	float hullArea = 0.f;
+	for (size_t i = 0; i < hull.size(); i++) hullArea += cross({ 0.f, 0.f }, hull[i], hull[(i + 1) % hull.size()]) * 0.5f;
+
+	ImVec2 axis{ 1.f, 0.f };
+	float smallest = FLT_MAX;
+	for (size_t i = 0; i < hull.size(); i++) {
+		ImVec2 edge = sub(hull[(i + 1) % hull.size()], hull[i]);
+		float edgeLength = length(edge);
+		if (edgeLength <= 0.f) continue;
+		ImVec2 along = scale(edge, 1.f / edgeLength);
+		ImVec2 across{ -along.y, along.x };
+
+		float x0 = FLT_MAX, x1 = -FLT_MAX, y0 = FLT_MAX, y1 = -FLT_MAX;
+		for (ImVec2 point : hull) {
+			float x = dot(point, along), y = dot(point, across);
+			x0 = std::min(x0, x); x1 = std::max(x1, x);
+			y0 = std::min(y0, y); y1 = std::max(y1, y);
+		}
+		float area = (x1 - x0) * (y1 - y0);
+		if (area < smallest) {
+			smallest = area;
+			axis = along;
+		}
+	}
+	if (hullArea < smallest * RECTANGLE_MIN_FILL) return FLT_MAX;
+	axis = level(axis);
+	ImVec2 across{ -axis.y, axis.x };
+
+	float x0 = FLT_MAX, x1 = -FLT_MAX, y0 = FLT_MAX, y1 = -FLT_MAX;
+	for (ImVec2 point : hull) {
+		float x = dot(point, axis), y = dot(point, across);
+		x0 = std::min(x0, x); x1 = std::max(x1, x);
+		y0 = std::min(y0, y); y1 = std::max(y1, y);
+	}
+
+	float sums[4] = {};
+	int counts[4] = {};
+	for (ImVec2 point : points) {
+		ImVec2 d = sub(point, origin);
+		float x = dot(d, axis), y = dot(d, across);
+		float distances[4] = { x - x0, x1 - x, y - y0, y1 - y };
+		int side = (int) (std::min_element(distances, distances + 4) - distances);
+		sums[side] += side < 2 ? x : y;
+		counts[side]++;
+	}
+	if (counts[0]) x0 = sums[0] / counts[0];
+	if (counts[1]) x1 = sums[1] / counts[1];
+	if (counts[2]) y0 = sums[2] / counts[2];
+	if (counts[3]) y1 = sums[3] / counts[3];
+	if (x1 - x0 < allowed || y1 - y0 < allowed) return FLT_MAX;
+
+	float perimeter = 2.f * ((x1 - x0) + (y1 - y0));
+	if (pathLength < perimeter * PERIMETER_MIN || pathLength > perimeter * PERIMETER_MAX) return FLT_MAX;
+
+	float total = 0.f;
+	for (ImVec2 point : points) {
+		ImVec2 d = sub(point, origin);
+		float x = dot(d, axis), y = dot(d, across);
+		float distance = std::min(std::min(std::fabs(x - x0), std::fabs(x1 - x)), std::min(std::fabs(y - y0), std::fabs(y1 - y)));
+		if (distance > allowed * MAX_ERROR_FACTOR) return FLT_MAX;
+		total += distance;
+	}
+	float error = total / points.size();
+	if (error > allowed) return FLT_MAX;
+
+	out.shape = StrokeShape::Rectangle;
+	frameCorners(origin, axis, x0, y0, x1, y1, out);
+	return error;
+}
+
+bool recogniseShape(const std::vector<ImVec2>& points, float tolerance, RecognisedShape& out) {
+	out = RecognisedShape();
+	if (points.size() < 2) return false;
+
+	ImVec2 min = points[0], max = points[0];
+	for (ImVec2 point : points) {
+		min = { std::min(min.x, point.x), std::min(min.y, point.y) };
+		max = { std::max(max.x, point.x), std::max(max.y, point.y) };
+	}
+	float size = std::max(max.x - min.x, max.y - min.y);
+	if (size < tolerance * MIN_SHAPE_SIZE) return false;
+	float allowed = tolerance + size * RELATIVE_TOLERANCE;
+
+	float travelled = pathLength(points);
+	if (length(sub(points.back(), points.front())) >= travelled * CLOSED_FRACTION) {
+		return fitLine(points, allowed, out) || fitArrow(points, allowed, out);
+	}
+
+	RecognisedShape ellipse;
+	RecognisedShape rectangle;
+	float ellipseError = fitEllipse(points, travelled, allowed, ellipse);
+	float rectangleError = fitRectangle(points, travelled, allowed, rectangle);
+	if (ellipseError == FLT_MAX && rectangleError == FLT_MAX) return false;
+	out = ellipseError < rectangleError ? ellipse : rectangle;
+	return true;
+}
+
+/**
+* Walks round the ellipse with a rotation recurrence, the only trig is for the step
+*/
+static void ellipseOutline(const ImVec2* corners, float tolerance, std::vector<ImVec2>& out) {
+	ImVec2 centre = midpoint(corners[0], corners[2]);
+	ImVec2 u = scale(sub(corners[1], corners[0]), 0.5f);
+	ImVec2 v = scale(sub(corners[3], corners[0]), 0.5f);
+	float radius = std::max(length(u), length(v));
+
+	// A chord of angle t sags radius * t^2 / 8 below the curve
+	int segments = ELLIPSE_MAX_SEGMENTS;
+	if (tolerance > 0.f && radius > 0.f) {
+		float step = std::sqrt(8.f * tolerance / radius);
+		segments = (int) std::ceil(6.2831853f / std::max(step, 1e-3f));
+	}
+	segments = std::clamp(segments, ELLIPSE_MIN_SEGMENTS, ELLIPSE_MAX_SEGMENTS);
+
+	double step = 6.283185307179586 / segments;
+	double stepCos = std::cos(step), stepSin = std::sin(step);
+	double c = 1.0, s = 0.0;
+	out.resize(segments + 1);
+	for (int i = 0; i < segments; i++) {
+		out[i] = { centre.x + u.x * (float) c + v.x * (float) s, centre.y + u.y * (float) c + v.y * (float) s };
+		double next = c * stepCos - s * stepSin;
+		s = s * stepCos + c * stepSin;
+		c = next;
+	}
+	out[segments] = out[0];
+}
+
+void shapeOutline(StrokeShape shape, const ImVec2* points, uint32_t count, float tolerance, std::vector<ImVec2>& out) {
+	if (count >= 4) {
+		switch (shape) {
+		case StrokeShape::Rectangle: {
+			ImVec2 start = midpoint(points[0], points[1]);
+			out.assign({ start, points[1], points[2], points[3], points[0], start });
+			return;
+		}
+		case StrokeShape::Ellipse:
+			ellipseOutline(points, tolerance, out);
+			return;
+		case StrokeShape::Arrow:
+			out.assign({ points[0], points[1], points[2], points[3], points[1] });
+			return;
+		default:
+			break;
+		}
+	}
+	out.assign(points, points + count);
+}
+
+void strokeOutline(const StrokeDocument& document, const Stroke& stroke, float tolerance, std::vector<ImVec2>& out) {
+	if (stroke.shape == StrokeShape::Freehand) {
+		document.copyPoints(stroke, out);
+		return;
+	}
+
+	ImVec2 points[4];
+	uint32_t count = std::min<uint32_t>(stroke.count, 4);
+	for (uint32_t i = 0; i < count; i++) points[i] = document.pointOf(stroke, i);
+	shapeOutline(stroke.shape, points, count, tolerance, out);
+}
+
+uint32_t strokeAnchors(const StrokeDocument& document, const Stroke& stroke, ImVec2 anchors[4]) {
+	if (stroke.count == 0) return 0;
+
+	auto at = [&](uint32_t i) { return document.pointOf(stroke, i); };
+	if (stroke.count >= 4 && stroke.shape == StrokeShape::Rectangle) {
+		for (uint32_t i = 0; i < 4; i++) anchors[i] = at(i);
+		return 4;
+	}
+	if (stroke.count >= 4 && stroke.shape == StrokeShape::Ellipse) {
+		for (uint32_t i = 0; i < 4; i++) anchors[i] = midpoint(at(i), at((i + 1) % 4));
+		return 4;
+	}
+	if (stroke.count >= 2 && stroke.shape == StrokeShape::Arrow) {
+		anchors[0] = at(0);
+		anchors[1] = at(1);
+		return 2;
+	}
+	anchors[0] = at(0);
+	if (stroke.count == 1) return 1;
+	anchors[1] = at(stroke.count - 1);
+	return 2;
+}
+
+const char* shapeName(StrokeShape shape) {
+	switch (shape) {
+	case StrokeShape::Line: return "Line";
+	case StrokeShape::Rectangle: return "Rectangle";
+	case StrokeShape::Ellipse: return "Ellipse";
+	case StrokeShape::Arrow: return "Arrow";
+	default: return "Freehand";
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef SHAPES_H
+#define SHAPES_H
+
+#include <cstdint>
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+
+/**
+* Shapes are stored as a handful of control points instead of everything that was drawn
+* Line: the two ends
+* Rectangle: its four corners, in order around it
+* Ellipse: the four corners of the rectangle it fits in, in order around it
+* Arrow: the tail, the tip, then the ends of the two barbs
+*/
+
+// Pixels the polyline a curved shape is drawn as may stray from the true curve, at the zoom it is drawn at
+const float SHAPE_TOLERANCE = 0.5f;
+// Outlines used for hit testing and erasing stay within this fraction of the stroke's thickness of the true curve
+const float SHAPE_HIT_TOLERANCE = 0.05f;
+
+struct ShapeSettings {
+	bool recognise = true;
+	float tolerance = 4.f;  // pixels the drawn points may stray from the shape, on top of a small fraction of its size
+};
+
+struct RecognisedShape {
+	StrokeShape shape = StrokeShape::Freehand;
+	ImVec2 points[4];
+	uint32_t count = 0;
+};
+
+/**
+* Fits a line, rectangle, ellipse or arrow to a finished stroke, returns false if none of them fit well enough
+* Rectangles and ellipses leaning by only a few degrees are straightened and nearly round ellipses become circles
+*/
+bool recogniseShape(const std::vector<ImVec2>& points, float tolerance, RecognisedShape& out);
+
+/**
+* The polyline a stroke is drawn as, curves are split finely enough to stay within tolerance of the true outline
+* Freehand strokes are copied as they are, closed shapes start and end halfway along a side so the ends meet flat
+*/
+void shapeOutline(StrokeShape shape, const ImVec2* points, uint32_t count, float tolerance, std::vector<ImVec2>& out);
+void strokeOutline(const StrokeDocument& document, const Stroke& stroke, float tolerance, std::vector<ImVec2>& out);
+
+/**
+* Points on a stroke that other strokes can snap to: the ends of lines, arrows and freehand strokes, the corners of
+* rectangles and the ends of an ellipse's axes
+* Returns how many of the (up to 4) anchors were written
+*/
+uint32_t strokeAnchors(const StrokeDocument& document, const Stroke& stroke, ImVec2 anchors[4]);
+
+const char* shapeName(StrokeShape shape);
+
+#endif // SHAPES_H
@@ -0,0 +1,216 @@
+#include "simplify.h"
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+// Samples held back by the streaming simplifier before it keeps a point anyway, bounds the per-sample cost
+const size_t MAX_STREAM_PENDING = 64;
+// Deepest a Catmull-Rom span is subdivided (2^6 segments)
+const int MAX_CURVE_DEPTH = 6;
+
+static float triangleArea(ImVec2 a, ImVec2 b, ImVec2 c) {
+	return std::fabs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) * 0.5f;
+}
+
+void simplifyDouglasPeucker(const std::vector<ImVec2>& in, float tolerance, std::vector<ImVec2>& out) {
+	out.clear();
+	if (in.size() < 3) {
+		out = in;
+		return;
+	}
+
+	std::vector<bool> keep(in.size(), false);
+	keep.front() = true;
+	keep.back() = true;
+
+	std::vector<std::pair<size_t, size_t>> stack;
+	stack.push_back({ 0, in.size() - 1 });
+	while (!stack.empty()) {
+		auto [first, last] = stack.back();
+		stack.pop_back();
+
+		float furthest = 0.f;
+		size_t index = first;
+		for (size_t i = first + 1; i < last; i++) {
+			float distance = segmentDistance(in[i], in[first], in[last]);
+			if (distance > furthest) {
+				furthest = distance;
+				index = i;
+			}
+		}
+
+		if (furthest > tolerance) {
+			keep[index] = true;
+			stack.push_back({ first, index });
+			stack.push_back({ index, last });
+		}
+	}
+
+	for (size_t i = 0; i < in.size(); i++) {
+		if (keep[i]) out.push_back(in[i]);
+	}
+}
+
+void simplifyVisvalingam(const std::vector<ImVec2>& in, float tolerance, std::vector<ImVec2>& out) {
+	out.clear();
+	if (in.size() < 3) {
+		out = in;
+		return;
+	}
+
+	size_t n = in.size();
+	std::vector<size_t> prev(n);
+	std::vector<size_t> next(n);
+	std::vector<float> area(n, 0.f);
+	std::vector<bool> removed(n, false);
+	for (size_t i = 0; i < n; i++) {
+		prev[i] = i - 1;
+		next[i] = i + 1;
+	}
+
+	typedef std::pair<float, size_t> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	for (size_t i = 1; i + 1 < n; i++) {
+		area[i] = triangleArea(in[i - 1], in[i], in[i + 1]);
+		queue.push({ area[i], i });
+	}
+
+	float threshold = tolerance * tolerance;
+	float last = 0.f;
+	while (!queue.empty()) {
+		auto [smallest, i] = queue.top();
+		queue.pop();
+		if (removed[i] || smallest != area[i]) continue;
+		if (smallest >= threshold) break;
+
+		// A stroke doubling back on itself makes a flat triangle with a long tip, which area alone would cut off
+		size_t p = prev[i];
+		size_t q = next[i];
+		if (segmentDistance(in[i], in[p], in[q]) > tolerance) continue;
+
+		// A point's area never drops below the one removed before it, otherwise removal order would depend on neighbours
+		last = std::max(last, smallest);
+		removed[i] = true;
+		next[p] = q;
+		prev[q] = p;
+
+		if (p > 0) {
+			area[p] = std::max(triangleArea(in[prev[p]], in[p], in[q]), last);
+			queue.push({ area[p], p });
+		}
+		if (q < n - 1) {
+			area[q] = std::max(triangleArea(in[p], in[q], in[next[q]]), last);
+			queue.push({ area[q], q });
+		}
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		if (!removed[i]) out.push_back(in[i]);
+	}
+}
+
+void smoothChaikin(const std::vector<ImVec2>& in, int iterations, std::vector<ImVec2>& out) {
+	out = in;
+	if (in.size() < 3) return;
+
+	std::vector<ImVec2> next;
+	for (int iteration = 0; iteration < iterations; iteration++) {
+		next.clear();
+		next.reserve(out.size() * 2);
+		next.push_back(out.front());
+		for (size_t i = 0; i + 1 < out.size(); i++) {
+			ImVec2 a = out[i];
+			ImVec2 b = out[i + 1];
+			next.push_back({ a.x * 0.75f + b.x * 0.25f, a.y * 0.75f + b.y * 0.25f });
+			next.push_back({ a.x * 0.25f + b.x * 0.75f, a.y * 0.25f + b.y * 0.75f });
+		}
+		next.push_back(out.back());
+		out.swap(next);
+	}
+}
+
+static ImVec2 catmullRom(ImVec2 p0, ImVec2 p1, ImVec2 p2, ImVec2 p3, float t) {
+	float t2 = t * t;
+	float t3 = t2 * t;
+	auto axis = [&](float a, float b, float c, float d) {
+		return 0.5f * (2.f * b + (c - a) * t + (2.f * a - 5.f * b + 4.f * c - d) * t2 + (3.f * b - a - 3.f * c + d) * t3);
+	};
+	return { axis(p0.x, p1.x, p2.x, p3.x), axis(p0.y, p1.y, p2.y, p3.y) };
+}
+
+static void subdivide(ImVec2 p0, ImVec2 p1, ImVec2 p2, ImVec2 p3, float t0, ImVec2 a, float t1, ImVec2 b, float tolerance, int depth, std::vector<ImVec2>& out) {
+	float tm = (t0 + t1) * 0.5f;
+	ImVec2 middle = catmullRom(p0, p1, p2, p3, tm);
+	if (depth < MAX_CURVE_DEPTH && segmentDistance(middle, a, b) > tolerance) {
+		subdivide(p0, p1, p2, p3, t0, a, tm, middle, tolerance, depth + 1, out);
+		subdivide(p0, p1, p2, p3, tm, middle, t1, b, tolerance, depth + 1, out);
+	}
+	else {
+		out.push_back(b);
+	}
+}
+
+void smoothCatmullRom(const std::vector<ImVec2>& in, float tolerance, std::vector<ImVec2>& out) {
+	out.clear();
+	if (in.size() < 3) {
+		out = in;
+		return;
+	}
+
+	out.push_back(in.front());
+	for (size_t i = 0; i + 1 < in.size(); i++) {
+		ImVec2 p0 = in[i > 0 ? i - 1 : 0];
+		ImVec2 p1 = in[i];
+		ImVec2 p2 = in[i + 1];
+		ImVec2 p3 = in[std::min(i + 2, in.size() - 1)];
+		subdivide(p0, p1, p2, p3, 0.f, p1, 1.f, p2, tolerance, 0, out);
+	}
+}
+
+void processStroke(const std::vector<ImVec2>& in, const SimplifySettings& settings, std::vector<ImVec2>& out) {
+	std::vector<ImVec2> simplified;
+	switch (settings.method) {
+	case SimplifyMethod::DouglasPeucker: simplifyDouglasPeucker(in, settings.tolerance, simplified); break;
+	case SimplifyMethod::Visvalingam: simplifyVisvalingam(in, settings.tolerance, simplified); break;
+	default: simplified = in; break;
+	}
+
+	switch (settings.smoothing) {
+	case SmoothMethod::Chaikin: smoothChaikin(simplified, 2, out); break;
+	case SmoothMethod::CatmullRom: smoothCatmullRom(simplified, settings.smoothTolerance, out); break;
+	default: out.swap(simplified); break;
+	}
+}
+
+void StreamingSimplifier::begin() {
+	count = 0;
+	between.clear();
+}
+
+StreamAction StreamingSimplifier::push(ImVec2 point, float tolerance) {
+	if (count < 2) {
+		anchor = count == 0 ? point : candidate;
+		candidate = point;
+		count++;
+		return StreamAction::Append;
+	}
+
+	bool straight = between.size() < MAX_STREAM_PENDING && segmentDistance(candidate, anchor, point) <= tolerance;
+	for (size_t i = 0; straight && i < between.size(); i++) {
+		straight = segmentDistance(between[i], anchor, point) <= tolerance;
+	}
+
+	if (straight) {
+		between.push_back(candidate);
+		candidate = point;
+		return StreamAction::ReplaceLast;
+	}
+
+	anchor = candidate;
+	candidate = point;
+	between.clear();
+	count++;
+	return StreamAction::Append;
+}
@@ -0,0 +1,71 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <vector>
+#include <imgui/imgui.h>
+
+enum class SimplifyMethod {
+	None,
+	DouglasPeucker,
+	Visvalingam
+};
+
+enum class SmoothMethod {
+	None,
+	Chaikin,
+	CatmullRom
+};
+
+struct SimplifySettings {
+	SimplifyMethod method = SimplifyMethod::DouglasPeucker;
+	float tolerance = 0.75f;  // pixels a point may move before it counts as a visible change
+	SmoothMethod smoothing = SmoothMethod::None;
+	float smoothTolerance = 0.5f;  // pixels the curve may sag between resampled points
+	bool streaming = true;  // drop collinear points while the stroke is still being drawn
+};
+
+/**
+* Ramer-Douglas-Peucker, keeps the points that are further than tolerance from the simplified line
+*/
+void simplifyDouglasPeucker(const std::vector<ImVec2>& in, float tolerance, std::vector<ImVec2>& out);
+/**
+* Visvalingam-Whyatt, repeatedly drops the point making the smallest triangle until none are under tolerance^2
+* A point further than tolerance from the line between its neighbours is kept whatever its area
+*/
+void simplifyVisvalingam(const std::vector<ImVec2>& in, float tolerance, std::vector<ImVec2>& out);
+
+void smoothChaikin(const std::vector<ImVec2>& in, int iterations, std::vector<ImVec2>& out);
+/**
+* Catmull-Rom spline through the points, each span is subdivided until it is within tolerance of straight
+* so flat parts stay as a single segment and only the curves gain points
+*/
+void smoothCatmullRom(const std::vector<ImVec2>& in, float tolerance, std::vector<ImVec2>& out);
+
+/**
+* Runs the whole pipeline for a finished stroke, simplifying and then smoothing
+*/
+void processStroke(const std::vector<ImVec2>& in, const SimplifySettings& settings, std::vector<ImVec2>& out);
+
+enum class StreamAction {
+	Append,  // add the point to the stroke
+	ReplaceLast  // the point replaces the stroke's last point
+};
+
+/**
+* Simplifies a stroke as it is being drawn
+* The stroke's last point is treated as a candidate, while every sample since the last kept point stays within
+* tolerance of the line to the newest sample, that sample just replaces the candidate
+*/
+class StreamingSimplifier {
+public:
+	void begin();
+	StreamAction push(ImVec2 point, float tolerance);
+
+private:
+	int count = 0;
+	ImVec2 anchor;
+	ImVec2 candidate;
+	std::vector<ImVec2> between;
+};
+
+#endif // SIMPLIFY_H
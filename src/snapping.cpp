@@ -1,27 +1,87 @@
-#include <iostream>
+#include "snapping.h"
+#include <cfloat>
 #include <cmath>
-#include <imgui/imgui.h>
+#include "shapes.h"
 
-const double PI = 3.14159265358979323846;
-const int SNAP_ANGLE_DEG = 15;
-const double SNAP_ANGLE = SNAP_ANGLE_DEG * PI / 180;  // xp/180
+int snapStepDegrees(SnapAngles angles) {
+	switch (angles) {
+	case SnapAngles::Degrees90: return 90;
+	case SnapAngles::Degrees45: return 45;
+	case SnapAngles::Degrees30: return 30;
+	default: return 15;
+	}
+}
+
+ImVec2 SnapEngine::snapAngle(ImVec2 origin, ImVec2 point, SnapAngles angles) {
+	if (directions.empty() || angles != tableAngles) {
+		tableAngles = angles;
+		int count = 360 / snapStepDegrees(angles);
+		directions.resize(count);
+		for (int i = 0; i < count; i++) {
+			double angle = 6.283185307179586 * i / count;
+			directions[i] = { (float) std::cos(angle), (float) std::sin(angle) };
+		}
+	}
+
+	float dx = point.x - origin.x;
+	float dy = point.y - origin.y;
+	// The nearest direction is the one the line has the biggest dot product with
+	float best = -FLT_MAX;
+	ImVec2 direction = directions[0];
+	for (ImVec2 candidate : directions) {
+		float along = dx * candidate.x + dy * candidate.y;
+		if (along > best) {
+			best = along;
+			direction = candidate;
+		}
+	}
+
+	float length = std::sqrt(dx * dx + dy * dy);
+	return { origin.x + direction.x * length, origin.y + direction.y * length };
+}
 
-double distance(ImVec2 p1, ImVec2 p2) {
-    double dx = p2.x - p1.x;
-    double dy = p2.y - p1.y;
-    return std::sqrt(dx * dx + dy * dy);
+ImVec2 SnapEngine::snapGrid(ImVec2 point, float size) const {
+	if (size <= 0.f) return point;
+	return { std::round(point.x / size) * size, std::round(point.y / size) * size };
 }
 
-double angle(ImVec2 p1, ImVec2 p2) {
-    double dx = p2.x - p1.x;
-    double dy = p2.y - p1.y;
-    return std::atan2(dy, dx);
+bool SnapEngine::findAnchor(ImVec2 point, float radius, ImVec2& anchor) {
+	// Anchors sit on their stroke's ink, so any stroke with one in range has a segment in range too
+	index.queryRadius(point, radius, hits);
+
+	float nearest = radius * radius;
+	bool found = false;
+	StrokeId previous = INVALID_STROKE;
+	for (const SegmentRef& hit : hits) {
+		if (hit.stroke == previous) continue;
+		previous = hit.stroke;
+		const Stroke* stroke = document.find(hit.stroke);
+		if (!stroke) continue;
+
+		ImVec2 anchors[4];
+		uint32_t count = strokeAnchors(document, *stroke, anchors);
+		for (uint32_t i = 0; i < count; i++) {
+			float dx = anchors[i].x - point.x;
+			float dy = anchors[i].y - point.y;
+			if (dx * dx + dy * dy <= nearest) {
+				nearest = dx * dx + dy * dy;
+				anchor = anchors[i];
+				found = true;
+			}
+		}
+	}
+	return found;
 }
 
-ImVec2 snap(ImVec2 origin, ImVec2 mouse) {
-    double dist = distance(origin, mouse);
-    double ang = std::round(angle(origin, mouse) / SNAP_ANGLE) * SNAP_ANGLE;
-    double x = origin.x + dist * std::cos(ang);
-    double y = origin.y + dist * std::sin(ang);
-    return { (float) x, (float) y };
-}
\ No newline at end of file
+ImVec2 SnapEngine::snapPoint(ImVec2 point, const SnapSettings& settings, float zoom) {
+	ImVec2 anchor;
+	if (settings.magnetism && findAnchor(point, settings.magnetRadius / zoom, anchor)) return anchor;
+	return settings.grid ? snapGrid(point, settings.gridSize) : point;
+}
+
+ImVec2 SnapEngine::snapEnd(ImVec2 origin, ImVec2 point, bool angles, const SnapSettings& settings, float zoom) {
+	ImVec2 anchor;
+	if (settings.magnetism && findAnchor(point, settings.magnetRadius / zoom, anchor)) return anchor;
+	if (angles) return snapAngle(origin, point, settings.angles);
+	return settings.grid ? snapGrid(point, settings.gridSize) : point;
+}
@@ -1,15 +1,66 @@
 #ifndef SNAPPING_H
 #define SNAPPING_H
 
-#include <cmath>
+#include <vector>
 #include <imgui/imgui.h>
+#include "stroke_document.h"
+#include "spatial_index.h"
 
-const double PI = 3.14159265358979323846;
-const int SNAP_ANGLE_DEG = 45;
-const double SNAP_ANGLE = SNAP_ANGLE_DEG * PI / 180;
+/**
+* Directions straight lines can be snapped to, each set splits the circle evenly
+*/
+enum class SnapAngles {
+	Degrees90,
+	Degrees45,
+	Degrees30,
+	Degrees15
+};
 
-double distance(ImVec2 p1, ImVec2 p2);
-double angle(ImVec2 p1, ImVec2 p2);
-ImVec2 snap(ImVec2 origin, ImVec2 mouse);
+struct SnapSettings {
+	SnapAngles angles = SnapAngles::Degrees15;
+	bool grid = false;
+	float gridSize = 25.f;  // board units
+	bool magnetism = true;  // pull onto the ends and corners of strokes already on the board
+	float magnetRadius = 10.f;  // pixels
+};
 
-#endif // SNAPPING_H
\ No newline at end of file
+/**
+* Snaps points for straight lines and recognised shapes
+* Directions come from a table built when the angle set changes, so snapping a point is a handful of dot products
+* and a square root, with no trig
+*/
+class SnapEngine {
+public:
+	SnapEngine(const StrokeDocument& document, const SpatialIndex& index) : document(document), index(index) {}
+
+	/**
+	* Where a free point lands, the nearest anchor within the magnet radius wins, then the grid
+	* zoom turns the radius from pixels into board units
+	*/
+	ImVec2 snapPoint(ImVec2 point, const SnapSettings& settings, float zoom);
+	/**
+	* Where the end of a line from origin lands, an anchor wins, then the nearest direction when angles is set, then the grid
+	*/
+	ImVec2 snapEnd(ImVec2 origin, ImVec2 point, bool angles, const SnapSettings& settings, float zoom);
+
+	/**
+	* Turns the line to the nearest direction in the set, keeping its length
+	*/
+	ImVec2 snapAngle(ImVec2 origin, ImVec2 point, SnapAngles angles);
+	ImVec2 snapGrid(ImVec2 point, float size) const;
+	/**
+	* Nearest stroke anchor (see strokeAnchors) within radius of point, false if there isn't one
+	*/
+	bool findAnchor(ImVec2 point, float radius, ImVec2& anchor);
+
+private:
+	const StrokeDocument& document;
+	const SpatialIndex& index;
+	std::vector<ImVec2> directions;
+	SnapAngles tableAngles = SnapAngles::Degrees15;
+	std::vector<SegmentRef> hits;
+};
+
+int snapStepDegrees(SnapAngles angles);
+
+#endif // SNAPPING_H
@@ -0,0 +1,201 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+#include "shapes.h"
+
+float segmentDistance(ImVec2 p, ImVec2 a, ImVec2 b) {
+	float dx = b.x - a.x;
+	float dy = b.y - a.y;
+	float lengthSq = dx * dx + dy * dy;
+	float t = lengthSq > 0.f ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / lengthSq : 0.f;
+	t = std::clamp(t, 0.f, 1.f);
+	float cx = a.x + t * dx - p.x;
+	float cy = a.y + t * dy - p.y;
+	return std::sqrt(cx * cx + cy * cy);
+}
+
+SpatialIndex::SpatialIndex(StrokeDocument& document, float cellSize) : document(document), cellSize(cellSize) {
+	document.addListener(this);
+	rebuild();
+}
+
+SpatialIndex::~SpatialIndex() {
+	document.removeListener(this);
+}
+
+int32_t SpatialIndex::cellOf(float coordinate) const {
+	return (int32_t) std::floor(coordinate / cellSize);
+}
+
+const std::vector<ImVec2>& SpatialIndex::strokePoints(const Stroke& stroke, const Filed* filed) const {
+	if (stroke.shape == StrokeShape::Freehand) {
+		document.copyPoints(stroke, points);
+		return points;
+	}
+
+	if (!filed) filed = &this->filed.at(stroke.id);
+	return filed->outline;
+}
+
+uint32_t SpatialIndex::segmentCount(const std::vector<ImVec2>& outline) {
+	uint32_t count = (uint32_t) outline.size();
+	return count > 1 ? count - 1 : count;
+}
+
+void SpatialIndex::segmentEnds(const std::vector<ImVec2>& outline, uint32_t segment, ImVec2& a, ImVec2& b) {
+	a = outline[segment];
+	b = outline[std::min<size_t>(segment + 1, outline.size() - 1)];
+}
+
+template<typename F> void SpatialIndex::forEachCell(ImVec2 a, ImVec2 b, float pad, F&& call) const {
+	int32_t x0 = cellOf(std::min(a.x, b.x) - pad);
+	int32_t y0 = cellOf(std::min(a.y, b.y) - pad);
+	int32_t x1 = cellOf(std::max(a.x, b.x) + pad);
+	int32_t y1 = cellOf(std::max(a.y, b.y) + pad);
+	for (int32_t y = y0; y <= y1; y++) {
+		for (int32_t x = x0; x <= x1; x++) {
+			call(cellKey(x, y));
+		}
+	}
+}
+
+void SpatialIndex::insert(const Stroke& stroke) {
+	Filed& entry = filed[stroke.id];
+	entry.pad = stroke.style.thickness * 0.5f;
+	if (stroke.shape != StrokeShape::Freehand) strokeOutline(document, stroke, stroke.style.thickness * SHAPE_HIT_TOLERANCE, entry.outline);
+
+	const std::vector<ImVec2>& outline = strokePoints(stroke, &entry);
+	for (uint32_t segment = 0; segment < segmentCount(outline); segment++) {
+		ImVec2 a, b;
+		segmentEnds(outline, segment, a, b);
+		forEachCell(a, b, entry.pad, [&](uint64_t key) {
+			cells[key].push_back({ stroke.id, segment });
+		});
+	}
+}
+
+void SpatialIndex::remove(const Stroke& stroke) {
+	auto entry = filed.find(stroke.id);
+	if (entry == filed.end()) return;
+
+	const std::vector<ImVec2>& outline = strokePoints(stroke, &entry->second);
+	for (uint32_t segment = 0; segment < segmentCount(outline); segment++) {
+		ImVec2 a, b;
+		segmentEnds(outline, segment, a, b);
+		forEachCell(a, b, entry->second.pad, [&](uint64_t key) {
+			auto cell = cells.find(key);
+			if (cell == cells.end()) return;
+
+			std::vector<SegmentRef>& refs = cell->second;
+			for (size_t i = 0; i < refs.size(); i++) {
+				if (refs[i].stroke == stroke.id && refs[i].segment == segment) {
+					refs[i] = refs.back();
+					refs.pop_back();
+					break;
+				}
+			}
+			if (refs.empty()) cells.erase(cell);
+		});
+	}
+	filed.erase(entry);
+}
+
+void SpatialIndex::collect(ImVec2 min, ImVec2 max, std::vector<SegmentRef>& out) const {
+	int32_t x0 = cellOf(min.x);
+	int32_t y0 = cellOf(min.y);
+	int32_t x1 = cellOf(max.x);
+	int32_t y1 = cellOf(max.y);
+	for (int32_t y = y0; y <= y1; y++) {
+		for (int32_t x = x0; x <= x1; x++) {
+			auto cell = cells.find(cellKey(x, y));
+			if (cell != cells.end()) out.insert(out.end(), cell->second.begin(), cell->second.end());
+		}
+	}
+	std::sort(out.begin(), out.end());
+	out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+void SpatialIndex::queryRadius(ImVec2 centre, float radius, std::vector<SegmentRef>& out) const {
+	out.clear();
+	collect({ centre.x - radius, centre.y - radius }, { centre.x + radius, centre.y + radius }, out);
+
+	// Refs come sorted by stroke, so each stroke's points are only unpacked once
+	const Stroke* stroke = nullptr;
+	const std::vector<ImVec2>* outline = nullptr;
+	auto hit = std::remove_if(out.begin(), out.end(), [&](const SegmentRef& ref) {
+		if (!stroke || stroke->id != ref.stroke) {
+			stroke = document.find(ref.stroke);
+			outline = &strokePoints(*stroke, nullptr);
+		}
+		ImVec2 a, b;
+		segmentEnds(*outline, ref.segment, a, b);
+		return segmentDistance(centre, a, b) > radius + stroke->style.thickness * 0.5f;
+	});
+	out.erase(hit, out.end());
+}
+
+void SpatialIndex::queryRect(ImVec2 min, ImVec2 max, std::vector<SegmentRef>& out) const {
+	out.clear();
+	collect(min, max, out);
+
+	const Stroke* stroke = nullptr;
+	const std::vector<ImVec2>* outline = nullptr;
+	auto hit = std::remove_if(out.begin(), out.end(), [&](const SegmentRef& ref) {
+		if (!stroke || stroke->id != ref.stroke) {
+			stroke = document.find(ref.stroke);
+			outline = &strokePoints(*stroke, nullptr);
+		}
+		ImVec2 a, b;
+		segmentEnds(*outline, ref.segment, a, b);
+		float pad = stroke->style.thickness * 0.5f;
+		// Bounding box test, good enough for selecting
+		return std::max(a.x, b.x) + pad < min.x || std::min(a.x, b.x) - pad > max.x
+			|| std::max(a.y, b.y) + pad < min.y || std::min(a.y, b.y) - pad > max.y;
+	});
+	out.erase(hit, out.end());
+}
+
+void SpatialIndex::rebuild() {
+	cells.clear();
+	filed.clear();
+	released = false;
+	for (const Stroke& stroke : document.strokes()) {
+		if (stroke.id != document.activeStroke()) insert(stroke);
+	}
+}
+
+void SpatialIndex::release() {
+	decltype(cells)().swap(cells);
+	decltype(filed)().swap(filed);
+	std::vector<ImVec2>().swap(points);
+	released = true;
+}
+
+size_t SpatialIndex::memoryUsage() const {
+	size_t total = cells.bucket_count() * sizeof(void*) + filed.size() * (sizeof(StrokeId) + sizeof(Filed) + sizeof(void*));
+	for (const auto& cell : cells) {
+		total += sizeof(cell) + cell.second.capacity() * sizeof(SegmentRef);
+	}
+	for (const auto& entry : filed) {
+		total += entry.second.outline.capacity() * sizeof(ImVec2);
+	}
+	return total + points.capacity() * sizeof(ImVec2);
+}
+
+void SpatialIndex::strokeAdded(const StrokeDocument&, const Stroke& stroke) {
+	if (!released) insert(stroke);
+}
+
+void SpatialIndex::strokeRemoved(const StrokeDocument&, const Stroke& stroke) {
+	remove(stroke);
+}
+
+void SpatialIndex::strokeRestyled(const StrokeDocument&, const Stroke& stroke) {
+	remove(stroke);
+	if (!released) insert(stroke);
+}
+
+void SpatialIndex::documentCleared(const StrokeDocument&) {
+	cells.clear();
+	filed.clear();
+}
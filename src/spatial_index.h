@@ -0,0 +1,89 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+
+const float DEFAULT_CELL_SIZE = 32.f;
+
+/**
+* A segment of a stroke, from its point `segment` to the one after it
+* Single point strokes have one segment that starts and ends on that point
+*/
+struct SegmentRef {
+	StrokeId stroke;
+	uint32_t segment;
+
+	bool operator==(const SegmentRef& other) const { return stroke == other.stroke && segment == other.segment; }
+	bool operator<(const SegmentRef& other) const { return stroke != other.stroke ? stroke < other.stroke : segment < other.segment; }
+};
+
+/**
+* Uniform grid over the segments of every committed stroke, kept up to date through the document's listener
+* Each segment is filed under every cell its (thickness padded) bounding box touches
+* Shapes are filed by the segments of their outline, so their SegmentRefs count along that rather than their points
+*/
+class SpatialIndex : public StrokeListener {
+public:
+	explicit SpatialIndex(StrokeDocument& document, float cellSize = DEFAULT_CELL_SIZE);
+	~SpatialIndex();
+	SpatialIndex(const SpatialIndex&) = delete;
+	SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+	/**
+	* Segments whose ink comes within radius of centre, sorted and without duplicates
+	*/
+	void queryRadius(ImVec2 centre, float radius, std::vector<SegmentRef>& out) const;
+	/**
+	* Segments whose ink overlaps the rectangle, sorted and without duplicates
+	*/
+	void queryRect(ImVec2 min, ImVec2 max, std::vector<SegmentRef>& out) const;
+
+	void rebuild();
+	/**
+	* Frees every cell, the index finds nothing and ignores the document until it is rebuilt
+	*/
+	void release();
+	bool isReleased() const { return released; }
+	size_t memoryUsage() const;
+
+	void strokeAdded(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRemoved(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRestyled(const StrokeDocument& document, const Stroke& stroke) override;
+	void documentCleared(const StrokeDocument& document) override;
+
+private:
+	// How a stroke was filed, restyling can change the thickness before we get to remove it
+	struct Filed {
+		float pad;
+		std::vector<ImVec2> outline;  // only for shapes
+	};
+
+	// The points a stroke's segments run between, freehand ones are unpacked into points
+	const std::vector<ImVec2>& strokePoints(const Stroke& stroke, const Filed* filed) const;
+	static uint32_t segmentCount(const std::vector<ImVec2>& outline);
+	static void segmentEnds(const std::vector<ImVec2>& outline, uint32_t segment, ImVec2& a, ImVec2& b);
+	template<typename F> void forEachCell(ImVec2 a, ImVec2 b, float pad, F&& call) const;
+	void insert(const Stroke& stroke);
+	void remove(const Stroke& stroke);
+	void collect(ImVec2 min, ImVec2 max, std::vector<SegmentRef>& out) const;
+	uint64_t cellKey(int32_t x, int32_t y) const { return ((uint64_t) (uint32_t) x << 32) | (uint32_t) y; }
+	int32_t cellOf(float coordinate) const;
+
+	StrokeDocument& document;
+	float cellSize;
+	std::unordered_map<uint64_t, std::vector<SegmentRef>> cells;
+	std::unordered_map<StrokeId, Filed> filed;
+	bool released = false;
+	mutable std::vector<ImVec2> points;
+};
+
+/**
+* Distance from p to the segment a-b
+*/
+float segmentDistance(ImVec2 p, ImVec2 a, ImVec2 b);
+
+#endif // SPATIAL_INDEX_H
@@ -0,0 +1,55 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+* Lock-free ring buffer for exactly one producer thread and one consumer thread
+* Capacity has to be a power of two, when the ring is full new items are dropped (and counted) rather than blocking
+*/
+template<typename T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	SpscQueue() : buffer(Capacity) {}
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Producer only
+	bool push(const T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == Capacity) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		buffer[h & (Capacity - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, takes up to max items and returns how many it got
+	size_t pop(T* out, size_t max) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		size_t available = head.load(std::memory_order_acquire) - t;
+		size_t count = available < max ? available : max;
+		for (size_t i = 0; i < count; i++) {
+			out[i] = buffer[(t + i) & (Capacity - 1)];
+		}
+		tail.store(t + count, std::memory_order_release);
+		return count;
+	}
+
+	size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+	size_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	alignas(64) std::atomic<size_t> dropped{ 0 };
+	std::vector<T> buffer;
+};
+
+#endif // SPSC_QUEUE_H
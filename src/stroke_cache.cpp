@@ -0,0 +1,337 @@
+#include "stroke_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "shapes.h"
+#include "simplify.h"
+
+// Chunk indices have to fit in an ImDrawIdx
+const int CHUNK_VERTICES = 65535;
+
+StrokeCache::StrokeCache(StrokeDocument& document, int level) : document(document), lodLevel(level), scale(std::ldexp(1.f, level)) {
+	document.addListener(this);
+}
+
+StrokeCache::~StrokeCache() {
+	document.removeListener(this);
+	if (scratch) IM_DELETE(scratch);
+}
+
+void StrokeCache::invalidate(StrokeId id) {
+	if (id > bakedUpTo) return;
+
+	if (chunks.empty()) {
+		bakedUpTo = std::min(bakedUpTo, id - 1);
+		return;
+	}
+
+	auto it = std::upper_bound(chunks.begin(), chunks.end(), id, [](StrokeId id, const GeometryChunk& chunk) { return id < chunk.firstId; });
+	if (it == chunks.begin()) {
+		chunks.front().firstId = id;
+		chunks.front().dirty = true;
+	}
+	else {
+		// Every chunk holding part of this stroke
+		for (auto chunk = it - 1; ; chunk--) {
+			chunk->dirty = true;
+			if (chunk == chunks.begin() || (chunk - 1)->lastId < id) break;
+		}
+	}
+	anyDirty = true;
+}
+
+static void growBounds(GeometryChunk& chunk, const StrokeSpan& span) {
+	if (chunk.spans.empty()) {
+		chunk.min = span.min;
+		chunk.max = span.max;
+	}
+	else {
+		chunk.min = { std::min(chunk.min.x, span.min.x), std::min(chunk.min.y, span.min.y) };
+		chunk.max = { std::max(chunk.max.x, span.max.x), std::max(chunk.max.y, span.max.y) };
+	}
+	chunk.spans.push_back(span);
+}
+
+void StrokeCache::flush(StrokeId firstId, StrokeId lastId, std::vector<GeometryChunk>& out) {
+	if (scratch->VtxBuffer.Size > 0) {
+		GeometryChunk chunk;
+		chunk.firstId = firstId;
+		chunk.lastId = lastId;
+		chunk.vertices.swap(scratch->VtxBuffer);
+		chunk.indices.swap(scratch->IdxBuffer);
+		for (const StrokeSpan& span : scratchSpans) growBounds(chunk, span);
+		out.push_back(std::move(chunk));
+	}
+	scratchSpans.clear();
+	scratch->_ResetForNewFrame();
+	scratch->Flags &= ~ImDrawListFlags_AllowVtxOffset;
+}
+
+/**
+* Tessellates strokes [firstStroke, endStroke) of the document onto the end of out
+* If the last chunk in out still has room it is topped up instead of starting a new one
+*/
+void StrokeCache::bake(size_t firstStroke, size_t endStroke, std::vector<GeometryChunk>& out) {
+	if (firstStroke >= endStroke) return;
+
+	const std::vector<Stroke>& strokes = document.strokes();
+	GeometryChunk* topUp = out.empty() ? nullptr : &out.back();
+	int room = topUp ? CHUNK_VERTICES - topUp->vertices.Size : CHUNK_VERTICES;
+	StrokeId chunkFirst = topUp ? topUp->firstId : strokes[firstStroke].id;
+
+	scratch->_ResetForNewFrame();
+	scratch->Flags &= ~ImDrawListFlags_AllowVtxOffset;
+	scratchSpans.clear();
+
+	auto finishChunk = [&](StrokeId lastId) {
+		if (topUp) {
+			ImDrawIdx base = (ImDrawIdx) topUp->vertices.Size;
+			int indexBase = topUp->indices.Size;
+			for (ImDrawIdx& index : scratch->IdxBuffer) index += base;
+			for (const ImDrawVert& vertex : scratch->VtxBuffer) topUp->vertices.push_back(vertex);
+			for (ImDrawIdx index : scratch->IdxBuffer) topUp->indices.push_back(index);
+			for (StrokeSpan span : scratchSpans) {
+				span.firstVertex += base;
+				span.firstIndex += indexBase;
+				growBounds(*topUp, span);
+			}
+			scratchSpans.clear();
+			topUp->lastId = lastId;
+			topUp = nullptr;
+			scratch->_ResetForNewFrame();
+			scratch->Flags &= ~ImDrawListFlags_AllowVtxOffset;
+		}
+		else {
+			flush(chunkFirst, lastId, out);
+		}
+		room = CHUNK_VERTICES;
+	};
+
+	// Miters can reach past the thickness, and the anti-aliased edge is a pixel at the level's zoom
+	float reach = tessellation.join == JoinStyle::Miter ? std::max(tessellation.miterLimit, 1.f) : 1.f;
+	float fringe = 2.f / scale;
+
+	StrokeId lastBaked = topUp ? topUp->lastId : INVALID_STROKE;
+	for (size_t s = firstStroke; s < endStroke; s++) {
+		const Stroke& stroke = strokes[s];
+		StrokeStyle style = stroke.style;
+		style.thickness *= scale;
+
+		if (stroke.shape != StrokeShape::Freehand) {
+			// Shapes are traced out finely enough for this level's zoom
+			strokeOutline(document, stroke, SHAPE_TOLERANCE / scale, outline);
+			scaled.clear();
+			for (ImVec2 point : outline) scaled.push_back({ point.x * scale, point.y * scale });
+		}
+		else {
+			// Unpacked straight onto the level, which is all the finer levels need
+			document.readPoints(stroke, xs, ys, scale);
+			if (lodLevel < 0) {
+				scaled.clear();
+				for (uint32_t i = 0; i < stroke.count; i++) {
+					ImVec2 point{ xs[i], ys[i] };
+					// Points that land on the same pixel can't be told apart, the last one always stays
+					if (!scaled.empty() && i + 1 < stroke.count) {
+						float dx = point.x - scaled.back().x, dy = point.y - scaled.back().y;
+						if (dx * dx + dy * dy < LOD_MIN_SPACING * LOD_MIN_SPACING) continue;
+					}
+					scaled.push_back(point);
+				}
+			}
+		}
+
+		if (lodLevel < 0 || stroke.shape != StrokeShape::Freehand) {
+			if (lodLevel < 0) simplifyDouglasPeucker(scaled, LOD_TOLERANCE, decimated);
+			const std::vector<ImVec2>& points = lodLevel < 0 ? decimated : scaled;
+
+			xs.resize(points.size());
+			ys.resize(points.size());
+			for (size_t i = 0; i < points.size(); i++) {
+				xs[i] = points[i].x;
+				ys[i] = points[i].y;
+			}
+		}
+		const float* strokeXs = xs.data();
+		const float* strokeYs = ys.data();
+		uint32_t strokeCount = (uint32_t) xs.size();
+
+		float pad = stroke.style.thickness * 0.5f * reach + fringe;
+		ImVec2 min{ stroke.min.x - pad, stroke.min.y - pad };
+		ImVec2 max{ stroke.max.x + pad, stroke.max.y + pad };
+
+		// Strokes too long for one chunk are split into runs that share their end points
+		uint32_t run = maxStrokePoints(style.thickness, CHUNK_VERTICES, tessellation, scratch);
+		uint32_t first = 0;
+		while (first < strokeCount) {
+			uint32_t count = std::min(run, strokeCount - first);
+			if (scratch->VtxBuffer.Size + strokeVertexBound(count, style.thickness, tessellation, scratch) > room) {
+				finishChunk(first == 0 ? lastBaked : stroke.id);
+				chunkFirst = stroke.id;
+			}
+			int firstVertex = scratch->VtxBuffer.Size;
+			int firstIndex = scratch->IdxBuffer.Size;
+			tessellateStroke(scratch, strokeXs + first, strokeYs + first, count, style, tessellation);
+			scratchSpans.push_back({ min, max, firstVertex, scratch->VtxBuffer.Size - firstVertex, firstIndex, scratch->IdxBuffer.Size - firstIndex });
+			if (first + count >= strokeCount) break;
+			first += count - 1;
+		}
+		lastBaked = stroke.id;
+	}
+	finishChunk(strokes[endStroke - 1].id);
+}
+
+void StrokeCache::sync(size_t pointBudget) {
+	if (!scratch) scratch = IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData());
+
+	if (anyDirty) {
+		// Strokes split over several chunks have to be rebaked as a whole
+		for (size_t i = 1; i < chunks.size(); i++) {
+			if (chunks[i - 1].dirty && chunks[i].firstId <= chunks[i - 1].lastId) chunks[i].dirty = true;
+		}
+		for (size_t i = chunks.size(); i-- > 1;) {
+			if (chunks[i].dirty && chunks[i - 1].lastId >= chunks[i].firstId) chunks[i - 1].dirty = true;
+		}
+
+		std::vector<GeometryChunk> rebuilt;
+		rebuilt.reserve(chunks.size());
+		size_t i = 0;
+		while (i < chunks.size()) {
+			if (!chunks[i].dirty) {
+				rebuilt.push_back(std::move(chunks[i++]));
+				continue;
+			}
+
+			size_t j = i;
+			while (j < chunks.size() && chunks[j].dirty) j++;
+
+			StrokeId lo = chunks[i].firstId;
+			StrokeId hi = j < chunks.size() ? chunks[j].firstId - 1 : bakedUpTo;
+			bake(document.lowerIndex(lo), document.lowerIndex(hi + 1), rebuilt);
+			i = j;
+		}
+		chunks.swap(rebuilt);
+		anyDirty = false;
+	}
+
+	size_t end = document.strokes().size();
+	if (document.isDrawing()) end--;
+	size_t first = document.lowerIndex(bakedUpTo + 1);
+	if (first < end) {
+		size_t stop = first;
+		size_t points = 0;
+		while (stop < end && points < pointBudget) points += document.strokes()[stop++].count;
+		if (stop == first) return;
+
+		bake(first, stop, chunks);
+		bakedUpTo = document.strokes()[stop - 1].id;
+	}
+}
+
+bool StrokeCache::isComplete() const {
+	size_t end = document.strokes().size();
+	if (document.isDrawing()) end--;
+	return !anyDirty && document.lowerIndex(bakedUpTo + 1) >= end;
+}
+
+/**
+* Copies vertices [firstVertex, firstVertex + vertexCount) and the indices using them onto the end of the draw list
+* Positions go from the level's coordinates to the screen with a scale and an offset
+*/
+static void copyGeometry(ImDrawList* drawList, const GeometryChunk& chunk, int firstVertex, int vertexCount, int firstIndex, int indexCount, float factor, ImVec2 offset) {
+	const ImDrawVert* vertices = chunk.vertices.Data + firstVertex;
+	if (factor == 1.f && offset.x == 0.f && offset.y == 0.f) {
+		std::memcpy(drawList->_VtxWritePtr, vertices, vertexCount * sizeof(ImDrawVert));
+	}
+	else {
+		for (int i = 0; i < vertexCount; i++) {
+			ImDrawVert vertex = vertices[i];
+			vertex.pos = { vertex.pos.x * factor + offset.x, vertex.pos.y * factor + offset.y };
+			drawList->_VtxWritePtr[i] = vertex;
+		}
+	}
+
+	// Only the indices need touching to move the geometry onto the list's vertices
+	ImDrawIdx base = (ImDrawIdx) (drawList->_VtxCurrentIdx - firstVertex);
+	const ImDrawIdx* indices = chunk.indices.Data + firstIndex;
+	for (int i = 0; i < indexCount; i++) {
+		drawList->_IdxWritePtr[i] = (ImDrawIdx) (base + indices[i]);
+	}
+	drawList->_VtxWritePtr += vertexCount;
+	drawList->_IdxWritePtr += indexCount;
+	drawList->_VtxCurrentIdx += vertexCount;
+}
+
+/**
+* Chunks entirely on screen are copied whole, chunks partly on screen stroke by stroke and the rest are skipped
+*/
+void StrokeCache::draw(ImDrawList* drawList, const Viewport& view) const {
+	float factor = view.zoom / scale;
+	ImVec2 offset{ -view.origin.x * view.zoom, -view.origin.y * view.zoom };
+	ImVec2 visibleMin = view.boardMin();
+	ImVec2 visibleMax = view.boardMax();
+
+	for (const GeometryChunk& chunk : chunks) {
+		if (chunk.vertices.Size == 0 || !view.isVisible(chunk.min, chunk.max)) continue;
+
+		if (chunk.min.x >= visibleMin.x && chunk.min.y >= visibleMin.y && chunk.max.x <= visibleMax.x && chunk.max.y <= visibleMax.y) {
+			drawList->PrimReserve(chunk.indices.Size, chunk.vertices.Size);
+			copyGeometry(drawList, chunk, 0, chunk.vertices.Size, 0, chunk.indices.Size, factor, offset);
+			continue;
+		}
+
+		int vertexCount = 0;
+		int indexCount = 0;
+		for (const StrokeSpan& span : chunk.spans) {
+			if (!view.isVisible(span.min, span.max)) continue;
+			vertexCount += span.vertexCount;
+			indexCount += span.indexCount;
+		}
+		if (vertexCount == 0) continue;
+
+		drawList->PrimReserve(indexCount, vertexCount);
+		for (const StrokeSpan& span : chunk.spans) {
+			if (view.isVisible(span.min, span.max)) copyGeometry(drawList, chunk, span.firstVertex, span.vertexCount, span.firstIndex, span.indexCount, factor, offset);
+		}
+	}
+}
+
+void StrokeCache::setTessellation(const TessellationSettings& settings) {
+	tessellation = settings;
+	invalidateAll();
+}
+
+void StrokeCache::invalidateAll() {
+	chunks.clear();
+	bakedUpTo = INVALID_STROKE;
+	anyDirty = false;
+}
+
+size_t StrokeCache::vertexCount() const {
+	size_t total = 0;
+	for (const GeometryChunk& chunk : chunks) total += chunk.vertices.Size;
+	return total;
+}
+
+size_t StrokeCache::memoryUsage() const {
+	size_t total = chunks.capacity() * sizeof(GeometryChunk);
+	for (const GeometryChunk& chunk : chunks) {
+		total += chunk.vertices.Capacity * sizeof(ImDrawVert) + chunk.indices.Capacity * sizeof(ImDrawIdx) + chunk.spans.capacity() * sizeof(StrokeSpan);
+	}
+	return total;
+}
+
+void StrokeCache::strokeAdded(const StrokeDocument&, const Stroke& stroke) {
+	invalidate(stroke.id);
+}
+
+void StrokeCache::strokeRemoved(const StrokeDocument&, const Stroke& stroke) {
+	invalidate(stroke.id);
+}
+
+void StrokeCache::strokeRestyled(const StrokeDocument&, const Stroke& stroke) {
+	invalidate(stroke.id);
+}
+
+void StrokeCache::documentCleared(const StrokeDocument&) {
+	invalidateAll();
+}
@@ -0,0 +1,104 @@
+#ifndef STROKE_CACHE_H
+#define STROKE_CACHE_H
+
+#include <cstdint>
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+#include "stroke_tessellator.h"
+#include "viewport.h"
+
+// How far decimated levels let a point move, in screen pixels at the level's own zoom
+const float LOD_TOLERANCE = 0.5f;
+// Decimated levels drop points closer than this to the last one kept, in screen pixels at the level's own zoom
+const float LOD_MIN_SPACING = 1.f;
+
+/**
+* Where one stroke's geometry sits in a chunk, with the stroke's bounding box for culling
+*/
+struct StrokeSpan {
+	ImVec2 min;
+	ImVec2 max;
+	int firstVertex;
+	int vertexCount;
+	int firstIndex;
+	int indexCount;
+};
+
+/**
+* Tessellated geometry for a run of strokes, the indices are relative to the start of the chunk
+* A chunk holds every stroke with an id from firstId to lastId, a stroke too big for one chunk is split over several
+*/
+struct GeometryChunk {
+	StrokeId firstId;
+	StrokeId lastId;
+	ImVector<ImDrawVert> vertices;
+	ImVector<ImDrawIdx> indices;
+	std::vector<StrokeSpan> spans;
+	ImVec2 min;  // bounding box of every stroke in the chunk
+	ImVec2 max;
+	bool dirty = false;
+};
+
+/**
+* Keeps committed strokes tessellated so that drawing them is just a copy into the draw list
+* New strokes are baked onto the end, removing / restoring / restyling a stroke only rebakes the chunk it is in
+* The stroke being drawn is never cached, the caller draws that one itself
+*
+* A cache is baked for one level of detail. Level 0 is the board at its own scale, level n is tessellated at a zoom of
+* 2^n so lines keep a one pixel anti-aliased edge when drawn near that zoom, and below 0 strokes are decimated too
+*/
+class StrokeCache : public StrokeListener {
+public:
+	explicit StrokeCache(StrokeDocument& document, int level = 0);
+	~StrokeCache();
+	StrokeCache(const StrokeCache&) = delete;
+	StrokeCache& operator=(const StrokeCache&) = delete;
+
+	/**
+	* Bakes anything new or dirty, needs a current ImGui frame for the font atlas UVs
+	* New strokes stop being baked once pointBudget of their points have been, the rest are left for the next call
+	*/
+	void sync(size_t pointBudget = SIZE_MAX);
+	// Every committed stroke is baked
+	bool isComplete() const;
+	/**
+	* Copies the geometry of every stroke in view into the draw list, placed for the view
+	*/
+	void draw(ImDrawList* drawList, const Viewport& view) const;
+	int level() const { return lodLevel; }
+	void invalidateAll();
+	// Changing how strokes are tessellated rebakes everything
+	void setTessellation(const TessellationSettings& settings);
+	const TessellationSettings& tessellationSettings() const { return tessellation; }
+
+	size_t vertexCount() const;
+	size_t memoryUsage() const;
+
+	void strokeAdded(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRemoved(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRestyled(const StrokeDocument& document, const Stroke& stroke) override;
+	void documentCleared(const StrokeDocument& document) override;
+
+private:
+	void invalidate(StrokeId id);
+	void bake(size_t firstStroke, size_t endStroke, std::vector<GeometryChunk>& out);
+	void flush(StrokeId firstId, StrokeId lastId, std::vector<GeometryChunk>& out);
+
+	StrokeDocument& document;
+	int lodLevel;
+	float scale;  // 2^lodLevel
+	TessellationSettings tessellation;
+	std::vector<GeometryChunk> chunks;
+	StrokeId bakedUpTo = INVALID_STROKE;
+	bool anyDirty = false;
+	ImDrawList* scratch = nullptr;
+	std::vector<StrokeSpan> scratchSpans;  // spans of what is in scratch, relative to it
+	std::vector<ImVec2> outline;
+	std::vector<ImVec2> scaled;
+	std::vector<ImVec2> decimated;
+	std::vector<float> xs;
+	std::vector<float> ys;
+};
+
+#endif // STROKE_CACHE_H
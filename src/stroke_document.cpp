@@ -0,0 +1,355 @@
+#include "stroke_document.h"
+#include <algorithm>
+#include <cfloat>
+#include "point_codec.h"
+
+// Don't bother compacting until this many points are wasted
+const size_t COMPACT_MIN_GARBAGE = 1 << 16;
+
+static void emptyBounds(Stroke& stroke) {
+	stroke.min = { FLT_MAX, FLT_MAX };
+	stroke.max = { -FLT_MAX, -FLT_MAX };
+}
+
+static void growBounds(Stroke& stroke, ImVec2 point) {
+	stroke.min.x = std::min(stroke.min.x, point.x);
+	stroke.min.y = std::min(stroke.min.y, point.y);
+	stroke.max.x = std::max(stroke.max.x, point.x);
+	stroke.max.y = std::max(stroke.max.y, point.y);
+}
+
+StrokeDocument::StrokeDocument(const StrokeDocument& other)
+	: xs(other.xs), ys(other.ys), strokeList(other.strokeList), nextId(other.nextId), client(other.client), garbage(other.garbage), drawing(other.drawing),
+	packedPoints(other.packedPoints), packedCount(other.packedCount) {}
+
+StrokeDocument& StrokeDocument::operator=(const StrokeDocument& other) {
+	xs = other.xs;
+	ys = other.ys;
+	strokeList = other.strokeList;
+	nextId = other.nextId;
+	client = other.client;
+	garbage = other.garbage;
+	drawing = other.drawing;
+	packedPoints = other.packedPoints;
+	packedCount = other.packedCount;
+	return *this;
+}
+
+std::vector<Stroke>::iterator StrokeDocument::lowerBound(StrokeId id) {
+	return std::lower_bound(strokeList.begin(), strokeList.end(), id, [](const Stroke& stroke, StrokeId id) { return stroke.id < id; });
+}
+
+std::vector<Stroke>::const_iterator StrokeDocument::lowerBound(StrokeId id) const {
+	return std::lower_bound(strokeList.begin(), strokeList.end(), id, [](const Stroke& stroke, StrokeId id) { return stroke.id < id; });
+}
+
+/**
+* Rounding keeps the order of coordinates, so the bounds rounded are the bounds of the points rounded
+*/
+static void roundBounds(Stroke& stroke) {
+	if (stroke.count == 0) return;
+
+	stroke.min = { packedCoordinate(stroke.min.x, stroke.grid), packedCoordinate(stroke.min.y, stroke.grid) };
+	stroke.max = { packedCoordinate(stroke.max.x, stroke.grid), packedCoordinate(stroke.max.y, stroke.grid) };
+}
+
+void StrokeDocument::packStroke(Stroke& stroke, const float* strokeXs, const float* strokeYs, uint32_t count) {
+	stroke.first = (uint32_t) packedPoints.size();
+	stroke.count = count;
+	stroke.grid = packingGrid(strokeXs, strokeYs, count);
+	packPoints(strokeXs, strokeYs, count, packedPoints, stroke.grid);
+	packedCount += count;
+	emptyBounds(stroke);
+	for (uint32_t i = 0; i < count; i++) growBounds(stroke, { strokeXs[i], strokeYs[i] });
+	roundBounds(stroke);
+}
+
+void StrokeDocument::packStroke(Stroke& stroke, const ImVec2* points, uint32_t count) {
+	stroke.first = (uint32_t) packedPoints.size();
+	stroke.count = count;
+	stroke.grid = packingGrid(points, count);
+	packPoints(points, count, packedPoints, stroke.grid);
+	packedCount += count;
+	emptyBounds(stroke);
+	for (uint32_t i = 0; i < count; i++) growBounds(stroke, points[i]);
+	roundBounds(stroke);
+}
+
+void StrokeDocument::pushActive(Stroke& stroke, const ImVec2* points, uint32_t count) {
+	xs.clear();
+	ys.clear();
+	stroke.first = 0;
+	stroke.count = count;
+	emptyBounds(stroke);
+	for (uint32_t i = 0; i < count; i++) {
+		xs.push_back(points[i].x);
+		ys.push_back(points[i].y);
+		growBounds(stroke, points[i]);
+	}
+}
+
+StrokeId StrokeDocument::beginStroke(StrokeStyle style) {
+	if (drawing) endStroke();
+
+	Stroke stroke{};
+	stroke.id = takeId();
+	stroke.style = style;
+	pushActive(stroke, nullptr, 0);
+	strokeList.push_back(stroke);
+	drawing = true;
+	return stroke.id;
+}
+
+void StrokeDocument::appendPoint(ImVec2 point) {
+	if (!drawing) return;
+
+	Stroke& stroke = strokeList.back();
+	xs.push_back(point.x);
+	ys.push_back(point.y);
+	stroke.count++;
+	growBounds(stroke, point);
+}
+
+void StrokeDocument::replaceLastPoint(ImVec2 point) {
+	if (!drawing || strokeList.back().count == 0) return appendPoint(point);
+
+	xs.back() = point.x;
+	ys.back() = point.y;
+	growBounds(strokeList.back(), point);
+}
+
+void StrokeDocument::replaceActivePoints(const ImVec2* points, uint32_t count, StrokeShape shape) {
+	if (!drawing) return;
+
+	Stroke& stroke = strokeList.back();
+	pushActive(stroke, points, count);
+	stroke.shape = shape;
+}
+
+StrokeId StrokeDocument::endStroke() {
+	if (!drawing) return INVALID_STROKE;
+	drawing = false;
+
+	Stroke& stroke = strokeList.back();
+	packStroke(stroke, xs.data(), ys.data(), stroke.count);
+	xs.clear();
+	ys.clear();
+	notify([&](StrokeListener* listener) { listener->strokeAdded(*this, stroke); });
+	return stroke.id;
+}
+
+StrokeId StrokeDocument::addStroke(StrokeStyle style, const ImVec2* points, uint32_t count, StrokeShape shape) {
+	if (drawing) endStroke();
+
+	Stroke stroke{};
+	stroke.id = takeId();
+	stroke.style = style;
+	stroke.shape = shape;
+	packStroke(stroke, points, count);
+	strokeList.push_back(stroke);
+	notify([&](StrokeListener* listener) { listener->strokeAdded(*this, strokeList.back()); });
+	return stroke.id;
+}
+
+bool StrokeDocument::insertStroke(StrokeId id, StrokeStyle style, const ImVec2* points, uint32_t count, StrokeShape shape) {
+	if (id == INVALID_STROKE || drawing || find(id)) return false;
+
+	Stroke stroke{};
+	stroke.id = id;
+	stroke.style = style;
+	stroke.shape = shape;
+	packStroke(stroke, points, count);
+	auto it = strokeList.insert(lowerBound(id), stroke);
+	if (id >= nextId) nextId = id + 1;
+	notify([&](StrokeListener* listener) { listener->strokeAdded(*this, *it); });
+	return true;
+}
+
+bool StrokeDocument::insertStroke(StrokeId id, StrokeStyle style, const PackedPoints& points, StrokeShape shape) {
+	if (id == INVALID_STROKE || drawing || find(id)) return false;
+
+	Stroke stroke{};
+	stroke.id = id;
+	stroke.style = style;
+	stroke.shape = shape;
+	stroke.first = (uint32_t) packedPoints.size();
+	stroke.count = points.count;
+	stroke.grid = points.grid;
+	packedPoints.insert(packedPoints.end(), points.bytes.begin(), points.bytes.end());
+	packedCount += points.count;
+	emptyBounds(stroke);
+	PointDecoder decoder(points.bytes.data(), points.grid);
+	for (uint32_t i = 0; i < points.count; i++) growBounds(stroke, decoder.next());
+
+	auto it = strokeList.insert(lowerBound(id), stroke);
+	if (id >= nextId) nextId = id + 1;
+	notify([&](StrokeListener* listener) { listener->strokeAdded(*this, *it); });
+	return true;
+}
+
+bool StrokeDocument::removeStroke(StrokeId id, PackedPoints* removedPoints) {
+	auto it = lowerBound(id);
+	if (it == strokeList.end() || it->id != id) return false;
+
+	bool active = drawing && it == strokeList.end() - 1;
+	if (removedPoints) {
+		removedPoints->count = it->count;
+		removedPoints->bytes.clear();
+		if (active) {
+			removedPoints->grid = packingGrid(xs.data(), ys.data(), it->count);
+			packPoints(xs.data(), ys.data(), it->count, removedPoints->bytes, removedPoints->grid);
+		}
+		else {
+			const uint8_t* start = packedPoints.data() + it->first;
+			removedPoints->grid = it->grid;
+			removedPoints->bytes.assign(start, start + packedSize(start, it->count));
+		}
+	}
+
+	if (active) {
+		drawing = false;
+		xs.clear();
+		ys.clear();
+	}
+	else {
+		notify([&](StrokeListener* listener) { listener->strokeRemoved(*this, *it); });
+		garbage += it->count;
+	}
+	strokeList.erase(it);
+	maybeCompact();
+	return true;
+}
+
+bool StrokeDocument::setStyle(StrokeId id, StrokeStyle style) {
+	auto it = lowerBound(id);
+	if (it == strokeList.end() || it->id != id) return false;
+	it->style = style;
+	if (!(drawing && it == strokeList.end() - 1)) notify([&](StrokeListener* listener) { listener->strokeRestyled(*this, *it); });
+	return true;
+}
+
+size_t StrokeDocument::lowerIndex(StrokeId id) const {
+	return lowerBound(id) - strokeList.begin();
+}
+
+const Stroke* StrokeDocument::find(StrokeId id) const {
+	auto it = lowerBound(id);
+	if (it == strokeList.end() || it->id != id) return nullptr;
+	return &*it;
+}
+
+void StrokeDocument::copyPoints(const Stroke& stroke, std::vector<ImVec2>& out) const {
+	out.resize(stroke.count);
+	if (stroke.id == activeStroke()) {
+		for (uint32_t i = 0; i < stroke.count; i++) out[i] = { xs[stroke.first + i], ys[stroke.first + i] };
+		return;
+	}
+
+	PointDecoder decoder(packedPoints.data() + stroke.first, stroke.grid);
+	for (uint32_t i = 0; i < stroke.count; i++) out[i] = decoder.next();
+}
+
+void StrokeDocument::readPoints(const Stroke& stroke, std::vector<float>& outXs, std::vector<float>& outYs, float scale, ImVec2 offset) const {
+	outXs.resize(stroke.count);
+	outYs.resize(stroke.count);
+	if (stroke.id == activeStroke()) {
+		for (uint32_t i = 0; i < stroke.count; i++) {
+			outXs[i] = xs[stroke.first + i] * scale + offset.x;
+			outYs[i] = ys[stroke.first + i] * scale + offset.y;
+		}
+		return;
+	}
+	unpackPoints(packedPoints.data() + stroke.first, stroke.count, stroke.grid, outXs.data(), outYs.data(), scale, offset);
+}
+
+ImVec2 StrokeDocument::pointOf(const Stroke& stroke, uint32_t index) const {
+	if (stroke.id == activeStroke()) return { xs[stroke.first + index], ys[stroke.first + index] };
+
+	PointDecoder decoder(packedPoints.data() + stroke.first, stroke.grid);
+	ImVec2 point = decoder.next();
+	for (uint32_t i = 0; i < index; i++) point = decoder.next();
+	return point;
+}
+
+size_t StrokeDocument::memoryUsage() const {
+	return xs.capacity() * sizeof(float) + ys.capacity() * sizeof(float) + strokeList.capacity() * sizeof(Stroke) + packedPoints.capacity();
+}
+
+StrokeId StrokeDocument::takeId() {
+	if (client == 0) return nextId++;
+
+	// The first id from nextId on that ends in the client's bits
+	StrokeId id = (nextId & ~STROKE_CLIENT_MASK) | client;
+	if (id < nextId) id += STROKE_CLIENT_MASK + 1;
+	nextId = id + 1;
+	return id;
+}
+
+void StrokeDocument::setClient(uint8_t client) {
+	this->client = client;
+}
+
+void StrokeDocument::continueIds(const StrokeDocument& other) {
+	nextId = std::max(nextId, other.nextId);
+	client = other.client;
+}
+
+void StrokeDocument::clear() {
+	xs.clear();
+	ys.clear();
+	strokeList.clear();
+	garbage = 0;
+	drawing = false;
+	std::vector<uint8_t>().swap(packedPoints);
+	packedCount = 0;
+	notify([&](StrokeListener* listener) { listener->documentCleared(*this); });
+}
+
+void StrokeDocument::reserve(size_t strokes, size_t points) {
+	strokeList.reserve(strokeList.size() + strokes);
+	// A rough guess, pen strokes pack to a little over 2 bytes a point
+	packedPoints.reserve(packedPoints.size() + points * 3);
+}
+
+void StrokeDocument::maybeCompact() {
+	if (garbage < COMPACT_MIN_GARBAGE || garbage < pointCount()) return;
+	compact();
+}
+
+/**
+* Rewrites the packed bytes so that they only hold the committed strokes' points, in drawing order
+*/
+void StrokeDocument::compact() {
+	std::vector<uint8_t> bytes;
+	bytes.reserve(packedPoints.size());
+	packedCount = 0;
+	for (Stroke& stroke : strokeList) {
+		if (stroke.id == activeStroke()) continue;
+
+		const uint8_t* start = packedPoints.data() + stroke.first;
+		stroke.first = (uint32_t) bytes.size();
+		bytes.insert(bytes.end(), start, start + packedSize(start, stroke.count));
+		packedCount += stroke.count;
+	}
+
+	packedPoints.swap(bytes);
+	garbage = 0;
+}
+
+void StrokeDocument::shrink() {
+	if (garbage > 0) compact();
+	packedPoints.shrink_to_fit();
+	strokeList.shrink_to_fit();
+	if (!drawing) {
+		std::vector<float>().swap(xs);
+		std::vector<float>().swap(ys);
+	}
+}
+
+void StrokeDocument::addListener(StrokeListener* listener) {
+	listeners.push_back(listener);
+}
+
+void StrokeDocument::removeListener(StrokeListener* listener) {
+	listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
@@ -0,0 +1,195 @@
+#ifndef STROKE_DOCUMENT_H
+#define STROKE_DOCUMENT_H
+
+#include <cstdint>
+#include <vector>
+#include <imgui/imgui.h>
+
+typedef uint32_t StrokeId;
+const StrokeId INVALID_STROKE = 0;
+
+// Low bits of a stroke id that say which client made it, once a document is shared (see StrokeDocument::setClient)
+const uint32_t STROKE_CLIENT_BITS = 8;
+const StrokeId STROKE_CLIENT_MASK = (1u << STROKE_CLIENT_BITS) - 1;
+
+struct StrokeStyle {
+	ImU32 colour;
+	float thickness;
+};
+
+/**
+* How a stroke's points are read, freehand strokes are a polyline through them and shapes are a few control points
+* (see shapes.h)
+*/
+enum class StrokeShape : uint8_t {
+	Freehand,
+	Line,
+	Rectangle,
+	Ellipse,
+	Arrow
+};
+
+/**
+* Per-stroke header, the points themselves live in the document
+* A committed stroke's points are packed (see point_codec.h), first is where they start in the document's packed bytes
+* and grid is the one they were rounded to. The stroke being drawn keeps its points as floats in the document's point
+* arrays instead, from first.
+* min/max is the bounding box of the points, shapes are laid out so that the bounding box of their control points also
+* covers their outline
+*/
+struct Stroke {
+	StrokeId id;
+	StrokeStyle style;
+	ImVec2 min;
+	ImVec2 max;
+	uint32_t first;
+	uint32_t count;
+	StrokeShape shape;
+	uint8_t grid;
+};
+
+/**
+* A stroke's points packed the way the document keeps them, eg. for the history while the stroke is off the board
+*/
+struct PackedPoints {
+	std::vector<uint8_t> bytes;
+	uint32_t count = 0;
+	uint8_t grid = 0;
+};
+
+class StrokeDocument;
+
+/**
+* Gets told about changes to a document's committed strokes, the stroke being drawn is only reported once it ends
+* strokeRemoved is called before the points are gone so they can still be read
+*/
+class StrokeListener {
+public:
+	virtual ~StrokeListener() = default;
+	virtual void strokeAdded(const StrokeDocument& /*document*/, const Stroke& /*stroke*/) {}
+	virtual void strokeRemoved(const StrokeDocument& /*document*/, const Stroke& /*stroke*/) {}
+	virtual void strokeRestyled(const StrokeDocument& /*document*/, const Stroke& /*stroke*/) {}
+	virtual void documentCleared(const StrokeDocument& /*document*/) {}
+};
+
+/**
+* Holds all of the ink on the board
+* Committed strokes are packed as they are committed, each into its own run of bytes, which takes about a quarter of
+* the memory of floats. They are read back with readPoints / copyPoints, straight into whatever is about to use them.
+* Only the stroke being drawn, which changes every frame, is kept as floats (structure-of-arrays, xs / ys).
+* Strokes are kept sorted by id, which is also the order they get drawn in
+* Removed strokes leave their bytes behind until the next compaction
+*/
+class StrokeDocument {
+public:
+	StrokeDocument() = default;
+	// Copies only carry the strokes, listeners stay with the original
+	StrokeDocument(const StrokeDocument& other);
+	StrokeDocument& operator=(const StrokeDocument& other);
+
+	/**
+	* Starts a new stroke at the top of the board, points are then added with appendPoint until endStroke
+	*/
+	StrokeId beginStroke(StrokeStyle style);
+	void appendPoint(ImVec2 point);
+	void replaceLastPoint(ImVec2 point);
+	// Swaps out every point of the stroke being drawn, eg. for a simplified version or the shape it was recognised as
+	void replaceActivePoints(const ImVec2* points, uint32_t count, StrokeShape shape = StrokeShape::Freehand);
+	StrokeId endStroke();
+	bool isDrawing() const { return drawing; }
+	StrokeId activeStroke() const { return drawing ? strokeList.back().id : INVALID_STROKE; }
+
+	/**
+	* Adds an already finished stroke at the top of the board
+	*/
+	StrokeId addStroke(StrokeStyle style, const ImVec2* points, uint32_t count, StrokeShape shape = StrokeShape::Freehand);
+
+	/**
+	* Puts back a stroke with a known id (eg. from undo), it is drawn in its original place
+	* Returns false if a stroke with that id already exists, or while a stroke is being drawn, which has to stay the last
+	* one until it ends
+	*/
+	bool insertStroke(StrokeId id, StrokeStyle style, const ImVec2* points, uint32_t count, StrokeShape shape = StrokeShape::Freehand);
+	// Points that are already packed are copied in as they are
+	bool insertStroke(StrokeId id, StrokeStyle style, const PackedPoints& points, StrokeShape shape = StrokeShape::Freehand);
+
+	/**
+	* Removes a stroke, optionally keeping its points (packed) first
+	*/
+	bool removeStroke(StrokeId id, PackedPoints* removedPoints = nullptr);
+
+	bool setStyle(StrokeId id, StrokeStyle style);
+
+	const Stroke* find(StrokeId id) const;
+	const std::vector<Stroke>& strokes() const { return strokeList; }
+	// Index into strokes() of the first stroke with an id of at least the one given
+	size_t lowerIndex(StrokeId id) const;
+	void copyPoints(const Stroke& stroke, std::vector<ImVec2>& out) const;
+	/**
+	* A stroke's points as two arrays of position * scale + offset, eg. on the screen, unpacked straight into them
+	* The arrays only grow, so callers that keep them don't allocate once they are big enough
+	*/
+	void readPoints(const Stroke& stroke, std::vector<float>& outXs, std::vector<float>& outYs, float scale = 1.f, ImVec2 offset = { 0.f, 0.f }) const;
+	/**
+	* One point of a stroke, a committed one unpacks every point before it so this is for the first few or the odd last one
+	*/
+	ImVec2 pointOf(const Stroke& stroke, uint32_t index) const;
+	// Where a committed stroke's packed points start, packedSize (point_codec.h) gives how many bytes they take
+	const uint8_t* packedPointsOf(const Stroke& stroke) const { return packedPoints.data() + stroke.first; }
+	// The stroke being drawn's points, from its first
+	const float* pointsX() const { return xs.data(); }
+	const float* pointsY() const { return ys.data(); }
+
+	// Points belonging to strokes that are still on the board
+	size_t pointCount() const { return packedCount - garbage + xs.size(); }
+	size_t memoryUsage() const;
+	// Of the committed strokes' points, including the ones removed strokes left behind
+	size_t packedBytes() const { return packedPoints.size(); }
+
+	void clear();
+	void compact();
+	void reserve(size_t strokes, size_t points);
+	/**
+	* Compacts and hands back spare capacity, for a document that won't change for a while
+	*/
+	void shrink();
+
+	/**
+	* Makes the ids handed out from now on work as a Lamport clock for a board shared between clients
+	* Every new id is above any the document has seen, its own or inserted, and ends in the client's STROKE_CLIENT_BITS,
+	* so ids made by different clients never collide and every client puts (and draws) strokes in the same order
+	* Client 0 is the default, ids just count up
+	*/
+	void setClient(uint8_t client);
+	uint8_t clientId() const { return client; }
+	// Carries on the ids (and client) of a document this one replaces, eg. when a layer is cleared
+	void continueIds(const StrokeDocument& other);
+
+	void addListener(StrokeListener* listener);
+	void removeListener(StrokeListener* listener);
+
+private:
+	StrokeId takeId();
+	std::vector<Stroke>::iterator lowerBound(StrokeId id);
+	std::vector<Stroke>::const_iterator lowerBound(StrokeId id) const;
+	void packStroke(Stroke& stroke, const float* strokeXs, const float* strokeYs, uint32_t count);
+	void packStroke(Stroke& stroke, const ImVec2* points, uint32_t count);
+	void pushActive(Stroke& stroke, const ImVec2* points, uint32_t count);
+	void maybeCompact();
+	template<typename F> void notify(F&& call) const {
+		for (StrokeListener* listener : listeners) call(listener);
+	}
+
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<Stroke> strokeList;
+	StrokeId nextId = 1;
+	uint8_t client = 0;
+	size_t garbage = 0;  // points of removed strokes still in packedPoints
+	bool drawing = false;
+	std::vector<uint8_t> packedPoints;
+	size_t packedCount = 0;  // points in packedPoints
+	std::vector<StrokeListener*> listeners;
+};
+
+#endif // STROKE_DOCUMENT_H
@@ -0,0 +1,373 @@
+#include "stroke_tessellator.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <imgui/imgui_internal.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TESSELLATOR_SSE
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TESSELLATOR_NEON
+#endif
+
+// Points closer together than this are merged, a segment that short has no usable direction
+const float MIN_SEGMENT_LENGTH = 1e-3f;
+// Stops the miter blowing up when a stroke doubles back on itself
+const float MIN_MITER_DENOMINATOR = 1e-4f;
+
+struct StrokeGeometry {
+	float halfCore;  // half the fully opaque width
+	float fringe;  // anti-aliased edge outside of that
+	float stepAngle;  // largest angle one slice of a round join / cap can cover
+	int capSteps;
+	// Whole pixel widths can use ImGui's baked anti-aliased line texture, which needs half the vertices
+	bool textured;
+};
+
+static StrokeGeometry strokeGeometry(float thickness, const ImDrawList* drawList) {
+	StrokeGeometry geometry;
+	geometry.fringe = drawList->Flags & ImDrawListFlags_AntiAliasedLines ? drawList->_FringeScale : 0.f;
+	geometry.halfCore = std::max(thickness - geometry.fringe, 0.f) * 0.5f;
+
+	// Same conditions AddPolyline checks before using the texture
+	int width = (int) thickness;
+	geometry.textured = (drawList->Flags & ImDrawListFlags_AntiAliasedLinesUseTex) && geometry.fringe == 1.f
+		&& width >= 1 && width < IM_DRAWLIST_TEX_LINES_WIDTH_MAX && thickness - width <= 0.00001f;
+
+	// Same error bound ImGui uses to pick circle segment counts
+	float radius = std::max(geometry.halfCore + geometry.fringe * 0.5f, 0.5f);
+	float error = std::min(drawList->_Data->CircleSegmentMaxError, radius);
+	geometry.stepAngle = 2.f * std::acos(1.f - error / radius);
+	geometry.capSteps = std::max((int) std::ceil(IM_PI / geometry.stepAngle), 1);
+	return geometry;
+}
+
+int strokeVertexBound(uint32_t count, float thickness, const TessellationSettings&, const ImDrawList* drawList) {
+	// Every point is at worst a section of 4 plus a half circle, and the caps are no more than that either
+	return ((int) count + 3) * (4 + 2 * strokeGeometry(thickness, drawList).capSteps);
+}
+
+int strokeIndexBound(uint32_t count, float thickness, const TessellationSettings&, const ImDrawList* drawList) {
+	return ((int) count + 3) * (18 + 9 * strokeGeometry(thickness, drawList).capSteps);
+}
+
+uint32_t maxStrokePoints(float thickness, int maxVertices, const TessellationSettings&, const ImDrawList* drawList) {
+	int perPoint = 4 + 2 * strokeGeometry(thickness, drawList).capSteps;
+	return (uint32_t) std::max(maxVertices / perPoint - 3, 2);
+}
+
+/**
+* Unit left hand normals and lengths of the count - 1 segments between consecutive points
+*/
+static void segmentNormals(const float* xs, const float* ys, uint32_t segments, float* nx, float* ny, float* length) {
+	uint32_t i = 0;
+#if defined(TESSELLATOR_SSE)
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= segments; i += 4) {
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i + 1), _mm_loadu_ps(xs + i));
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i + 1), _mm_loadu_ps(ys + i));
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		__m128 inverse = _mm_div_ps(_mm_set1_ps(1.f), len);
+		_mm_storeu_ps(nx + i, _mm_sub_ps(zero, _mm_mul_ps(dy, inverse)));
+		_mm_storeu_ps(ny + i, _mm_mul_ps(dx, inverse));
+		_mm_storeu_ps(length + i, len);
+	}
+#elif defined(TESSELLATOR_NEON)
+	for (; i + 4 <= segments; i += 4) {
+		float32x4_t dx = vsubq_f32(vld1q_f32(xs + i + 1), vld1q_f32(xs + i));
+		float32x4_t dy = vsubq_f32(vld1q_f32(ys + i + 1), vld1q_f32(ys + i));
+		float32x4_t len = vsqrtq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy));
+		float32x4_t inverse = vdivq_f32(vdupq_n_f32(1.f), len);
+		vst1q_f32(nx + i, vnegq_f32(vmulq_f32(dy, inverse)));
+		vst1q_f32(ny + i, vmulq_f32(dx, inverse));
+		vst1q_f32(length + i, len);
+	}
+#endif
+	for (; i < segments; i++) {
+		float dx = xs[i + 1] - xs[i];
+		float dy = ys[i + 1] - ys[i];
+		float len = std::sqrt(dx * dx + dy * dy);
+		nx[i] = -dy / len;
+		ny[i] = dx / len;
+		length[i] = len;
+	}
+}
+
+/**
+* For the point between segment i and i + 1: the miter (n0 + n1) / (1 + n0.n1), which reaches the corner of the
+* offset lines when scaled by the half width, along with n0.n1 and n0 x n1 to tell how sharp the turn is and which way
+*/
+static void jointMiters(const float* nx, const float* ny, uint32_t joints, float* mx, float* my, float* dot, float* cross) {
+	uint32_t i = 0;
+#if defined(TESSELLATOR_SSE)
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 minimum = _mm_set1_ps(MIN_MITER_DENOMINATOR);
+	for (; i + 4 <= joints; i += 4) {
+		__m128 x0 = _mm_loadu_ps(nx + i);
+		__m128 y0 = _mm_loadu_ps(ny + i);
+		__m128 x1 = _mm_loadu_ps(nx + i + 1);
+		__m128 y1 = _mm_loadu_ps(ny + i + 1);
+		__m128 d = _mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1));
+		__m128 scale = _mm_div_ps(one, _mm_max_ps(_mm_add_ps(one, d), minimum));
+		_mm_storeu_ps(mx + i, _mm_mul_ps(_mm_add_ps(x0, x1), scale));
+		_mm_storeu_ps(my + i, _mm_mul_ps(_mm_add_ps(y0, y1), scale));
+		_mm_storeu_ps(dot + i, d);
+		_mm_storeu_ps(cross + i, _mm_sub_ps(_mm_mul_ps(x0, y1), _mm_mul_ps(y0, x1)));
+	}
+#elif defined(TESSELLATOR_NEON)
+	const float32x4_t one = vdupq_n_f32(1.f);
+	const float32x4_t minimum = vdupq_n_f32(MIN_MITER_DENOMINATOR);
+	for (; i + 4 <= joints; i += 4) {
+		float32x4_t x0 = vld1q_f32(nx + i);
+		float32x4_t y0 = vld1q_f32(ny + i);
+		float32x4_t x1 = vld1q_f32(nx + i + 1);
+		float32x4_t y1 = vld1q_f32(ny + i + 1);
+		float32x4_t d = vmlaq_f32(vmulq_f32(x0, x1), y0, y1);
+		float32x4_t scale = vdivq_f32(one, vmaxq_f32(vaddq_f32(one, d), minimum));
+		vst1q_f32(mx + i, vmulq_f32(vaddq_f32(x0, x1), scale));
+		vst1q_f32(my + i, vmulq_f32(vaddq_f32(y0, y1), scale));
+		vst1q_f32(dot + i, d);
+		vst1q_f32(cross + i, vmlsq_f32(vmulq_f32(x0, y1), y0, x1));
+	}
+#endif
+	for (; i < joints; i++) {
+		float d = nx[i] * nx[i + 1] + ny[i] * ny[i + 1];
+		float scale = 1.f / std::max(1.f + d, MIN_MITER_DENOMINATOR);
+		mx[i] = (nx[i] + nx[i + 1]) * scale;
+		my[i] = (ny[i] + ny[i + 1]) * scale;
+		dot[i] = d;
+		cross[i] = nx[i] * ny[i + 1] - ny[i] * nx[i + 1];
+	}
+}
+
+/**
+* Per thread working space so tessellating doesn't allocate once it has warmed up
+*/
+struct TessellationScratch {
+	std::vector<float> xs, ys;
+	std::vector<float> nx, ny, length;
+	std::vector<float> mx, my, dot, cross;
+};
+
+void tessellateStroke(ImDrawList* drawList, const float* xs, const float* ys, uint32_t count, StrokeStyle style, const TessellationSettings& settings) {
+	if (count == 0) return;
+
+	thread_local TessellationScratch scratch;
+	scratch.xs.clear();
+	scratch.ys.clear();
+	scratch.xs.push_back(xs[0]);
+	scratch.ys.push_back(ys[0]);
+	for (uint32_t i = 1; i < count; i++) {
+		float dx = xs[i] - scratch.xs.back();
+		float dy = ys[i] - scratch.ys.back();
+		if (dx * dx + dy * dy < MIN_SEGMENT_LENGTH * MIN_SEGMENT_LENGTH) continue;
+		scratch.xs.push_back(xs[i]);
+		scratch.ys.push_back(ys[i]);
+	}
+	const float* px = scratch.xs.data();
+	const float* py = scratch.ys.data();
+	uint32_t points = (uint32_t) scratch.xs.size();
+	uint32_t segments = points - 1;
+	uint32_t joints = points > 2 ? points - 2 : 0;
+
+	scratch.nx.resize(segments);
+	scratch.ny.resize(segments);
+	scratch.length.resize(segments);
+	segmentNormals(px, py, segments, scratch.nx.data(), scratch.ny.data(), scratch.length.data());
+	scratch.mx.resize(joints);
+	scratch.my.resize(joints);
+	scratch.dot.resize(joints);
+	scratch.cross.resize(joints);
+	jointMiters(scratch.nx.data(), scratch.ny.data(), joints, scratch.mx.data(), scratch.my.data(), scratch.dot.data(), scratch.cross.data());
+
+	StrokeGeometry geometry = strokeGeometry(style.thickness, drawList);
+	bool textured = geometry.textured;
+	float core = geometry.halfCore;
+	float outer = geometry.halfCore + geometry.fringe;
+	float stepCos = std::cos(geometry.stepAngle);
+	ImU32 colour = style.colour;
+	if (geometry.fringe > 0.f && style.thickness < geometry.fringe) {
+		// Too thin for a solid core, fade it instead
+		ImU32 alpha = (ImU32) (((colour >> IM_COL32_A_SHIFT) & 0xFF) * style.thickness / geometry.fringe);
+		colour = (colour & ~IM_COL32_A_MASK) | (alpha << IM_COL32_A_SHIFT);
+	}
+	ImU32 fringeColour = colour & ~IM_COL32_A_MASK;
+
+	// Textured strokes are a single pair of vertices across, with the fade coming from the texture
+	ImVec2 leftUv = drawList->_Data->TexUvWhitePixel;
+	ImVec2 rightUv = leftUv;
+	ImVec2 centreUv = leftUv;
+	if (textured) {
+		ImVec4 line = drawList->_Data->TexUvLines[(int) style.thickness];
+		leftUv = ImVec2(line.x, line.y);
+		rightUv = ImVec2(line.z, line.w);
+		centreUv = ImVec2((line.x + line.z) * 0.5f, (line.y + line.w) * 0.5f);
+		outer = style.thickness * 0.5f + 1.f;
+	}
+
+	int vertexBound = strokeVertexBound(count, style.thickness, settings, drawList);
+	int indexBound = strokeIndexBound(count, style.thickness, settings, drawList);
+	drawList->PrimReserve(indexBound, vertexBound);
+	ImDrawVert* vertexStart = drawList->_VtxWritePtr;
+	ImDrawIdx* indexStart = drawList->_IdxWritePtr;
+	ImDrawVert* vertexWrite = vertexStart;
+	ImDrawIdx* indexWrite = indexStart;
+	unsigned int nextIndex = drawList->_VtxCurrentIdx;
+
+	auto vertex = [&](float x, float y, ImU32 col, ImVec2 uv) {
+		vertexWrite->pos = ImVec2(x, y);
+		vertexWrite->uv = uv;
+		vertexWrite->col = col;
+		vertexWrite++;
+		return (ImDrawIdx) nextIndex++;
+	};
+	auto triangle = [&](ImDrawIdx a, ImDrawIdx b, ImDrawIdx c) {
+		indexWrite[0] = a;
+		indexWrite[1] = b;
+		indexWrite[2] = c;
+		indexWrite += 3;
+	};
+	auto quad = [&](ImDrawIdx a, ImDrawIdx b, ImDrawIdx c, ImDrawIdx d) {
+		triangle(a, b, c);
+		triangle(a, c, d);
+	};
+
+	// The edge of the stroke in direction (ux, uy) from (x, y), textured strokes only have the fringe vertex
+	struct Rim {
+		ImDrawIdx core, fringe;
+	};
+	auto rim = [&](float x, float y, float ux, float uy, ImVec2 uv) {
+		Rim r;
+		r.fringe = vertex(x + ux * outer, y + uy * outer, textured ? colour : fringeColour, uv);
+		r.core = textured ? r.fringe : vertex(x + ux * core, y + uy * core, colour, uv);
+		return r;
+	};
+	// A cut across the stroke
+	struct Section {
+		Rim left, right;
+	};
+	auto section = [&](float x, float y, float lx, float ly, float rx, float ry) {
+		return Section{ rim(x, y, lx, ly, leftUv), rim(x, y, rx, ry, rightUv) };
+	};
+	auto bridge = [&](const Section& a, const Section& b) {
+		quad(a.left.core, a.right.core, b.right.core, b.left.core);
+		if (textured) return;
+		quad(a.left.fringe, a.left.core, b.left.core, b.left.fringe);
+		quad(a.right.core, a.right.fringe, b.right.fringe, b.right.core);
+	};
+	// Fan around (x, y) starting at direction (ux, uy) and turning by angle (counter clockwise when positive)
+	auto arc = [&](ImDrawIdx centre, float x, float y, Rim from, float ux, float uy, Rim to, float angle, int steps, ImVec2 uv) {
+		float c = std::cos(angle / steps);
+		float s = std::sin(angle / steps);
+		Rim previous = from;
+		for (int k = 1; k <= steps; k++) {
+			Rim step = to;
+			if (k < steps) {
+				float rx = ux * c - uy * s;
+				uy = ux * s + uy * c;
+				ux = rx;
+				step = rim(x, y, ux, uy, uv);
+			}
+			triangle(centre, previous.core, step.core);
+			if (!textured) quad(previous.core, previous.fringe, step.fringe, step.core);
+			previous = step;
+		}
+	};
+	// Half circle from one side of a section round to the other
+	// With the texture the fan has to stay on one side's UVs, so it ends on a copy of the far vertex
+	auto cap = [&](float x, float y, const Rim& from, float ux, float uy, const Rim& to, ImVec2 uv) {
+		ImDrawIdx centre = vertex(x, y, colour, centreUv);
+		Rim end = to;
+		if (textured) end.core = end.fringe = vertex(x - ux * outer, y - uy * outer, colour, uv);
+		arc(centre, x, y, from, ux, uy, end, IM_PI, geometry.capSteps, uv);
+	};
+
+	if (points == 1) {
+		// A dot, two caps back to back
+		Section s = section(px[0], py[0], 0.f, 1.f, 0.f, -1.f);
+		cap(px[0], py[0], s.left, 0.f, 1.f, s.right, leftUv);
+		cap(px[0], py[0], s.right, 0.f, -1.f, s.left, rightUv);
+	}
+	else {
+		const float* nx = scratch.nx.data();
+		const float* ny = scratch.ny.data();
+		Section current = section(px[0], py[0], nx[0], ny[0], -nx[0], -ny[0]);
+		if (settings.roundCaps) cap(px[0], py[0], current.left, nx[0], ny[0], current.right, leftUv);
+
+		for (uint32_t j = 0; j < joints; j++) {
+			float x = px[j + 1];
+			float y = py[j + 1];
+			float mx = scratch.mx[j];
+			float my = scratch.my[j];
+			float dot = scratch.dot[j];
+			bool turnsLeft = scratch.cross[j] > 0.f;  // the left side is on the inside of the turn
+
+			// Past the length of the shorter segment the inner corner would fold back over the stroke
+			float miterSq = mx * mx + my * my;
+			float tangent = std::sqrt(std::max(miterSq - 1.f, 0.f)) * outer;
+			float shortest = std::min(scratch.length[j], scratch.length[j + 1]);
+			float inner = tangent > shortest ? shortest / tangent : 1.f;
+
+			bool sharp = settings.join == JoinStyle::Round ? dot < stepCos : miterSq > settings.miterLimit * settings.miterLimit;
+			if (!sharp) {
+				float left = turnsLeft ? inner : 1.f;
+				float right = turnsLeft ? 1.f : inner;
+				Section s = section(x, y, mx * left, my * left, -mx * right, -my * right);
+				bridge(current, s);
+				current = s;
+				continue;
+			}
+
+			// The inner corner is shared, the outer side gets a vertex for each segment with a fan between them
+			float n0x = nx[j], n0y = ny[j];
+			float n1x = nx[j + 1], n1y = ny[j + 1];
+			float angle = std::acos(std::clamp(dot, -1.f, 1.f));
+			int steps = settings.join == JoinStyle::Round ? std::max((int) std::ceil(angle / geometry.stepAngle), 1) : 1;
+
+			float side = turnsLeft ? inner : -inner;
+			Rim corner = rim(x, y, mx * side, my * side, turnsLeft ? leftUv : rightUv);
+			Section end;
+			Section start;
+			if (turnsLeft) {
+				end = { corner, rim(x, y, -n0x, -n0y, rightUv) };
+				start = { corner, rim(x, y, -n1x, -n1y, rightUv) };
+				bridge(current, end);
+				arc(corner.core, x, y, end.right, -n0x, -n0y, start.right, angle, steps, rightUv);
+			}
+			else {
+				end = { rim(x, y, n0x, n0y, leftUv), corner };
+				start = { rim(x, y, n1x, n1y, leftUv), corner };
+				bridge(current, end);
+				arc(corner.core, x, y, end.left, n0x, n0y, start.left, -angle, steps, leftUv);
+			}
+			current = start;
+		}
+
+		uint32_t last = points - 1;
+		float lx = nx[segments - 1];
+		float ly = ny[segments - 1];
+		Section end = section(px[last], py[last], lx, ly, -lx, -ly);
+		bridge(current, end);
+		if (settings.roundCaps) cap(px[last], py[last], end.right, -lx, -ly, end.left, rightUv);
+	}
+
+	int vertexCount = (int) (vertexWrite - vertexStart);
+	int indexCount = (int) (indexWrite - indexStart);
+	drawList->_VtxWritePtr = vertexWrite;
+	drawList->_IdxWritePtr = indexWrite;
+	drawList->_VtxCurrentIdx = nextIndex;
+	drawList->PrimUnreserve(indexBound - indexCount, vertexBound - vertexCount);
+}
+
+void drawStroke(ImDrawList* drawList, const float* xs, const float* ys, uint32_t count, StrokeStyle style, const TessellationSettings& settings) {
+	uint32_t run = maxStrokePoints(style.thickness, 65535, settings, drawList);
+	uint32_t first = 0;
+	while (true) {
+		uint32_t length = std::min(run, count - first);
+		tessellateStroke(drawList, xs + first, ys + first, length, style, settings);
+		if (first + length >= count) break;
+		first += length - 1;
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef STROKE_TESSELLATOR_H
+#define STROKE_TESSELLATOR_H
+
+#include <cstdint>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+
+enum class JoinStyle {
+	Round,
+	Miter
+};
+
+struct TessellationSettings {
+	JoinStyle join = JoinStyle::Round;
+	float miterLimit = 4.f;  // longest miter, as a multiple of half the thickness, before it is bevelled instead
+	bool roundCaps = true;
+};
+
+/**
+* Most vertices / indices tessellateStroke can emit for a stroke of count points
+*/
+int strokeVertexBound(uint32_t count, float thickness, const TessellationSettings& settings, const ImDrawList* drawList);
+int strokeIndexBound(uint32_t count, float thickness, const TessellationSettings& settings, const ImDrawList* drawList);
+/**
+* Most points a single tessellateStroke call can take and stay within maxVertices, at least 2
+*/
+uint32_t maxStrokePoints(float thickness, int maxVertices, const TessellationSettings& settings, const ImDrawList* drawList);
+
+/**
+* Writes the stroke into the draw list as one connected, anti-aliased mesh
+* Neighbouring segments share their vertices and are joined without gaps or overdraw, so translucent strokes blend
+* evenly along their whole length. Normals and miters are worked out four points at a time with SSE / NEON.
+* Whole pixel widths are two vertices across using ImGui's baked line texture for the anti-aliasing, like AddPolyline
+* The stroke has to fit in strokeVertexBound vertices of the list's current 16 bit index range
+*/
+void tessellateStroke(ImDrawList* drawList, const float* xs, const float* ys, uint32_t count, StrokeStyle style, const TessellationSettings& settings);
+/**
+* tessellateStroke for strokes of any length, long strokes are drawn as several runs that overlap by a point
+*/
+void drawStroke(ImDrawList* drawList, const float* xs, const float* ys, uint32_t count, StrokeStyle style, const TessellationSettings& settings);
+
+#endif // STROKE_TESSELLATOR_H
@@ -0,0 +1,714 @@
+#include "sync_session.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include "point_codec.h"
+
+// The host is always client 1, joining clients are numbered on from it
+const uint8_t HOST_CLIENT = 1;
+// Anything claiming a bigger batch than this is a broken stream
+const uint32_t MAX_BATCH_BYTES = 256 * 1024 * 1024;
+// Longest varint a uint32 takes
+const int MAX_VARINT_BYTES = 5;
+
+template<typename T> static void put(std::vector<uint8_t>& out, T value) {
+	size_t at = out.size();
+	out.resize(at + sizeof(T));
+	std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+namespace {
+	/**
+	* Reads ops another client sent, checking everything against the end of the batch
+	*/
+	class OpReader {
+	public:
+		OpReader(const uint8_t* at, const uint8_t* end) : at(at), end(end) {}
+
+		bool varint(uint32_t& value) {
+			value = 0;
+			for (int i = 0; i < MAX_VARINT_BYTES && at < end; i++) {
+				uint8_t byte = *at++;
+				value |= (uint32_t) (byte & 0x7F) << (7 * i);
+				if (!(byte & 0x80)) return true;
+			}
+			return false;
+		}
+
+		template<typename T> bool get(T& value) {
+			if ((size_t) (end - at) < sizeof(T)) return false;
+			std::memcpy(&value, at, sizeof(T));
+			at += sizeof(T);
+			return true;
+		}
+
+		bool style(StrokeStyle& style) {
+			return get(style.colour) && get(style.thickness) && std::isfinite(style.thickness) && style.thickness >= 0.f;
+		}
+
+		// Every varint is checked to be there before anything unpacks them, packed is left with their bytes
+		bool points(uint32_t count, PackedPoints& packed) {
+			if (!get(packed.grid) || packed.grid > MAX_PACKED_GRID || count > (size_t) (end - at) / 2) return false;
+			const uint8_t* start = at;
+			uint32_t ignored;
+			for (uint32_t i = 0; i < count * 2; i++) {
+				if (!varint(ignored)) return false;
+			}
+
+			packed.bytes.assign(start, at);
+			packed.count = count;
+			return true;
+		}
+
+		bool points(uint32_t count, PackedPoints& packed, std::vector<ImVec2>& out) {
+			if (!points(count, packed)) return false;
+
+			out.resize(count);
+			PointDecoder decoder(packed.bytes.data(), packed.grid);
+			for (ImVec2& point : out) point = decoder.next();
+			return true;
+		}
+
+		bool done() const { return at == end; }
+
+		const uint8_t* at;
+		const uint8_t* end;
+	};
+}
+
+bool SharedStrokes::add(StrokeDocument& document, StrokeId id, uint32_t stamp, StrokeStyle style, const PackedPoints& points, StrokeShape shape) {
+	Clock& clock = strokes[id];
+	if (stamp > clock.styled) {
+		clock.styled = stamp;
+		clock.style = style;
+	}
+	if (stamp <= clock.placed) return false;
+
+	clock.placed = stamp;
+	clock.present = true;
+	// Over whatever an older add left, eg. the whole stroke where a pixel eraser has since kept only a piece
+	document.removeStroke(id);
+	return document.insertStroke(id, clock.style, points, shape);
+}
+
+bool SharedStrokes::remove(StrokeDocument& document, StrokeId id, uint32_t stamp) {
+	Clock& clock = strokes[id];
+	if (stamp <= clock.placed) return false;
+
+	clock.placed = stamp;
+	clock.present = false;
+	return document.removeStroke(id);
+}
+
+bool SharedStrokes::restyle(StrokeDocument& document, StrokeId id, uint32_t stamp, StrokeStyle style) {
+	Clock& clock = strokes[id];
+	if (stamp <= clock.styled) return false;
+
+	clock.styled = stamp;
+	clock.style = style;
+	return document.setStyle(id, style);
+}
+
+void SharedStrokes::placed(StrokeId id, uint32_t stamp, bool present) {
+	Clock& clock = strokes[id];
+	clock.placed = stamp;
+	clock.present = present;
+}
+
+void SharedStrokes::styled(StrokeId id, uint32_t stamp, StrokeStyle style) {
+	Clock& clock = strokes[id];
+	clock.styled = stamp;
+	clock.style = style;
+}
+
+const SharedStrokes::Clock* SharedStrokes::find(StrokeId id) const {
+	auto clock = strokes.find(id);
+	return clock == strokes.end() ? nullptr : &clock->second;
+}
+
+SyncSession::SyncSession(LayerStack& layers) : layers(layers) {
+	layers.addListener(this);
+}
+
+SyncSession::~SyncSession() {
+	close();
+	layers.removeListener(this);
+}
+
+bool SyncSession::host(uint16_t port) {
+	close();
+	if (!listener.listen(port)) return false;
+
+	client = HOST_CLIENT;
+	nextClient = HOST_CLIENT + 1;
+	shareAll();
+	return true;
+}
+
+bool SyncSession::join(uint16_t port, double timeout) {
+	close();
+	Peer& host = peers.emplace_back();
+	if (!host.socket.connect(port, timeout)) {
+		peers.clear();
+		return false;
+	}
+	host.client = HOST_CLIENT;
+
+	snapshot.clear();
+	put(snapshot, SYNC_HELLO);
+	putVarint(snapshot, SYNC_VERSION);
+	sendBatch(host, snapshot);
+	counters.opsSent++;
+
+	// The host's layers come in the welcome, and its strokes right after it, update() takes it from there
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+	while (!peers[0].greeted) {
+		if (!receive(peers[0]) || std::chrono::steady_clock::now() >= deadline) {
+			close();
+			return false;
+		}
+		if (!peers[0].greeted) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+void SyncSession::close() {
+	unwatchAll();
+	shared.clear();
+	sharedStrokes.clear();
+	clock = 0;
+	listener.close();
+	peers.clear();
+	client = 0;
+	outgoing.clear();
+	deferred.clear();
+	erasedFrom.clear();
+	sendingId = INVALID_STROKE;
+	for (size_t i = live.size(); i-- > 0;) endLive(i);
+}
+
+size_t SyncSession::peerCount() const {
+	size_t count = 0;
+	for (const Peer& peer : peers) count += peer.greeted;
+	return count;
+}
+
+void SyncSession::watch(StrokeDocument& document, LayerId layer) {
+	if (!watched.emplace(&document, layer).second) return;
+	document.addListener(this);
+	document.setClient(client);
+}
+
+void SyncSession::unwatch(const StrokeDocument& document) {
+	auto entry = watched.find(&document);
+	if (entry == watched.end()) return;
+
+	// Only ever removing ourselves, the listener list doesn't change the document
+	const_cast<StrokeDocument&>(document).removeListener(this);
+	watched.erase(entry);
+}
+
+void SyncSession::shareAll() {
+	for (size_t i = 0; i < layers.size(); i++) {
+		shared.push_back(layers[i].id());
+		watch(layers[i].document(), layers[i].id());
+	}
+}
+
+void SyncSession::unwatchAll() {
+	while (!watched.empty()) unwatch(*watched.begin()->first);
+}
+
+bool SyncSession::isShared(LayerId layer) const {
+	return std::find(shared.begin(), shared.end(), layer) != shared.end();
+}
+
+bool SyncSession::update() {
+	changed = false;
+	if (!isConnected()) return false;
+
+	LocalSocket connection;
+	while (isHosting() && listener.accept(connection)) peers.emplace_back().socket = std::move(connection);
+
+	// Ops held back last frame came in before anything new
+	if (!deferred.empty()) {
+		retry.swap(deferred);
+		deferred.clear();
+		applyOps(nullptr, retry.data(), retry.data() + retry.size());
+		retry.clear();
+	}
+	for (size_t i = 0; i < peers.size();) {
+		if (receive(peers[i])) i++;
+		else dropPeer(i);
+	}
+
+	// Strokes erased by someone else leave cells behind in the dedup hash (see PointIngestor::rebuild)
+	for (LayerId id : erasedFrom) {
+		if (Layer* layer = layers.find(id)) {
+			LayerContents& ink = layer->unpacked();
+			ink.ingestor.rebuild(ink.document);
+		}
+	}
+	erasedFrom.clear();
+
+	sendLive();
+	if (!outgoing.empty()) {
+		for (Peer& peer : peers) {
+			if (peer.greeted) sendBatch(peer, outgoing);
+		}
+		outgoing.clear();
+	}
+	for (Peer& peer : peers) peer.socket.flush();
+	return changed;
+}
+
+void SyncSession::sendBatch(Peer& peer, const std::vector<uint8_t>& ops) {
+	frame.clear();
+	put(frame, (uint32_t) ops.size());
+	frame.insert(frame.end(), ops.begin(), ops.end());
+	peer.socket.send(frame.data(), frame.size());
+	counters.batchesSent++;
+	counters.bytesSent += frame.size();
+}
+
+/**
+* Sends whatever has been added to the stroke being drawn on a shared layer since last frame
+* Points are only ever added at the end or the last one replaced, so only the last one sent can have changed
+*/
+void SyncSession::sendLive() {
+	const Layer& layer = layers.active();
+	const StrokeDocument& document = layer.peek().document;
+	const Stroke* stroke = watched.count(&document) ? document.find(document.activeStroke()) : nullptr;
+	if (sendingId != INVALID_STROKE && (!stroke || stroke->id != sendingId)) {
+		if (!sendingAdded) {
+			put(outgoing, SYNC_LIVE_END);
+			putVarint(outgoing, sendingId);
+			counters.opsSent++;
+		}
+		sendingId = INVALID_STROKE;
+	}
+	if (!stroke || stroke->count == 0) return;
+
+	if (stroke->id != sendingId) {
+		sendingId = stroke->id;
+		sentPoints = 0;
+		sendingAdded = false;
+	}
+	ImVec2 last = document.pointOf(*stroke, stroke->count - 1);
+	if (stroke->count == sentPoints && last.x == lastSent.x && last.y == lastSent.y) return;
+
+	uint32_t first = std::min(sentPoints > 0 ? sentPoints - 1 : 0, stroke->count - 1);
+	put(outgoing, SYNC_LIVE);
+	putVarint(outgoing, layer.id());
+	putVarint(outgoing, stroke->id);
+	put(outgoing, stroke->style.colour);
+	put(outgoing, stroke->style.thickness);
+	putVarint(outgoing, first);
+	putVarint(outgoing, stroke->count - first);
+	const float* tailXs = document.pointsX() + first;
+	const float* tailYs = document.pointsY() + first;
+	uint8_t grid = packingGrid(tailXs, tailYs, stroke->count - first);
+	put(outgoing, grid);
+	packPoints(tailXs, tailYs, stroke->count - first, outgoing, grid);
+	counters.opsSent++;
+	sentPoints = stroke->count;
+	lastSent = last;
+}
+
+uint32_t SyncSession::nextStamp() {
+	clock++;
+	return (clock << STROKE_CLIENT_BITS) | client;
+}
+
+void SyncSession::observe(uint32_t stamp) {
+	clock = std::max(clock, stamp >> STROKE_CLIENT_BITS);
+}
+
+/**
+* Stamps a change made here and sends it, the stamps are kept even with nobody to send to for whoever joins later
+*/
+void SyncSession::sendAdd(LayerId layer, const StrokeDocument& document, const Stroke& stroke) {
+	uint32_t stamp = nextStamp();
+	SharedStrokes& strokes = sharedStrokes[layer];
+	strokes.placed(stroke.id, stamp, true);
+	strokes.styled(stroke.id, stamp, stroke.style);
+	if (!peers.empty()) writeAdd(outgoing, layer, document, stroke, stamp);
+}
+
+void SyncSession::sendRemove(LayerId layer, StrokeId id) {
+	uint32_t stamp = nextStamp();
+	sharedStrokes[layer].placed(id, stamp, false);
+	if (!peers.empty()) writeRemove(outgoing, layer, id, stamp);
+}
+
+void SyncSession::writeAdd(std::vector<uint8_t>& out, LayerId layer, const StrokeDocument& document, const Stroke& stroke, uint32_t stamp) {
+	put(out, SYNC_ADD);
+	putVarint(out, layer);
+	putVarint(out, stroke.id);
+	putVarint(out, stamp);
+	put(out, stroke.style.colour);
+	put(out, stroke.style.thickness);
+	put(out, (uint8_t) stroke.shape);
+	putVarint(out, stroke.count);
+	// Sent exactly as the document keeps them, so every client ends up with the same points
+	put(out, stroke.grid);
+	const uint8_t* packed = document.packedPointsOf(stroke);
+	out.insert(out.end(), packed, packed + packedSize(packed, stroke.count));
+	counters.opsSent++;
+}
+
+void SyncSession::writeRemove(std::vector<uint8_t>& out, LayerId layer, StrokeId id, uint32_t stamp) {
+	put(out, SYNC_REMOVE);
+	putVarint(out, layer);
+	putVarint(out, id);
+	putVarint(out, stamp);
+	counters.opsSent++;
+}
+
+void SyncSession::writeRestyle(std::vector<uint8_t>& out, LayerId layer, StrokeId id, uint32_t stamp, StrokeStyle style) {
+	put(out, SYNC_RESTYLE);
+	putVarint(out, layer);
+	putVarint(out, id);
+	putVarint(out, stamp);
+	put(out, style.colour);
+	put(out, style.thickness);
+	counters.opsSent++;
+}
+
+void SyncSession::writeWelcome(std::vector<uint8_t>& out, uint8_t joined) {
+	std::vector<LayerInfo> described;
+	layers.describe(described);
+
+	put(out, SYNC_WELCOME);
+	putVarint(out, SYNC_VERSION);
+	put(out, joined);
+	putVarint(out, (uint32_t) described.size());
+	for (const LayerInfo& layer : described) {
+		putVarint(out, layer.id);
+		put(out, (uint8_t) layer.visible);
+		putVarint(out, (uint32_t) layer.name.size());
+		out.insert(out.end(), layer.name.begin(), layer.name.end());
+	}
+	counters.opsSent++;
+}
+
+bool SyncSession::receive(Peer& peer) {
+	// A peer that has just gone may still have sent a last batch or two
+	bool open = peer.socket.receive(peer.inbox);
+
+	size_t at = 0;
+	while (peer.inbox.size() - at >= sizeof(uint32_t)) {
+		uint32_t size;
+		std::memcpy(&size, peer.inbox.data() + at, sizeof(size));
+		if (size > MAX_BATCH_BYTES) return false;
+		if (peer.inbox.size() - at - sizeof(uint32_t) < size) break;
+
+		const uint8_t* batch = peer.inbox.data() + at;
+		if (!applyBatch(peer, batch, batch + sizeof(uint32_t) + size)) return false;
+		at += sizeof(uint32_t) + size;
+	}
+	peer.inbox.erase(peer.inbox.begin(), peer.inbox.begin() + at);
+	return open;
+}
+
+bool SyncSession::applyBatch(Peer& peer, const uint8_t* at, const uint8_t* end) {
+	counters.batchesReceived++;
+	counters.bytesReceived += end - at;
+
+	// Passed on as it is, before anything in it is applied here, so everyone gets each client's ops in the same order
+	if (isHosting() && peer.greeted) {
+		for (Peer& other : peers) {
+			if (&other == &peer || !other.greeted) continue;
+			other.socket.send(at, end - at);
+			counters.batchesSent++;
+			counters.bytesSent += end - at;
+		}
+	}
+	return applyOps(&peer, at + sizeof(uint32_t), end);
+}
+
+/**
+* Ops on a layer whose document is in the middle of a stroke are held back until it is done, strokes from elsewhere
+* can't go in under the one being drawn
+* peer is null when applying ops that were held back, they have already been counted
+*/
+bool SyncSession::applyOps(Peer* peer, const uint8_t* at, const uint8_t* end) {
+	OpReader reader(at, end);
+	applying = true;
+	bool ok = true;
+	while (ok && !reader.done()) {
+		const uint8_t* start = reader.at;
+		uint8_t op = 0;
+		uint32_t layerId = INVALID_LAYER;
+		uint32_t id = INVALID_STROKE;
+		uint32_t count = 0;
+		StrokeStyle style{};
+		ok = reader.get(op);
+		if (peer) counters.opsReceived++;
+
+		switch (op) {
+		case SYNC_HELLO: {
+			uint32_t version;
+			ok = ok && peer && reader.varint(version) && hello(*peer, version);
+			break;
+		}
+		case SYNC_WELCOME: {
+			uint32_t version;
+			uint8_t joined;
+			std::vector<LayerInfo> saved;
+			ok = ok && peer && reader.varint(version) && version == SYNC_VERSION && reader.get(joined) && reader.varint(count);
+			for (uint32_t i = 0; ok && i < count; i++) {
+				LayerInfo& layer = saved.emplace_back();
+				uint8_t visible;
+				uint32_t length;
+				ok = reader.varint(layer.id) && layer.id != INVALID_LAYER && reader.get(visible) && reader.varint(length) && length <= (size_t) (reader.end - reader.at);
+				if (!ok) break;
+				layer.visible = visible != 0;
+				layer.name.assign((const char*) reader.at, length);
+				reader.at += length;
+			}
+			ok = ok && welcome(*peer, saved, joined);
+			break;
+		}
+		case SYNC_ADD:
+		case SYNC_REMOVE:
+		case SYNC_RESTYLE: {
+			uint8_t shape = 0;
+			uint32_t stamp = 0;
+			ok = ok && reader.varint(layerId) && reader.varint(id) && id != INVALID_STROKE && reader.varint(stamp);
+			if (op == SYNC_ADD) ok = ok && reader.style(style) && reader.get(shape) && shape <= (uint8_t) StrokeShape::Arrow && reader.varint(count) && reader.points(count, received);
+			if (op == SYNC_RESTYLE) ok = ok && reader.style(style);
+			if (!ok || !isShared(layerId)) break;
+
+			Layer* layer = layers.find(layerId);
+			if (!layer) break;
+			if (layer->peek().document.isDrawing()) {
+				deferred.insert(deferred.end(), start, reader.at);
+				break;
+			}
+
+			StrokeDocument& document = layer->unpacked().document;
+			SharedStrokes& strokes = sharedStrokes[layerId];
+			observe(stamp);
+			bool erased = false;
+			if (op == SYNC_ADD) {
+				bool replacing = document.find(id) != nullptr;
+				erased = strokes.add(document, id, stamp, style, received, (StrokeShape) shape) && replacing;
+				for (size_t i = live.size(); i-- > 0;) {
+					if (live[i].id == id) endLive(i);
+				}
+			}
+			else if (op == SYNC_REMOVE) erased = strokes.remove(document, id, stamp);
+			else strokes.restyle(document, id, stamp, style);
+			if (erased && std::find(erasedFrom.begin(), erasedFrom.end(), layerId) == erasedFrom.end()) erasedFrom.push_back(layerId);
+			changed = true;
+			break;
+		}
+		case SYNC_LIVE: {
+			uint32_t first;
+			ok = ok && reader.varint(layerId) && reader.varint(id) && reader.style(style) && reader.varint(first) && reader.varint(count) && reader.points(count, received, points);
+			if (!ok || !isShared(layerId)) break;
+
+			auto stroke = std::find_if(live.begin(), live.end(), [&](const LiveStroke& stroke) { return stroke.id == id; });
+			if (stroke == live.end()) stroke = live.insert(live.end(), { layerId, id, style, {}, { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } });
+			stroke->style = style;
+			// A client that joined part way through a stroke only has its end
+			stroke->points.resize(std::min<size_t>(first, stroke->points.size()));
+			stroke->drawnPoints = std::min(stroke->drawnPoints, (uint32_t) stroke->points.size());
+			for (ImVec2 point : points) {
+				stroke->points.push_back(point);
+				stroke->min = { std::min(stroke->min.x, point.x), std::min(stroke->min.y, point.y) };
+				stroke->max = { std::max(stroke->max.x, point.x), std::max(stroke->max.y, point.y) };
+			}
+			changed = true;
+			break;
+		}
+		case SYNC_LIVE_END:
+			ok = ok && reader.varint(id);
+			for (size_t i = 0; ok && i < live.size(); i++) {
+				if (live[i].id == id) endLive(i);
+			}
+			break;
+		default:
+			ok = false;
+		}
+	}
+	applying = false;
+	return ok;
+}
+
+bool SyncSession::hello(Peer& peer, uint32_t version) {
+	if (!isHosting() || peer.greeted || version != SYNC_VERSION || nextClient > STROKE_CLIENT_MASK) return false;
+
+	peer.client = nextClient++;
+	peer.greeted = true;
+
+	snapshot.clear();
+	writeWelcome(snapshot, peer.client);
+	for (LayerId id : shared) {
+		const Layer* layer = layers.find(id);
+		const StrokeDocument& document = layer->document();
+		SharedStrokes& strokes = sharedStrokes[id];
+		for (const Stroke& stroke : document.strokes()) {
+			if (stroke.id == document.activeStroke()) continue;
+
+			// Drawn before the board was shared, stamped now
+			const SharedStrokes::Clock* clock = strokes.find(stroke.id);
+			if (!clock) {
+				uint32_t stamp = nextStamp();
+				strokes.placed(stroke.id, stamp, true);
+				strokes.styled(stroke.id, stamp, stroke.style);
+				clock = strokes.find(stroke.id);
+			}
+			writeAdd(snapshot, id, document, stroke, clock->placed);
+			if (clock->styled > clock->placed) writeRestyle(snapshot, id, stroke.id, clock->styled, stroke.style);
+		}
+		// Removed ones too, so an add of one that is still on its way somewhere can't bring it back
+		for (const auto& [stroke, clock] : strokes.clocks()) {
+			if (!clock.present) writeRemove(snapshot, id, stroke, clock.placed);
+		}
+	}
+	// Ops held back here haven't reached the layers yet, they follow the strokes like they will here
+	snapshot.insert(snapshot.end(), deferred.begin(), deferred.end());
+	sendBatch(peer, snapshot);
+	return true;
+}
+
+bool SyncSession::welcome(Peer& peer, const std::vector<LayerInfo>& saved, uint8_t joined) {
+	if (isHosting() || peer.greeted || joined <= HOST_CLIENT || saved.empty()) return false;
+
+	unwatchAll();
+	shared.clear();
+	sharedStrokes.clear();
+	layers.restore(saved);
+	client = joined;
+	shareAll();
+	peer.greeted = true;
+	changed = true;
+	return true;
+}
+
+void SyncSession::dropPeer(size_t index) {
+	uint8_t left = peers[index].client;
+	peers.erase(peers.begin() + index);
+	if (!isHosting()) {
+		close();
+		return;
+	}
+
+	// Whatever it was in the middle of drawing won't be finished, anyone else showing it is told so
+	for (size_t i = live.size(); i-- > 0;) {
+		if ((live[i].id & STROKE_CLIENT_MASK) != left) continue;
+		put(outgoing, SYNC_LIVE_END);
+		putVarint(outgoing, live[i].id);
+		counters.opsSent++;
+		endLive(i);
+	}
+}
+
+void SyncSession::endLive(size_t index) {
+	LiveStroke& stroke = gone.emplace_back(std::move(live[index]));
+	stroke.points.clear();
+	live.erase(live.begin() + index);
+	changed = true;
+}
+
+void SyncSession::drawLive(ImDrawList* drawList, const Viewport& view, DamageTracker& damage, const TessellationSettings& tessellation) {
+	for (const LiveStroke& stroke : gone) {
+		float pad = damage.strokePadding(stroke.style.thickness * view.zoom);
+		ImVec2 min = view.toScreen(stroke.min);
+		ImVec2 max = view.toScreen(stroke.max);
+		damage.add({ min.x - pad, min.y - pad }, { max.x + pad, max.y + pad });
+	}
+	gone.clear();
+
+	for (LiveStroke& stroke : live) {
+		const Layer* layer = layers.find(stroke.layer);
+		if (!layer || !layer->isVisible() || stroke.points.empty()) continue;
+
+		uint32_t count = (uint32_t) stroke.points.size();
+		xs.resize(count);
+		ys.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			ImVec2 point = view.toScreen(stroke.points[i]);
+			xs[i] = point.x;
+			ys[i] = point.y;
+		}
+		StrokeStyle style = stroke.style;
+		style.thickness *= view.zoom;
+		drawStroke(drawList, xs.data(), ys.data(), count, style, tessellation);
+
+		// Like the stroke being drawn here, only what follows the last two points drawn last frame can have changed
+		ImVec2 min{ FLT_MAX, FLT_MAX }, max{ -FLT_MAX, -FLT_MAX };
+		uint32_t tail = std::min(stroke.drawnPoints, count);
+		for (uint32_t i = tail > 2 ? tail - 2 : 0; i < count; i++) {
+			min = { std::min(min.x, xs[i]), std::min(min.y, ys[i]) };
+			max = { std::max(max.x, xs[i]), std::max(max.y, ys[i]) };
+		}
+		float pad = damage.strokePadding(style.thickness);
+		damage.addOverlay({ min.x - pad, min.y - pad }, { max.x + pad, max.y + pad });
+		stroke.drawnPoints = count;
+	}
+}
+
+void SyncSession::layerRemoved(Layer& layer) {
+	unwatch(layer.document());
+	std::erase(shared, layer.id());
+	sharedStrokes.erase(layer.id());
+}
+
+/**
+* Sends the difference between the documents, so a clear goes out as a remove for every stroke it took away and
+* undoing it as an add for every one it put back
+*/
+void SyncSession::layerSwapped(Layer& layer, const StrokeDocument& previous) {
+	unwatch(previous);
+	if (!isShared(layer.id())) return;
+
+	StrokeDocument& next = layer.document();
+	watch(next, layer.id());
+
+	// Both are sorted by id
+	const std::vector<Stroke>& before = previous.strokes();
+	const std::vector<Stroke>& after = next.strokes();
+	size_t i = 0;
+	size_t j = 0;
+	while (i < before.size() || j < after.size()) {
+		if (j == after.size() || (i < before.size() && before[i].id < after[j].id)) sendRemove(layer.id(), before[i++].id);
+		else if (i == before.size() || after[j].id < before[i].id) {
+			if (after[j].id != next.activeStroke()) sendAdd(layer.id(), next, after[j]);
+			j++;
+		}
+		else {
+			i++;
+			j++;
+		}
+	}
+}
+
+void SyncSession::strokeAdded(const StrokeDocument& document, const Stroke& stroke) {
+	auto layer = watched.find(&document);
+	if (applying || layer == watched.end()) return;
+
+	sendAdd(layer->second, document, stroke);
+	if (stroke.id == sendingId) sendingAdded = true;
+}
+
+void SyncSession::strokeRemoved(const StrokeDocument& document, const Stroke& stroke) {
+	auto layer = watched.find(&document);
+	if (applying || layer == watched.end()) return;
+
+	sendRemove(layer->second, stroke.id);
+}
+
+void SyncSession::strokeRestyled(const StrokeDocument& document, const Stroke& stroke) {
+	auto layer = watched.find(&document);
+	if (applying || layer == watched.end()) return;
+
+	uint32_t stamp = nextStamp();
+	sharedStrokes[layer->second].styled(stroke.id, stamp, stroke.style);
+	if (!peers.empty()) writeRestyle(outgoing, layer->second, stroke.id, stamp, stroke.style);
+}
@@ -0,0 +1,223 @@
+#ifndef SYNC_SESSION_H
+#define SYNC_SESSION_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <imgui/imgui.h>
+#include "layers.h"
+#include "local_socket.h"
+#include "viewport.h"
+#include "damage.h"
+#include "stroke_tessellator.h"
+
+const uint16_t DEFAULT_SYNC_PORT = 47613;
+
+/**
+* Sync stream layout (little endian)
+* A run of batches, each a uint32 byte count and then that many bytes of ops, a client sends at most one a frame
+* Every op starts with its SyncOp byte. Layer and stroke ids, counts and versions are varints (see point_codec.h),
+* colours are uint32s, thicknesses floats, and points are the grid (uint8) they were packed on and then packPoints' bytes
+* Stamps are varints too, see SharedStrokes
+* SYNC_HELLO     version                                                    joining client to host, before anything else
+* SYNC_WELCOME   version, client (uint8), layer count, then per layer its id, visible (uint8), name byte count and bytes
+* SYNC_ADD       layer, stroke, stamp, colour, thickness, shape (uint8), point count, points
+* SYNC_REMOVE    layer, stroke, stamp
+* SYNC_RESTYLE   layer, stroke, stamp, colour, thickness
+* SYNC_LIVE      layer, stroke, colour, thickness, first, point count, points    a stroke still being drawn, from first on
+* SYNC_LIVE_END  stroke                                                     it went away without being added
+*/
+const uint32_t SYNC_VERSION = 3;
+
+enum SyncOp : uint8_t {
+	SYNC_HELLO = 1,
+	SYNC_WELCOME = 2,
+	SYNC_ADD = 3,
+	SYNC_REMOVE = 4,
+	SYNC_RESTYLE = 5,
+	SYNC_LIVE = 6,
+	SYNC_LIVE_END = 7
+};
+
+struct SyncStats {
+	size_t opsSent = 0;
+	size_t opsReceived = 0;
+	size_t batchesSent = 0;
+	size_t batchesReceived = 0;
+	size_t bytesSent = 0;
+	size_t bytesReceived = 0;
+};
+
+/**
+* A stroke another client is still drawing, on the board
+*/
+struct LiveStroke {
+	LayerId layer;
+	StrokeId id;
+	StrokeStyle style;
+	std::vector<ImVec2> points;
+	ImVec2 min;
+	ImVec2 max;
+	uint32_t drawnPoints = 0;  // how many had been drawn by the last frame
+};
+
+/**
+* What each stroke of a shared layer was last placed (added or removed) and styled by, so ops on it can be applied in
+* whatever order they arrive and every client still ends up with the same board
+* Every op carries a stamp from its client's Lamport clock, with the client in the low STROKE_CLIENT_BITS like stroke
+* ids, and only the newest placing op and the newest style count. A stroke removed and put back under the same id (by
+* undo, or the pixel eraser keeping the first piece of what it cut) ends up with the points of its newest add on every
+* client whichever op came first, and one that was removed keeps its stamps so an older add never brings it back.
+*/
+class SharedStrokes {
+public:
+	struct Clock {
+		uint32_t placed = 0;
+		uint32_t styled = 0;
+		StrokeStyle style{};
+		bool present = false;
+	};
+
+	// Ops from another client, each only changes the document if it is newer than what it would replace
+	bool add(StrokeDocument& document, StrokeId id, uint32_t stamp, StrokeStyle style, const PackedPoints& points, StrokeShape shape);
+	bool remove(StrokeDocument& document, StrokeId id, uint32_t stamp);
+	bool restyle(StrokeDocument& document, StrokeId id, uint32_t stamp, StrokeStyle style);
+
+	// Changes made on this client, already on the document
+	void placed(StrokeId id, uint32_t stamp, bool present);
+	void styled(StrokeId id, uint32_t stamp, StrokeStyle style);
+
+	const Clock* find(StrokeId id) const;
+	const std::unordered_map<StrokeId, Clock>& clocks() const { return strokes; }
+
+private:
+	std::unordered_map<StrokeId, Clock> strokes;
+};
+
+/**
+* Shares the board's layers with other instances on the same machine
+* One instance hosts and the others join it over a loopback socket, the host passes every batch it gets on to everyone
+* else. Committed strokes, erasing (removes) and restyles go out as ops once a frame, along with the newest points of
+* the stroke being drawn so the others can show it as it happens.
+* Stroke ids are a Lamport clock with the client in their low bits (see StrokeDocument::setClient), so every client
+* agrees on the order strokes are drawn in, and ops are stamped from another one so they can be applied in whatever
+* order they cross (see SharedStrokes).
+* Joining replaces every layer with the host's. Only the strokes on the layers there were at that point are shared after
+* that, adding, removing, renaming, hiding or reordering a layer stays on the client that did it.
+* Committed strokes are sent as the document packed them, so every client has exactly the same points.
+*/
+class SyncSession : public LayerListener, public StrokeListener {
+public:
+	explicit SyncSession(LayerStack& layers);
+	~SyncSession();
+	SyncSession(const SyncSession&) = delete;
+	SyncSession& operator=(const SyncSession&) = delete;
+
+	/**
+	* Shares this board with whoever joins on 127.0.0.1:port
+	*/
+	bool host(uint16_t port = DEFAULT_SYNC_PORT);
+	/**
+	* Connects to a host and waits up to timeout seconds to be let in, then replaces every layer with the host's
+	* Nothing else may be keeping the layers (eg. a LayeredSession), they are all swapped out from under it
+	*/
+	bool join(uint16_t port = DEFAULT_SYNC_PORT, double timeout = 5.0);
+	void close();
+
+	bool isHosting() const { return listener.isOpen(); }
+	bool isConnected() const { return isHosting() || !peers.empty(); }
+	uint8_t clientId() const { return client; }
+	// Clients joined to this host, or 1 for the host this client joined
+	size_t peerCount() const;
+
+	/**
+	* Call once a frame, applies everything that came in and sends this frame's changes as one batch
+	* Returns true if anything from another client changed the board or the strokes being drawn on it
+	*/
+	bool update();
+	/**
+	* Draws the strokes other clients are in the middle of over the board, damaging what they cover
+	*/
+	void drawLive(ImDrawList* drawList, const Viewport& view, DamageTracker& damage, const TessellationSettings& tessellation);
+	bool hasLiveStrokes() const { return !live.empty(); }
+	const SyncStats& stats() const { return counters; }
+
+	void layerRemoved(Layer& layer) override;
+	void layerSwapped(Layer& layer, const StrokeDocument& previous) override;
+
+	void strokeAdded(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRemoved(const StrokeDocument& document, const Stroke& stroke) override;
+	void strokeRestyled(const StrokeDocument& document, const Stroke& stroke) override;
+
+private:
+	struct Peer {
+		LocalSocket socket;
+		std::vector<uint8_t> inbox;
+		uint8_t client = 0;
+		bool greeted = false;  // past SYNC_HELLO / SYNC_WELCOME, ops flow both ways
+	};
+
+	void watch(StrokeDocument& document, LayerId layer);
+	void unwatch(const StrokeDocument& document);
+	void shareAll();
+	void unwatchAll();
+	bool isShared(LayerId layer) const;
+
+	uint32_t nextStamp();
+	void observe(uint32_t stamp);
+	void sendAdd(LayerId layer, const StrokeDocument& document, const Stroke& stroke);
+	void sendRemove(LayerId layer, StrokeId id);
+	void writeAdd(std::vector<uint8_t>& out, LayerId layer, const StrokeDocument& document, const Stroke& stroke, uint32_t stamp);
+	void writeRemove(std::vector<uint8_t>& out, LayerId layer, StrokeId id, uint32_t stamp);
+	void writeRestyle(std::vector<uint8_t>& out, LayerId layer, StrokeId id, uint32_t stamp, StrokeStyle style);
+	void writeWelcome(std::vector<uint8_t>& out, uint8_t joined);
+	void sendBatch(Peer& peer, const std::vector<uint8_t>& ops);
+	void sendLive();
+
+	// These return false once the peer has to go, because it left or sent something malformed
+	bool receive(Peer& peer);
+	bool applyBatch(Peer& peer, const uint8_t* at, const uint8_t* end);
+	bool applyOps(Peer* peer, const uint8_t* at, const uint8_t* end);
+	bool hello(Peer& peer, uint32_t version);
+	bool welcome(Peer& peer, const std::vector<LayerInfo>& saved, uint8_t joined);
+	void dropPeer(size_t index);
+	void endLive(size_t index);
+
+	LayerStack& layers;
+	LocalSocket listener;
+	std::vector<Peer> peers;
+	uint8_t client = 0;
+	uint8_t nextClient = 0;
+	std::vector<LayerId> shared;
+	std::unordered_map<const StrokeDocument*, LayerId> watched;
+	std::unordered_map<LayerId, SharedStrokes> sharedStrokes;
+	uint32_t clock = 0;  // Lamport time of the last op made or seen here, stamps are it shifted over the client
+	bool applying = false;
+	bool changed = false;
+
+	// This frame's ops, and ops held back for a layer that is being drawn on (they can't go under the stroke being drawn)
+	std::vector<uint8_t> outgoing;
+	std::vector<uint8_t> deferred;
+	std::vector<uint8_t> retry;
+	std::vector<LayerId> erasedFrom;
+
+	// The stroke being drawn here, as far as it has been sent
+	StrokeId sendingId = INVALID_STROKE;
+	uint32_t sentPoints = 0;
+	ImVec2 lastSent{ 0.f, 0.f };
+	bool sendingAdded = false;
+
+	// Strokes being drawn elsewhere, and ones that have gone (damaged where they were the next time strokes are drawn)
+	std::vector<LiveStroke> live;
+	std::vector<LiveStroke> gone;
+
+	SyncStats counters;
+	std::vector<ImVec2> points;
+	PackedPoints received;
+	std::vector<uint8_t> frame;
+	std::vector<uint8_t> snapshot;
+	std::vector<float> xs;
+	std::vector<float> ys;
+};
+
+#endif // SYNC_SESSION_H
@@ -0,0 +1,67 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+
+	for (unsigned i = 1; i < threads; i++) {
+		workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+	if (count == 0) return;
+	if (workers.empty() || count == 1) {
+		for (size_t i = 0; i < count; i++) task(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		this->count = count;
+		next = 0;
+		pending = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	runTasks();
+
+	// Every worker has to check in, otherwise a slow one could pick up this task after it has gone out of scope
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this]() { return pending == 0; });
+	this->task = nullptr;
+}
+
+void ThreadPool::runTasks() {
+	for (size_t i = next++; i < count; i = next++) {
+		(*task)(i);
+	}
+}
+
+void ThreadPool::work() {
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+
+		runTasks();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--pending == 0) finished.notify_one();
+	}
+}
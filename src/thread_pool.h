@@ -0,0 +1,48 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* Fixed set of worker threads for splitting a loop across cores
+* The calling thread works on the loop too, so a pool of one thread runs everything inline
+*/
+class ThreadPool {
+public:
+	// threads = 0 uses one thread per core
+	explicit ThreadPool(unsigned threads = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	* Runs task(0) ... task(count - 1) across the pool and returns once every call has finished
+	* Indices are handed out one at a time, so uneven work balances itself
+	*/
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+	unsigned size() const { return (unsigned) workers.size() + 1; }
+
+private:
+	void work();
+	void runTasks();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	const std::function<void(size_t)>* task = nullptr;
+	size_t count = 0;
+	std::atomic<size_t> next{ 0 };
+	uint64_t generation = 0;
+	size_t pending = 0;  // workers yet to finish the current generation
+	bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,27 @@
+#include "viewport.h"
+#include <algorithm>
+
+bool Viewport::isVisible(ImVec2 min, ImVec2 max) const {
+	ImVec2 visibleMax = boardMax();
+	return max.x >= origin.x && max.y >= origin.y && min.x <= visibleMax.x && min.y <= visibleMax.y;
+}
+
+void Viewport::pan(ImVec2 screenDelta) {
+	origin.x -= screenDelta.x / zoom;
+	origin.y -= screenDelta.y / zoom;
+}
+
+void Viewport::zoomAt(ImVec2 screen, float factor) {
+	ImVec2 anchor = toBoard(screen);
+	zoom = std::clamp(zoom * factor, MIN_ZOOM, MAX_ZOOM);
+	origin = { anchor.x - screen.x / zoom, anchor.y - screen.y / zoom };
+}
+
+void Viewport::reset() {
+	origin = { 0.f, 0.f };
+	zoom = 1.f;
+}
+
+bool Viewport::operator==(const Viewport& other) const {
+	return origin.x == other.origin.x && origin.y == other.origin.y && zoom == other.zoom && size.x == other.size.x && size.y == other.size.y;
+}
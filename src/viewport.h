@@ -0,0 +1,38 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include <imgui/imgui.h>
+
+const float MIN_ZOOM = 1.f / 64.f;
+const float MAX_ZOOM = 64.f;
+
+/**
+* Which part of the board is on screen
+* The board is unbounded, strokes are stored in board coordinates and the viewport maps them to screen pixels
+*/
+class Viewport {
+public:
+	ImVec2 toScreen(ImVec2 board) const { return { (board.x - origin.x) * zoom, (board.y - origin.y) * zoom }; }
+	ImVec2 toBoard(ImVec2 screen) const { return { origin.x + screen.x / zoom, origin.y + screen.y / zoom }; }
+
+	// The visible part of the board
+	ImVec2 boardMin() const { return origin; }
+	ImVec2 boardMax() const { return toBoard(size); }
+	bool isVisible(ImVec2 min, ImVec2 max) const;
+
+	void pan(ImVec2 screenDelta);
+	/**
+	* Zooms by factor, keeping the board under the screen point where it is
+	*/
+	void zoomAt(ImVec2 screen, float factor);
+	void reset();
+
+	bool operator==(const Viewport& other) const;
+	bool operator!=(const Viewport& other) const { return !(*this == other); }
+
+	ImVec2 origin{ 0.f, 0.f };  // board position of the screen's top left corner
+	float zoom = 1.f;  // screen pixels per board unit
+	ImVec2 size{ 0.f, 0.f };  // screen size in pixels
+};
+
+#endif // VIEWPORT_H
@@ -0,0 +1,274 @@
+#include "whiteboard.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include "profiler.h"
+#include "stroke_tessellator.h"
+
+DrawingSettings toSettings(const float colour[4], float thickness) {
+	DrawingSettings settings{};
+	std::copy(colour, colour + 4, settings.colour);
+	settings.thickness = thickness;
+	return settings;
+}
+
+StrokeStyle toStyle(const float colour[4], float thickness) {
+	return { ImGui::ColorConvertFloat4ToU32({ colour[0], colour[1], colour[2], colour[3] }), thickness };
+}
+
+Whiteboard::Whiteboard() : layers(damage, toSettings(DEFAULT_DRAWING_COLOUR, DEFAULT_DRAWING_THICKNESS)) {}
+
+void Whiteboard::documentLoaded() {
+	for (size_t i = 0; i < layers.size(); i++) {
+		LayerContents& ink = layers[i].contents();
+		ink.ingestor.rebuild(ink.document);
+	}
+}
+
+void Whiteboard::setTessellation(const TessellationSettings& settings) {
+	layers.setTessellation(settings);
+	damage.setJoinReach(settings.join == JoinStyle::Miter ? settings.miterLimit : 1.f);
+	damage.addAll();
+}
+
+size_t Whiteboard::memoryUsage() const {
+	return layers.memoryUsage();
+}
+
+/**
+* Undo / redo put back the colour and thickness that were in use at that point
+*/
+void Whiteboard::loadSettings() {
+	const DrawingSettings& unloading = layers.active().peek().history.settings();
+	std::memcpy(drawingColour, unloading.colour, sizeof(drawingColour));
+	drawingThickness = unloading.thickness;
+}
+
+void Whiteboard::update(const FrameInput& input) {
+	layers.update(input.time);
+	if (input.cycleTool && !isBusy()) tool = tool == Tool::Pen ? Tool::StrokeEraser : tool == Tool::StrokeEraser ? Tool::PixelEraser : Tool::Pen;
+	if (input.uiCaptured) {
+		panning = false;
+		return;
+	}
+	PROFILE_SCOPE("Tools");
+
+	updateView(input);
+	if (!layers.active().isVisible() && !isBusy()) return;
+
+	LayerContents& ink = layers.active().contents();
+	ImVec2 mouse = view.toBoard(input.mouse);
+
+	if (panning) {
+		// Nothing else happens until the pan is over
+	}
+	else if (input.leftDown && !drawingStraightLine && !drawingLine && tool != Tool::Pen) {
+		updateEraser(input);
+	}
+	else if (erasing) {
+		erasing = false;
+		PROFILE_SCOPE("Commit");
+
+		HistoryEntry entry;
+		if (ink.eraser.end(entry)) {
+			entry.settings = toSettings(drawingColour, drawingThickness);
+			layers.commit(std::move(entry));
+			ink.ingestor.rebuild(ink.document);
+		}
+	}
+	else if (input.leftDown && !drawingStraightLine) {
+		updatePen(input);
+	}
+	else if (drawingLine) {
+		finishStroke();
+	}
+	else if (input.redoClicked && !drawingStraightLine) {
+		PROFILE_SCOPE("Undo / Redo");
+		layers.redo();
+		loadSettings();
+	}
+	else if (input.undoClicked && !drawingStraightLine) {
+		PROFILE_SCOPE("Undo / Redo");
+		layers.undo();
+		loadSettings();
+	}
+	else if (input.rightDown) {
+		if (!drawingStraightLine) {
+			drawingStraightLine = true;
+			lineStart = ink.snapper.snapPoint(mouse, snapSettings, view.zoom);
+		}
+		lineEnd = ink.snapper.snapEnd(lineStart, mouse, input.snapHeld, snapSettings, view.zoom);
+	}
+	else if (drawingStraightLine) {
+		drawingStraightLine = false;
+		PROFILE_SCOPE("Commit");
+		ImVec2 line[2] = { lineStart, ink.snapper.snapEnd(lineStart, mouse, input.snapHeld, snapSettings, view.zoom) };
+		HistoryEntry entry;
+		entry.added.push_back(ink.document.addStroke(toStyle(drawingColour, drawingThickness / view.zoom), line, 2));
+		entry.settings = toSettings(drawingColour, drawingThickness);
+		layers.commit(std::move(entry));
+	}
+}
+
+/**
+* Middle drag pans, the wheel zooms around the mouse
+*/
+void Whiteboard::updateView(const FrameInput& input) {
+	if (input.resetView) view.reset();
+	if (input.wheel != 0.f) view.zoomAt(input.mouse, std::pow(ZOOM_STEP, input.wheel));
+
+	if (input.middleDown && !drawingLine && !erasing && !drawingStraightLine) {
+		if (panning) view.pan({ input.mouse.x - panLast.x, input.mouse.y - panLast.y });
+		panning = true;
+		panLast = input.mouse;
+	}
+	else panning = false;
+
+	damage.setView(view);
+}
+
+void Whiteboard::updateEraser(const FrameInput& input) {
+	Eraser& eraser = layers.active().contents().eraser;
+	ImVec2 mouse = view.toBoard(input.mouse);
+	if (!erasing) {
+		erasing = true;
+		eraser.begin(mouse);
+	}
+
+	eraser.moveTo(mouse, eraserRadius / view.zoom, tool == Tool::StrokeEraser ? EraserMode::Stroke : EraserMode::Pixel);
+}
+
+void Whiteboard::updatePen(const FrameInput& input) {
+	LayerContents& ink = layers.active().contents();
+	auto addPoint = [&](ImVec2 point, double time) {
+		if (!ink.ingestor.accept(point, time)) return;
+
+		rawPoints++;
+		if (simplifySettings.streaming && streamer.push(point, simplifySettings.tolerance / view.zoom) == StreamAction::ReplaceLast) ink.document.replaceLastPoint(point);
+		else ink.document.appendPoint(point);
+	};
+
+	size_t pressed = 0;
+	for (size_t i = 0; i < input.sampleCount; i++) {
+		if (input.samples[i].buttons & POINTER_LEFT) pressed++;
+	}
+
+	if (!drawingLine) {
+		drawingLine = true;
+		ink.document.beginStroke(toStyle(drawingColour, drawingThickness / view.zoom));
+		ink.ingestor.begin();
+		streamer.begin();
+		drawnPoints = 0;
+		activeMin = { FLT_MAX, FLT_MAX };
+		activeMax = { -FLT_MAX, -FLT_MAX };
+		// The pointer might not have moved since the press
+		if (pressed == 0) addPoint(view.toBoard(input.mouse), input.time);
+	}
+
+	// Every sample since the last frame, not just where the pointer is now
+	for (size_t i = 0; i < input.sampleCount; i++) {
+		if (input.samples[i].buttons & POINTER_LEFT) addPoint(view.toBoard({ input.samples[i].x, input.samples[i].y }), input.samples[i].time);
+	}
+}
+
+void Whiteboard::finishStroke() {
+	drawingLine = false;
+	PROFILE_SCOPE("Commit");
+	// Simplifying or recognising a shape reshapes the whole stroke, not just its end
+	damage.add(activeMin, activeMax);
+
+	LayerContents& ink = layers.active().contents();
+	StrokeDocument& document = ink.document;
+	if (const Stroke* stroke = document.find(document.activeStroke())) {
+		document.copyPoints(*stroke, strokePoints);
+		RecognisedShape shape;
+		if (shapeSettings.recognise && recogniseShape(strokePoints, shapeSettings.tolerance / view.zoom, shape)) {
+			if (shape.shape == StrokeShape::Line) {
+				for (uint32_t i = 0; i < 2; i++) shape.points[i] = ink.snapper.snapPoint(shape.points[i], snapSettings, view.zoom);
+			}
+			document.replaceActivePoints(shape.points, shape.count, shape.shape);
+			keptPoints += shape.count;
+			recognisedShapes++;
+		}
+		else {
+			SimplifySettings settings = simplifySettings;
+			settings.tolerance /= view.zoom;
+			settings.smoothTolerance /= view.zoom;
+			processStroke(strokePoints, settings, processedPoints);
+			document.replaceActivePoints(processedPoints.data(), (uint32_t) processedPoints.size());
+			keptPoints += processedPoints.size();
+		}
+	}
+
+	HistoryEntry entry;
+	entry.added.push_back(document.endStroke());
+	entry.settings = toSettings(drawingColour, drawingThickness);
+	layers.commit(std::move(entry));
+}
+
+void Whiteboard::draw(ImDrawList* drawList, const FrameInput& input) {
+	damage.setView(view);
+	{
+		PROFILE_SCOPE("Cache Sync");
+		for (size_t i = 0; i < layers.size(); i++) {
+			if (!layers[i].isVisible()) continue;
+
+			LodCache& cache = layers[i].unpacked().cache;
+			cache.sync(view);
+			// A layer that was packed away comes back a bake budget at a time, nothing else damages what gets added
+			if (cache.isRefilling()) damage.addAll();
+		}
+	}
+
+	PROFILE_SCOPE("Stroke Emission");
+	for (size_t i = 0; i < layers.size(); i++) {
+		if (!layers[i].isVisible()) continue;
+
+		layers[i].unpacked().cache.draw(drawList, view);
+		// The stroke being drawn goes on top of its own layer, under any above it
+		if (i == layers.activeLayer()) drawActiveStroke(drawList);
+	}
+
+	if (tool != Tool::Pen && !input.uiCaptured) {
+		drawList->AddCircle(input.mouse, eraserRadius, IM_COL32(255, 255, 255, 200), 0, 2.f);
+		float reach = eraserRadius + 2.f;
+		damage.addOverlay({ input.mouse.x - reach, input.mouse.y - reach }, { input.mouse.x + reach, input.mouse.y + reach });
+	}
+
+	if (drawingStraightLine) {
+		ImVec2 screenStart = view.toScreen(lineStart);
+		ImVec2 screenEnd = view.toScreen(lineEnd);
+		const float xs[2] = { screenStart.x, screenEnd.x };
+		const float ys[2] = { screenStart.y, screenEnd.y };
+		drawStroke(drawList, xs, ys, 2, toStyle(drawingColour, drawingThickness), layers.tessellationSettings());
+
+		float pad = damage.strokePadding(drawingThickness);
+		damage.addOverlay({ std::min(xs[0], xs[1]) - pad, std::min(ys[0], ys[1]) - pad }, { std::max(xs[0], xs[1]) + pad, std::max(ys[0], ys[1]) + pad });
+	}
+}
+
+void Whiteboard::drawActiveStroke(ImDrawList* drawList) {
+	const LayerContents& ink = layers.active().contents();
+	const StrokeDocument& document = ink.document;
+	const Stroke* stroke = document.find(document.activeStroke());
+	if (!stroke) return;
+
+	ink.cache.drawDirect(drawList, *stroke, view);
+
+	// Points are only ever added or replaced at the end, so the damage is whatever follows the last two drawn
+	ImVec2 min{ FLT_MAX, FLT_MAX }, max{ -FLT_MAX, -FLT_MAX };
+	uint32_t tail = std::min(drawnPoints, stroke->count);
+	for (uint32_t i = tail > 2 ? tail - 2 : 0; i < stroke->count; i++) {
+		ImVec2 point = view.toScreen(document.pointOf(*stroke, i));
+		min = { std::min(min.x, point.x), std::min(min.y, point.y) };
+		max = { std::max(max.x, point.x), std::max(max.y, point.y) };
+	}
+	float pad = damage.strokePadding(stroke->style.thickness * view.zoom);
+	min = { min.x - pad, min.y - pad };
+	max = { max.x + pad, max.y + pad };
+	damage.addOverlay(min, max);
+	activeMin = { std::min(activeMin.x, min.x), std::min(activeMin.y, min.y) };
+	activeMax = { std::max(activeMax.x, max.x), std::max(activeMax.y, max.y) };
+	drawnPoints = stroke->count;
+}
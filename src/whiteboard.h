@@ -0,0 +1,131 @@
+#ifndef WHITEBOARD_H
+#define WHITEBOARD_H
+
+#include <cstddef>
+#include <vector>
+#include <imgui/imgui.h>
+#include "stroke_document.h"
+#include "history.h"
+#include "layers.h"
+#include "viewport.h"
+#include "simplify.h"
+#include "shapes.h"
+#include "snapping.h"
+#include "input_source.h"
+#include "damage.h"
+
+const float DEFAULT_DRAWING_COLOUR[4] = { 1.f, 0.f, 0.f, 1.f };
+const float DEFAULT_DRAWING_THICKNESS = 5.f;
+// Zoom factor for each notch of the mouse wheel
+const float ZOOM_STEP = 1.2f;
+
+enum class Tool {
+	Pen,
+	StrokeEraser,
+	PixelEraser
+};
+
+/**
+* Everything the board reacts to in a frame
+* Filled in from the window each frame, or read back from a recording
+*/
+struct FrameInput {
+	double time = 0.0;  // monotonicSeconds() at the start of the frame
+	ImVec2 mouse{ 0.f, 0.f };  // screen position
+	bool leftDown = false;
+	bool rightDown = false;
+	bool middleDown = false;  // pans the board
+	float wheel = 0.f;  // notches scrolled, zooms around the mouse
+	bool undoClicked = false;  // mouse back button
+	bool redoClicked = false;  // mouse forward button
+	bool snapHeld = false;  // left shift, snaps straight lines to the nearest angle
+	bool cycleTool = false;  // E
+	bool resetView = false;  // Home
+	bool uiCaptured = false;  // the menu has the mouse
+	const PointerSample* samples = nullptr;  // every pointer sample since the last frame
+	size_t sampleCount = 0;
+};
+
+DrawingSettings toSettings(const float colour[4], float thickness);
+StrokeStyle toStyle(const float colour[4], float thickness);
+
+/**
+* The board and the drawing / erasing / undo / straight line / pan and zoom state machine, without any window or
+* graphics device
+* update() runs the tools for a frame, draw() emits the board into a draw list
+* Input comes in screen coordinates and is mapped onto the board through the view, thicknesses, the eraser radius and
+* simplification tolerances are all in screen pixels at the zoom they are used at
+* The tools work on the active layer, and leave it alone while it is hidden
+*/
+class Whiteboard {
+public:
+	Whiteboard();
+	Whiteboard(const Whiteboard&) = delete;
+	Whiteboard& operator=(const Whiteboard&) = delete;
+
+	void update(const FrameInput& input);
+	/**
+	* Needs a current ImGui frame
+	*/
+	void draw(ImDrawList* drawList, const FrameInput& input);
+	/**
+	* Call after strokes are loaded into the layers from outside
+	*/
+	void documentLoaded();
+	/**
+	* Changes how strokes are tessellated, which redraws the whole board
+	*/
+	void setTessellation(const TessellationSettings& settings);
+
+	bool isBusy() const { return drawingLine || erasing || drawingStraightLine || panning; }
+	size_t memoryUsage() const;
+
+	// Every layer's document tells the damage tracker about its strokes
+	DamageTracker damage;
+	LayerStack layers;
+
+	// The owner sets the size, the board pans and zooms it
+	Viewport view;
+
+	// Edited directly by the menu
+	float drawingColour[4] = { DEFAULT_DRAWING_COLOUR[0], DEFAULT_DRAWING_COLOUR[1], DEFAULT_DRAWING_COLOUR[2], DEFAULT_DRAWING_COLOUR[3] };
+	float drawingThickness = DEFAULT_DRAWING_THICKNESS;
+	Tool tool = Tool::Pen;
+	float eraserRadius = 15.f;
+	SimplifySettings simplifySettings;
+	SnapSettings snapSettings;
+	ShapeSettings shapeSettings;
+
+	// Points taken in by the pen, points kept after simplification or shape recognition, and strokes recognised as shapes
+	size_t rawPoints = 0;
+	size_t keptPoints = 0;
+	size_t recognisedShapes = 0;
+
+private:
+	void updateView(const FrameInput& input);
+	void updateEraser(const FrameInput& input);
+	void updatePen(const FrameInput& input);
+	void finishStroke();
+	void drawActiveStroke(ImDrawList* drawList);
+	void loadSettings();
+
+	StreamingSimplifier streamer;
+	std::vector<ImVec2> strokePoints;
+	std::vector<ImVec2> processedPoints;
+
+	bool drawingLine = false;
+	bool erasing = false;
+	bool drawingStraightLine = false;
+	// On the board, already snapped
+	ImVec2 lineStart;
+	ImVec2 lineEnd;
+	bool panning = false;
+	ImVec2 panLast;
+
+	// How much of the stroke being drawn was drawn last frame, and everywhere on screen it has been drawn
+	uint32_t drawnPoints = 0;
+	ImVec2 activeMin;
+	ImVec2 activeMax;
+};
+
+#endif // WHITEBOARD_H
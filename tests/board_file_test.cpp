@@ -0,0 +1,322 @@
+#include "test.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include "board_file.h"
+#include "stroke_document.h"
+
+namespace {
+	std::vector<ImVec2> wiggle(uint32_t count, float x, float y) {
+		std::vector<ImVec2> points;
+		for (uint32_t i = 0; i < count; i++) points.push_back({ x + i * 1.75f, y + std::sin(i * 0.3f) * 20.f });
+		return points;
+	}
+
+	// A few pens, a highlighter and a shape, the kinds of stroke a board holds
+	void drawSome(StrokeDocument& document) {
+		std::vector<ImVec2> points = wiggle(80, 10.f, 50.f);
+		document.addStroke({ IM_COL32(255, 0, 0, 255), 4.f }, points.data(), (uint32_t) points.size());
+		points = wiggle(300, -4000.f, 1200.f);
+		document.addStroke({ IM_COL32(255, 255, 0, 96), 20.f }, points.data(), (uint32_t) points.size());
+		const ImVec2 dot{ 7.f, 9.f };
+		document.addStroke({ IM_COL32_WHITE, 9.f }, &dot, 1);
+		const ImVec2 rectangle[] = { { 20.f, 15.f }, { 110.f, 15.f }, { 110.f, 75.f }, { 20.f, 75.f } };
+		document.addStroke({ IM_COL32(80, 160, 255, 255), 3.f }, rectangle, 4, StrokeShape::Rectangle);
+	}
+
+	// Same strokes, styles and shapes, and exactly the same points
+	bool sameStrokes(const StrokeDocument& a, const StrokeDocument& b) {
+		if (a.strokes().size() != b.strokes().size()) return false;
+		std::vector<ImVec2> pointsA, pointsB;
+		for (size_t i = 0; i < a.strokes().size(); i++) {
+			const Stroke& strokeA = a.strokes()[i];
+			const Stroke& strokeB = b.strokes()[i];
+			if (strokeA.id != strokeB.id || strokeA.count != strokeB.count || strokeA.shape != strokeB.shape) return false;
+			if (strokeA.style.colour != strokeB.style.colour || strokeA.style.thickness != strokeB.style.thickness) return false;
+			a.copyPoints(strokeA, pointsA);
+			b.copyPoints(strokeB, pointsB);
+			for (uint32_t p = 0; p < strokeA.count; p++) {
+				if (pointsA[p].x != pointsB[p].x || pointsA[p].y != pointsB[p].y) return false;
+			}
+		}
+		return true;
+	}
+
+	std::vector<uint8_t> readFile(const std::string& path) {
+		std::vector<uint8_t> bytes;
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file) return bytes;
+		uint8_t buffer[4096];
+		for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;) bytes.insert(bytes.end(), buffer, buffer + read);
+		fclose(file);
+		return bytes;
+	}
+
+	void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file) return;
+		fwrite(bytes.data(), 1, bytes.size(), file);
+		fclose(file);
+	}
+
+	/**
+	* What a crash would leave on disk, the board and journal of a session that is still open copied to crashed
+	*/
+	void crashImage(const std::string& path, const std::string& crashed) {
+		std::filesystem::copy_file(path, crashed, std::filesystem::copy_options::overwrite_existing);
+		std::filesystem::copy_file(path + ".journal", crashed + ".journal", std::filesystem::copy_options::overwrite_existing);
+	}
+}
+
+TEST(board_file, boards_read_back_what_was_written) {
+	StrokeDocument document;
+	drawSome(document);
+	std::string path = testPath("round_trip.wbd");
+	REQUIRE(writeBoard(path, document));
+
+	StrokeDocument read;
+	CHECK(readBoard(path, read) == BoardRead::Loaded);
+	CHECK(sameStrokes(document, read));
+	CHECK(read.pointCount() == document.pointCount());
+
+	// An empty board too, and one that isn't there
+	StrokeDocument empty;
+	REQUIRE(writeBoard(path, empty));
+	CHECK(readBoard(path, read = StrokeDocument()) == BoardRead::Loaded);
+	CHECK(read.strokes().empty());
+	CHECK(readBoard(testPath("missing.wbd"), read) == BoardRead::Missing);
+}
+
+TEST(board_file, ink_drawn_zoomed_in_keeps_its_shape) {
+	// A twentieth of a pixel between samples, drawn at the deepest zoom, and a stroke far from the origin
+	std::vector<ImVec2> fine;
+	for (int i = 0; i < 200; i++) fine.push_back({ 500.f + i * 0.05f, 300.f + std::sin(i * 0.1f) * 0.5f });
+	StrokeDocument document;
+	document.addStroke({ IM_COL32_WHITE, 0.1f }, fine.data(), (uint32_t) fine.size());
+	std::vector<ImVec2> far = wiggle(100, 3000000.f, -2000000.f);
+	document.addStroke({ IM_COL32_WHITE, 2.f }, far.data(), (uint32_t) far.size());
+	REQUIRE(document.strokes()[0].grid > 0);
+
+	std::string path = testPath("zoomed.wbd");
+	REQUIRE(writeBoard(path, document));
+	StrokeDocument read;
+	CHECK(readBoard(path, read) == BoardRead::Loaded);
+	CHECK(sameStrokes(document, read));
+	CHECK(read.strokes()[0].grid == document.strokes()[0].grid);
+	// Saved as it was packed, not much bigger than the document holds it
+	CHECK(std::filesystem::file_size(path) <= sizeof(BoardHeader) + 2 * sizeof(BoardStrokeRecord) + document.packedBytes());
+}
+
+TEST(board_file, version_2_boards_still_load) {
+	// One stroke the way version 2 wrote it, a rectangle with its x and y arrays after the record
+	BoardHeader header{};
+	std::memcpy(header.magic, BOARD_MAGIC, sizeof(header.magic));
+	header.version = 2;
+	header.strokeCount = 1;
+	header.pointCount = 4;
+	header.strokesOffset = sizeof(BoardHeader);
+	header.pointsOffset = header.strokesOffset + sizeof(LegacyStrokeRecord);
+	header.pointsSize = header.pointsOffset + 4 * sizeof(uint16_t);
+	LegacyStrokeRecord record{ 7, IM_COL32(255, 0, 0, 255), 3.f, 10.f, 20.f, 1, 4, (uint32_t) StrokeShape::Rectangle, 0 };
+	const uint16_t xs[] = { 0, 400, 400, 0 };
+	const uint16_t ys[] = { 0, 0, 160, 160 };
+
+	std::vector<uint8_t> bytes(header.pointsSize + sizeof(ys));
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + header.strokesOffset, &record, sizeof(record));
+	std::memcpy(bytes.data() + header.pointsOffset, xs, sizeof(xs));
+	std::memcpy(bytes.data() + header.pointsSize, ys, sizeof(ys));
+	std::string path = testPath("version_2.wbd");
+	writeFile(path, bytes);
+
+	StrokeDocument read;
+	REQUIRE(readBoard(path, read) == BoardRead::Loaded);
+	const Stroke* stroke = read.find(7);
+	REQUIRE(stroke && stroke->count == 4);
+	CHECK(stroke->shape == StrokeShape::Rectangle && stroke->style.thickness == 3.f);
+	// Steps of 2 / 8 px from the origin
+	CHECK(read.pointOf(*stroke, 2).x == 110.f && read.pointOf(*stroke, 2).y == 60.f);
+}
+
+TEST(board_file, sessions_keep_the_board_across_a_close) {
+	std::string path = testPath("session.wbd");
+	StrokeDocument document;
+	{
+		BoardSession session(document);
+		REQUIRE(session.open(path));
+		drawSome(document);
+		document.removeStroke(document.strokes()[1].id);
+		document.setStyle(document.strokes()[0].id, { IM_COL32(0, 255, 0, 255), 6.f });
+	}
+	CHECK(!std::filesystem::exists(path + ".journal"));
+
+	StrokeDocument reopened;
+	BoardSession session(reopened);
+	REQUIRE(session.open(path));
+	CHECK(sameStrokes(document, reopened));
+}
+
+TEST(board_file, a_crash_loses_nothing_that_was_journaled) {
+	std::string path = testPath("crash.wbd");
+	std::string crashed = testPath("crashed.wbd");
+	StrokeDocument document;
+	BoardSession session(document);
+	REQUIRE(session.open(path));
+	drawSome(document);
+	document.removeStroke(document.strokes()[2].id);
+	document.setStyle(document.strokes()[0].id, { IM_COL32(0, 255, 0, 255), 6.f });
+	CHECK(session.journalSize() > 0);
+	crashImage(path, crashed);
+
+	StrokeDocument recovered;
+	BoardSession recovery(recovered);
+	REQUIRE(recovery.open(crashed));
+	CHECK(sameStrokes(document, recovered));
+	// Folded into the board as it was opened, the journal starts again empty
+	StrokeDocument board;
+	CHECK(readBoard(crashed, board) == BoardRead::Loaded);
+	CHECK(sameStrokes(document, board));
+	CHECK(recovery.journalSize() == 0);
+}
+
+TEST(board_file, a_torn_journal_keeps_every_record_before_the_tear) {
+	std::string path = testPath("torn.wbd");
+	std::string crashed = testPath("torn_crashed.wbd");
+	StrokeDocument document;
+	BoardSession session(document);
+	REQUIRE(session.open(path));
+	drawSome(document);
+	StrokeDocument beforeLast = document;
+	size_t journaled = session.journalSize();
+	std::vector<ImVec2> points = wiggle(50, 300.f, 300.f);
+	document.addStroke({ IM_COL32(255, 0, 255, 255), 2.f }, points.data(), (uint32_t) points.size());
+
+	// The last record cut short anywhere, from its length to its last byte
+	for (size_t cut : { journaled + 2, journaled + 9, session.journalSize() - 1 }) {
+		crashImage(path, crashed);
+		std::filesystem::resize_file(crashed + ".journal", cut);
+		StrokeDocument recovered;
+		BoardSession recovery(recovered);
+		REQUIRE(recovery.open(crashed));
+		CHECK(sameStrokes(beforeLast, recovered));
+	}
+
+	// Or all there but with a byte flipped, the checksum drops it
+	crashImage(path, crashed);
+	std::vector<uint8_t> journal = readFile(crashed + ".journal");
+	journal[journal.size() - 5] ^= 0x40;
+	writeFile(crashed + ".journal", journal);
+	StrokeDocument recovered;
+	BoardSession recovery(recovered);
+	REQUIRE(recovery.open(crashed));
+	CHECK(sameStrokes(beforeLast, recovered));
+}
+
+TEST(board_file, a_compaction_that_failed_does_not_stop_the_next) {
+	std::string path = testPath("leftover.wbd");
+	StrokeDocument document;
+	BoardSession session(document);
+	REQUIRE(session.open(path));
+	drawSome(document);
+	// What a compaction that couldn't write the board leaves behind, the journal it had moved out of the way
+	writeFile(path + ".journal.old", readFile(path + ".journal"));
+	std::vector<ImVec2> points = wiggle(40, 200.f, 200.f);
+	document.addStroke({ IM_COL32(0, 255, 255, 255), 5.f }, points.data(), (uint32_t) points.size());
+
+	// The next compaction takes it over, with the journal on its end, and removes it once the board is written
+	session.compactInBackground();
+	CHECK(session.journalSize() == 0);
+	session.close();
+	CHECK(!std::filesystem::exists(path + ".journal.old"));
+	CHECK(!std::filesystem::exists(path + ".journal"));
+
+	StrokeDocument board;
+	CHECK(readBoard(path, board) == BoardRead::Loaded);
+	CHECK(sameStrokes(document, board));
+}
+
+TEST(board_file, packed_points_running_past_their_stroke_are_unreadable) {
+	StrokeDocument document;
+	drawSome(document);
+	std::string path = testPath("overrun.wbd");
+	REQUIRE(writeBoard(path, document));
+	std::vector<uint8_t> bytes = readFile(path);
+
+	// The first stroke claiming one more point than its bytes hold
+	BoardStrokeRecord record;
+	std::memcpy(&record, bytes.data() + sizeof(BoardHeader), sizeof(record));
+	record.count++;
+	std::memcpy(bytes.data() + sizeof(BoardHeader), &record, sizeof(record));
+	writeFile(path, bytes);
+
+	StrokeDocument read;
+	CHECK(readBoard(path, read) == BoardRead::Unreadable);
+	CHECK(read.strokes().empty());
+}
+
+TEST(board_file, a_truncated_board_adds_nothing) {
+	StrokeDocument document;
+	drawSome(document);
+	std::string path = testPath("truncated.wbd");
+	REQUIRE(writeBoard(path, document));
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+	StrokeDocument read;
+	const ImVec2 dot{ 1.f, 1.f };
+	read.addStroke({ IM_COL32_WHITE, 2.f }, &dot, 1);
+	CHECK(readBoard(path, read) == BoardRead::Unreadable);
+	CHECK(read.strokes().size() == 1);
+}
+
+TEST(board_file, an_unreadable_board_is_moved_aside_not_replaced) {
+	std::string path = testPath("corrupt.wbd");
+	StrokeDocument document;
+	drawSome(document);
+	REQUIRE(writeBoard(path, document));
+	std::vector<uint8_t> bytes = readFile(path);
+	bytes.resize(bytes.size() / 2);
+	writeFile(path, bytes);
+
+	StrokeDocument opened;
+	{
+		BoardSession session(opened);
+		REQUIRE(session.open(path));
+		CHECK(opened.strokes().empty());
+		const ImVec2 dot{ 3.f, 3.f };
+		opened.addStroke({ IM_COL32_WHITE, 2.f }, &dot, 1);
+	}
+	CHECK(readFile(path + ".unreadable") == bytes);
+
+	// A second one goes next to the first rather than over it
+	writeFile(path, bytes);
+	StrokeDocument again;
+	BoardSession session(again);
+	REQUIRE(session.open(path));
+	CHECK(readFile(path + ".unreadable.2") == bytes);
+	CHECK(readFile(path + ".unreadable") == bytes);
+}
+
+TEST(board_file, a_board_from_a_newer_version_is_left_alone) {
+	std::string path = testPath("newer.wbd");
+	StrokeDocument document;
+	drawSome(document);
+	REQUIRE(writeBoard(path, document));
+	std::vector<uint8_t> bytes = readFile(path);
+	uint32_t newer = BOARD_VERSION + 1;
+	std::memcpy(bytes.data() + offsetof(BoardHeader, version), &newer, sizeof(newer));
+	writeFile(path, bytes);
+
+	StrokeDocument opened;
+	{
+		BoardSession session(opened);
+		CHECK(!session.open(path));
+		CHECK(!session.isOpen());
+		const ImVec2 dot{ 3.f, 3.f };
+		opened.addStroke({ IM_COL32_WHITE, 2.f }, &dot, 1);
+		session.discard();
+	}
+	CHECK(readFile(path) == bytes);
+	CHECK(!std::filesystem::exists(path + ".journal") && !std::filesystem::exists(path + ".unreadable"));
+}
@@ -0,0 +1,174 @@
+#include "test.h"
+#include <algorithm>
+#include <vector>
+#include <imgui/imgui.h>
+#include "damage.h"
+#include "viewport.h"
+
+namespace {
+	const int SCREEN = 1000;
+
+	bool contains(const DamageRect& outer, const DamageRect& inner) {
+		return outer.x0 <= inner.x0 && outer.y0 <= inner.y0 && outer.x1 >= inner.x1 && outer.y1 >= inner.y1;
+	}
+
+	bool covered(const std::vector<DamageRect>& rects, const DamageRect& rect) {
+		return std::any_of(rects.begin(), rects.end(), [&](const DamageRect& other) { return contains(other, rect); });
+	}
+
+	bool isFullScreen(const std::vector<DamageRect>& rects) {
+		return rects.size() == 1 && rects[0] == DamageRect{ 0, 0, SCREEN, SCREEN };
+	}
+
+	// A tracker over a SCREEN x SCREEN view, past the full redraw every tracker starts with
+	void start(DamageTracker& tracker) {
+		Viewport view;
+		view.size = { (float) SCREEN, (float) SCREEN };
+		tracker.setView(view);
+		std::vector<DamageRect> redraw, present;
+		tracker.endFrame(1, redraw, present);
+	}
+
+	void addRect(DamageTracker& tracker, const DamageRect& rect) {
+		tracker.add({ (float) rect.x0, (float) rect.y0 }, { (float) rect.x1, (float) rect.y1 });
+	}
+
+	// Small and far apart, so no two are ever merged
+	DamageRect apart(int i) {
+		return { 20 + (i % 5) * 200, 20 + (i / 5) * 200, 40 + (i % 5) * 200, 40 + (i / 5) * 200 };
+	}
+}
+
+TEST(damage, touching_rects_merge_and_apart_ones_do_not) {
+	std::vector<DamageRect> rects;
+	mergeDamage(rects, { 0, 0, 10, 10 });
+	mergeDamage(rects, { 50, 50, 60, 60 });
+	CHECK(rects.size() == 2);
+
+	// Sharing an edge with the first, then overlapping both, which leaves one
+	mergeDamage(rects, { 10, 0, 20, 10 });
+	CHECK(rects.size() == 2);
+	CHECK(covered(rects, { 0, 0, 20, 10 }));
+	mergeDamage(rects, { 15, 5, 55, 55 });
+	REQUIRE(rects.size() == 1);
+	CHECK(rects[0] == (DamageRect{ 0, 0, 60, 60 }));
+}
+
+TEST(damage, merging_keeps_at_most_eight_rects_covering_everything) {
+	std::vector<DamageRect> rects;
+	for (int i = 0; i < 20; i++) {
+		mergeDamage(rects, apart(i));
+		CHECK((int) rects.size() <= MAX_DAMAGE_RECTS);
+	}
+	CHECK((int) rects.size() == MAX_DAMAGE_RECTS);
+	for (int i = 0; i < 20; i++) CHECK(covered(rects, apart(i)));
+	// Merging never leaves two that touch
+	for (size_t a = 0; a < rects.size(); a++) {
+		for (size_t b = a + 1; b < rects.size(); b++) {
+			CHECK(!(rects[a].x0 <= rects[b].x1 && rects[b].x0 <= rects[a].x1 && rects[a].y0 <= rects[b].y1 && rects[b].y0 <= rects[a].y1));
+		}
+	}
+}
+
+TEST(damage, more_than_half_the_screen_redraws_all_of_it) {
+	DamageTracker tracker;
+	start(tracker);
+	std::vector<DamageRect> redraw, present;
+
+	addRect(tracker, { 0, 0, SCREEN, 400 });
+	tracker.endFrame(1, redraw, present);
+	REQUIRE(present.size() == 1);
+	CHECK(present[0] == (DamageRect{ 0, 0, SCREEN, 400 }));
+	CHECK(redraw == present);
+
+	// Two that don't touch, 60% between them
+	addRect(tracker, { 0, 0, SCREEN, 300 });
+	addRect(tracker, { 0, 700, SCREEN, SCREEN });
+	tracker.endFrame(1, redraw, present);
+	CHECK(isFullScreen(present));
+	CHECK(isFullScreen(redraw));
+
+	// Moving the view damages everything too
+	Viewport view;
+	view.size = { (float) SCREEN, (float) SCREEN };
+	view.origin = { 5.f, 0.f };
+	tracker.setView(view);
+	tracker.endFrame(1, redraw, present);
+	CHECK(isFullScreen(present));
+}
+
+TEST(damage, buffer_age_brings_in_the_frames_it_missed) {
+	// The same four frames each time, A to C closed, D the one being presented
+	for (int age = 0; age <= DAMAGE_HISTORY + 2; age++) {
+		DamageTracker tracker;
+		start(tracker);
+		std::vector<DamageRect> redraw, present;
+		for (int frame = 0; frame < 3; frame++) {
+			addRect(tracker, apart(frame));
+			tracker.endFrame(1, redraw, present);
+		}
+		addRect(tracker, apart(3));
+		tracker.endFrame(age, redraw, present);
+
+		REQUIRE(present.size() == 1);
+		CHECK(present[0] == apart(3));
+		if (age == 0 || age > DAMAGE_HISTORY + 1) {
+			// Unknown contents, or older than the history goes back
+			CHECK(isFullScreen(redraw));
+			continue;
+		}
+		// A buffer age frames old is missing the last age - 1 frames as well as this one
+		CHECK((int) redraw.size() == age);
+		for (int frame = 3; frame > 3 - age; frame--) CHECK(covered(redraw, apart(frame)));
+		for (int frame = 3 - age; frame >= 0; frame--) CHECK(!covered(redraw, apart(frame)));
+	}
+}
+
+TEST(damage, a_full_frame_in_the_history_redraws_everything) {
+	std::vector<DamageRect> redraw, present;
+	for (int age = 1; age <= 3; age++) {
+		DamageTracker tracker;
+		start(tracker);
+		tracker.addAll();
+		tracker.endFrame(1, redraw, present);
+		addRect(tracker, apart(0));
+		tracker.endFrame(1, redraw, present);
+
+		// Two frames old the buffer has the full frame in it, three frames old it was drawn before it
+		addRect(tracker, apart(1));
+		tracker.endFrame(age, redraw, present);
+		CHECK(isFullScreen(redraw) == (age == 3));
+		CHECK(!isFullScreen(present));
+	}
+}
+
+TEST(damage, an_overlay_is_damaged_the_frame_after_it_goes) {
+	DamageTracker tracker;
+	start(tracker);
+	std::vector<DamageRect> redraw, present;
+	CHECK(!tracker.hasDamage());
+
+	const DamageRect cursor{ 100, 100, 132, 132 };
+	tracker.addOverlay({ 100.f, 100.f }, { 132.f, 132.f });
+	CHECK(tracker.hasDamage());
+	tracker.endFrame(1, redraw, present);
+	REQUIRE(present.size() == 1);
+	CHECK(present[0] == cursor);
+
+	// Moved, both where it is and where it was
+	const DamageRect moved{ 600, 600, 632, 632 };
+	tracker.addOverlay({ 600.f, 600.f }, { 632.f, 632.f });
+	tracker.endFrame(1, redraw, present);
+	CHECK(present.size() == 2);
+	CHECK(covered(present, cursor) && covered(present, moved));
+
+	// Gone, where it was last still has to be drawn over
+	CHECK(tracker.hasDamage());
+	tracker.endFrame(1, redraw, present);
+	REQUIRE(present.size() == 1);
+	CHECK(present[0] == moved);
+
+	CHECK(!tracker.hasDamage());
+	tracker.endFrame(1, redraw, present);
+	CHECK(present.empty());
+}
@@ -0,0 +1,162 @@
+#include "test.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include <imgui/imgui.h>
+#include "whiteboard.h"
+
+namespace {
+	const ImVec2 DISPLAY_SIZE{ 2560.f, 1440.f };
+	// How many times faster a cached frame has to build than an AddLine per segment, whatever the machine (wb_bench's
+	// frame suite holds it to 144 Hz)
+	const double CACHED_SPEEDUP = 3.0;
+	// 400 strokes of 251 points, all of them on screen
+	const size_t STROKES = 400;
+	const size_t SEGMENTS_PER_STROKE = 250;
+
+	/**
+	* An ImGui context with no platform or renderer behind it, the previous context comes back when it goes
+	*/
+	class HeadlessContext {
+	public:
+		HeadlessContext() : previous(ImGui::GetCurrentContext()), context(ImGui::CreateContext()) {
+			ImGui::SetCurrentContext(context);
+			ImGuiIO& io = ImGui::GetIO();
+			io.IniFilename = nullptr;
+			io.DisplaySize = DISPLAY_SIZE;
+			io.DeltaTime = 1.f / 144.f;
+			io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+			unsigned char* pixels = nullptr;
+			int width = 0, height = 0;
+			io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+		}
+
+		~HeadlessContext() {
+			ImGui::DestroyContext(context);
+			ImGui::SetCurrentContext(previous);
+		}
+
+		HeadlessContext(const HeadlessContext&) = delete;
+		HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	private:
+		ImGuiContext* previous;
+		ImGuiContext* context;
+	};
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double median(std::vector<double> times) {
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	// Wandering strokes over one screen, kept as the points they were drawn with
+	std::vector<std::vector<ImVec2>> wanderingStrokes() {
+		std::mt19937 rng(4);
+		auto uniform = [&](float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); };
+		std::vector<std::vector<ImVec2>> strokes(STROKES);
+		for (std::vector<ImVec2>& points : strokes) {
+			ImVec2 point{ uniform(100.f, DISPLAY_SIZE.x - 100.f), uniform(100.f, DISPLAY_SIZE.y - 100.f) };
+			float heading = uniform(0.f, 6.2831853f);
+			for (size_t i = 0; i <= SEGMENTS_PER_STROKE; i++) {
+				heading += uniform(-0.3f, 0.3f);
+				point = { std::clamp(point.x + 4.f * std::cos(heading), 0.f, DISPLAY_SIZE.x), std::clamp(point.y + 4.f * std::sin(heading), 0.f, DISPLAY_SIZE.y) };
+				points.push_back(point);
+			}
+		}
+		return strokes;
+	}
+
+	/**
+	* A board at 1:1 holding the strokes, nothing is baked until it is drawn
+	*/
+	std::unique_ptr<Whiteboard> boardOf(const std::vector<std::vector<ImVec2>>& strokes) {
+		auto board = std::make_unique<Whiteboard>();
+		board->view.size = DISPLAY_SIZE;
+		StrokeDocument& document = board->layers.active().contents().document;
+		for (const std::vector<ImVec2>& points : strokes) document.addStroke({ IM_COL32(255, 0, 0, 255), 3.f }, points.data(), (uint32_t) points.size());
+		return board;
+	}
+
+	double buildFrame(Whiteboard& board, const FrameInput& input) {
+		auto start = std::chrono::steady_clock::now();
+		ImGui::NewFrame();
+		board.update(input);
+		board.draw(ImGui::GetBackgroundDrawList(), input);
+		ImGui::Render();
+		return millisecondsSince(start);
+	}
+
+	// Bakes until the board is drawn from its 1:1 cache
+	void warmUp(Whiteboard& board) {
+		FrameInput input;
+		for (int frame = 0; frame < 100 && board.layers.active().peek().cache.drawnLevel() != 0; frame++) buildFrame(board, input);
+		buildFrame(board, input);
+	}
+}
+
+TEST(frame_build, committed_strokes_are_only_baked_once) {
+	HeadlessContext context;
+	std::unique_ptr<Whiteboard> board = boardOf(wanderingStrokes());
+	warmUp(*board);
+	const LodCache& cache = board->layers.active().peek().cache;
+	REQUIRE(cache.drawnLevel() == 0);
+	size_t baked = cache.vertexCount();
+	CHECK(baked > 0);
+	CHECK((size_t) ImGui::GetDrawData()->TotalVtxCount >= baked);
+
+	// Drawing a stroke across the board leaves the committed ones alone until it is let go of
+	std::vector<PointerSample> samples(1);
+	FrameInput input;
+	for (int frame = 0; frame < 60; frame++) {
+		input.time = frame / 144.0;
+		input.mouse = { 200.f + frame * 10.f, 300.f + frame * 5.f };
+		input.leftDown = true;
+		samples[0] = { input.mouse.x, input.mouse.y, 1.f, POINTER_LEFT, input.time };
+		input.samples = samples.data();
+		input.sampleCount = 1;
+		buildFrame(*board, input);
+		CHECK(cache.vertexCount() == baked);
+	}
+	input.leftDown = false;
+	input.sampleCount = 0;
+	buildFrame(*board, input);
+	buildFrame(*board, input);
+	CHECK(board->layers.strokeCount() == STROKES + 1);
+	CHECK(cache.vertexCount() > baked);
+}
+
+TEST(frame_build, a_hundred_thousand_segments_build_faster_than_a_line_each) {
+	HeadlessContext context;
+	std::vector<std::vector<ImVec2>> strokes = wanderingStrokes();
+	std::unique_ptr<Whiteboard> board = boardOf(strokes);
+	REQUIRE(board->layers.pointCount() == STROKES * (SEGMENTS_PER_STROKE + 1));
+	warmUp(*board);
+
+	FrameInput input;
+	std::vector<double> cached;
+	for (int frame = 0; frame < 60; frame++) cached.push_back(buildFrame(*board, input));
+
+	// What every frame used to do, an AddLine for each segment
+	std::vector<double> perSegment;
+	for (int frame = 0; frame < 10; frame++) {
+		auto start = std::chrono::steady_clock::now();
+		ImGui::NewFrame();
+		ImDrawList* drawList = ImGui::GetBackgroundDrawList();
+		for (const std::vector<ImVec2>& points : strokes) {
+			for (size_t i = 1; i < points.size(); i++) drawList->AddLine(points[i - 1], points[i], IM_COL32(255, 0, 0, 255), 3.f);
+		}
+		ImGui::Render();
+		perSegment.push_back(millisecondsSince(start));
+	}
+
+	printf("  frame build with %zu segments: %.2f ms cached, %.2f ms a line per segment\n", STROKES * SEGMENTS_PER_STROKE, median(cached), median(perSegment));
+	CHECK(median(cached) * CACHED_SPEEDUP < median(perSegment));
+}
@@ -0,0 +1,192 @@
+#include "test.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <imgui/imgui.h>
+#include "png_reader.h"
+#include "png_writer.h"
+#include "rasterizer.h"
+#include "stroke_document.h"
+#include "thread_pool.h"
+
+/**
+* Renders fixed boards with the CPU rasterizer and compares them with the reference images in tests/golden
+* Run wb_tests golden with WB_UPDATE_GOLDEN=1 set to write the references again after a deliberate change to how strokes
+* are drawn. When an image doesn't match, what was drawn is written next to wb_tests as <scene>.actual.png
+*/
+
+namespace {
+	const int WIDTH = 256;
+	const int HEIGHT = 160;
+	// A channel this far from the reference still counts as the same, rounding in the anti-aliasing can differ by a level or two
+	const int CHANNEL_TOLERANCE = 3;
+	// Fraction of the pixels allowed past the tolerance before an image counts as changed
+	const double MAX_CHANGED_FRACTION = 0.002;
+
+	struct Scene {
+		const char* name;
+		std::vector<StrokeDocument> layers;
+		RasterSettings settings{ { 0.f, 0.f }, 1.f, { 0.1f, 0.1f, 0.12f, 1.f } };
+	};
+
+	void wavyStroke(StrokeDocument& document, StrokeStyle style, ImVec2 from, ImVec2 to, float amplitude, int points) {
+		std::vector<ImVec2> path;
+		for (int i = 0; i < points; i++) {
+			float t = i / (float) (points - 1);
+			path.push_back({ from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t + amplitude * std::sin(t * 9.4247780f) });
+		}
+		document.addStroke(style, path.data(), (uint32_t) path.size());
+	}
+
+	// Pens of a few thicknesses, a single point dot and a sharp zig-zag to show the round joins and caps
+	void penStrokes(Scene& scene) {
+		StrokeDocument& document = scene.layers.emplace_back();
+		wavyStroke(document, { IM_COL32(255, 0, 0, 255), 2.f }, { 16.f, 30.f }, { 240.f, 30.f }, 10.f, 60);
+		wavyStroke(document, { IM_COL32(0, 200, 255, 255), 5.f }, { 16.f, 70.f }, { 240.f, 70.f }, 14.f, 40);
+		wavyStroke(document, { IM_COL32(255, 255, 255, 255), 12.f }, { 24.f, 120.f }, { 150.f, 120.f }, 18.f, 12);
+		const ImVec2 zigzag[] = { { 170.f, 140.f }, { 190.f, 100.f }, { 205.f, 140.f }, { 225.f, 95.f } };
+		document.addStroke({ IM_COL32(120, 255, 80, 255), 6.f }, zigzag, 4);
+		const ImVec2 dot{ 240.f, 140.f };
+		document.addStroke({ IM_COL32(255, 200, 0, 255), 9.f }, &dot, 1);
+	}
+
+	// Translucent thick strokes over each other and over a solid one, blended the way the overlay blends them
+	void highlighters(Scene& scene) {
+		StrokeDocument& document = scene.layers.emplace_back();
+		wavyStroke(document, { IM_COL32(255, 255, 255, 255), 4.f }, { 10.f, 80.f }, { 246.f, 80.f }, 30.f, 50);
+		wavyStroke(document, { IM_COL32(255, 255, 0, 100), 20.f }, { 20.f, 50.f }, { 236.f, 110.f }, 0.f, 2);
+		wavyStroke(document, { IM_COL32(0, 255, 120, 100), 20.f }, { 20.f, 110.f }, { 236.f, 50.f }, 0.f, 2);
+		// Crossing itself, a stroke shouldn't darken where it overlaps its own ink
+		const ImVec2 loop[] = { { 60.f, 20.f }, { 120.f, 140.f }, { 180.f, 20.f }, { 40.f, 90.f }, { 220.f, 90.f } };
+		document.addStroke({ IM_COL32(255, 60, 200, 110), 16.f }, loop, 5);
+	}
+
+	void shapes(Scene& scene) {
+		StrokeDocument& document = scene.layers.emplace_back();
+		const ImVec2 line[] = { { 12.f, 150.f }, { 120.f, 100.f } };
+		document.addStroke({ IM_COL32(255, 255, 255, 255), 3.f }, line, 2, StrokeShape::Line);
+		const ImVec2 rectangle[] = { { 20.f, 15.f }, { 110.f, 15.f }, { 110.f, 75.f }, { 20.f, 75.f } };
+		document.addStroke({ IM_COL32(255, 80, 80, 255), 4.f }, rectangle, 4, StrokeShape::Rectangle);
+		const ImVec2 ellipse[] = { { 140.f, 15.f }, { 240.f, 15.f }, { 240.f, 85.f }, { 140.f, 85.f } };
+		document.addStroke({ IM_COL32(80, 160, 255, 255), 5.f }, ellipse, 4, StrokeShape::Ellipse);
+		const ImVec2 arrow[] = { { 140.f, 140.f }, { 236.f, 110.f }, { 220.f, 104.f }, { 226.f, 124.f } };
+		document.addStroke({ IM_COL32(255, 220, 0, 255), 3.f }, arrow, 4, StrokeShape::Arrow);
+	}
+
+	// Two layers, the second half see-through over the first, on a transparent background so the image keeps their alpha
+	void layers(Scene& scene) {
+		StrokeDocument& bottom = scene.layers.emplace_back();
+		wavyStroke(bottom, { IM_COL32(255, 0, 0, 255), 24.f }, { 20.f, 80.f }, { 236.f, 80.f }, 40.f, 30);
+		StrokeDocument& top = scene.layers.emplace_back();
+		wavyStroke(top, { IM_COL32(0, 0, 255, 128), 30.f }, { 128.f, 10.f }, { 128.f, 150.f }, 0.f, 2);
+		scene.settings.background = { 0.f, 0.f, 0.f, 0.f };
+	}
+
+	// Part of the board at 4x, strokes thinner than a pixel at 1:1 and off the top left of the image
+	void zoomed(Scene& scene) {
+		StrokeDocument& document = scene.layers.emplace_back();
+		wavyStroke(document, { IM_COL32(255, 255, 255, 255), 0.5f }, { 90.f, 95.f }, { 170.f, 95.f }, 4.f, 40);
+		wavyStroke(document, { IM_COL32(255, 128, 0, 255), 3.f }, { 80.f, 110.f }, { 160.f, 120.f }, 6.f, 20);
+		wavyStroke(document, { IM_COL32(0, 255, 255, 255), 2.f }, { 50.f, 80.f }, { 110.f, 130.f }, 3.f, 20);
+		scene.settings.origin = { 96.f, 90.f };
+		scene.settings.scale = 4.f;
+	}
+
+	const struct {
+		const char* name;
+		void (*build)(Scene& scene);
+	} SCENES[] = {
+		{ "pen_strokes", penStrokes },
+		{ "highlighters", highlighters },
+		{ "shapes", shapes },
+		{ "layers", layers },
+		{ "zoomed", zoomed }
+	};
+
+	void render(const Scene& scene, ThreadPool& pool, RasterImage& image, int tileSize = DEFAULT_TILE_SIZE) {
+		std::vector<const StrokeDocument*> documents;
+		for (const StrokeDocument& document : scene.layers) documents.push_back(&document);
+		RasterSettings settings = scene.settings;
+		settings.tileSize = tileSize;
+		image.width = WIDTH;
+		image.height = HEIGHT;
+		rasterize(documents, settings, image, pool);
+	}
+
+	std::string referencePath(const char* scene) {
+		return std::string(WB_GOLDEN_DIR) + "/" + scene + ".png";
+	}
+}
+
+TEST(golden, png_reader_reads_back_what_is_written) {
+	ThreadPool pool(2);
+	std::mt19937 rng(9);
+	const int width = 37, height = 70;
+	std::vector<uint8_t> pixels(width * height * 4);
+	// Noise in the top half and flat colour below, so both literals and long matches get written
+	for (size_t i = 0; i < pixels.size(); i++) pixels[i] = i < pixels.size() / 2 ? (uint8_t) rng() : (uint8_t) (i % 4 * 60);
+
+	int readWidth = 0, readHeight = 0;
+	std::vector<uint8_t> read;
+	REQUIRE(decodePng(encodePng(width, height, pixels.data(), pool), readWidth, readHeight, read));
+	CHECK(readWidth == width && readHeight == height);
+	CHECK(read == pixels);
+}
+
+TEST(golden, tiles_and_threads_do_not_change_the_image) {
+	ThreadPool single(1), several(4);
+	for (const auto& entry : SCENES) {
+		Scene scene{ entry.name, {} };
+		entry.build(scene);
+		RasterImage reference, tiled;
+		render(scene, single, reference);
+		render(scene, several, tiled, 16);
+		CHECK(reference.pixels == tiled.pixels);
+	}
+}
+
+TEST(golden, scenes_match_their_reference_images) {
+	ThreadPool pool;
+	bool updating = getenv("WB_UPDATE_GOLDEN") != nullptr;
+	for (const auto& entry : SCENES) {
+		Scene scene{ entry.name, {} };
+		entry.build(scene);
+		RasterImage image;
+		render(scene, pool, image);
+
+		std::string path = referencePath(entry.name);
+		if (updating) {
+			CHECK(writePng(path, image.width, image.height, image.pixels.data(), pool));
+			printf("  wrote %s\n", path.c_str());
+			continue;
+		}
+
+		int width = 0, height = 0;
+		std::vector<uint8_t> reference;
+		bool loaded = readPng(path, width, height, reference);
+		if (!loaded) printf("  %s: couldn't read %s\n", entry.name, path.c_str());
+		CHECK(loaded);
+		size_t changed = 0;
+		int worst = 0;
+		if (loaded && width == image.width && height == image.height) {
+			for (size_t pixel = 0; pixel < reference.size(); pixel += 4) {
+				int difference = 0;
+				for (int c = 0; c < 4; c++) difference = std::max(difference, std::abs(reference[pixel + c] - image.pixels[pixel + c]));
+				worst = std::max(worst, difference);
+				if (difference > CHANNEL_TOLERANCE) changed++;
+			}
+		}
+		else changed = image.pixels.size() / 4;
+
+		bool matches = changed <= MAX_CHANGED_FRACTION * image.width * image.height;
+		if (!matches) {
+			std::string actual = std::string(entry.name) + ".actual.png";
+			writePng(actual, image.width, image.height, image.pixels.data(), pool);
+			printf("  %s: %zu pixels changed, up to %d a channel, drawn into %s\n", entry.name, changed, worst, actual.c_str());
+		}
+		CHECK(matches);
+	}
+}
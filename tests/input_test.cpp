@@ -0,0 +1,101 @@
+#include "test.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "input_source.h"
+#include "spsc_queue.h"
+
+namespace {
+	// A pen sampled at 1 kHz moving right, with the left button down for the second half
+	std::vector<PointerSample> penSamples(size_t count) {
+		std::vector<PointerSample> samples;
+		for (size_t i = 0; i < count; i++) {
+			uint8_t buttons = i >= count / 2 ? POINTER_LEFT : 0;
+			samples.push_back({ (float) i, 100.f + (float) (i % 7), 0.5f, buttons, 10.0 + i * 0.001 });
+		}
+		return samples;
+	}
+}
+
+TEST(input, the_queue_keeps_order_and_drops_when_full) {
+	SpscQueue<int, 8> queue;
+	int out[8];
+	// Around the ring a few times, so the indices wrap
+	for (int round = 0; round < 5; round++) {
+		for (int i = 0; i < 6; i++) CHECK(queue.push(round * 10 + i));
+		CHECK(queue.size() == 6);
+		REQUIRE(queue.pop(out, 4) == 4);
+		CHECK(out[0] == round * 10 && out[3] == round * 10 + 3);
+		REQUIRE(queue.pop(out, 8) == 2);
+		CHECK(out[0] == round * 10 + 4 && out[1] == round * 10 + 5);
+	}
+	CHECK(queue.droppedCount() == 0);
+
+	for (int i = 0; i < 8; i++) CHECK(queue.push(i));
+	CHECK(!queue.push(8) && !queue.push(9));
+	CHECK(queue.droppedCount() == 2);
+	REQUIRE(queue.pop(out, 8) == 8);
+	CHECK(out[0] == 0 && out[7] == 7 && queue.size() == 0);
+}
+
+TEST(input, the_queue_passes_everything_between_threads_in_order) {
+	const int COUNT = 200000;
+	SpscQueue<int, 1024> queue;
+	std::thread producer([&] {
+		for (int i = 0; i < COUNT; i++) {
+			while (!queue.push(i)) std::this_thread::yield();
+		}
+	});
+
+	std::vector<int> batch(64);
+	int expected = 0;
+	bool inOrder = true;
+	while (expected < COUNT) {
+		size_t count = queue.pop(batch.data(), batch.size());
+		for (size_t i = 0; i < count; i++) inOrder = inOrder && batch[i] == expected++;
+		if (count == 0) std::this_thread::yield();
+	}
+	producer.join();
+	CHECK(inOrder && expected == COUNT);
+}
+
+TEST(input, replayed_samples_arrive_in_order_and_are_counted) {
+	std::vector<PointerSample> recorded = penSamples(120);
+	std::string path = testPath("pen.samples");
+	REQUIRE(saveSamples(path, recorded));
+	ReplaySource source;
+	REQUIRE(source.load(path));
+
+	SampleQueue queue;
+	InputStats stats;
+	std::vector<PointerSample> batch(4096);
+	std::vector<PointerSample> received;
+	size_t frames = 0;
+	double started = monotonicSeconds();
+	REQUIRE(source.start(queue));
+	// Drained like the render loop does, a batch a frame, until the source is done and the queue is empty
+	while (!source.finished() || queue.size() > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(7));
+		size_t count = queue.pop(batch.data(), batch.size());
+		stats.frame(batch.data(), count, monotonicSeconds());
+		received.insert(received.end(), batch.begin(), batch.begin() + count);
+		frames++;
+	}
+	source.stop();
+
+	REQUIRE(received.size() == recorded.size());
+	CHECK(queue.droppedCount() == 0);
+	for (size_t i = 0; i < received.size(); i++) {
+		CHECK(received[i].x == recorded[i].x && received[i].y == recorded[i].y);
+		CHECK(received[i].pressure == recorded[i].pressure && received[i].buttons == recorded[i].buttons);
+		// Stamped when they were pushed, on our clock rather than the recording's
+		CHECK(received[i].time >= started && (i == 0 || received[i].time >= received[i - 1].time));
+	}
+	// Recorded 120 ms apart end to end, so they can't all have come in one frame
+	CHECK(received.back().time - received.front().time >= 0.1);
+
+	CHECK(stats.totalSamples == recorded.size());
+	CHECK(stats.samplesPerFrame > 0.0 && stats.samplesPerFrame <= (double) recorded.size());
+	CHECK(stats.latency >= 0.0 && stats.maxLatency >= stats.latency);
+	CHECK(frames > 1);
+}
@@ -0,0 +1,55 @@
+#include "test.h"
+#include <vector>
+#include "damage.h"
+#include "layers.h"
+
+namespace {
+	const DrawingSettings SETTINGS{ { 1.f, 0.f, 0.f, 1.f }, 5.f };
+
+	// Draws a short line on the active layer and commits it, like the pen does when it is released
+	StrokeId draw(LayerStack& layers, float y) {
+		const ImVec2 points[] = { { 0.f, y }, { 50.f, y }, { 100.f, y + 10.f } };
+		HistoryEntry entry;
+		entry.added.push_back(layers.active().document().addStroke({ IM_COL32_WHITE, 2.f }, points, 3));
+		entry.settings = SETTINGS;
+		StrokeId id = entry.added.back();
+		layers.commit(std::move(entry));
+		return id;
+	}
+
+	std::vector<StrokeId> ids(const StrokeDocument& document) {
+		std::vector<StrokeId> out;
+		for (const Stroke& stroke : document.strokes()) out.push_back(stroke.id);
+		return out;
+	}
+}
+
+TEST(layers, clearing_is_undone_and_redone_as_one_step) {
+	DamageTracker damage;
+	LayerStack layers(damage, SETTINGS);
+	StrokeId first = draw(layers, 0.f);
+	StrokeId second = draw(layers, 20.f);
+	draw(layers, 40.f);
+
+	// The third stroke is undone, so it could be redone until the layer is cleared
+	REQUIRE(layers.undo());
+	REQUIRE(layers.clear(0, 0.0));
+	CHECK(layers.active().document().strokes().empty());
+
+	REQUIRE(layers.undo());
+	CHECK(ids(layers.active().document()) == std::vector<StrokeId>({ first, second }));
+
+	// Redo puts the clear back, not the stroke undone before it
+	REQUIRE(layers.redo());
+	CHECK(layers.active().document().strokes().empty());
+	CHECK(!layers.active().canRedo());
+
+	// And the history before the clear still steps back as it was
+	REQUIRE(layers.undo());
+	REQUIRE(layers.undo());
+	CHECK(ids(layers.active().document()) == std::vector<StrokeId>({ first }));
+	REQUIRE(layers.redo());
+	CHECK(ids(layers.active().document()) == std::vector<StrokeId>({ first, second }));
+	REQUIRE(layers.redo());
+	CHECK(layers.active().document().strokes().empty());
+}
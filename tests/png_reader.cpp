@@ -0,0 +1,271 @@
+#include "png_reader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+const int MAX_CODE_BITS = 15;
+
+const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+// Order the code length code lengths come in, RFC 1951 3.2.7
+const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+/**
+* Deflate bit reader, bits come out least significant first
+* Reading past the end gives zeros and sets overrun, which the caller checks once a block is done
+*/
+class BitReader {
+public:
+	BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+	uint32_t bits(int count) {
+		uint32_t value = 0;
+		for (int i = 0; i < count; i++) {
+			if (position >= size) {
+				overrun = true;
+				return value;
+			}
+			value |= (uint32_t) ((data[position] >> bit) & 1) << i;
+			if (++bit == 8) {
+				bit = 0;
+				position++;
+			}
+		}
+		return value;
+	}
+
+	void alignToByte() {
+		if (bit > 0) {
+			bit = 0;
+			position++;
+		}
+	}
+
+	const uint8_t* data;
+	size_t size;
+	size_t position = 0;
+	int bit = 0;
+	bool overrun = false;
+};
+
+/**
+* Canonical Huffman code, decoded a bit at a time by counting codes of each length
+*/
+struct Huffman {
+	uint16_t counts[MAX_CODE_BITS + 1];
+	uint16_t symbols[288];
+
+	void build(const uint8_t* lengths, int count) {
+		memset(counts, 0, sizeof(counts));
+		for (int i = 0; i < count; i++) counts[lengths[i]]++;
+		counts[0] = 0;
+
+		uint16_t offsets[MAX_CODE_BITS + 1];
+		offsets[1] = 0;
+		for (int length = 1; length < MAX_CODE_BITS; length++) offsets[length + 1] = offsets[length] + counts[length];
+		for (int i = 0; i < count; i++) {
+			if (lengths[i] != 0) symbols[offsets[lengths[i]]++] = (uint16_t) i;
+		}
+	}
+
+	int decode(BitReader& reader) const {
+		int code = 0, first = 0, index = 0;
+		for (int length = 1; length <= MAX_CODE_BITS; length++) {
+			code |= (int) reader.bits(1);
+			int count = counts[length];
+			if (code - first < count) return symbols[index + code - first];
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+			if (reader.overrun) return -1;
+		}
+		return -1;
+	}
+};
+
+static bool inflateCodes(BitReader& reader, const Huffman& literals, const Huffman& distances, std::vector<uint8_t>& out) {
+	while (true) {
+		int symbol = literals.decode(reader);
+		if (symbol < 0) return false;
+		if (symbol < 256) {
+			out.push_back((uint8_t) symbol);
+			continue;
+		}
+		if (symbol == 256) return !reader.overrun;
+
+		symbol -= 257;
+		if (symbol >= 29) return false;
+		size_t length = LENGTH_BASE[symbol] + reader.bits(LENGTH_EXTRA[symbol]);
+		int d = distances.decode(reader);
+		if (d < 0 || d >= 30) return false;
+		size_t distance = DISTANCE_BASE[d] + reader.bits(DISTANCE_EXTRA[d]);
+		if (distance > out.size()) return false;
+		// Byte at a time, the match can overlap what it is copying
+		size_t from = out.size() - distance;
+		for (size_t i = 0; i < length; i++) out.push_back(out[from + i]);
+	}
+}
+
+static bool readDynamicCodes(BitReader& reader, Huffman& literals, Huffman& distances) {
+	int literalCount = (int) reader.bits(5) + 257;
+	int distanceCount = (int) reader.bits(5) + 1;
+	int codeLengthCount = (int) reader.bits(4) + 4;
+	if (literalCount > 286 || distanceCount > 30) return false;
+
+	uint8_t codeLengths[19] = {};
+	for (int i = 0; i < codeLengthCount; i++) codeLengths[CODE_LENGTH_ORDER[i]] = (uint8_t) reader.bits(3);
+	Huffman codeLengthCode;
+	codeLengthCode.build(codeLengths, 19);
+
+	uint8_t lengths[286 + 30] = {};
+	for (int i = 0; i < literalCount + distanceCount;) {
+		int symbol = codeLengthCode.decode(reader);
+		if (symbol < 0) return false;
+		if (symbol < 16) {
+			lengths[i++] = (uint8_t) symbol;
+			continue;
+		}
+
+		uint8_t repeated = 0;
+		int times;
+		if (symbol == 16) {
+			if (i == 0) return false;
+			repeated = lengths[i - 1];
+			times = 3 + (int) reader.bits(2);
+		}
+		else if (symbol == 17) times = 3 + (int) reader.bits(3);
+		else times = 11 + (int) reader.bits(7);
+		if (i + times > literalCount + distanceCount) return false;
+		while (times-- > 0) lengths[i++] = repeated;
+	}
+
+	literals.build(lengths, literalCount);
+	distances.build(lengths + literalCount, distanceCount);
+	return !reader.overrun;
+}
+
+/**
+* zlib stream to bytes, stored, fixed and dynamic Huffman blocks
+*/
+static bool inflateZlib(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+	if (in.size() < 2 || (in[0] & 0x0F) != 8 || ((in[0] << 8) | in[1]) % 31 != 0 || (in[1] & 0x20)) return false;
+
+	BitReader reader(in.data() + 2, in.size() - 2);
+	bool last = false;
+	while (!last) {
+		last = reader.bits(1) == 1;
+		uint32_t type = reader.bits(2);
+		if (type == 0) {
+			reader.alignToByte();
+			if (reader.position + 4 > reader.size) return false;
+			const uint8_t* header = reader.data + reader.position;
+			uint16_t length = (uint16_t) (header[0] | (header[1] << 8));
+			uint16_t complement = (uint16_t) (header[2] | (header[3] << 8));
+			if ((uint16_t) ~length != complement || reader.position + 4 + length > reader.size) return false;
+			out.insert(out.end(), header + 4, header + 4 + length);
+			reader.position += 4 + length;
+		}
+		else if (type == 1) {
+			// Fixed Huffman codes, RFC 1951 3.2.6
+			uint8_t lengths[288 + 30];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			memset(lengths + 288, 5, 30);
+			Huffman literals, distances;
+			literals.build(lengths, 288);
+			distances.build(lengths + 288, 30);
+			if (!inflateCodes(reader, literals, distances, out)) return false;
+		}
+		else if (type == 2) {
+			Huffman literals, distances;
+			if (!readDynamicCodes(reader, literals, distances) || !inflateCodes(reader, literals, distances, out)) return false;
+		}
+		else return false;
+	}
+	return true;
+}
+
+static uint32_t bigEndian(const uint8_t* at) {
+	return ((uint32_t) at[0] << 24) | ((uint32_t) at[1] << 16) | ((uint32_t) at[2] << 8) | at[3];
+}
+
+static uint8_t paeth(int a, int b, int c) {
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return (uint8_t) a;
+	return (uint8_t) (pb <= pc ? b : c);
+}
+
+bool decodePng(const std::vector<uint8_t>& png, int& width, int& height, std::vector<uint8_t>& rgba) {
+	if (png.size() < 8 || memcmp(png.data(), PNG_SIGNATURE, 8) != 0) return false;
+
+	int colourType = -1;
+	std::vector<uint8_t> compressed;
+	for (size_t at = 8; at + 12 <= png.size();) {
+		uint32_t length = bigEndian(&png[at]);
+		if (at + 12 + length > png.size()) return false;
+		const uint8_t* type = &png[at + 4];
+		const uint8_t* data = &png[at + 8];
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+			width = (int) bigEndian(data);
+			height = (int) bigEndian(data + 4);
+			// 8 bits, RGB or RGBA, no interlacing
+			if (data[8] != 8 || (data[9] != 2 && data[9] != 6) || data[12] != 0) return false;
+			colourType = data[9];
+		}
+		else if (memcmp(type, "IDAT", 4) == 0) compressed.insert(compressed.end(), data, data + length);
+		else if (memcmp(type, "IEND", 4) == 0) break;
+		at += 12 + length;
+	}
+	if (colourType < 0 || width <= 0 || height <= 0) return false;
+
+	std::vector<uint8_t> filtered;
+	if (!inflateZlib(compressed, filtered)) return false;
+	size_t channels = colourType == 6 ? 4 : 3;
+	size_t stride = (size_t) width * channels;
+	if (filtered.size() < (stride + 1) * height) return false;
+
+	// Undo each row's filter in place, against the row above it
+	std::vector<uint8_t> previous(stride, 0);
+	rgba.resize((size_t) width * height * 4);
+	for (int y = 0; y < height; y++) {
+		uint8_t filter = filtered[y * (stride + 1)];
+		uint8_t* row = &filtered[y * (stride + 1) + 1];
+		for (size_t i = 0; i < stride; i++) {
+			int left = i >= channels ? row[i - channels] : 0;
+			int up = previous[i];
+			int upLeft = i >= channels ? previous[i - channels] : 0;
+			switch (filter) {
+			case 0: break;
+			case 1: row[i] = (uint8_t) (row[i] + left); break;
+			case 2: row[i] = (uint8_t) (row[i] + up); break;
+			case 3: row[i] = (uint8_t) (row[i] + ((left + up) >> 1)); break;
+			case 4: row[i] = (uint8_t) (row[i] + paeth(left, up, upLeft)); break;
+			default: return false;
+			}
+		}
+		memcpy(previous.data(), row, stride);
+
+		uint8_t* out = &rgba[(size_t) y * width * 4];
+		for (int x = 0; x < width; x++) {
+			for (size_t c = 0; c < channels; c++) out[x * 4 + c] = row[x * channels + c];
+			if (channels == 3) out[x * 4 + 3] = 255;
+		}
+	}
+	return true;
+}
+
+bool readPng(const std::string& path, int& width, int& height, std::vector<uint8_t>& rgba) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) return false;
+	std::vector<uint8_t> png;
+	uint8_t buffer[65536];
+	for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;) png.insert(png.end(), buffer, buffer + read);
+	fclose(file);
+	return decodePng(png, width, height, rgba);
+}
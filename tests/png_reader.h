@@ -0,0 +1,15 @@
+#ifndef PNG_READER_H
+#define PNG_READER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+* Decodes an 8 bit RGB or RGBA PNG that isn't interlaced into RGBA pixels (straight alpha, rows top to bottom)
+* Enough to read back what encodePng writes, and reference images saved by other tools, for the golden image tests
+*/
+bool decodePng(const std::vector<uint8_t>& png, int& width, int& height, std::vector<uint8_t>& rgba);
+bool readPng(const std::string& path, int& width, int& height, std::vector<uint8_t>& rgba);
+
+#endif // PNG_READER_H
@@ -0,0 +1,49 @@
+#include "test.h"
+#include "input_recorder.h"
+#include "replay_runner.h"
+
+TEST(replay, synthetic_sessions_are_deterministic) {
+	std::vector<RecordedFrame> first = syntheticSession(20, 50, 7);
+	std::vector<RecordedFrame> second = syntheticSession(20, 50, 7);
+	REQUIRE(first.size() == second.size());
+	for (size_t i = 0; i < first.size(); i++) {
+		REQUIRE(first[i].samples.size() == second[i].samples.size());
+		CHECK(first[i].input.time == second[i].input.time && first[i].input.leftDown == second[i].input.leftDown);
+		for (size_t j = 0; j < first[i].samples.size(); j++) CHECK(first[i].samples[j].x == second[i].samples[j].x);
+	}
+}
+
+TEST(replay, replays_end_on_the_same_board) {
+	std::vector<RecordedFrame> frames = syntheticSession(40, 60, 3);
+	ReplayReport first = runReplay("first", frames);
+	ReplayReport second = runReplay("second", frames);
+	CHECK(first.frames == frames.size());
+	CHECK(first.strokes > 0 && first.points > 0 && first.vertices > 0);
+	CHECK(first.strokes == second.strokes && first.points == second.points && first.vertices == second.vertices);
+}
+
+TEST(replay, recordings_load_back_as_recorded) {
+	std::vector<RecordedFrame> frames = syntheticSession(5, 30, 11);
+	frames[3].input.undoClicked = true;
+	frames[4].input.wheel = -2.f;
+	std::string path = testPath("session.rec");
+	InputRecorder recorder;
+	REQUIRE(recorder.open(path));
+	for (const RecordedFrame& frame : frames) recorder.record(frame.input);
+	recorder.close();
+
+	std::vector<RecordedFrame> loaded;
+	REQUIRE(loadRecording(path, loaded));
+	REQUIRE(loaded.size() == frames.size());
+	for (size_t i = 0; i < frames.size(); i++) {
+		const FrameInput& a = frames[i].input;
+		const FrameInput& b = loaded[i].input;
+		CHECK(a.time == b.time && a.mouse.x == b.mouse.x && a.mouse.y == b.mouse.y);
+		CHECK(a.leftDown == b.leftDown && a.rightDown == b.rightDown && a.undoClicked == b.undoClicked && a.wheel == b.wheel);
+		REQUIRE(b.sampleCount == a.sampleCount);
+		for (size_t j = 0; j < a.sampleCount; j++) CHECK(a.samples[j].x == b.samples[j].x && a.samples[j].time == b.samples[j].time);
+	}
+
+	// Replaying what was loaded builds the same board as the original frames
+	CHECK(runReplay("loaded", loaded).points == runReplay("recorded", frames).points);
+}
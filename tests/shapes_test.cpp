@@ -0,0 +1,275 @@
+#include "test.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "shapes.h"
+#include "snapping.h"
+#include "spatial_index.h"
+
+namespace {
+	const float TAU = 6.2831853f;
+	// Strokes drawn of each kind, and how many of them recognition may miss
+	const int STROKES = 200;
+	const float MIN_RECOGNISED = 0.95f;
+	// Scribbles and open arcs that may come out as a shape
+	const float MAX_FALSE_POSITIVES = 0.05f;
+
+	/**
+	* Points a hand would leave going along an outline: 3 px apart, wavering off it by about 1% of the shape's size
+	* plus a pixel of jitter
+	*/
+	class Hand {
+	public:
+		explicit Hand(uint32_t seed) : rng(seed) {}
+
+		float uniform(float low, float high) { return low + (high - low) * (float) (rng() >> 8) / (float) (1u << 24); }
+
+		void begin(ImVec2 start, float size) {
+			points.assign(1, start);
+			travelled = 0.f;
+			wobble = size * 0.01f;
+			phase = uniform(0.f, TAU);
+		}
+
+		void add(ImVec2 point, ImVec2 normal) {
+			travelled += std::hypot(point.x - points.back().x, point.y - points.back().y);
+			float offset = wobble * std::sin(travelled / 150.f + phase) + uniform(-0.5f, 0.5f);
+			points.push_back({ point.x + normal.x * offset, point.y + normal.y * offset });
+		}
+
+		void lineTo(ImVec2 target) {
+			ImVec2 from = points.back();
+			float dx = target.x - from.x, dy = target.y - from.y;
+			float length = std::hypot(dx, dy);
+			int steps = std::max(1, (int) (length / 3.f));
+			for (int i = 1; i <= steps; i++) add({ from.x + dx * i / steps, from.y + dy * i / steps }, { -dy / length, dx / length });
+		}
+
+		std::vector<ImVec2> points;
+
+	private:
+		std::mt19937 rng;
+		float travelled = 0.f;
+		float wobble = 0.f;
+		float phase = 0.f;
+	};
+
+	float distance(ImVec2 a, ImVec2 b) {
+		return std::hypot(a.x - b.x, a.y - b.y);
+	}
+
+	/**
+	* A shape of the kind at a random place, size and angle, drawn by hand
+	* truth gets what was meant: a line or arrow's shaft, or a closed shape's centre and its two half sizes in x
+	*/
+	void drawShape(Hand& hand, StrokeShape kind, int variant, ImVec2 truth[3], float& size) {
+		size = hand.uniform(80.f, 600.f);
+		ImVec2 centre{ hand.uniform(-3000.f, 3000.f), hand.uniform(-3000.f, 3000.f) };
+		float angle = hand.uniform(0.f, TAU);
+		ImVec2 axis{ std::cos(angle), std::sin(angle) };
+		auto at = [&](float x, float y) { return ImVec2{ centre.x + axis.x * x - axis.y * y, centre.y + axis.y * x + axis.x * y }; };
+
+		if (kind == StrokeShape::Line || kind == StrokeShape::Arrow) {
+			truth[0] = at(-size * 0.5f, 0.f);
+			truth[1] = at(size * 0.5f, 0.f);
+			hand.begin(truth[0], size);
+			hand.lineTo(truth[1]);
+			if (kind == StrokeShape::Arrow) {
+				// Barbs 30 degrees either side of the shaft, drawn back through the tip or straight across
+				float head = size * hand.uniform(0.15f, 0.3f);
+				ImVec2 left = at(size * 0.5f - head * 0.866f, head * 0.5f);
+				ImVec2 right = at(size * 0.5f - head * 0.866f, -head * 0.5f);
+				hand.lineTo(left);
+				if (variant % 2) hand.lineTo(truth[1]);
+				hand.lineTo(right);
+			}
+		}
+		else if (kind == StrokeShape::Rectangle) {
+			float w = size * 0.5f, h = size * hand.uniform(0.2f, 0.5f);
+			truth[0] = centre;
+			truth[1] = { w, 0.f };
+			truth[2] = { h, 0.f };
+			ImVec2 corners[4] = { at(-w, -h), at(w, -h), at(w, h), at(-w, h) };
+			hand.begin(corners[0], size);
+			for (int corner = 1; corner <= 4; corner++) hand.lineTo(corners[corner % 4]);
+		}
+		else {
+			float a = size * 0.5f, b = a * hand.uniform(0.3f, 1.f);
+			truth[0] = centre;
+			truth[1] = { a, 0.f };
+			truth[2] = { b, 0.f };
+			float start = hand.uniform(0.f, TAU);
+			float end = start + TAU + hand.uniform(-0.05f, 0.2f);
+			hand.begin(at(a * std::cos(start), b * std::sin(start)), size);
+			for (float t = start + 3.f / a; t <= end; t += 3.f / a) {
+				ImVec2 normal = at(b * std::cos(t), a * std::sin(t));
+				normal = { normal.x - centre.x, normal.y - centre.y };
+				float length = std::hypot(normal.x, normal.y);
+				hand.add(at(a * std::cos(t), b * std::sin(t)), { normal.x / length, normal.y / length });
+			}
+		}
+	}
+
+	/**
+	* How far the fit is from what was meant, as a fraction of the shape's size
+	*/
+	float fitError(StrokeShape kind, const RecognisedShape& shape, const ImVec2 truth[3], float size) {
+		if (kind == StrokeShape::Line || kind == StrokeShape::Arrow) {
+			return std::max(distance(shape.points[0], truth[0]), distance(shape.points[1], truth[1])) / size;
+		}
+		ImVec2 centre{ (shape.points[0].x + shape.points[2].x) * 0.5f, (shape.points[0].y + shape.points[2].y) * 0.5f };
+		float first = distance(shape.points[0], shape.points[1]) * 0.5f;
+		float second = distance(shape.points[0], shape.points[3]) * 0.5f;
+		float large = std::max(first, second), small = std::min(first, second);
+		return std::max({ distance(centre, truth[0]), std::fabs(large - truth[1].x), std::fabs(small - truth[2].x) }) / size;
+	}
+
+	// Direction of a line in degrees, 0-360
+	float degrees(ImVec2 from, ImVec2 to) {
+		float angle = std::atan2(to.y - from.y, to.x - from.x) * 360.f / TAU;
+		return angle < 0.f ? angle + 360.f : angle;
+	}
+}
+
+TEST(shapes, hand_drawn_shapes_are_recognised_as_what_was_meant) {
+	const StrokeShape kinds[] = { StrokeShape::Line, StrokeShape::Rectangle, StrokeShape::Ellipse, StrokeShape::Arrow };
+	const float tolerance = ShapeSettings().tolerance;
+	Hand hand(15);
+	for (StrokeShape kind : kinds) {
+		int recognised = 0;
+		int mistaken = 0;
+		float worst = 0.f;
+		for (int i = 0; i < STROKES; i++) {
+			ImVec2 truth[3];
+			float size;
+			drawShape(hand, kind, i, truth, size);
+			RecognisedShape shape;
+			if (!recogniseShape(hand.points, tolerance, shape)) continue;
+			if (shape.shape != kind) {
+				mistaken++;
+				continue;
+			}
+			recognised++;
+			worst = std::max(worst, fitError(kind, shape, truth, size));
+		}
+		if (recognised < STROKES * MIN_RECOGNISED || mistaken > 0) printf("  %s: %d of %d recognised, %d mistaken\n", shapeName(kind), recognised, STROKES, mistaken);
+		CHECK(recognised >= STROKES * MIN_RECOGNISED);
+		CHECK(mistaken == 0);
+		// Within a few percent of the shape that was meant, however it was drawn
+		CHECK(worst < 0.05f);
+	}
+}
+
+TEST(shapes, scribbles_and_open_arcs_stay_freehand) {
+	const float tolerance = ShapeSettings().tolerance;
+	Hand hand(16);
+	int shapes = 0;
+	for (int i = 0; i < STROKES; i++) {
+		float size = hand.uniform(80.f, 600.f);
+		float heading = hand.uniform(0.f, TAU);
+		int steps = (int) (size / 3.f);
+		// Wandering, or curling round by 60 to 200 degrees without closing
+		float turn = hand.uniform(1.f, 3.5f) / steps;
+		hand.begin({ hand.uniform(-3000.f, 3000.f), hand.uniform(-3000.f, 3000.f) }, size);
+		for (int step = 0; step < steps; step++) {
+			heading += i % 2 ? turn : hand.uniform(-0.3f, 0.3f);
+			ImVec2 from = hand.points.back();
+			hand.add({ from.x + 3.f * std::cos(heading), from.y + 3.f * std::sin(heading) }, { 0.f, 0.f });
+		}
+		RecognisedShape shape;
+		if (recogniseShape(hand.points, tolerance, shape)) shapes++;
+	}
+	CHECK(shapes <= STROKES * MAX_FALSE_POSITIVES);
+
+	// A zigzag and a spiral are nothing, however straight or closed they are overall
+	std::vector<ImVec2> zigzag, spiral;
+	for (int i = 0; i < 40; i++) zigzag.push_back({ i * 10.f, i % 2 ? 30.f : 0.f });
+	for (float t = 0.f; t < 3.f * TAU; t += 0.05f) spiral.push_back({ std::cos(t) * t * 20.f, std::sin(t) * t * 20.f });
+	RecognisedShape shape;
+	CHECK(!recogniseShape(zigzag, tolerance, shape));
+	CHECK(!recogniseShape(spiral, tolerance, shape));
+	// And so is anything too small to tell
+	const ImVec2 dab[] = { { 0.f, 0.f }, { 2.f, 1.f }, { 3.f, 0.f } };
+	CHECK(!recogniseShape(std::vector<ImVec2>(dab, dab + 3), tolerance, shape));
+}
+
+TEST(shapes, lines_snap_to_the_nearest_direction_in_the_set) {
+	StrokeDocument document;
+	SpatialIndex index(document);
+	SnapEngine snapper(document, index);
+	const SnapAngles sets[] = { SnapAngles::Degrees90, SnapAngles::Degrees45, SnapAngles::Degrees30, SnapAngles::Degrees15 };
+	const ImVec2 origin{ 100.f, -50.f };
+	std::mt19937 rng(3);
+	for (SnapAngles angles : sets) {
+		float step = (float) snapStepDegrees(angles);
+		bool nearest = true;
+		bool sameLength = true;
+		for (int i = 0; i < 500; i++) {
+			float angle = (float) (rng() % 36000) / 100.f;
+			float length = 10.f + (float) (rng() % 1000);
+			ImVec2 point{ origin.x + std::cos(angle * TAU / 360.f) * length, origin.y + std::sin(angle * TAU / 360.f) * length };
+			ImVec2 snapped = snapper.snapAngle(origin, point, angles);
+
+			// On a direction of the set, and no more than half a step from where the line pointed
+			float result = degrees(origin, snapped);
+			float offStep = std::fmod(result + step * 0.5f, step) - step * 0.5f;
+			float turned = std::fabs(result - angle);
+			turned = std::min(turned, 360.f - turned);
+			nearest = nearest && std::fabs(offStep) < 0.01f && turned <= step * 0.5f + 0.01f;
+			sameLength = sameLength && std::fabs(distance(origin, snapped) - length) < length * 1e-4f;
+		}
+		CHECK(nearest);
+		CHECK(sameLength);
+	}
+
+	// 50 degrees goes up to 90 when there is only 0 and 90, to 45 with 45s, and to 60 with 30s
+	ImVec2 fifty{ origin.x + std::cos(50.f * TAU / 360.f) * 100.f, origin.y + std::sin(50.f * TAU / 360.f) * 100.f };
+	CHECK_NEAR(degrees(origin, snapper.snapAngle(origin, fifty, SnapAngles::Degrees90)), 90.0, 0.01);
+	CHECK_NEAR(degrees(origin, snapper.snapAngle(origin, fifty, SnapAngles::Degrees45)), 45.0, 0.01);
+	CHECK_NEAR(degrees(origin, snapper.snapAngle(origin, fifty, SnapAngles::Degrees30)), 60.0, 0.01);
+	CHECK_NEAR(degrees(origin, snapper.snapAngle(origin, fifty, SnapAngles::Degrees15)), 45.0, 0.01);
+
+	ImVec2 gridded = snapper.snapGrid({ 37.f, -62.f }, 25.f);
+	CHECK(gridded.x == 25.f && gridded.y == -50.f);
+	gridded = snapper.snapGrid({ 38.f, -63.f }, 25.f);
+	CHECK(gridded.x == 50.f && gridded.y == -75.f);
+}
+
+TEST(shapes, ends_snap_to_the_nearest_anchor_in_reach) {
+	StrokeDocument document;
+	SpatialIndex index(document);
+	SnapEngine snapper(document, index);
+	const ImVec2 rectangle[] = { { 0.f, 0.f }, { 200.f, 0.f }, { 200.f, 100.f }, { 0.f, 100.f } };
+	document.addStroke({ IM_COL32_WHITE, 2.f }, rectangle, 4, StrokeShape::Rectangle);
+	const ImVec2 line[] = { { 300.f, 0.f }, { 320.f, 40.f }, { 340.f, 80.f } };
+	document.addStroke({ IM_COL32_WHITE, 2.f }, line, 3);
+
+	// Corners of the rectangle and the ends of the line, but not the middle of either
+	ImVec2 anchor;
+	CHECK(snapper.findAnchor({ 203.f, 96.f }, 10.f, anchor) && anchor.x == 200.f && anchor.y == 100.f);
+	CHECK(snapper.findAnchor({ 337.f, 85.f }, 10.f, anchor) && anchor.x == 340.f && anchor.y == 80.f);
+	CHECK(!snapper.findAnchor({ 100.f, 2.f }, 10.f, anchor));
+	CHECK(!snapper.findAnchor({ 320.f, 41.f }, 10.f, anchor));
+	CHECK(!snapper.findAnchor({ 215.f, 100.f }, 10.f, anchor));
+	// The nearer of two in reach
+	CHECK(snapper.findAnchor({ 255.f, 0.f }, 60.f, anchor) && anchor.x == 300.f);
+	CHECK(snapper.findAnchor({ 245.f, 0.f }, 60.f, anchor) && anchor.x == 200.f);
+
+	// An anchor wins over the angle, the radius is in pixels so it shrinks on the board as the view zooms in
+	SnapSettings settings;
+	settings.angles = SnapAngles::Degrees45;
+	ImVec2 end = snapper.snapEnd({ -100.f, 400.f }, { 205.f, 104.f }, true, settings, 1.f);
+	CHECK(end.x == 200.f && end.y == 100.f);
+	end = snapper.snapEnd({ -100.f, 400.f }, { 205.f, 104.f }, true, settings, 4.f);
+	CHECK_NEAR(degrees({ -100.f, 400.f }, end), 315.0, 0.01);
+	settings.magnetism = false;
+	end = snapper.snapEnd({ -100.f, 400.f }, { 205.f, 104.f }, true, settings, 1.f);
+	CHECK_NEAR(degrees({ -100.f, 400.f }, end), 315.0, 0.01);
+	// And the grid when the angle isn't held
+	settings.grid = true;
+	end = snapper.snapEnd({ -100.f, 400.f }, { 205.f, 104.f }, false, settings, 1.f);
+	CHECK(end.x == 200.f && end.y == 100.f);
+	end = snapper.snapPoint({ 61.f, 14.f }, settings, 1.f);
+	CHECK(end.x == 50.f && end.y == 25.f);
+}
@@ -0,0 +1,67 @@
+#include "test.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <imgui/imgui.h>
+#include "simplify.h"
+#include "spatial_index.h"
+
+namespace {
+	// Furthest any point of in is from the line through out
+	float maxDeviation(const std::vector<ImVec2>& in, const std::vector<ImVec2>& out) {
+		float furthest = 0.f;
+		for (ImVec2 point : in) {
+			float nearest = 1e30f;
+			for (size_t i = 0; i + 1 < out.size(); i++) nearest = std::min(nearest, segmentDistance(point, out[i], out[i + 1]));
+			furthest = std::max(furthest, nearest);
+		}
+		return furthest;
+	}
+
+	// Along a line and back over it, every triangle is flat
+	std::vector<ImVec2> doublingBack() {
+		std::vector<ImVec2> points;
+		for (int i = 0; i <= 20; i++) points.push_back({ i * 6.f, 100.f });
+		for (int i = 19; i >= 10; i--) points.push_back({ i * 6.f, 100.f });
+		return points;
+	}
+
+	std::vector<ImVec2> wobblyArc() {
+		std::vector<ImVec2> points;
+		for (int i = 0; i < 200; i++) {
+			float angle = i * 0.02f;
+			float radius = 300.f + 0.3f * std::sin(i * 1.7f);
+			points.push_back({ radius * std::cos(angle), radius * std::sin(angle) });
+		}
+		return points;
+	}
+}
+
+TEST(simplify, douglas_peucker_stays_within_tolerance) {
+	std::vector<ImVec2> in = wobblyArc(), out;
+	simplifyDouglasPeucker(in, 0.75f, out);
+	CHECK(out.size() < in.size() / 3);
+	CHECK(out.front().x == in.front().x && out.back().x == in.back().x);
+	CHECK(maxDeviation(in, out) <= 0.75f + 1e-3f);
+}
+
+TEST(simplify, visvalingam_keeps_where_a_stroke_turns_back) {
+	std::vector<ImVec2> in = doublingBack(), out;
+	simplifyVisvalingam(in, 0.75f, out);
+	CHECK(out.size() < in.size());
+	CHECK(std::any_of(out.begin(), out.end(), [](ImVec2 point) { return point.x == 120.f; }));
+	CHECK(maxDeviation(in, out) <= 0.75f);
+}
+
+TEST(simplify, streaming_keeps_the_ends_and_stays_within_tolerance) {
+	std::vector<ImVec2> in = wobblyArc(), out;
+	StreamingSimplifier streamer;
+	streamer.begin();
+	for (ImVec2 point : in) {
+		if (streamer.push(point, 0.75f) == StreamAction::ReplaceLast) out.back() = point;
+		else out.push_back(point);
+	}
+	CHECK(out.size() < in.size() / 2);
+	CHECK(out.front().x == in.front().x && out.back().x == in.back().x);
+	CHECK(maxDeviation(in, out) <= 0.75f + 1e-3f);
+}
@@ -0,0 +1,175 @@
+#include "test.h"
+#include "stroke_document.h"
+
+namespace {
+	std::vector<ImVec2> wiggle(uint32_t count, float x) {
+		std::vector<ImVec2> points;
+		for (uint32_t i = 0; i < count; i++) points.push_back({ x + i * 1.5f, std::sin(i * 0.2f) * 30.f });
+		return points;
+	}
+
+	struct Recorder : StrokeListener {
+		void strokeAdded(const StrokeDocument&, const Stroke& stroke) override { added.push_back(stroke.id); }
+		void strokeRemoved(const StrokeDocument&, const Stroke& stroke) override { removed.push_back(stroke.id); }
+		std::vector<StrokeId> added;
+		std::vector<StrokeId> removed;
+	};
+}
+
+TEST(stroke_document, strokes_keep_their_style_bounds_and_order) {
+	StrokeDocument document;
+	std::vector<ImVec2> points = wiggle(40, 10.f);
+	StrokeId first = document.addStroke({ IM_COL32(255, 0, 0, 255), 4.f }, points.data(), 40);
+	StrokeId second = document.addStroke({ IM_COL32(0, 0, 255, 128), 20.f }, points.data(), 10);
+	CHECK(first != INVALID_STROKE && second > first);
+	REQUIRE(document.strokes().size() == 2);
+	CHECK(document.pointCount() == 50);
+
+	const Stroke* stroke = document.find(second);
+	REQUIRE(stroke);
+	CHECK(stroke->style.colour == IM_COL32(0, 0, 255, 128) && stroke->style.thickness == 20.f);
+	CHECK(stroke->count == 10);
+	for (uint32_t i = 0; i < stroke->count; i++) {
+		ImVec2 point = document.pointOf(*stroke, i);
+		CHECK(point.x >= stroke->min.x && point.x <= stroke->max.x && point.y >= stroke->min.y && point.y <= stroke->max.y);
+		CHECK_NEAR(point.x, points[i].x, 1.0 / 16);
+		CHECK_NEAR(point.y, points[i].y, 1.0 / 16);
+	}
+	CHECK(document.lowerIndex(second) == 1 && !document.find(second + 1000));
+}
+
+TEST(stroke_document, drawing_commits_on_end) {
+	StrokeDocument document;
+	Recorder recorder;
+	document.addListener(&recorder);
+	StrokeId id = document.beginStroke({ IM_COL32_WHITE, 2.f });
+	document.appendPoint({ 1.f, 2.f });
+	document.appendPoint({ 3.f, 4.f });
+	document.replaceLastPoint({ 5.f, 6.f });
+	CHECK(document.isDrawing() && document.activeStroke() == id);
+	CHECK(recorder.added.empty());
+	CHECK(document.pointsX()[1] == 5.f && document.pointsY()[1] == 6.f);
+
+	CHECK(document.endStroke() == id);
+	CHECK(!document.isDrawing() && recorder.added == std::vector<StrokeId>{ id });
+	const Stroke* stroke = document.find(id);
+	REQUIRE(stroke && stroke->count == 2);
+	CHECK(document.pointOf(*stroke, 1).x == 5.f && document.pointOf(*stroke, 1).y == 6.f);
+	document.removeListener(&recorder);
+}
+
+TEST(stroke_document, removed_strokes_go_back_exactly_where_they_were) {
+	StrokeDocument document;
+	Recorder recorder;
+	document.addListener(&recorder);
+	std::vector<ImVec2> points = wiggle(100, 0.f);
+	StrokeId a = document.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 100);
+	StrokeId b = document.addStroke({ IM_COL32_WHITE, 3.f }, points.data(), 60);
+	StrokeId c = document.addStroke({ IM_COL32_WHITE, 4.f }, points.data(), 30);
+
+	std::vector<ImVec2> before, after;
+	document.copyPoints(*document.find(b), before);
+	PackedPoints saved;
+	CHECK(document.removeStroke(b, &saved));
+	CHECK(!document.removeStroke(b));
+	CHECK(recorder.removed == std::vector<StrokeId>{ b });
+	CHECK(document.pointCount() == 130);
+	document.compact();
+
+	CHECK(document.insertStroke(b, { IM_COL32_WHITE, 3.f }, saved));
+	CHECK(!document.insertStroke(b, { IM_COL32_WHITE, 3.f }, saved));
+	REQUIRE(document.strokes().size() == 3);
+	CHECK(document.strokes()[0].id == a && document.strokes()[1].id == b && document.strokes()[2].id == c);
+	document.copyPoints(*document.find(b), after);
+	REQUIRE(after.size() == before.size());
+	for (size_t i = 0; i < before.size(); i++) CHECK(after[i].x == before[i].x && after[i].y == before[i].y);
+	document.removeListener(&recorder);
+}
+
+TEST(stroke_document, nothing_is_inserted_over_the_stroke_being_drawn) {
+	StrokeDocument document;
+	std::vector<ImVec2> points = wiggle(20, 0.f);
+	StrokeId below = document.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 20);
+	PackedPoints saved;
+	document.removeStroke(below, &saved);
+	StrokeId active = document.beginStroke({ IM_COL32_BLACK, 4.f });
+	document.appendPoint({ 1.f, 2.f });
+	document.appendPoint({ 3.f, 4.f });
+
+	// Above it, eg. from another client, or below it, eg. undone: either would have to wait for the stroke to end
+	CHECK(!document.insertStroke(active + 1, { IM_COL32_WHITE, 2.f }, points.data(), 20));
+	CHECK(!document.insertStroke(below, { IM_COL32_WHITE, 2.f }, saved));
+	CHECK(document.isDrawing() && document.activeStroke() == active);
+	CHECK(document.strokes().size() == 1 && document.strokes().back().count == 2);
+	CHECK(document.pointsX()[1] == 3.f && document.pointsY()[1] == 4.f);
+
+	CHECK(document.endStroke() == active);
+	CHECK(document.insertStroke(active + 1, { IM_COL32_WHITE, 2.f }, points.data(), 20));
+	CHECK(document.insertStroke(below, { IM_COL32_WHITE, 2.f }, saved));
+	REQUIRE(document.strokes().size() == 3);
+	CHECK(document.strokes()[0].id == below && document.strokes()[1].id == active && document.strokes()[2].id == active + 1);
+}
+
+TEST(stroke_document, compaction_keeps_every_live_point) {
+	StrokeDocument document;
+	std::vector<ImVec2> points = wiggle(250, 0.f);
+	std::vector<StrokeId> ids;
+	for (int i = 0; i < 200; i++) ids.push_back(document.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 250));
+	for (int i = 0; i < 200; i += 2) document.removeStroke(ids[i]);
+	size_t bytes = document.packedBytes();
+	document.compact();
+	CHECK(document.packedBytes() * 2 <= bytes + 16);
+	CHECK(document.pointCount() == 100 * 250);
+
+	std::vector<float> xs, ys;
+	for (const Stroke& stroke : document.strokes()) {
+		document.readPoints(stroke, xs, ys);
+		REQUIRE(xs.size() == 250);
+		CHECK_NEAR(xs[249], points[249].x, 1.0 / 16);
+		CHECK_NEAR(ys[100], points[100].y, 1.0 / 16);
+	}
+}
+
+TEST(stroke_document, client_ids_never_collide) {
+	StrokeDocument host, client;
+	client.setClient(3);
+	std::vector<ImVec2> points = wiggle(5, 0.f);
+	StrokeId fromHost = host.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 5);
+	StrokeId fromClient = client.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 5);
+	CHECK((fromClient & STROKE_CLIENT_MASK) == 3);
+	CHECK(fromHost != fromClient);
+
+	// Seeing a higher id moves the clock past it
+	client.insertStroke(fromClient + 500, { IM_COL32_WHITE, 2.f }, points.data(), 5);
+	StrokeId next = client.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 5);
+	CHECK(next > fromClient + 500 && (next & STROKE_CLIENT_MASK) == 3);
+}
+
+TEST(stroke_document, copies_carry_the_strokes_but_not_the_listeners) {
+	StrokeDocument document;
+	Recorder recorder;
+	document.addListener(&recorder);
+	std::vector<ImVec2> points = wiggle(20, 0.f);
+	document.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 20);
+	StrokeDocument copy = document;
+	copy.addStroke({ IM_COL32_WHITE, 2.f }, points.data(), 20);
+	CHECK(recorder.added.size() == 1);
+	CHECK(copy.strokes().size() == 2 && document.strokes().size() == 1);
+	document.removeListener(&recorder);
+}
+
+TEST(stroke_document, points_past_the_packed_range_clamp_in_order) {
+	// Far enough out on either side that rounding onto the grid hits the limit, the step between them is the widest there is
+	StrokeDocument document;
+	const ImVec2 points[] = { { -1e12f, 5.f }, { 1e12f, -5.f }, { -1e12f, 1e12f }, { 3.f, 4.f } };
+	StrokeId id = document.addStroke({ IM_COL32_WHITE, 2.f }, points, 4);
+	const Stroke* stroke = document.find(id);
+	REQUIRE(stroke);
+
+	std::vector<ImVec2> read;
+	document.copyPoints(*stroke, read);
+	REQUIRE(read.size() == 4);
+	CHECK(read[0].x < 0.f && read[1].x > 0.f && read[0].x == -read[1].x && read[2].x == read[0].x);
+	CHECK(read[2].y == read[1].x);
+	CHECK(read[3].x == 3.f && read[3].y == 4.f);
+}
@@ -0,0 +1,268 @@
+#include "test.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+#include "damage.h"
+#include "layers.h"
+#include "point_codec.h"
+#include "sync_session.h"
+
+namespace {
+	const uint8_t CLIENT_A = 2;
+	const uint8_t CLIENT_B = 3;
+	// Away from DEFAULT_SYNC_PORT, so a board being shared on this machine doesn't get in the way
+	const uint16_t TEST_PORT = DEFAULT_SYNC_PORT + 11;
+	const DrawingSettings SETTINGS{ { 1.f, 0.f, 0.f, 1.f }, 5.f };
+
+	// A stamp or stroke id from a client's Lamport clock at time
+	uint32_t at(uint32_t time, uint8_t client) {
+		return (time << STROKE_CLIENT_BITS) | client;
+	}
+
+	struct Op {
+		SyncOp op;
+		StrokeId id;
+		uint32_t stamp;
+		StrokeStyle style;
+		PackedPoints points;
+	};
+
+	PackedPoints pack(std::vector<ImVec2> points) {
+		PackedPoints packed;
+		packed.count = (uint32_t) points.size();
+		packed.grid = packingGrid(points.data(), packed.count);
+		packPoints(points.data(), packed.count, packed.bytes, packed.grid);
+		return packed;
+	}
+
+	std::vector<ImVec2> line(ImVec2 from, ImVec2 to, int count) {
+		std::vector<ImVec2> points;
+		for (int i = 0; i < count; i++) points.push_back({ from.x + (to.x - from.x) * i / (count - 1), from.y + (to.y - from.y) * i / (count - 1) });
+		return points;
+	}
+
+	void apply(StrokeDocument& document, SharedStrokes& strokes, const Op& op) {
+		if (op.op == SYNC_ADD) strokes.add(document, op.id, op.stamp, op.style, op.points, StrokeShape::Freehand);
+		else if (op.op == SYNC_REMOVE) strokes.remove(document, op.id, op.stamp);
+		else strokes.restyle(document, op.id, op.stamp, op.style);
+	}
+
+	bool sameBoard(const StrokeDocument& a, const StrokeDocument& b) {
+		if (a.strokes().size() != b.strokes().size()) return false;
+		std::vector<ImVec2> pointsA, pointsB;
+		for (size_t i = 0; i < a.strokes().size(); i++) {
+			const Stroke& strokeA = a.strokes()[i];
+			const Stroke& strokeB = b.strokes()[i];
+			if (strokeA.id != strokeB.id || strokeA.style.colour != strokeB.style.colour || strokeA.style.thickness != strokeB.style.thickness) return false;
+			a.copyPoints(strokeA, pointsA);
+			b.copyPoints(strokeB, pointsB);
+			if (pointsA.size() != pointsB.size()) return false;
+			for (size_t p = 0; p < pointsA.size(); p++) {
+				if (pointsA[p].x != pointsB[p].x || pointsA[p].y != pointsB[p].y) return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	* Hosts on TEST_PORT and joins it, the host kept updating on another thread until the joiner is let in
+	*/
+	bool connect(SyncSession& host, SyncSession& joiner) {
+		if (!host.host(TEST_PORT)) return false;
+		std::atomic<bool> joining{ true };
+		std::thread hosting([&] {
+			while (joining) {
+				host.update();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+		bool joined = joiner.join(TEST_PORT, 5.0);
+		joining = false;
+		hosting.join();
+		return joined;
+	}
+
+	/**
+	* Sends from's changes this frame and updates to until they have come in, false if they haven't within a few seconds
+	*/
+	bool exchange(SyncSession& from, SyncSession& to) {
+		size_t received = to.stats().opsReceived;
+		from.update();
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (to.stats().opsReceived == received && std::chrono::steady_clock::now() < deadline) {
+			to.update();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return to.stats().opsReceived > received;
+	}
+}
+
+/**
+* Two clients' ops on the same strokes, including the ones that put an id back after removing it: the pixel eraser
+* keeping the first piece of a stroke it cut, and undoing an erase. Every order they could arrive in gives the same board.
+*/
+TEST(sync, the_same_ops_in_any_order_give_the_same_board) {
+	const StrokeStyle red{ IM_COL32(255, 0, 0, 255), 4.f };
+	const StrokeStyle green{ IM_COL32(0, 255, 0, 255), 4.f };
+	const StrokeStyle blue{ IM_COL32(0, 0, 255, 255), 8.f };
+	const StrokeStyle yellow{ IM_COL32(255, 255, 0, 255), 8.f };
+	const StrokeId first = at(1, CLIENT_A);
+	const StrokeId second = at(2, CLIENT_B);
+	const StrokeId piece = at(5, CLIENT_A);
+	const StrokeId brief = at(6, CLIENT_B);
+
+	const std::vector<Op> ops = {
+		{ SYNC_ADD, first, at(1, CLIENT_A), red, pack(line({ 0.f, 0.f }, { 100.f, 0.f }, 20)) },
+		{ SYNC_ADD, second, at(2, CLIENT_B), blue, pack(line({ 0.f, 50.f }, { 100.f, 50.f }, 20)) },
+		// A cuts the middle out of the first stroke, the first piece keeps its id
+		{ SYNC_REMOVE, first, at(3, CLIENT_A), {}, {} },
+		{ SYNC_ADD, first, at(4, CLIENT_A), red, pack(line({ 0.f, 0.f }, { 40.f, 0.f }, 8)) },
+		{ SYNC_ADD, piece, at(5, CLIENT_A), red, pack(line({ 60.f, 0.f }, { 100.f, 0.f }, 8)) },
+		// B recolours it at the same time, before seeing the cut
+		{ SYNC_RESTYLE, first, at(3, CLIENT_B), green, {} },
+		// B erases the second stroke and undoes that, then A recolours it
+		{ SYNC_REMOVE, second, at(4, CLIENT_B), {}, {} },
+		{ SYNC_ADD, second, at(6, CLIENT_B), blue, pack(line({ 0.f, 50.f }, { 100.f, 50.f }, 20)) },
+		{ SYNC_RESTYLE, second, at(7, CLIENT_A), yellow, {} },
+		// A stroke that is gone again before everyone has it
+		{ SYNC_ADD, brief, at(6, CLIENT_B), blue, pack(line({ 0.f, 90.f }, { 10.f, 90.f }, 4)) },
+		{ SYNC_REMOVE, brief, at(8, CLIENT_A), {}, {} }
+	};
+
+	StrokeDocument expected;
+	SharedStrokes expectedStrokes;
+	for (const Op& op : ops) apply(expected, expectedStrokes, op);
+	REQUIRE(expected.strokes().size() == 3);
+	const Stroke* cut = expected.find(first);
+	REQUIRE(cut);
+	CHECK(cut->count == 8 && cut->style.colour == red.colour);
+	CHECK(expected.find(piece) != nullptr && expected.find(brief) == nullptr);
+	const Stroke* restored = expected.find(second);
+	REQUIRE(restored);
+	CHECK(restored->count == 20 && restored->style.colour == yellow.colour);
+
+	std::vector<size_t> order(ops.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::mt19937 rng(17);
+	bool converged = true;
+	for (int run = 0; run < 2000 && converged; run++) {
+		if (run == 0) std::reverse(order.begin(), order.end());
+		else std::shuffle(order.begin(), order.end(), rng);
+
+		StrokeDocument document;
+		SharedStrokes strokes;
+		for (size_t i : order) apply(document, strokes, ops[i]);
+		converged = sameBoard(expected, document);
+	}
+	CHECK(converged);
+}
+
+TEST(sync, ops_older_than_a_local_change_do_not_undo_it) {
+	StrokeDocument document;
+	SharedStrokes strokes;
+	const StrokeStyle style{ IM_COL32_WHITE, 2.f };
+	std::vector<ImVec2> points = line({ 0.f, 0.f }, { 10.f, 10.f }, 5);
+
+	// Put back here by an undo at time 5, after another client removed it at time 4 and restyled it at 3
+	StrokeId id = at(1, CLIENT_A);
+	REQUIRE(document.insertStroke(id, style, points.data(), 5));
+	strokes.placed(id, at(5, CLIENT_A), true);
+	strokes.styled(id, at(5, CLIENT_A), style);
+	CHECK(!strokes.remove(document, id, at(4, CLIENT_B)));
+	CHECK(!strokes.restyle(document, id, at(3, CLIENT_B), { IM_COL32_BLACK, 9.f }));
+	const Stroke* stroke = document.find(id);
+	REQUIRE(stroke);
+	CHECK(stroke->style.colour == IM_COL32_WHITE);
+
+	// Removed here, an add that was sent before the remove was seen doesn't bring it back
+	document.removeStroke(id);
+	strokes.placed(id, at(6, CLIENT_A), false);
+	CHECK(!strokes.add(document, id, at(5, CLIENT_B), style, pack(points), StrokeShape::Freehand));
+	CHECK(!document.find(id));
+	CHECK(strokes.add(document, id, at(7, CLIENT_B), style, pack(points), StrokeShape::Freehand));
+	CHECK(document.find(id) != nullptr);
+}
+
+/**
+* A stroke added on one client turns up on the other under the same id, and erasing or restyling it there comes back
+*/
+TEST(sync, committed_strokes_reach_the_other_client_and_back) {
+	DamageTracker hostDamage, joinDamage;
+	LayerStack hostLayers(hostDamage, SETTINGS);
+	LayerStack joinLayers(joinDamage, SETTINGS);
+	SyncSession host(hostLayers);
+	SyncSession joiner(joinLayers);
+	REQUIRE(connect(host, joiner));
+	CHECK(host.peerCount() == 1 && joiner.peerCount() == 1);
+	CHECK(joiner.clientId() != host.clientId());
+
+	StrokeDocument& hostDocument = hostLayers.active().document();
+	StrokeDocument& joinDocument = joinLayers.active().document();
+	std::vector<ImVec2> points = line({ 0.f, 50.f }, { 100.f, 70.f }, 10);
+	StrokeId id = hostDocument.addStroke({ IM_COL32_BLACK, 2.f }, points.data(), (uint32_t) points.size());
+	REQUIRE(exchange(host, joiner));
+	const Stroke* arrived = joinDocument.find(id);
+	REQUIRE(arrived);
+	CHECK(arrived->count == points.size() && arrived->style.colour == IM_COL32_BLACK && arrived->style.thickness == 2.f);
+	std::vector<ImVec2> received;
+	joinDocument.copyPoints(*arrived, received);
+	REQUIRE(received.size() == points.size());
+	// Sent packed, so only as close as the packed grid
+	for (size_t i = 0; i < points.size(); i++) {
+		CHECK(std::fabs(received[i].x - points[i].x) <= 0.5f / PACKED_SUBPIXELS && std::fabs(received[i].y - points[i].y) <= 0.5f / PACKED_SUBPIXELS);
+	}
+
+	joinDocument.setStyle(id, { IM_COL32_WHITE, 6.f });
+	REQUIRE(exchange(joiner, host));
+	const Stroke* restyled = hostDocument.find(id);
+	REQUIRE(restyled);
+	CHECK(restyled->style.colour == IM_COL32_WHITE && restyled->style.thickness == 6.f);
+
+	joinDocument.removeStroke(id);
+	REQUIRE(exchange(joiner, host));
+	CHECK(!hostDocument.find(id) && hostDocument.strokes().empty());
+}
+
+/**
+* Another client's stroke arriving on the layer being drawn on waits for the stroke to end, and then goes in under
+* its id without touching the stroke that was being drawn
+*/
+TEST(sync, ops_for_the_layer_being_drawn_on_wait_for_the_stroke) {
+	DamageTracker hostDamage, joinDamage;
+	LayerStack hostLayers(hostDamage, SETTINGS);
+	LayerStack joinLayers(joinDamage, SETTINGS);
+	SyncSession host(hostLayers);
+	SyncSession joiner(joinLayers);
+	REQUIRE(connect(host, joiner));
+
+	StrokeDocument& document = joinLayers.active().document();
+	StrokeId active = document.beginStroke({ IM_COL32_WHITE, 3.f });
+	const std::vector<ImVec2> drawn = line({ 0.f, 0.f }, { 30.f, 30.f }, 4);
+	for (ImVec2 point : drawn) document.appendPoint(point);
+
+	std::vector<ImVec2> points = line({ 0.f, 50.f }, { 100.f, 50.f }, 10);
+	StrokeId remote = hostLayers.active().document().addStroke({ IM_COL32_BLACK, 2.f }, points.data(), (uint32_t) points.size());
+	REQUIRE(exchange(host, joiner));
+
+	// Held back, the stroke being drawn is still the only one and still on top
+	CHECK(document.isDrawing() && document.activeStroke() == active);
+	CHECK(document.strokes().size() == 1 && document.strokes().back().count == drawn.size());
+	CHECK(!document.find(remote));
+
+	document.endStroke();
+	joiner.update();
+	REQUIRE(document.strokes().size() == 2);
+	CHECK(document.strokes()[0].id < document.strokes()[1].id);
+	const Stroke* mine = document.find(active);
+	const Stroke* theirs = document.find(remote);
+	REQUIRE(mine && theirs);
+	CHECK(mine->style.colour == IM_COL32_WHITE && theirs->style.colour == IM_COL32_BLACK && theirs->count == points.size());
+	std::vector<ImVec2> kept;
+	document.copyPoints(*mine, kept);
+	REQUIRE(kept.size() == drawn.size());
+	for (size_t i = 0; i < kept.size(); i++) CHECK(kept[i].x == drawn[i].x && kept[i].y == drawn[i].y);
+}
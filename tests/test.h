@@ -0,0 +1,37 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+* A small test runner for the platform-free core, without pulling in a framework
+* TEST(suite, name) registers a test, CHECK records a failure and carries on, REQUIRE records it and leaves the test
+* wb_tests runs every suite, or only the ones named on the command line
+*/
+struct TestCase {
+	const char* suite;
+	const char* name;
+	void (*run)();
+};
+
+std::vector<TestCase>& testCases();
+void testFailed(const char* file, int line, const char* expression);
+// A file path under the system's temporary directory for this test run, removed with it afterwards
+std::string testPath(const std::string& name);
+
+struct TestRegistration {
+	TestRegistration(const char* suite, const char* name, void (*run)()) { testCases().push_back({ suite, name, run }); }
+};
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static TestRegistration suite##_##name##_registration(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+#define CHECK(condition) do { if (!(condition)) testFailed(__FILE__, __LINE__, #condition); } while (false)
+#define CHECK_NEAR(a, b, tolerance) do { if (!(std::fabs((double) (a) - (double) (b)) <= (tolerance))) testFailed(__FILE__, __LINE__, #a " ~ " #b); } while (false)
+#define REQUIRE(condition) do { if (!(condition)) { testFailed(__FILE__, __LINE__, #condition); return; } } while (false)
+
+#endif // TEST_H
@@ -0,0 +1,57 @@
+#include "test.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+namespace {
+	int failures = 0;
+
+	std::filesystem::path scratchDirectory() {
+		static std::filesystem::path directory = [] {
+			std::filesystem::path path = std::filesystem::temp_directory_path() / ("wb_tests_" + std::to_string(std::random_device()()));
+			std::filesystem::create_directories(path);
+			return path;
+		}();
+		return directory;
+	}
+}
+
+std::vector<TestCase>& testCases() {
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+void testFailed(const char* file, int line, const char* expression) {
+	fprintf(stderr, "  %s:%d: failed %s\n", file, line, expression);
+	failures++;
+}
+
+std::string testPath(const std::string& name) {
+	return (scratchDirectory() / name).string();
+}
+
+/**
+* Runs every test, or those in the suites named on the command line, returns 1 if any of them failed
+*/
+int main(int argc, char** argv) {
+	int ran = 0;
+	int failed = 0;
+	for (const TestCase& test : testCases()) {
+		bool wanted = argc < 2;
+		for (int i = 1; i < argc; i++) wanted = wanted || strcmp(argv[i], test.suite) == 0;
+		if (!wanted) continue;
+
+		int before = failures;
+		test.run();
+		ran++;
+		if (failures != before) failed++;
+		printf("%s %s.%s\n", failures == before ? "[ ok ]" : "[fail]", test.suite, test.name);
+	}
+
+	std::error_code ignored;
+	std::filesystem::remove_all(scratchDirectory(), ignored);
+	printf("%d of %d tests passed\n", ran - failed, ran);
+	return failed == 0 && ran > 0 ? 0 : 1;
+}